@@ -0,0 +1,177 @@
+/*
+*
+*   expression heavy parser benchmark, lexes a generated source once and
+*   then parses it over and over on a fresh arena. Reports produced nodes
+*   per second and arena bytes per node, the bytes include everything the
+*   parser puts on the arena (declaration and argument arrays too)
+*
+*   make bench && ./build/bin/bench_expressions [functions] [iterations]
+*
+*/
+
+#include "../src/arena/arena.h"
+#include "../src/ast/ast.h"
+#include "../src/ast_parser/types.h"
+#include "../src/ast_visitor/visitor.h"
+#include "../src/lexer/lexer.h"
+#include "../src/mythril/types.h"
+#include "../src/tokens/tokens.h"
+#include "../src/utils/types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_FUNCTIONS  2000
+#define BENCH_DEFAULT_ITERATIONS 50
+
+static const char* BENCH_STATEMENTS[] = {
+    "    let a: i32 = x * 3 + y / 2 - (x - y) * (y + 1) % 7;\n",
+    "    let b: i32 = -x + ~y * *p - &q << 2 >> 1;\n",
+    "    let c: bool = a < b && b <= c || !(c > d) && d >= e == f != g;\n",
+    "    let d: i32 = f(a, b + 1, g(c)[2], h.k) + v[i][j] * s.t.u;\n",
+    "    let e: i32 = ((((a + b) * (c + d)) - ((e - f) / (g | h))) ^ (i & j));\n",
+    "    x = y += z -= a * b + f(c, d, e, g, h, i, j, k, l);\n",
+};
+
+#define BENCH_STATEMENT_COUNT (sizeof(BENCH_STATEMENTS) / sizeof(BENCH_STATEMENTS[0]))
+
+static VisitAction count_node(AstVisitor* v, VisitFrame* frame) {
+    (void) frame;
+
+    (*(usize*) v -> user)++;
+
+    return VISIT_CONTINUE;
+}
+
+static char* generate_source(ArenaAllocator* arena, usize functions, usize* len) {
+    usize size = 1;
+
+    for (usize i = 0; i < BENCH_STATEMENT_COUNT; i++) {
+        size += strlen(BENCH_STATEMENTS[i]);
+    }
+
+    size = functions * (size + 64);
+
+    char* source = arena_alloc(arena, size);
+    char* cursor = source;
+
+    for (usize f = 0; f < functions; f++) {
+        cursor += sprintf(cursor, "fn f%zu(x: i32, y: i32): i32 {\n", f);
+
+        for (usize i = 0; i < BENCH_STATEMENT_COUNT; i++) {
+            cursor += sprintf(cursor, "%s", BENCH_STATEMENTS[i]);
+        }
+
+        cursor += sprintf(cursor, "    return a + b;\n}\n");
+    }
+
+    *len = (usize) (cursor - source) + 1;
+
+    return source;
+}
+
+static f64 seconds_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (f64) ts.tv_sec + (f64) ts.tv_nsec * 1e-9;
+}
+
+i32 main(i32 argc, char** argv) {
+    const usize functions = argc > 1 ? strtoull(argv[1], nullptr, 10) : BENCH_DEFAULT_FUNCTIONS;
+    const usize iterations = argc > 2 ? strtoull(argv[2], nullptr, 10) : BENCH_DEFAULT_ITERATIONS;
+
+    ArenaAllocator arena = {0};
+    init_arena(&arena, 1 << 20);
+
+    usize len = 0;
+    char* source = generate_source(&arena, functions, &len);
+
+    char* path = "bench.myth";
+
+    DiagContext diag_ctx = {
+        .arena = &arena,
+        .path = path,
+        .source_buffer = source,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .warning_count = 0,
+        .error_count = 0,
+        .note_count = 0,
+        .stderr_supports_colours = false
+    };
+
+    Tokens tokens = {
+        .items = arena_array(&arena, Token, 64),
+        .count = 0,
+        .capacity = 64
+    };
+
+    Program program = {0};
+
+    MythrilContext ctx = {
+        .arena = &arena,
+        .diag_ctx = &diag_ctx,
+        .tokens = &tokens,
+        .program = &program,
+        .buffer_start = source,
+        .buffer_end = source + len
+    };
+
+    tokenize(&ctx);
+
+    push_end_of_program(&tokens, &arena);
+
+    // every iteration parses onto the same emptied arena
+    ArenaAllocator parse_arena = {0};
+    init_arena(&parse_arena, 1 << 20);
+
+    ctx.arena = &parse_arena;
+    diag_ctx.arena = &parse_arena;
+
+    f64 best = 0.0;
+    f64 total = 0.0;
+    usize bytes = 0;
+
+    for (usize i = 0; i < iterations; i++) {
+        arena_reset(&parse_arena);
+
+        program = (Program) {0};
+
+        const f64 start = seconds_now();
+        parse(&ctx, path, PARSE_NONE);
+        const f64 elapsed = seconds_now() - start;
+
+        total += elapsed;
+        best = i == 0 || elapsed < best ? elapsed : best;
+        bytes = total_usage(&parse_arena);
+    }
+
+    if (diag_ctx.error_count > 0) {
+        fprintf(stderr, "Error: generated source did not parse cleanly\n");
+        return 1;
+    }
+
+    usize nodes = 0;
+
+    AstVisitor visitor;
+    init_visitor(&visitor, &arena, &nodes);
+    visitor_on_all(&visitor, count_node, nullptr);
+    visit_program(&visitor, &program);
+
+    printf("tokens      %zu\n", tokens.count);
+    printf("nodes       %zu\n", nodes);
+    printf("iterations  %zu\n", iterations);
+    printf("best        %.3f ms\n", best * 1e3);
+    printf("mean        %.3f ms\n", total / (f64) iterations * 1e3);
+    printf("nodes/sec   %.2f M\n", (f64) nodes / best * 1e-6);
+    printf("bytes/node  %.1f\n", (f64) bytes / (f64) nodes);
+
+    arena_free(&parse_arena);
+    arena_free(&arena);
+
+    return 0;
+}
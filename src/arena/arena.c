@@ -145,6 +145,35 @@ inline void arena_reset(ArenaAllocator* arena) {
     arena -> end = arena -> start;
 }
 
+ArenaMark arena_mark(const ArenaAllocator* arena) {
+    return (ArenaMark) {
+        .block = arena -> end,
+        .usage = arena -> end ? arena -> end -> usage : 0
+    };
+}
+
+/*
+ *
+ *  blocks after the current one are always empty, so only the marked
+ *  block keeps part of its usage. Memory handed out after the mark is
+ *  reused by the next allocations
+ *
+ */
+void arena_rewind(ArenaAllocator* arena, const ArenaMark mark) {
+    if (UNLIKELY(!mark.block)) {
+        arena_reset(arena);
+        return;
+    }
+
+    mark.block -> usage = mark.usage;
+
+    for (ArenaBlock* block = mark.block -> next; block != NULL; block = block -> next) {
+        block -> usage = 0;
+    }
+
+    arena -> end = mark.block;
+}
+
 void arena_free(ArenaAllocator* arena) {
     ArenaBlock* block = arena -> start;
 
@@ -158,6 +187,34 @@ void arena_free(ArenaAllocator* arena) {
     arena -> end = NULL;
 }
 
+/*
+ *
+ *  what other handed out stays where it is and lives as long as arena
+ *  does. The blocks go first so the ones after arena -> end stay empty
+ *
+ */
+void arena_adopt(ArenaAllocator* arena, ArenaAllocator* other) {
+    if (!other -> start) {
+        return;
+    }
+
+    ArenaBlock* last = other -> start;
+
+    while (last -> next != NULL) {
+        last = last -> next;
+    }
+
+    last -> next = arena -> start;
+    arena -> start = other -> start;
+
+    if (!arena -> end) {
+        arena -> end = other -> end;
+    }
+
+    other -> start = NULL;
+    other -> end = NULL;
+}
+
 size_t total_capacity(const ArenaAllocator* arena) {
     const ArenaBlock* current = arena -> start;
     size_t total = 0;
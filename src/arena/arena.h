@@ -36,6 +36,12 @@ typedef struct {
     size_t default_capacity;
 } ArenaAllocator;
 
+// a position in an arena, everything allocated after it can be dropped
+typedef struct {
+    ArenaBlock* block;
+    size_t usage;
+} ArenaMark;
+
 size_t align_size(size_t size);
 
 void init_arena(ArenaAllocator* arena, size_t default_capacity);
@@ -47,8 +53,14 @@ void* arena_memcpy(void* dest, const void* src, size_t len);
 char* arena_strdup(ArenaAllocator* arena, const char* str);
 
 void arena_reset(ArenaAllocator* arena);
+
+ArenaMark arena_mark(const ArenaAllocator* arena);
+void arena_rewind(ArenaAllocator* arena, ArenaMark mark);
 void arena_free(ArenaAllocator* arena); 
 
+// moves the blocks of other in front of those of arena, other is left empty
+void arena_adopt(ArenaAllocator* arena, ArenaAllocator* other);
+
 size_t total_capacity(const ArenaAllocator* arena);
 size_t total_usage(const ArenaAllocator* arena); 
 
@@ -37,21 +37,6 @@ void* arena_realloc_generic(ArenaAllocator* arena, void* ptr, size_t old_size, s
         current++;
     }
 
-    n = (new_size - old_size) / 8;
-
-    for (size_t i = 0; i < n; i += 8) {
-        new_ptr[i] = 0;
-        new_ptr[i + 1] = 0;
-        new_ptr[i + 2] = 0;
-        new_ptr[i + 3] = 0;
-        new_ptr[i + 4] = 0;
-        new_ptr[i + 5] = 0;
-        new_ptr[i + 6] = 0;
-        new_ptr[i + 7] = 0;
-
-        current += 8;
-    }
-
     while (current < new_size) {
         new_ptr[current++] = 0;
     }
@@ -65,8 +65,19 @@ void* arena_realloc_sse2(ArenaAllocator* arena, void* ptr, const size_t old_size
         copy_size -= 16;
     }
 
+    while (copy_size > 0) {
+        *new_ptr++ = *old_ptr++;
+        copy_size--;
+    }
+
     const __m128i zeros = _mm_setzero_si128();
     size_t zero_size = new_size - old_size;
+
+    while (zero_size > 0 && ((uintptr_t) new_ptr & 15)) {
+        *new_ptr++ = 0;
+        zero_size--;
+    }
+
     while (zero_size >= 64) {
         _mm_store_si128((__m128i*) SSE2_CHUNK(new_ptr, 0), zeros);
         _mm_store_si128((__m128i*) SSE2_CHUNK(new_ptr, 1), zeros);
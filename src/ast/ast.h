@@ -7,11 +7,34 @@
 #include "../ast_parser/types.h"
 #include "../files/types.h"
 #include "../mythril/types.h"
+#include "../trace/types.h"
+#include "../unit/types.h"
+#include "../writer/types.h"
 
-void parse(MythrilContext* ctx, char** file_paths, FileBuffer* buffers, usize file_count);
+/*
+*
+*   parses the token stream of one file into ctx -> program, up to its
+*   TOK_EOP. flags are ParseFlags
+*
+*/
+void parse(MythrilContext* ctx, const char* path, u32 flags);
 
-AstSlice* make_slice_from_token(ArenaAllocator* arena, Token* token);
+/*
+*
+*   parses every unit, same result as parse_unit() on each in order,
+*   diagnostics included and in the same order. Top level declarations
+*   are found through the bracket match table and handed to jobs threads,
+*   each parsing into an arena of its own. Small inputs, unbalanced
+*   brackets or a declaration that does not end where the split expected
+*   fall back to parsing one unit after the other. Returns the arena bytes
+*   the parse took, worker arenas included. trace may be nullptr
+*
+*/
+usize parse_parallel(CompilationUnit** units, usize unit_count, DiagContext* diag_ctx, u32 flags, u32 jobs, Trace* trace);
 
-void print_program(Program* p);
+// by value, nodes embed their slices so nothing is allocated
+AstSlice slice_from_token(const Token* token);
+
+void print_program(Writer* w, ArenaAllocator* arena, Program* p);
 
 #endif // !MYTHRIL_AST_H
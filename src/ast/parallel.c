@@ -0,0 +1,468 @@
+#include "ast.h"
+#include "types.h"
+
+#include "../ast_parser/parser.h"
+#include "../diagnostics/diagnostics.h"
+#include "../trace/trace.h"
+#include "../unit/unit.h"
+#include "../utils/macros.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define PARALLEL_MIN_TOKENS      8192
+#define PARALLEL_RANGES_PER_JOB  4
+#define PARALLEL_MAX_JOBS        64
+#define PARALLEL_ARENA_CAPACITY  (256 * 1024)
+#define RANGE_NODES_INIT_CAPACITY 4
+
+/*
+*
+*   tokens [start, end) of a unit that hold one top level declaration,
+*   end is the next declaration keyword or the TOK_EOF of the unit.
+*   Everything after unit is written by the worker that took the range
+*
+*/
+typedef struct {
+    usize start;
+    usize end;
+    u32 unit;    // index into ParallelParse.units
+    u8 _padding[4];
+
+    AstNode** nodes;
+    usize node_count;
+    usize node_capacity;
+
+    DiagContext* diagnostics; // nullptr when the range parsed cleanly
+    usize stop;               // parser index once the range was done
+} ParseRange;
+
+typedef struct {
+    CompilationUnit** units;
+    usize unit_count;
+    DiagContext* diag_ctx;
+    Trace* trace;
+    u32 flags;
+    u8 _padding[4];
+
+    ParseRange* ranges;
+    usize range_count;
+    usize next; // next range to hand out, taken atomically
+
+    // what the lexer left of --max-errors, 0 is unlimited. Errors of the
+    // finished ranges add up in errors, the ranges after the one that
+    // spends the budget are never needed
+    u32 budget;
+    u32 errors;
+    b8 aborted;
+    u8 _padding2[7];
+} ParallelParse;
+
+typedef struct {
+    ParallelParse* shared;
+
+    ArenaAllocator arena;
+    DiagContext diag_ctx;
+
+    u32 id; // trace thread, 0 is the calling thread
+    u8 _padding[4];
+} ParseWorker;
+
+static void parse_sequential(CompilationUnit** units, usize unit_count, DiagContext* diag_ctx, u32 flags, Trace* trace);
+static usize units_arena_usage(CompilationUnit** units, usize unit_count);
+static usize split_declarations(ParallelParse* pp, ArenaAllocator* arena);
+static b8 split_unit(ParallelParse* pp, ArenaAllocator* arena, u32 unit, usize* capacity);
+static void* parse_worker(void* arg);
+static void parse_range(ParseWorker* worker, ParseRange* range, u32 budget);
+
+usize parse_parallel(CompilationUnit** units, usize unit_count, DiagContext* diag_ctx, u32 flags, u32 jobs, Trace* trace) {
+    const usize usage_before = units_arena_usage(units, unit_count);
+
+    ParallelParse pp = {
+        .units = units,
+        .unit_count = unit_count,
+        .diag_ctx = diag_ctx,
+        .trace = trace,
+        .flags = flags,
+        .ranges = nullptr,
+        .range_count = 0,
+        .next = 0,
+        .budget = diag_ctx -> max_errors > 0 ? diag_ctx -> max_errors - diag_ctx -> error_count : 0,
+        .errors = 0,
+        .aborted = false
+    };
+
+    if (jobs > PARALLEL_MAX_JOBS) {
+        jobs = PARALLEL_MAX_JOBS;
+    }
+
+    usize token_count = 0;
+
+    for (usize i = 0; i < unit_count; i++) {
+        token_count += units[i] -> tokens.count;
+    }
+
+    // the ranges only live until the merge, they go on a scratch arena
+    ArenaAllocator scratch = {0};
+    init_arena(&scratch, PARALLEL_ARENA_CAPACITY);
+
+    // small inputs and unbalanced brackets are not worth splitting, a budget
+    // already spent by the lexer leaves nothing to parse
+    if (
+        jobs < 2                                            ||
+        diag_ctx -> aborted                                 ||
+        token_count < PARALLEL_MIN_TOKENS                   ||
+        split_declarations(&pp, &scratch) == 0              ||
+        pp.range_count < jobs * PARALLEL_RANGES_PER_JOB
+    ) {
+        arena_free(&scratch);
+        parse_sequential(units, unit_count, diag_ctx, flags, trace);
+        return units_arena_usage(units, unit_count) - usage_before;
+    }
+
+    ParseWorker workers[jobs];
+    pthread_t threads[jobs];
+
+    // a worker whose thread failed to start just takes no ranges
+    b8 started[jobs];
+
+    for (u32 i = 0; i < jobs; i++) {
+        workers[i].shared = &pp;
+        workers[i].id = i;
+        init_arena(&workers[i].arena, PARALLEL_ARENA_CAPACITY);
+
+        // the calling thread is worker 0
+        started[i] = i > 0 && pthread_create(&threads[i], nullptr, parse_worker, &workers[i]) == 0;
+    }
+
+    parse_worker(&workers[0]);
+
+    for (u32 i = 1; i < jobs; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], nullptr);
+        }
+    }
+
+    // what the workers allocated is part of the parse, even when it is redone
+    usize worker_usage = 0;
+
+    for (u32 i = 0; i < jobs; i++) {
+        worker_usage += total_usage(&workers[i].arena);
+    }
+
+    // ranges are handed out in order, every one before the budget ran out
+    // was parsed. The range that takes the count over it is where one pass stops
+    usize range_end = pp.range_count;
+    b8 budget_spent = false;
+    u32 errors_before = 0;
+
+    for (usize i = 0; i < pp.range_count && pp.budget > 0; i++) {
+        const u32 errors = pp.ranges[i].diagnostics ? pp.ranges[i].diagnostics -> error_count : 0;
+
+        if (errors_before + errors >= pp.budget) {
+            range_end = i + 1;
+            budget_spent = true;
+            break;
+        }
+
+        errors_before += errors;
+    }
+
+    // a declaration that ran into the next range would have parsed
+    // differently in one pass, redo everything to keep the output identical.
+    // The range that spent the budget stopped early on purpose
+    for (usize i = 0; i < range_end; i++) {
+        if (budget_spent && i + 1 == range_end) {
+            break;
+        }
+
+        if (MEOW_UNLIKELY(pp.ranges[i].stop != pp.ranges[i].end)) {
+            for (u32 j = 0; j < jobs; j++) {
+                arena_free(&workers[j].arena);
+            }
+
+            arena_free(&scratch);
+            parse_sequential(units, unit_count, diag_ctx, flags, trace);
+            return units_arena_usage(units, unit_count) - usage_before + worker_usage;
+        }
+    }
+
+    // parsed on its own the last range had the whole budget, again with
+    // what the ranges before it left it stops where one pass would have
+    if (budget_spent && errors_before > 0) {
+        ParseRange* last = &pp.ranges[range_end - 1];
+
+        last -> node_count = 0;
+        last -> diagnostics = nullptr;
+
+        parse_range(&workers[0], last, pp.budget - errors_before);
+    }
+
+    // source order for both the nodes and the diagnostics
+    usize range = 0;
+
+    for (u32 u = 0; u < unit_count; u++) {
+        CompilationUnit* unit = units[u];
+        Program* program = &unit -> program;
+
+        usize total = 0;
+
+        for (usize i = range; i < range_end && pp.ranges[i].unit == u; i++) {
+            total += pp.ranges[i].node_count;
+        }
+
+        program -> declarations = arena_array(&unit -> arena, AstNode*, total > 0 ? total : 1);
+        program -> capacity = total > 0 ? total : 1;
+        program -> count = 0;
+
+        while (range < range_end && pp.ranges[range].unit == u) {
+            ParseRange* r = &pp.ranges[range++];
+
+            memcpy(program -> declarations + program -> count, r -> nodes, r -> node_count * sizeof(AstNode*));
+            program -> count += r -> node_count;
+
+            if (r -> diagnostics) {
+                diagnostics_append(diag_ctx, r -> diagnostics);
+            }
+        }
+    }
+
+    if (unit_count > 0) {
+        diag_ctx -> path = units[unit_count - 1] -> path;
+        diag_ctx -> source_buffer = units[unit_count - 1] -> buffer.ptr;
+    }
+
+    // the nodes and the text of the diagnostics live as long as the units,
+    // the first one is freed or kept warm with the rest
+    for (u32 i = 0; i < jobs; i++) {
+        arena_adopt(&units[0] -> arena, &workers[i].arena);
+    }
+
+    arena_free(&scratch);
+
+    // the worker arenas are counted with the first unit now
+    return units_arena_usage(units, unit_count) - usage_before;
+}
+
+static void parse_sequential(CompilationUnit** units, usize unit_count, DiagContext* diag_ctx, u32 flags, Trace* trace) {
+    for (usize i = 0; i < unit_count; i++) {
+        // units after a spent budget keep an empty program
+        if (diag_ctx -> aborted) {
+            units[i] -> program = (Program) {0};
+            continue;
+        }
+
+        const u64 start = trace_start(trace);
+
+        parse_unit(units[i], diag_ctx, flags);
+
+        trace_span(trace, "parse unit", units[i] -> path, 0, start);
+    }
+}
+
+static usize units_arena_usage(CompilationUnit** units, usize unit_count) {
+    usize usage = 0;
+
+    for (usize i = 0; i < unit_count; i++) {
+        usage += total_usage(&units[i] -> arena);
+    }
+
+    return usage;
+}
+
+/*
+*
+*   walks the top level only, every bracket group is jumped over through
+*   the match table so bodies cost nothing. Returns 0 if a bracket is
+*   unbalanced, the split points could not be trusted then
+*
+*/
+static usize split_declarations(ParallelParse* pp, ArenaAllocator* arena) {
+    usize capacity = 64;
+    pp -> ranges = arena_array(arena, ParseRange, capacity);
+    pp -> range_count = 0;
+
+    for (u32 u = 0; u < pp -> unit_count; u++) {
+        if (!split_unit(pp, arena, u, &capacity)) {
+            return 0;
+        }
+    }
+
+    return pp -> range_count;
+}
+
+// appends the ranges of one unit, false if its brackets are unbalanced
+static b8 split_unit(ParallelParse* pp, ArenaAllocator* arena, u32 unit, usize* capacity) {
+    const Tokens* tokens = &pp -> units[unit] -> tokens;
+
+    ParseRange* ranges = pp -> ranges;
+    usize count = pp -> range_count;
+    usize start = 0;
+
+    for (usize i = 0; i < tokens -> count;) {
+        const TokenKind kind = tokens -> items[i].kind;
+
+        const b8 boundary = kind == TOK_EOF || kind == TOK_EOP || (is_top_level_decl_start(kind) && i != start);
+
+        if (boundary && i > start) {
+            if (count >= *capacity) {
+                ranges = arena_realloc(arena, ranges, *capacity * sizeof(ParseRange), *capacity * 2 * sizeof(ParseRange));
+                *capacity *= 2;
+            }
+
+            ranges[count++] = (ParseRange) {
+                .start = start,
+                .end = i,
+                .unit = unit,
+                .nodes = nullptr,
+                .node_count = 0,
+                .node_capacity = 0,
+                .diagnostics = nullptr,
+                .stop = 0
+            };
+
+            start = i;
+        }
+
+        if (kind == TOK_EOP) {
+            break;
+        }
+
+        // a NUL inside the file, the next range starts after it
+        if (kind == TOK_EOF) {
+            start = ++i;
+            continue;
+        }
+
+        switch (kind) {
+            case TOK_LEFT_PAREN:
+            case TOK_LEFT_SQUARE:
+            case TOK_LEFT_BRACE: {
+                const u32 match = tokens -> matches[i];
+
+                if (match == TOKEN_UNMATCHED) {
+                    return false;
+                }
+
+                i = match + 1;
+            } break;
+
+            case TOK_RIGHT_PAREN:
+            case TOK_RIGHT_SQUARE:
+            case TOK_RIGHT_BRACE: {
+                // a closer at the top level has no opener
+                return false;
+            }
+
+            default: {
+                i++;
+            } break;
+        }
+    }
+
+    pp -> ranges = ranges;
+    pp -> range_count = count;
+
+    return true;
+}
+
+static void* parse_worker(void* arg) {
+    ParseWorker* worker = arg;
+    ParallelParse* pp = worker -> shared;
+
+    const u64 start = trace_start(pp -> trace);
+
+    while (!__atomic_load_n(&pp -> aborted, __ATOMIC_RELAXED)) {
+        const usize index = __atomic_fetch_add(&pp -> next, 1, __ATOMIC_RELAXED);
+
+        if (index >= pp -> range_count) {
+            break;
+        }
+
+        ParseRange* range = &pp -> ranges[index];
+
+        parse_range(worker, range, pp -> budget);
+
+        if (pp -> budget > 0 && range -> diagnostics) {
+            const u32 errors = __atomic_add_fetch(&pp -> errors, range -> diagnostics -> error_count, __ATOMIC_RELAXED);
+
+            if (errors >= pp -> budget) {
+                __atomic_store_n(&pp -> aborted, true, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    trace_span(pp -> trace, "parse worker", nullptr, worker -> id, start);
+
+    return nullptr;
+}
+
+static void parse_range(ParseWorker* worker, ParseRange* range, u32 budget) {
+    ParallelParse* pp = worker -> shared;
+
+    CompilationUnit* unit = pp -> units[range -> unit];
+
+    worker -> diag_ctx = (DiagContext) {
+        .arena = &worker -> arena,
+        .path = unit -> path,
+        .source_buffer = unit -> buffer.ptr,
+        .units = pp -> diag_ctx -> units,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .warning_count = 0,
+        .error_count = 0,
+        .note_count = 0,
+        .max_errors = budget,
+        .unit_count = pp -> diag_ctx -> unit_count,
+        .stderr_supports_colours = pp -> diag_ctx -> stderr_supports_colours,
+        .aborted = false
+    };
+
+    // the tokens are shared read only, everything else is the workers own
+    MythrilContext ctx = unit_context(unit, &worker -> diag_ctx);
+    ctx.arena = &worker -> arena;
+
+    Parser parser = {
+        .arena = &worker -> arena,
+        .tokens = &unit -> tokens,
+        .program = &unit -> program,
+        .items = unit -> tokens.items,
+        .path = unit -> path,
+        .index = range -> start,
+        .count = unit -> tokens.count,
+        .flags = pp -> flags
+    };
+
+    range -> node_capacity = RANGE_NODES_INIT_CAPACITY;
+    range -> nodes = arena_array(&worker -> arena, AstNode*, RANGE_NODES_INIT_CAPACITY);
+
+    while (parser.index < range -> end) {
+        if (PARSE_ABORTED(&ctx)) {
+            __atomic_store_n(&pp -> aborted, true, __ATOMIC_RELAXED);
+            break;
+        }
+
+        AstNode* node = parse_top_level_decl(&ctx, &parser);
+
+        if (!node) {
+            continue;
+        }
+
+        if (range -> node_count >= range -> node_capacity) {
+            usize size = range -> node_capacity * sizeof(AstNode*);
+
+            range -> nodes = arena_realloc(&worker -> arena, range -> nodes, size, size * 2);
+            range -> node_capacity *= 2;
+        }
+
+        range -> nodes[range -> node_count++] = node;
+    }
+
+    range -> stop = parser.index;
+
+    if (worker -> diag_ctx.error_count + worker -> diag_ctx.warning_count + worker -> diag_ctx.note_count > 0) {
+        range -> diagnostics = arena_alloc(&worker -> arena, sizeof(DiagContext));
+        *range -> diagnostics = worker -> diag_ctx;
+    }
+}
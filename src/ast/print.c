@@ -1,63 +1,78 @@
-#include <stdio.h>
-
 #include "ast.h"
 #include "types.h"
 
-static void print_node(AstNode* node, int indent);
-static void print_type(AstType* type);
-static void print_slice(AstSlice slice);
-static void print_indent(int level);
+#include "../ast_visitor/visitor.h"
+#include "../writer/writer.h"
 
-static void print_indent(int level) {
-    for (int i = 0; i < level; i++) {
-        printf("  ");
-    }
+typedef struct {
+    Writer* writer;
+
+    // next enum variant to print, variants without a value
+    // are not visited and get printed in between the others
+    usize next_variant;
+} PrintState;
+
+static VisitAction print_pre(AstVisitor* v, VisitFrame* frame);
+static VisitAction print_post(AstVisitor* v, VisitFrame* frame);
+static void print_type(Writer* w, AstType* type);
+static void print_slice(Writer* w, AstSlice slice);
+static void print_indent(Writer* w, int level);
+
+static void print_indent(Writer* w, int level) {
+    writer_repeat(w, ' ', level * 2);
 }
 
-static void print_slice(AstSlice slice) {
-    printf("%.*s", (int)slice.len, slice.ptr);
+static void print_slice(Writer* w, AstSlice slice) {
+    writer_write(w, slice.ptr, slice.len);
 }
 
-static void print_type(AstType* type) {
+static void print_type(Writer* w, AstType* type) {
     if (!type) {
-        printf("<no-type>");
+        writer_str(w, "<no-type>");
         return;
     }
 
     if (type -> is_mutable) {
-        printf("MUTABLE ");
+        writer_str(w, "MUTABLE ");
     }
 
     if (type -> is_ref) {
-        printf("REF ");
+        writer_str(w, "REF ");
     }
     
     switch (type->kind) {
         case TYPE_BASIC:
-            print_slice(type->identifier);
+            print_slice(w, type->identifier);
             break;
         case TYPE_POINTER:
-            print_type(type->pointee);
-            printf("*");
-            break;
-        case TYPE_ARRAY:
-            print_type(type->array.element_type);
-            printf("[");
-            if (type->array.size_expr) {
-                print_node(type->array.size_expr, 0);
-            }
-            printf("]");
+            print_type(w, type->pointee);
+            writer_str(w, "*");
             break;
+        case TYPE_ARRAY: {
+            // the size expression itself is visited as a child node
+            AstNode* size = type->array.size_expr;
+
+            print_type(w, type->array.element_type);
+            writer_str(w, "[");
+            if (size && size->kind == AST_LITERAL) {
+                print_slice(w, size->literal.value);
+            } else if (size && size->kind == AST_IDENTIFIER) {
+                print_slice(w, size->identifier.value);
+            } else if (size) {
+                writer_str(w, "...");
+            }
+            writer_str(w, "]");
+        } break;
         case TYPE_ERR:
-            printf("<error-type>");
+            writer_str(w, "<error-type>");
             break;
     }
 }
 
-static void print_path(AstSlice* segments, usize count) {
+static void print_path(Writer* w, AstSlice* segments, usize count) {
     for (usize i = 0; i < count; i++) {
-        print_slice(segments[i]);
-        if (i < count - 1) printf("::");
+        print_slice(w, segments[i]);
+        if (i < count - 1) writer_str(w, "::");
     }
 }
 
@@ -102,368 +117,352 @@ static const char* token_to_op_string(TokenKind kind) {
     }
 }
 
-static void print_node(AstNode* node, int indent) {
-    if (!node) return;
-    
-    print_indent(indent);
+
+static void print_enum_variants(Writer* w, AstEnumDecl* decl, usize until, int indent, PrintState* state) {
+    for (; state->next_variant < until; state->next_variant++) {
+        AstEnumVariant* variant = decl->variants[state->next_variant];
+
+        if (variant->value) {
+            continue;
+        }
+
+        print_indent(w, indent);
+        print_slice(w, variant->identifier);
+        writer_str(w, "\n");
+    }
+}
+
+static VisitAction print_pre(AstVisitor* v, VisitFrame* frame) {
+    PrintState* state = v->user;
+    Writer* w = state->writer;
+
+    AstNode* node = frame->node;
+    AstNode* parent = frame->parent;
+    int indent = frame->depth;
+
+    if (parent && parent->kind == AST_ENUM_DECL) {
+        print_enum_variants(w, &parent->enum_decl, frame->slot, indent, state);
+        print_indent(w, indent);
+        print_slice(w, parent->enum_decl.variants[frame->slot]->identifier);
+        writer_str(w, " = ");
+        state->next_variant = frame->slot + 1;
+    } else if (parent && parent->kind == AST_IF_STMT && parent->if_stmt.else_stmt == node) {
+        print_indent(w, indent - 1);
+        writer_str(w, "ELSE\n");
+        print_indent(w, indent);
+    } else {
+        print_indent(w, indent);
+    }
     
     switch (node->kind) {
         case AST_MODULE_DECL: {
-            printf("MODULE ");
-            print_path(node->module_decl.segments, node->module_decl.count);
-            printf("\n");
+            writer_str(w, "MODULE ");
+            print_path(w, node->module_decl.segments, node->module_decl.count);
+            writer_str(w, "\n");
             break;
         }
         
         case AST_IMPORT_DECL: {
-            printf("IMPORT ");
-            print_path(node->import_decl.segments, node->import_decl.count);
-            printf("\n");
+            writer_str(w, "IMPORT ");
+            print_path(w, node->import_decl.segments, node->import_decl.count);
+            writer_str(w, "\n");
             break;
         }
         
         case AST_STRUCT_DECL: {
-            printf("STRUCT ");
-            print_slice(node->struct_decl.identifier);
-            printf(" {\n");
+            writer_str(w, "STRUCT ");
+            print_slice(w, node->struct_decl.identifier);
+            writer_str(w, " {\n");
             for (usize i = 0; i < node->struct_decl.count; i++) {
-                print_indent(indent + 1);
-                print_slice(node->struct_decl.fields[i]->identifier);
-                printf(": ");
-                print_type(node->struct_decl.fields[i]->type);
-                printf("\n");
+                print_indent(w, indent + 1);
+                print_slice(w, node->struct_decl.fields[i]->identifier);
+                writer_str(w, ": ");
+                print_type(w, node->struct_decl.fields[i]->type);
+                writer_str(w, "\n");
+            }
+            break;
+        }
+
+        case AST_UNION_DECL: {
+            writer_str(w, "UNION ");
+            print_slice(w, node->union_decl.identifier);
+            writer_str(w, " {\n");
+            for (usize i = 0; i < node->union_decl.count; i++) {
+                print_indent(w, indent + 1);
+                print_slice(w, node->union_decl.variants[i]->identifier);
+                writer_str(w, ": ");
+                print_type(w, node->union_decl.variants[i]->type);
+                writer_str(w, "\n");
             }
-            print_indent(indent);
-            printf("}\n");
             break;
         }
         
         case AST_ENUM_DECL: {
-            printf("ENUM ");
-            print_slice(node->enum_decl.identifier);
-            printf(" {\n");
-            for (usize i = 0; i < node->enum_decl.count; i++) {
-                print_indent(indent + 1);
-                print_slice(node->enum_decl.variants[i]->identifier);
-                if (node->enum_decl.variants[i]->value) {
-                    printf(" = (\n");
-                    print_node(node->enum_decl.variants[i]->value, indent+2);
-                    print_indent(indent + 1);
-                    printf(")");
-                }
-                printf("\n");
+            writer_str(w, "ENUM ");
+            print_slice(w, node->enum_decl.identifier);
+            if (node->enum_decl.type.ptr) {
+                writer_str(w, ": ");
+                print_slice(w, node->enum_decl.type);
             }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, " {\n");
+            state->next_variant = 0;
             break;
         }
         
         case AST_IMPL_DECL: {
-            printf("IMPL ");
-            print_slice(node->impl_decl.target);
-            printf(" {\n");
-            for (usize i = 0; i < node->impl_decl.fn_count; i++) {
-                print_node(node->impl_decl.functions[i], indent + 1);
-            }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, "IMPL ");
+            print_slice(w, node->impl_decl.target);
+            writer_str(w, " {\n");
             break;
         }
         
         case AST_FUNCTION_DECL: {
-            printf("FN ");
-            print_slice(node->function_decl.identifier);
-            printf("(");
+            writer_str(w, "FN ");
+            print_slice(w, node->function_decl.identifier);
+            writer_str(w, "(");
             for (usize i = 0; i < node->function_decl.param_count; i++) {
-                print_slice(node->function_decl.parameters[i].identifier);
-                printf(": ");
-                print_type(node->function_decl.parameters[i].type);
-                if (i < node->function_decl.param_count - 1) printf(", ");
+                print_slice(w, node->function_decl.parameters[i].identifier);
+                writer_str(w, ": ");
+                print_type(w, node->function_decl.parameters[i].type);
+                if (i < node->function_decl.param_count - 1) writer_str(w, ", ");
             }
-            printf("): ");
-            print_type(node->function_decl.return_type);
-            printf(" {\n");
-            for (usize i = 0; i < node->function_decl.stmt_count; i++) {
-                print_node(node->function_decl.statements[i], indent + 1);
+            writer_str(w, "): ");
+            print_type(w, node->function_decl.return_type);
+            writer_str(w, " {\n");
+            if (node->function_decl.lazy_body) {
+                print_indent(w, indent + 1);
+                writer_str(w, "...\n");
             }
-            print_indent(indent);
-            printf("}\n");
             break;
         }
         
         case AST_STATIC_DECL: {
-            printf("STATIC ");
-            print_slice(node->static_decl.identifier);
-            printf(": ");
-            print_type(node->static_decl.type);
-            if (node->static_decl.value) {
-                printf(" = ");
-                print_node(node->static_decl.value, 0);
-            }
-            printf("\n");
+            writer_str(w, "STATIC ");
+            print_slice(w, node->static_decl.identifier);
+            writer_str(w, ": ");
+            print_type(w, node->static_decl.type);
+            writer_str(w, node->static_decl.value ? " =\n" : "\n");
             break;
         }
         
         case AST_CONST_DECL: {
-            printf("CONST ");
-            print_slice(node->const_decl.identifier);
-            printf(": ");
-            print_type(node->const_decl.type);
-            printf(" = ");
-            print_node(node->const_decl.value, 0);
-            printf("\n");
+            writer_str(w, "CONST ");
+            print_slice(w, node->const_decl.identifier);
+            writer_str(w, ": ");
+            print_type(w, node->const_decl.type);
+            writer_str(w, " =\n");
             break;
         }
         
         case AST_VAR_DECL: {
-            printf("VAR ");
+            writer_str(w, "VAR ");
             if (node->var_decl.is_mutable) {
-                printf("mutable ");
-            }
-            print_slice(node->var_decl.identifier);
-            printf(": ");
-            print_type(node->var_decl.type);
-            if (node->var_decl.value) {
-                printf(" = ");
-                print_node(node->var_decl.value, 0);
-                printf("\n");
-            } else {
-                printf("\n");
+                writer_str(w, "mutable ");
             }
+            print_slice(w, node->var_decl.identifier);
+            writer_str(w, ": ");
+            print_type(w, node->var_decl.type);
+            writer_str(w, node->var_decl.value ? " =\n" : "\n");
             break;
         }
         
         case AST_ASSIGNMENT: {
-            printf("ASSIGN ");
-            print_node(node->assignment.lvalue, 0);
-            printf(" %s ", token_to_op_string(node->assignment.op));
-            print_node(node->assignment.rvalue, 0);
-            printf("\n");
+            writer_str(w, "ASSIGN(");
+            writer_str(w, token_to_op_string(node->assignment.op));
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_IF_STMT: {
-            printf("IF ");
-            print_node(node->if_stmt.expression, 0);
-            printf(" {\n");
-            for (usize i = 0; i < node->if_stmt.stmt_count; i++) {
-                print_node(node->if_stmt.statements[i], indent + 1);
-            }
-            print_indent(indent);
-            printf("}");
-            if (node->if_stmt.else_stmt) {
-                printf(" ELSE ");
-                if (node->if_stmt.else_stmt->kind == AST_IF_STMT) {
-                    printf("\n");
-                    print_node(node->if_stmt.else_stmt, indent);
-                } else {
-                    printf("{\n");
-                    print_node(node->if_stmt.else_stmt, indent + 1);
-                    print_indent(indent);
-                    printf("}\n");
-                }
-            } else {
-                printf("\n");
-            }
+            writer_str(w, "IF\n");
             break;
         }
         
         case AST_MATCH_STMT: {
-            printf("MATCH ");
-            print_node(node->match_stmt.expression, 0);
-            printf(" {\n");
-            for (usize i = 0; i < node->match_stmt.arm_count; i++) {
-                print_indent(indent + 1);
-                print_node(node->match_stmt.arms[i].pattern, 0);
-                printf(": {\n");
-                for (usize j = 0; j < node->match_stmt.arms[i].stmt_count; j++) {
-                    print_node(node->match_stmt.arms[i].statements[j], indent + 2);
-                }
-                print_indent(indent + 1);
-                printf("}\n");
-            }
-            if (node->match_stmt.stmt_count > 0) {
-                print_indent(indent + 1);
-                printf("_: {\n");
-                for (usize i = 0; i < node->match_stmt.stmt_count; i++) {
-                    print_node(node->match_stmt.statements[i], indent + 2);
-                }
-                print_indent(indent + 1);
-                printf("}\n");
-            }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, "MATCH\n");
             break;
         }
         
         case AST_LOOP_STMT: {
-            printf("LOOP {\n");
-            for (usize i = 0; i < node->loop_stmt.stmt_count; i++) {
-                print_node(node->loop_stmt.statements[i], indent + 1);
-            }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, "LOOP\n");
             break;
         }
         
         case AST_WHILE_STMT: {
-            printf("WHILE ");
-            print_node(node->while_stmt.cond, 0);
-            printf(" {\n");
-            for (usize i = 0; i < node->while_stmt.stmt_count; i++) {
-                print_node(node->while_stmt.statements[i], indent + 1);
-            }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, "WHILE\n");
             break;
         }
         
         case AST_FOR_STMT: {
-            printf("FOR ");
-            print_node(node->for_stmt.init, 0);
-            printf("; ");
-            print_node(node->for_stmt.cond, 0);
-            printf("; ");
-            print_node(node->for_stmt.step, 0);
-            printf(" {\n");
-            for (usize i = 0; i < node->for_stmt.stmt_count; i++) {
-                print_node(node->for_stmt.statements[i], indent + 1);
-            }
-            print_indent(indent);
-            printf("}\n");
+            writer_str(w, "FOR\n");
             break;
         }
         
         case AST_BREAK_STMT: {
-            printf("BREAK\n");
+            writer_str(w, "BREAK\n");
             break;
         }
         
         case AST_CONTINUE_STMT: {
-            printf("CONTINUE\n");
+            writer_str(w, "CONTINUE\n");
             break;
         }
         
         case AST_RETURN_STMT: {
-            printf("RETURN");
-            if (node->return_stmt.expression) {
-                printf(" ");
-                print_node(node->return_stmt.expression, 0);
-                printf("\n");
-                print_node(node->return_stmt.expression, indent + 1);
-            } else {
-                printf("\n");
-            }
+            writer_str(w, "RETURN\n");
             break;
         }
         
         case AST_EXPR_STMT: {
-            print_node(node->expr_stmt.expression, indent);
+            writer_str(w, "EXPR\n");
             break;
         }
         
         case AST_UNARY: {
-            printf("Unary(%s)\n", token_to_op_string(node->unary.op));
-            print_node(node->unary.operand, indent + 1);
+            writer_str(w, "Unary(");
+            writer_str(w, token_to_op_string(node->unary.op));
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_BINARY: {
-            printf("Binary(%s)\n", token_to_op_string(node->binary.op));
-            print_node(node->binary.left, indent + 1);
-            print_node(node->binary.right, indent + 1);
+            writer_str(w, "Binary(");
+            writer_str(w, token_to_op_string(node->binary.op));
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_FUNCTION_CALL: {
-            printf("Call(");
-            print_slice(node->function_call.identifier);
-            printf(")\n");
-            for (usize i = 0; i < node->function_call.arg_count; i++) {
-                print_node(node->function_call.arguments[i], indent + 1);
+            // a callee that is not a name is printed as the first child
+            if (node->function_call.callee) {
+                writer_str(w, "Call\n");
+                break;
             }
+
+            writer_str(w, "Call(");
+            print_slice(w, node->function_call.identifier);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_ARRAY_INDEX: {
-            printf("ArrayIndex\n");
-            print_node(node->array_index.array, indent + 1);
-            print_node(node->array_index.index, indent + 1);
+            writer_str(w, "ArrayIndex\n");
             break;
         }
         
         case AST_MEMBER_ACCESS: {
-            printf("Member(%s", token_to_op_string(node->member_access.op));
-            print_slice(node->member_access.member);
-            printf(")\n");
-            print_node(node->member_access.object, indent + 1);
+            writer_str(w, "Member(");
+            writer_str(w, token_to_op_string(node->member_access.op));
+            print_slice(w, node->member_access.member);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_IDENTIFIER: {
-            printf("Identifier(");
-            print_slice(node->identifier.value);
-            printf(")\n");
+            writer_str(w, "Identifier(");
+            print_slice(w, node->identifier.value);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_LITERAL: {
-            printf("Literal(");
-            print_slice(node->literal.value);
-            printf(")\n");
+            writer_str(w, "Literal(");
+            print_slice(w, node->literal.value);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_PATTERN_IDENT: {
-            print_slice(node->pattern_ident.identifier);
+            writer_str(w, "Pattern(");
+            print_slice(w, node->pattern_ident.identifier);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_PATTERN_LITERAL: {
-            print_slice(node->pattern_literal.literal.value);
+            writer_str(w, "Pattern(");
+            print_slice(w, node->pattern_literal.literal.value);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_PATTERN_VARIANT: {
-            print_slice(node->pattern_variant.variant);
-            if (node->pattern_variant.count > 0) {
-                printf("(");
-                for (usize i = 0; i < node->pattern_variant.count; i++) {
-                    print_node(node->pattern_variant.patterns[i], 0);
-                    if (i < node->pattern_variant.count - 1) printf(", ");
-                }
-                printf(")");
-            }
+            writer_str(w, "PatternVariant(");
+            print_slice(w, node->pattern_variant.variant);
+            writer_str(w, ")\n");
             break;
         }
         
         case AST_PATTERN_WILDCARD: {
-            printf("_");
+            writer_str(w, "Pattern(_)\n");
             break;
         }
         
         case AST_ERROR: {
-            printf("<ERROR>\n");
+            writer_str(w, "<ERROR>\n");
+            break;
+        }
+
+        case AST_KIND_COUNT: {
             break;
         }
     }
+
+    return VISIT_CONTINUE;
 }
 
-void print_program(Program* program) {
+static VisitAction print_post(AstVisitor* v, VisitFrame* frame) {
+    PrintState* state = v->user;
+    Writer* w = state->writer;
+
+    AstNode* node = frame->node;
+    int indent = frame->depth;
+
+    switch (node->kind) {
+        case AST_ENUM_DECL: {
+            print_enum_variants(w, &node->enum_decl, node->enum_decl.count, indent + 1, state);
+            print_indent(w, indent);
+            writer_str(w, "}\n");
+        } break;
+
+        case AST_STRUCT_DECL:
+        case AST_UNION_DECL:
+        case AST_IMPL_DECL:
+        case AST_FUNCTION_DECL: {
+            print_indent(w, indent);
+            writer_str(w, "}\n");
+        } break;
+
+        default: {
+        } break;
+    }
+
+    // blank line between top level declarations
+    if (frame->depth == 0) {
+        writer_str(w, "\n");
+    }
+
+    return VISIT_CONTINUE;
+}
+
+void print_program(Writer* w, ArenaAllocator* arena, Program* program) {
     if (!program) {
-        printf("NULL program\n");
+        writer_str(w, "NULL program\n");
         return;
     }
 
-    printf("[AST Start]\n\n");
-    
-    for (usize i = 0; i < program->count; i++) {
-        print_node(program->declarations[i], 0);
+    PrintState state = {
+        .writer = w,
+        .next_variant = 0
+    };
 
-        if (i < program->count - 1) {
-            printf("\n");
-        }
-    }
+    AstVisitor visitor;
+    init_visitor(&visitor, arena, &state);
+    visitor_on_all(&visitor, print_pre, print_post);
+
+    writer_str(w, "[AST Start]\n\n");
+
+    visit_program(&visitor, program);
 
-    printf("\n[AST End]\n");
+    writer_str(w, "[AST End]\n");
 }
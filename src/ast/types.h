@@ -45,7 +45,9 @@
     X(AST_PATTERN_VARIANT)  \
     X(AST_PATTERN_WILDCARD) \
                             \
-    X(AST_ERROR) /* set node to error if error is present*/
+    X(AST_ERROR) /* set node to error if error is present*/ \
+                            \
+    X(AST_KIND_COUNT)
 
 typedef enum {
     X_AST(GENERATE_ENUM)
@@ -175,6 +177,11 @@ typedef struct {
     AstNode** statements;
     usize stmt_capacity;
     usize stmt_count;
+
+    // token range of a body --outline skipped, statements stay empty
+    usize body_start;
+    usize body_end;
+    bool lazy_body;
 } AstFunctionDecl;
 
 typedef struct {
@@ -296,7 +303,13 @@ typedef struct {
 } AstBinary;
 
 typedef struct {
+    // the name called, empty when callee is set
     AstSlice identifier;
+
+    // anything else that is called, x.foo(1), f(1)(2) or (g)(1).
+    // nullptr for a plain name
+    AstNode* callee;
+
     AstNode** arguments;
     usize arg_capacity;
     usize arg_count;
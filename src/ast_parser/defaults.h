@@ -18,4 +18,7 @@
 
 #define STMTS_INIT_CAPACITY         32
 
+// nested expressions and blocks, the parser recurses once per level
+#define PARSER_MAX_DEPTH            1024
+
 #endif // !MYTHRIL_AST_PARSER_DEFAULTS_H
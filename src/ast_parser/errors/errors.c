@@ -2,95 +2,105 @@
 
 #include "../../diagnostics/diagnostics.h"
 
+// the TOK_EOP sentinels have no text, the TOK_EOF before them does
+static Token* located(Parser* p, Token* token) {
+    while (token -> kind == TOK_EOP && token > p -> items) {
+        token--;
+    }
+
+    return token;
+}
+
+/*
+*
+*   only the first error of a region is reported, the rest are follow-ons
+*   of the same mistake and are dropped before any text is looked at.
+*   Never while speculating, an attempt is told to have failed by the
+*   errors it reports and a rollback puts the flag back anyway
+*
+*/
+static b8 follow_on(Parser* p) {
+    const b8 suppressed = p -> poisoned && p -> speculating == 0;
+
+    p -> poisoned = true;
+
+    return suppressed;
+}
+
 void error_at_current(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
-    SourceLocation location = source_location_from_token(
-        p -> path,
-        ctx -> buffer_start,
-        parser_peek(p)
-    );
+    if (follow_on(p)) {
+        return;
+    }
 
-    diag_error_help(ctx -> diag_ctx, location, msg, help);
+    diag_error_help(ctx -> diag_ctx, located(p, parser_peek(p)), msg, help);
 }
 
 void error_at_previous(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
-    SourceLocation location = source_location_from_token(
-        p -> path,
-        ctx -> buffer_start,
-        parser_peek_previous(p)
-    );
+    if (follow_on(p)) {
+        return;
+    }
 
-    diag_error_help(ctx -> diag_ctx, location, msg, help);
+    diag_error_help(ctx -> diag_ctx, located(p, parser_peek_previous(p)), msg, help);
 }
 
-void error_at_previous_end(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
-    Token* token = parser_peek_previous(p);
-
-    const char* ptr_copy = token -> lexeme;
-    const u32 len_copy = token -> length;
+/*
+*
+*   the helpers below point at text around a token, they work on a copy
+*   since the token array is shared between parser threads
+*
+*/
 
-    token -> lexeme += token -> length;
-    token -> length = 1;
+void error_at_previous_end(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
+    if (follow_on(p)) {
+        return;
+    }
 
-    SourceLocation location = source_location_from_token(
-        p -> path,
-        ctx -> buffer_start,
-        token
-    );
+    Token token = *located(p, parser_peek_previous(p));
 
-    diag_error_help(ctx -> diag_ctx, location, msg, help);
+    token.lexeme += token.length;
+    token.length = 1;
 
-    token -> lexeme = ptr_copy;
-    token -> length = len_copy;
+    diag_error_help(ctx -> diag_ctx, &token, msg, help);
 }
 
 void error_till_end_of_line(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
-    Token* line = parser_peek(p);
+    if (follow_on(p)) {
+        return;
+    }
 
-    const char* cursor = line -> lexeme;
+    Token line = *located(p, parser_peek(p));
 
-    while (*cursor != '\n') {
+    const char* cursor = line.lexeme;
+
+    while (*cursor != '\n' && *cursor != 0) {
         cursor++;
     }
 
-    line -> length = cursor - line -> lexeme;
-
-    SourceLocation location = source_location_from_token(
-        p -> path,
-        ctx -> buffer_start,
-        line
-    );
+    line.length = cursor - line.lexeme;
 
-    diag_error_help(ctx -> diag_ctx, location, msg, help);
+    diag_error_help(ctx -> diag_ctx, &line, msg, help);
 }
 
 void error_whole_line(MythrilContext* ctx, Parser* p, const char* msg, const char* help) {
-    Token* line = parser_peek(p);
+    if (follow_on(p)) {
+        return;
+    }
 
-    const char* start = line -> lexeme;
-    const char* end = line -> lexeme;
+    Token line = *located(p, parser_peek(p));
 
-    const char* ptr_copy = line -> lexeme;
-    const usize len_copy = line -> length;  
+    const char* start = line.lexeme;
+    const char* end = line.lexeme;
 
-    while (*end != '\n') {
+    while (*end != '\n' && *end != 0) {
         end++;
     }
 
-    while (*(start - 1) != '\n') {
+    while (start > ctx -> buffer_start && *(start - 1) != '\n') {
         start--;
     }
 
-    line -> lexeme = start;
-    line -> length = end - start;
-
-    SourceLocation location = source_location_from_token(
-        p -> path,
-        ctx -> buffer_start,
-        line
-    );
-
-    diag_error_help(ctx -> diag_ctx, location, msg, help);
+    line.lexeme = start;
+    line.length = end - start;
 
-    line -> lexeme = ptr_copy; 
-    line -> length = len_copy;
+    diag_error_help(ctx -> diag_ctx, &line, msg, help);
 }
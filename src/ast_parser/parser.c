@@ -2,15 +2,90 @@
 #include "parser.h"
 #include "errors/errors.h"
 #include "recovery/recovery.h"
+#include "speculate/speculate.h"
 #include "types.h"
 
-#include "precedence/precedence.h"
+#include "precedence/types.h"
 
 #include "../ast/ast.h"
+#include "../diagnostics/diagnostics.h"
+#include "../utils/macros.h"
 
 #include <stdio.h>
 #include <stdbool.h>
 
+static b8 parse_function_block(MythrilContext* ctx, Parser* p, AstFunctionDecl* function);
+
+static AstNode* make_error_node(Parser* p);
+
+static AstNode* parse_literal(MythrilContext* ctx, Parser* p, Token* token);
+static AstNode* parse_identifier(MythrilContext* ctx, Parser* p, Token* token);
+static AstNode* parse_unary(MythrilContext* ctx, Parser* p, Token* token);
+static AstNode* parse_group(MythrilContext* ctx, Parser* p, Token* token);
+
+static AstNode* parse_binary(MythrilContext* ctx, Parser* p, AstNode* left, Token* op, u8 right_prec);
+static AstNode* parse_call(MythrilContext* ctx, Parser* p, AstNode* callee, Token* op, u8 right_prec);
+static AstNode* parse_index(MythrilContext* ctx, Parser* p, AstNode* array, Token* op, u8 right_prec);
+static AstNode* parse_member(MythrilContext* ctx, Parser* p, AstNode* object, Token* op, u8 right_prec);
+
+// a token starts an expression if it has a prefix handler
+static const PrefixParseFn PREFIX_RULES[256] = {
+    [TOK_LITERAL_NUMBER]    = parse_literal,
+    [TOK_LITERAL_STRING]    = parse_literal,
+    [TOK_TRUE]              = parse_literal,
+    [TOK_FALSE]             = parse_literal,
+    [TOK_NULL]              = parse_literal,
+
+    [TOK_IDENTIFIER]        = parse_identifier,
+    [TOK_SELF]              = parse_identifier,
+
+    [TOK_MINUS]             = parse_unary,
+    [TOK_PLUS]              = parse_unary,
+    [TOK_BANG]              = parse_unary,
+    [TOK_BIT_NOT]           = parse_unary,
+    [TOK_STAR]              = parse_unary,
+    [TOK_AMPERSAND]         = parse_unary,
+    [TOK_PLUS_PLUS]         = parse_unary,
+    [TOK_MINUS_MINUS]       = parse_unary,
+
+    [TOK_LEFT_PAREN]        = parse_group,
+};
+
+// set for exactly the tokens with a non zero BINDING_POWER
+static const InfixParseFn INFIX_RULES[256] = {
+    [TOK_LEFT_PAREN]            = parse_call,
+    [TOK_LEFT_SQUARE]           = parse_index,
+    [TOK_DOT]                   = parse_member,
+
+    [TOK_STAR]                  = parse_binary,
+    [TOK_SLASH]                 = parse_binary,
+    [TOK_PERCENT]               = parse_binary,
+    [TOK_PLUS]                  = parse_binary,
+    [TOK_MINUS]                 = parse_binary,
+    [TOK_BIT_SHIFT_LEFT]        = parse_binary,
+    [TOK_BIT_SHIFT_RIGHT]       = parse_binary,
+    [TOK_LESS_THAN]             = parse_binary,
+    [TOK_LESS_THAN_EQUALS]      = parse_binary,
+    [TOK_GREATER_THAN]          = parse_binary,
+    [TOK_GREATER_THAN_EQUALS]   = parse_binary,
+    [TOK_EQUALS_EQUALS]         = parse_binary,
+    [TOK_BANG_EQUALS]           = parse_binary,
+    [TOK_AMPERSAND]             = parse_binary,
+    [TOK_BIT_XOR]               = parse_binary,
+    [TOK_BIT_OR]                = parse_binary,
+    [TOK_COND_AND]              = parse_binary,
+    [TOK_COND_OR]               = parse_binary,
+    [TOK_EQUALS]                = parse_binary,
+    [TOK_PLUS_EQUALS]           = parse_binary,
+    [TOK_MINUS_EQUALS]          = parse_binary,
+    [TOK_STAR_EQUALS]           = parse_binary,
+    [TOK_SLASH_EQUALS]          = parse_binary,
+    [TOK_BIT_AND_EQUALS]        = parse_binary,
+    [TOK_BIT_OR_EQUALS]         = parse_binary,
+    [TOK_BIT_XOR_EQUALS]        = parse_binary,
+    [TOK_BIT_NOT_EQUALS]        = parse_binary,
+};
+
 AstNode* top_level_decl_fail(Parser* p, AstNode* node) {
     recover_to_top_level_decl(p);
     node -> kind = AST_ERROR;
@@ -49,7 +124,7 @@ b8 parse_path_segments(MythrilContext* ctx, Parser* p, AstSlice* segments, usize
             return false;
         }
 
-        segments[(*count)++] = *make_slice_from_token(p -> arena, segment);
+        segments[(*count)++] = slice_from_token(segment);
 
         parser_advance(p);
 
@@ -79,6 +154,62 @@ b8 parse_path_segments(MythrilContext* ctx, Parser* p, AstSlice* segments, usize
     return true;
 }
 
+AstNode* parse_top_level_decl(MythrilContext* ctx, Parser* p) {
+    parser_resync(p);
+
+    Token* token = parser_peek(p);
+
+    switch (token -> kind) {
+        case TOK_MODULE: {
+            parser_advance(p);
+            return parse_module_decl(ctx, p);
+        }
+
+        case TOK_IMPORT: {
+            parser_advance(p);
+            return parse_import_decl(ctx, p);
+        }
+
+        case TOK_ENUM: {
+            parser_advance(p);
+            return parse_enum_decl(ctx, p);
+        }
+
+        case TOK_STRUCT: {
+            parser_advance(p);
+            return parse_struct_decl(ctx, p);
+        }
+
+        case TOK_IMPL: {
+            parser_advance(p);
+            return parse_impl_decl(ctx, p);
+        }
+
+        case TOK_FUNCTION: {
+            parser_advance(p);
+            return parse_function_decl(ctx, p);
+        }
+
+        case TOK_CONST: {
+            parser_advance(p);
+            return parse_const_decl(ctx, p);
+        }
+
+        case TOK_STATIC: {
+            parser_advance(p);
+            return parse_static_decl(ctx, p);
+        }
+
+        default: {
+            diag_error_token(ctx -> diag_ctx, token, DIAG_UNEXPECTED_TOP_LEVEL);
+
+            recover_to_top_level_decl(p);
+        } break;
+    }
+
+    return nullptr;
+}
+
 AstNode* parse_module_decl(MythrilContext* ctx, Parser* p) {
     AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
@@ -124,6 +255,8 @@ AstNode* parse_import_decl(MythrilContext* ctx, Parser* p) {
 }
 
 AstEnumVariant* parse_enum_variant(MythrilContext* ctx, Parser* p) {
+    parser_resync(p);
+
     AstEnumVariant* variant = arena_alloc(p -> arena, sizeof(*variant));
     
     variant -> value = nullptr;
@@ -141,7 +274,7 @@ AstEnumVariant* parse_enum_variant(MythrilContext* ctx, Parser* p) {
         return nullptr;
     }
 
-    variant -> identifier = *make_slice_from_token(p -> arena, name);
+    variant -> identifier = slice_from_token(name);
 
     parser_advance(p);
 
@@ -215,7 +348,7 @@ AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p) {
         return top_level_decl_fail(p, node);
     }
 
-    node -> enum_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> enum_decl.identifier = slice_from_token(name);
 
     parser_advance(p);
 
@@ -236,7 +369,7 @@ AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p) {
                 parser_advance(p);
             }
         } else {
-            node -> enum_decl.type = *make_slice_from_token(p -> arena, type);
+            node -> enum_decl.type = slice_from_token(type);
             parser_advance(p);
         }
     }
@@ -252,17 +385,18 @@ AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p) {
         return top_level_decl_fail(p, node);
     }
 
-    delimiters_push(p, parser_peek(p), name -> lexeme, name -> length);
-
     parser_advance(p);
 
     if (parser_check_current(p, TOK_RIGHT_BRACE)) {
-        delimiters_pop(p);
         parser_advance(p);
         return node;
     }
 
     while (!parser_check_current(p, TOK_RIGHT_BRACE)) {
+        if (PARSE_ABORTED(ctx)) {
+            break;
+        }
+
         if (node -> enum_decl.count >= node -> enum_decl.capacity) {
             usize size = sizeof(AstEnumVariant*) * node -> enum_decl.capacity;
 
@@ -276,12 +410,15 @@ AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p) {
             node -> enum_decl.capacity *= 2;
         }
 
+        const usize start = p -> index;
+
         AstEnumVariant* variant = parse_enum_variant(ctx, p);
 
-        if (!variant) {
-            // todo: recover in enum
-        } else {
+        if (variant) {
             node -> enum_decl.variants[node -> enum_decl.count++] = variant;
+        } else if (p -> index == start) {
+            // nothing was consumed, looping again would never end
+            return top_level_decl_fail(p, node);
         }
     }
 
@@ -291,6 +428,8 @@ AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p) {
 }
 
 AstStructField* parse_struct_field(MythrilContext* ctx, Parser* p) {
+    parser_resync(p);
+
     AstStructField* field = arena_alloc(p -> arena, sizeof(*field));
 
     Token* name = parser_peek(p);
@@ -324,7 +463,7 @@ AstStructField* parse_struct_field(MythrilContext* ctx, Parser* p) {
     AstType* type = parse_type(ctx, p);
 
     field -> type = type;
-    field -> identifier = *make_slice_from_token(p -> arena, name);
+    field -> identifier = slice_from_token(name);
 
     if (!parser_check_current(p, TOK_SEMI_COLON)) {
         error_at_previous_end(
@@ -365,7 +504,7 @@ AstNode* parse_struct_decl(MythrilContext* ctx, Parser* p) {
         return top_level_decl_fail(p, node);
     }
 
-    node -> struct_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> struct_decl.identifier = slice_from_token(name);
 
     parser_advance(p);
 
@@ -381,6 +520,10 @@ AstNode* parse_struct_decl(MythrilContext* ctx, Parser* p) {
     parser_advance(p);
 
     while (!parser_check_current(p, TOK_RIGHT_BRACE)) {
+        if (PARSE_ABORTED(ctx)) {
+            break;
+        }
+
         if (node -> struct_decl.count >= node -> struct_decl.capacity) {
             usize size = sizeof(AstStructField*) * node -> struct_decl.capacity;
 
@@ -433,7 +576,7 @@ AstNode* parse_impl_decl(MythrilContext* ctx, Parser* p) {
         return top_level_decl_fail(p, node);
     }
 
-    node -> impl_decl.target = *make_slice_from_token(p -> arena, name);
+    node -> impl_decl.target = slice_from_token(name);
 
     parser_advance(p);
 
@@ -451,6 +594,23 @@ AstNode* parse_impl_decl(MythrilContext* ctx, Parser* p) {
     parser_advance(p);
 
     while (!parser_check_current(p, TOK_RIGHT_BRACE)) {
+        if (PARSE_ABORTED(ctx)) {
+            break;
+        }
+
+        const TokenKind current = parser_peek(p) -> kind;
+
+        if (current == TOK_EOF || current == TOK_EOP) {
+            error_at_previous_end(
+                ctx,
+                p,
+                "expected '}'",
+                "add '}' after the functions"
+            );
+
+            return top_level_decl_fail(p, node);
+        }
+
         if (node -> impl_decl.fn_count >= node -> impl_decl.fn_capacity) {
             usize size = node -> impl_decl.fn_capacity * sizeof(AstNode*);
 
@@ -464,6 +624,10 @@ AstNode* parse_impl_decl(MythrilContext* ctx, Parser* p) {
             node -> impl_decl.fn_capacity *= 2;
         }
 
+        parser_resync(p);
+
+        const usize start = p -> index;
+
         if (!parser_check_current(p, TOK_FUNCTION)) {
             error_at_current(
                 ctx,
@@ -480,6 +644,12 @@ AstNode* parse_impl_decl(MythrilContext* ctx, Parser* p) {
         if (func) {
             node -> impl_decl.functions[node -> impl_decl.fn_count++] = func;
         }
+
+        // recovery stopped at the next top level declaration, the impl was never closed
+        if (p -> index == start) {
+            node -> kind = AST_ERROR;
+            return node;
+        }
     }
 
     parser_advance(p);
@@ -505,6 +675,10 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
         sizeof(AstParameter) * PARAM_INIT_CAPACITY
     );
 
+    node -> function_decl.lazy_body = false;
+    node -> function_decl.body_start = 0;
+    node -> function_decl.body_end = 0;
+
     node -> function_decl.stmt_count = 0;
     node -> function_decl.stmt_capacity = STMTS_INIT_CAPACITY;
     node -> function_decl.statements = arena_alloc(
@@ -525,7 +699,7 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
         return top_level_decl_fail(p, node);
     }
 
-    node -> function_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> function_decl.identifier = slice_from_token(name);
 
     parser_advance(p);
 
@@ -550,9 +724,21 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
     while (!parser_check_current(p, TOK_RIGHT_PAREN)) {
         Token* param_name = parser_peek(p);
 
+        // recovery stops at the end of the file, so would this loop
+        if (param_name -> kind == TOK_EOF || param_name -> kind == TOK_EOP) {
+            error_at_previous_end(
+                ctx,
+                p,
+                "expected ')'",
+                "add ')' after the parameters"
+            );
+
+            return top_level_decl_fail(p, node);
+        }
+
         if (param_name -> kind == TOK_SELF) {
             node -> function_decl.parameters[node -> function_decl.param_count++] = (AstParameter) {
-                .identifier = *make_slice_from_token(p -> arena, param_name),
+                .identifier = slice_from_token(param_name),
                 .type = nullptr 
             };
 
@@ -622,7 +808,7 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
         }
 
         node -> function_decl.parameters[node -> function_decl.param_count++] = (AstParameter) {
-            .identifier = *make_slice_from_token(p -> arena, param_name),
+            .identifier = slice_from_token(param_name),
             .type = param_type
         };
 
@@ -681,13 +867,53 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
         );
     }
 
+    // the lexer already knows where the body ends, skip it in one step
+    if (p -> flags & PARSE_LAZY_BODIES && parser_check_current(p, TOK_LEFT_BRACE)) {
+        const u32 close = p -> tokens -> matches[p -> index];
+
+        if (close != TOKEN_UNMATCHED) {
+            node -> function_decl.body_start = p -> index + 1;
+            node -> function_decl.body_end = close;
+            node -> function_decl.lazy_body = true;
+
+            p -> index = close + 1;
+
+            return node;
+        }
+    }
+
     parser_advance(p);
 
     // todo: parse block, with depth ADD DEPTH ASAP
 
-    AstFunctionDecl* function = &node -> function_decl;
+    if (!parse_function_block(ctx, p, &node -> function_decl)) {
+        return top_level_decl_fail(p, node);
+    }
+
+    parser_advance(p);
 
+    return node;
+}
+
+static b8 parse_function_block(MythrilContext* ctx, Parser* p, AstFunctionDecl* function) {
     while (!parser_check_current(p, TOK_RIGHT_BRACE)) {
+        if (PARSE_ABORTED(ctx)) {
+            break;
+        }
+
+        TokenKind current = parser_peek(p) -> kind;
+
+        if (current == TOK_EOF || current == TOK_EOP) {
+            error_at_previous_end(
+                ctx,
+                p,
+                "expected '}'",
+                "add '}' to close the function body"
+            );
+
+            return false;
+        }
+
         if (function -> stmt_count >= function -> stmt_capacity) {
             usize size = function -> stmt_capacity * sizeof(AstNode*);
 
@@ -708,9 +934,7 @@ AstNode* parse_function_decl(MythrilContext* ctx, Parser* p) {
         }     
     }
 
-    parser_advance(p);
-
-    return node;
+    return true;
 }
 
 AstNode* parse_const_decl(MythrilContext* ctx, Parser* p) {
@@ -786,7 +1010,7 @@ AstNode* parse_const_decl(MythrilContext* ctx, Parser* p) {
     //
     // parser_advance(p);
 
-    node -> const_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> const_decl.identifier = slice_from_token(name);
     node -> const_decl.type = type;
     node -> const_decl.value = value;
 
@@ -866,7 +1090,7 @@ AstNode* parse_static_decl(MythrilContext* ctx, Parser* p) {
 
     parser_advance(p);
 
-    node -> const_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> const_decl.identifier = slice_from_token(name);
     node -> const_decl.type = type;
     node -> const_decl.value = value;
 
@@ -899,7 +1123,7 @@ AstNode* parse_var_decl(MythrilContext* ctx, Parser *p) {
         return statement_fail(p, node);
     }
 
-    node -> var_decl.identifier = *make_slice_from_token(p -> arena, name);
+    node -> var_decl.identifier = slice_from_token(name);
 
     parser_advance(p);
 
@@ -958,6 +1182,8 @@ AstNode* parse_var_decl(MythrilContext* ctx, Parser *p) {
 }
 
 AstNode* parse_statement(MythrilContext* ctx, Parser* p) {
+    parser_resync(p);
+
     AstNode* node = nullptr;
 
     TokenKind kind = parser_peek(p) -> kind;
@@ -1012,6 +1238,16 @@ AstNode* parse_statement(MythrilContext* ctx, Parser* p) {
         } break;
 
         default: {
+            // any other expression start is tried as an expression statement,
+            // one that does not parse cleanly leaves no trace behind
+            if (PREFIX_RULES[kind]) {
+                node = parser_speculate(ctx, p, SPECULATE_EXPRESSION_STATEMENT, parse_expression);
+
+                if (node) {
+                    break;
+                }
+            }
+
             node = arena_alloc(p -> arena, sizeof(*node));
 
             error_till_end_of_line(
@@ -1025,6 +1261,11 @@ AstNode* parse_statement(MythrilContext* ctx, Parser* p) {
         } break;
     }
 
+    // the declaration recovered on its own and took the ';' with it
+    if (needs_semicolon && node -> kind == AST_ERROR && p -> recovered_at == p -> index) {
+        return node;
+    }
+
     if (needs_semicolon && !parser_check_current(p, TOK_SEMI_COLON)) {
         error_at_previous_end(
             ctx,
@@ -1041,6 +1282,56 @@ AstNode* parse_statement(MythrilContext* ctx, Parser* p) {
     return node;
 }
 
+/*
+*
+*   close is the '}' the prepass matched with the opening '{' of a block,
+*   nested blocks need no depth counting. Without an opener or with an
+*   unclosed one the block ends at the next '}' a statement would start at
+*
+*/
+static b8 at_block_end(Parser* p, u32 close) {
+    if (MEOW_LIKELY(close != TOKEN_UNMATCHED)) {
+        return p -> index >= close;
+    }
+
+    return parser_check_current(p, TOK_RIGHT_BRACE);
+}
+
+/*
+*
+*   a block past PARSER_MAX_DEPTH is reported once and skipped whole, the
+*   cursor is left on its '}' as if it had been parsed. An unclosed one
+*   runs to the end of the input
+*
+*/
+static b8 enter_block(MythrilContext* ctx, Parser* p, u32 close) {
+    if (MEOW_LIKELY(p -> depth < PARSER_MAX_DEPTH)) {
+        p -> depth++;
+        return true;
+    }
+
+    error_at_previous(
+        ctx,
+        p,
+        "block nested too deeply",
+        "move the inner blocks into a function"
+    );
+
+    if (close != TOKEN_UNMATCHED) {
+        p -> index = close;
+        return false;
+    }
+
+    TokenKind current = parser_peek(p) -> kind;
+
+    while (current != TOK_EOF && current != TOK_EOP) {
+        parser_advance(p);
+        current = parser_peek(p) -> kind;
+    }
+
+    return false;
+}
+
 AstNode* parse_loop_stmt(MythrilContext* ctx, Parser* p) {
     AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
@@ -1050,6 +1341,8 @@ AstNode* parse_loop_stmt(MythrilContext* ctx, Parser* p) {
     node -> loop_stmt.stmt_capacity = STMTS_INIT_CAPACITY;
     node -> loop_stmt.statements = arena_alloc(p -> arena, sizeof(AstNode*) * STMTS_INIT_CAPACITY);
 
+    u32 close = TOKEN_UNMATCHED;
+
     if (!parser_check_current(p, TOK_LEFT_BRACE)) {
         error_at_previous_end(
             ctx,
@@ -1058,35 +1351,28 @@ AstNode* parse_loop_stmt(MythrilContext* ctx, Parser* p) {
             "add a '{' here"
         );
     } else {
+        close = p -> tokens -> matches[p -> index];
         parser_advance(p);
     }
 
-    if (parser_check_current(p, TOK_RIGHT_BRACE)) {
+    if (!enter_block(ctx, p, close)) {
+        node -> kind = AST_ERROR;
         return node;
     }
 
-    // todo: proper depth tracking but with global parser delimiters i think
-    //       need to figure something out
-
-    i32 depth = 1;
+    if (parser_check_current(p, TOK_RIGHT_BRACE)) {
+        p -> depth--;
+        return node;
+    }
 
-    while (depth > 0) {
+    while (!at_block_end(p, close)) {
         TokenKind current = parser_peek(p) -> kind;
 
         if (current == TOK_EOF || current == TOK_EOP) {
+            p -> depth--;
             return statement_fail(p, node);
         }
 
-        if (current == TOK_LEFT_BRACE) {
-            depth++;
-        } else if (current == TOK_RIGHT_BRACE) {
-            depth--;
-
-            if (depth == 0) {
-                return node;
-            }
-        }
-
         if (node -> loop_stmt.stmt_count >= node -> loop_stmt.stmt_capacity) {
             usize size = sizeof(AstNode*) * node -> loop_stmt.stmt_capacity;
 
@@ -1100,9 +1386,18 @@ AstNode* parse_loop_stmt(MythrilContext* ctx, Parser* p) {
             node -> loop_stmt.stmt_capacity *= 2;
         }
 
+        const usize start = p -> index;
+
         node -> loop_stmt.statements[node -> loop_stmt.stmt_count++] = parse_statement(ctx, p);
+
+        // the '}' of a nested block is reported but starts no statement
+        if (p -> index == start) {
+            parser_advance(p);
+        }
     }
 
+    p -> depth--;
+
     return node;
 }
 
@@ -1116,6 +1411,8 @@ AstNode* parse_while_stmt(MythrilContext* ctx, Parser* p) {
     node -> while_stmt.statements = arena_alloc(p -> arena, sizeof(AstNode*) * STMTS_INIT_CAPACITY);
     node -> while_stmt.cond = parse_expression(ctx, p);
 
+    u32 close = TOKEN_UNMATCHED;
+
     if (!parser_check_current(p, TOK_LEFT_BRACE)) {
         error_at_previous_end(
             ctx,
@@ -1124,35 +1421,28 @@ AstNode* parse_while_stmt(MythrilContext* ctx, Parser* p) {
             "add a '{' here"
         );
     } else {
+        close = p -> tokens -> matches[p -> index];
         parser_advance(p);
     }
 
-    if (parser_check_current(p, TOK_RIGHT_BRACE)) {
+    if (!enter_block(ctx, p, close)) {
+        node -> kind = AST_ERROR;
         return node;
     }
 
-    // todo: proper depth tracking but with global parser delimiters i think
-    //       need to figure something out
-
-    i32 depth = 1;
+    if (parser_check_current(p, TOK_RIGHT_BRACE)) {
+        p -> depth--;
+        return node;
+    }
 
-    while (depth > 0) {
+    while (!at_block_end(p, close)) {
         TokenKind current = parser_peek(p) -> kind;
 
         if (current == TOK_EOF || current == TOK_EOP) {
+            p -> depth--;
             return statement_fail(p, node);
         }
 
-        if (current == TOK_LEFT_BRACE) {
-            depth++;
-        } else if (current == TOK_RIGHT_BRACE) {
-            depth--;
-
-            if (depth == 0) {
-                return node;
-            }
-        }
-
         if (node -> while_stmt.stmt_count >= node -> while_stmt.stmt_capacity) {
             usize size = sizeof(AstNode*) * node -> while_stmt.stmt_capacity;
 
@@ -1166,9 +1456,18 @@ AstNode* parse_while_stmt(MythrilContext* ctx, Parser* p) {
             node -> while_stmt.stmt_capacity *= 2;
         }
 
+        const usize start = p -> index;
+
         node -> while_stmt.statements[node -> while_stmt.stmt_count++] = parse_statement(ctx, p);
+
+        // the '}' of a nested block is reported but starts no statement
+        if (p -> index == start) {
+            parser_advance(p);
+        }
     }
 
+    p -> depth--;
+
     return node;
 }
 
@@ -1227,13 +1526,27 @@ AstNode* parse_for_stmt(MythrilContext* ctx, Parser* p) {
         return statement_fail(p, node);
     }
 
+    const u32 close = p -> tokens -> matches[p -> index];
+
     parser_advance(p);
 
     node -> for_stmt.init = init;
     node -> for_stmt.cond = cond;
     node -> for_stmt.step = step;
 
-    while (!parser_check_current(p, TOK_RIGHT_BRACE)) {
+    if (!enter_block(ctx, p, close)) {
+        node -> kind = AST_ERROR;
+        return node;
+    }
+
+    while (!at_block_end(p, close)) {
+        const TokenKind current = parser_peek(p) -> kind;
+
+        if (current == TOK_EOF || current == TOK_EOP) {
+            p -> depth--;
+            return statement_fail(p, node);
+        }
+
         if (node -> for_stmt.stmt_count >= node -> for_stmt.stmt_capacity) {
             usize size = node -> for_stmt.stmt_capacity * sizeof(AstNode*);
 
@@ -1247,13 +1560,22 @@ AstNode* parse_for_stmt(MythrilContext* ctx, Parser* p) {
             node -> for_stmt.stmt_capacity *= 2;
         }
 
+        const usize start = p -> index;
+
         AstNode* statement = parse_statement(ctx, p);
 
         if (statement) {
             node -> for_stmt.statements[node -> for_stmt.stmt_count++] = statement;
         }
+
+        // the '}' of a nested block is reported but starts no statement
+        if (p -> index == start) {
+            parser_advance(p);
+        }
     }
 
+    p -> depth--;
+
     return node;
 }
 
@@ -1303,7 +1625,7 @@ AstType* parse_type(MythrilContext* ctx, Parser* p) {
     Token* base_token = parser_advance(p);
 
     base_type -> kind = TYPE_BASIC;
-    base_type -> identifier = *make_slice_from_token(p -> arena, base_token);
+    base_type -> identifier = slice_from_token(base_token);
 
     AstType* result = base_type;
 
@@ -1314,6 +1636,8 @@ AstType* parse_type(MythrilContext* ctx, Parser* p) {
             AstType* ptr_type = arena_alloc(p -> arena, sizeof(*ptr_type));
 
             ptr_type -> kind = TYPE_POINTER;
+            ptr_type -> is_mutable = false;
+            ptr_type -> is_ref = false;
             ptr_type -> pointee = result;
 
             result = ptr_type;
@@ -1324,6 +1648,8 @@ AstType* parse_type(MythrilContext* ctx, Parser* p) {
             AstType* array_type = arena_alloc(p -> arena, sizeof(*array_type));
 
             array_type -> kind = TYPE_ARRAY;
+            array_type -> is_mutable = false;
+            array_type -> is_ref = false;
             array_type -> array.element_type = result;
             
             if (!parser_check_current(p, TOK_RIGHT_SQUARE)) {
@@ -1360,345 +1686,306 @@ AstType* parse_type(MythrilContext* ctx, Parser* p) {
 }
 
 AstNode* parse_expression(MythrilContext* ctx, Parser* p) {
-    AstNode* node = parse_expr_prec(ctx, p, 0);
-    
-    if (!node) {
-        node = arena_alloc(p -> arena, sizeof(*node));
-        node -> kind = AST_ERROR;
-    }
+    return parse_expr_prec(ctx, p, 0);
+}
+
+/*
+*
+*   pratt parser, the prefix handler of the first token produces the left
+*   operand, then infix handlers fold operators into it for as long as
+*   they bind at least as tight as min_prec. Every handler allocates
+*   exactly the one node it returns
+*
+*/
+AstNode* parse_expr_prec(MythrilContext* ctx, Parser* p, u32 min_prec) {
+    Token* token = parser_peek(p);
+
+    const PrefixParseFn prefix = PREFIX_RULES[token -> kind];
 
-    if (node -> kind == AST_ERROR) {
-        // todo: recover, perhaps pass in a pointer to a specific recovery function
+    if (MEOW_UNLIKELY(!prefix)) {
+        error_at_previous_end(
+            ctx,
+            p,
+            "expected an expression",
+            "add an expression"
+        );
+
+        return make_error_node(p);
     }
 
-    return node;
-}
+    // the handlers recurse back in here, nothing is consumed past the limit
+    // and the enclosing statement recovers as from any other error
+    if (MEOW_UNLIKELY(p -> depth >= PARSER_MAX_DEPTH)) {
+        error_at_current(
+            ctx,
+            p,
+            "expression nested too deeply",
+            "split it up with a local variable"
+        );
 
-AstNode* parse_expr_prec(MythrilContext* ctx, Parser* p, u32 min_prec) {
-    AstNode* left = parse_primary(ctx, p);
+        return make_error_node(p);
+    }
 
-    while (is_binary_operator(parser_peek(p) -> kind)) {
-        TokenKind op_kind = parser_peek(p) -> kind;
-        u8 prec = get_precedence(op_kind);
+    p -> depth++;
 
-        if (prec < min_prec) {
-            break;
-        }
+    parser_advance(p);
 
-        Token* op = parser_advance(p);
+    AstNode* left = prefix(ctx, p, token);
 
-        u8 next_prec = prec + (is_right_associative(op_kind) ? 0 : 1);
+    while (MEOW_LIKELY(left -> kind != AST_ERROR)) {
+        Token* op = parser_peek(p);
 
-        AstNode* right = parse_expr_prec(ctx, p, next_prec);
+        const BindingPower power = BINDING_POWER[op -> kind];
 
-        AstNode* bin_op = arena_alloc(p -> arena, sizeof(*bin_op));
+        if (power.left == 0 || power.left < min_prec) {
+            break;
+        }
 
-        bin_op -> kind = AST_BINARY;
-        bin_op -> binary.left = left;
-        bin_op -> binary.op = op -> kind;
-        bin_op -> binary.right = right;
+        parser_advance(p);
 
-        left = bin_op;
+        left = INFIX_RULES[op -> kind](ctx, p, left, op, power.right);
     }
 
+    p -> depth--;
+
     return left;
 }
 
-AstNode* parse_primary(MythrilContext* ctx, Parser* p) {
-    Token current = *parser_peek(p);
-
+static AstNode* make_error_node(Parser* p) {
     AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
-    if (is_prefix_operator(current.kind)) {
-        Token* op = parser_advance(p);
+    node -> kind = AST_ERROR;
 
-        AstNode* operand = parse_expr_prec(ctx, p, UNARY_PRECEDENCE);
+    return node;
+}
 
-        AstNode* unary_op = arena_alloc(p -> arena, sizeof(*unary_op));
+//
+//  prefix handlers, token is already consumed
+//
 
-        unary_op -> kind = AST_UNARY;
+static AstNode* parse_literal(MythrilContext* ctx, Parser* p, Token* token) {
+    (void) ctx;
 
-        unary_op -> unary.op = op -> kind;
-        unary_op -> unary.operand = operand;
+    AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
-        return parse_postfix(ctx, p, unary_op);
-    }
+    node -> kind = AST_LITERAL;
 
-    if (current.kind == TOK_LITERAL_NUMBER) {
-        Token* token = parser_advance(p);
-        
-        node -> kind = AST_LITERAL;
+    node -> literal.kind = token -> kind;
+    node -> literal.value = slice_from_token(token);
 
-        node -> literal.kind = TOK_LITERAL_NUMBER;
-        node -> literal.value = *make_slice_from_token(p -> arena, token);
+    return node;
+}
 
-        return parse_postfix(ctx, p, node);
-    }
+static AstNode* parse_identifier(MythrilContext* ctx, Parser* p, Token* token) {
+    (void) ctx;
 
-    if (current.kind == TOK_LITERAL_STRING) {
-        Token* token = parser_advance(p);
-        
-        node -> kind = AST_LITERAL;
+    AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
-        node -> literal.kind = TOK_LITERAL_STRING;
-        node -> literal.value = *make_slice_from_token(p -> arena, token);
+    node -> kind = AST_IDENTIFIER;
 
-        return parse_postfix(ctx, p, node);
-    }
+    node -> identifier.value = slice_from_token(token);
 
-    if (current.kind == TOK_TRUE || current.kind == TOK_FALSE) {
-        Token* token = parser_advance(p);
-        
-        node -> kind = AST_LITERAL;
+    return node;
+}
 
-        node -> literal.kind = token -> kind;
-        node -> literal.value = *make_slice_from_token(p -> arena, token);
+static AstNode* parse_unary(MythrilContext* ctx, Parser* p, Token* token) {
+    AstNode* operand = parse_expr_prec(ctx, p, UNARY_PRECEDENCE);
 
-        return parse_postfix(ctx, p, node);
-    }
+    AstNode* node = arena_alloc(p -> arena, sizeof(*node));
+
+    node -> kind = AST_UNARY;
 
-    if (current.kind == TOK_NULL) {
-        Token* token = parser_advance(p);
-        
-        AstNode* node = arena_alloc(p -> arena, sizeof(*node));
+    node -> unary.op = token -> kind;
+    node -> unary.operand = operand;
 
-        node -> kind = AST_LITERAL;
+    return node;
+}
 
-        node -> literal.kind = TOK_NULL;
-        node -> literal.value = *make_slice_from_token(p -> arena, token);
+static AstNode* parse_group(MythrilContext* ctx, Parser* p, Token* token) {
+    (void) token;
 
-        return parse_postfix(ctx, p, node);
-    }
+    AstNode* expr = parse_expression(ctx, p);
 
-    if (current.kind == TOK_IDENTIFIER || current.kind == TOK_SELF) {
-        Token* token = parser_advance(p);
-        
-        node -> kind = AST_IDENTIFIER;
+    if (!parser_check_current(p, TOK_RIGHT_PAREN)) {
+        error_at_current(
+            ctx,
+            p,
+            "expected ')'",
+            "add a ')' here"
+        );
 
-        node -> identifier.value = *make_slice_from_token(p -> arena, token);
+        expr -> kind = AST_ERROR;
 
-        return parse_postfix(ctx, p, node);
+        return expr;
     }
 
-    if (current.kind == TOK_LEFT_PAREN) {
-        parser_advance(p);
-
-        AstNode* expr = parse_expression(ctx, p);
+    parser_advance(p);
 
-        if (!parser_check_current(p, TOK_RIGHT_PAREN)) {
-            error_at_current(
-                ctx,
-                p,
-                "expected ')'",
-                "add a ')' here"
-            );
+    return expr;
+}
 
-            expr -> kind = AST_ERROR;
+//
+//  infix handlers, op is already consumed
+//
 
-            return expr;
-        }
+static AstNode* parse_binary(MythrilContext* ctx, Parser* p, AstNode* left, Token* op, u8 right_prec) {
+    AstNode* right = parse_expr_prec(ctx, p, right_prec);
 
-        return parse_postfix(ctx, p, expr);
-    }
+    AstNode* node = arena_alloc(p -> arena, sizeof(*node));
 
-    error_at_previous_end(
-        ctx,
-        p,
-        "expected an expression",
-        "add an expression"
-    );
+    node -> kind = AST_BINARY;
 
-    node -> kind = AST_ERROR;
+    node -> binary.left = left;
+    node -> binary.op = op -> kind;
+    node -> binary.right = right;
 
     return node;
 }
 
-AstNode* parse_postfix(MythrilContext* ctx, Parser* p, AstNode* node) {
-    while (true) {
-        Token current = *parser_peek(p);
+static AstNode* parse_call(MythrilContext* ctx, Parser* p, AstNode* callee, Token* op, u8 right_prec) {
+    (void) op;
+    (void) right_prec;
 
-        if (current.kind == TOK_LEFT_PAREN) {
-            parser_advance(p);
+    // the node is allocated once the arguments parsed, nothing is left behind on an error
+    usize arg_count = 0;
+    usize arg_capacity = ARGS_INIT_CAPACITY;
+    AstNode** arguments = arena_array(p -> arena, AstNode*, ARGS_INIT_CAPACITY);
 
-            AstNode* call = arena_alloc(p -> arena, sizeof(*call));
+    while (!parser_check_current(p, TOK_RIGHT_PAREN)) {
+        AstNode* argument = parse_expression(ctx, p);
 
-            call -> kind = AST_FUNCTION_CALL;
+        if (arg_count >= arg_capacity) {
+            usize old_size = sizeof(AstNode*) * arg_capacity;
+            usize new_size = old_size * 2;
 
-            call -> function_call.identifier = node -> identifier.value;
-            call -> function_call.arg_count = 0;
-            call -> function_call.arg_capacity = ARGS_INIT_CAPACITY;
-            call -> function_call.arguments = arena_alloc(
+            arguments = arena_realloc(
                 p -> arena,
-                sizeof(AstNode*) * ARGS_INIT_CAPACITY
+                arguments,
+                old_size,
+                new_size
             );
 
-            while (!parser_check_current(p, TOK_RIGHT_PAREN)) {
-                AstNode* argument = parse_expression(ctx, p);
-
-                if (call -> function_call.arg_count >= call -> function_call.arg_capacity) {
-                    usize old_size = sizeof(AstNode*) * call -> function_call.arg_capacity;
-                    usize new_size = old_size * 2;
-
-                    call -> function_call.arguments = arena_realloc(
-                        p -> arena,
-                        call -> function_call.arguments,
-                        old_size,
-                        new_size
-                    );
-                }
-
-                call -> function_call.arguments[call -> function_call.arg_count++] = argument;
-
-                if (parser_check_current(p, TOK_RIGHT_PAREN)) {
-                    break;
-                }
+            arg_capacity *= 2;
+        }
 
-                if (!parser_check_current(p, TOK_COMMA)) {
-                    if (parser_check_current(p, TOK_SEMI_COLON)) {
-                        error_at_previous_end(
-                            ctx,
-                            p,
-                            "expected ')'",
-                            "add a ')' here"
-                        );
-                    } else {
-                        error_at_previous_end(
-                            ctx,
-                            p,
-                            "expected ',' between args",
-                            "add a ',' here"
-                        );
-                    }
-
-                    node -> kind = AST_ERROR;
-
-                    return node;
-                }
+        arguments[arg_count++] = argument;
 
-                parser_advance(p);
-            }
+        if (parser_check_current(p, TOK_RIGHT_PAREN)) {
+            break;
+        }
 
-            if (!parser_check_current(p, TOK_RIGHT_PAREN)) {
+        if (!parser_check_current(p, TOK_COMMA)) {
+            if (parser_check_current(p, TOK_SEMI_COLON)) {
                 error_at_previous_end(
                     ctx,
                     p,
                     "expected ')'",
-                    "add ')' after arguments"
+                    "add a ')' here"
+                );
+            } else {
+                error_at_previous_end(
+                    ctx,
+                    p,
+                    "expected ',' between args",
+                    "add a ',' here"
                 );
             }
 
-            parser_advance(p);
+            callee -> kind = AST_ERROR;
 
-            node = call;
-            continue;
+            return callee;
         }
 
-        if (current.kind == TOK_LEFT_SQUARE) {
-            parser_advance(p);
-            
-            AstNode* index_expr = parse_expression(ctx, p);
+        parser_advance(p);
+    }
 
-            if (!parser_check_current(p, TOK_RIGHT_SQUARE)) {
-                error_at_previous_end(
-                    ctx,
-                    p,
-                    "expected ']'",
-                    "add a ']' here"
-                );
+    if (!parser_check_current(p, TOK_RIGHT_PAREN)) {
+        error_at_previous_end(
+            ctx,
+            p,
+            "expected ')'",
+            "add ')' after arguments"
+        );
+    }
 
-                node -> kind = AST_ERROR;
+    parser_advance(p);
 
-                return node;
-            }
+    AstNode* call = arena_alloc(p -> arena, sizeof(*call));
 
-            parser_advance(p);
+    call -> kind = AST_FUNCTION_CALL;
 
-            AstNode* index = arena_alloc(p -> arena, sizeof(*index));
+    // a plain name is kept as one, the node for it is not needed
+    if (callee -> kind == AST_IDENTIFIER) {
+        call -> function_call.identifier = callee -> identifier.value;
+        call -> function_call.callee = nullptr;
+    } else {
+        call -> function_call.identifier = (AstSlice) {0};
+        call -> function_call.callee = callee;
+    }
 
-            index -> kind = AST_ARRAY_INDEX;
+    call -> function_call.arg_count = arg_count;
+    call -> function_call.arg_capacity = arg_capacity;
+    call -> function_call.arguments = arguments;
 
-            index -> array_index.array = node;
-            index -> array_index.index = index_expr;
+    return call;
+}
 
-            node = index;
-            continue;
-        }
+static AstNode* parse_index(MythrilContext* ctx, Parser* p, AstNode* array, Token* op, u8 right_prec) {
+    (void) op;
+    (void) right_prec;
 
-        if (current.kind == TOK_DOT) {
-            parser_advance(p);
-            
-            Token member = *parser_advance(p); 
+    AstNode* index_expr = parse_expression(ctx, p);
 
-            if (member.kind != TOK_IDENTIFIER) {
-                error_at_current(
-                    ctx,
-                    p,
-                    "expected identifier",
-                    "add object identifier"
-                );
+    if (!parser_check_current(p, TOK_RIGHT_SQUARE)) {
+        error_at_previous_end(
+            ctx,
+            p,
+            "expected ']'",
+            "add a ']' here"
+        );
 
-                node -> kind = AST_ERROR;
+        array -> kind = AST_ERROR;
 
-                return node;
-            }
+        return array;
+    }
 
-            AstNode* access = arena_alloc(p -> arena, sizeof(*access));
+    parser_advance(p);
 
-            access -> kind = AST_MEMBER_ACCESS;
+    AstNode* index = arena_alloc(p -> arena, sizeof(*index));
 
-            access -> member_access.object = node;
-            access -> member_access.member = *make_slice_from_token(p -> arena, &member);
+    index -> kind = AST_ARRAY_INDEX;
 
-            node = access;
-            continue;
-        }
+    index -> array_index.array = array;
+    index -> array_index.index = index_expr;
 
-        if (current.kind == TOK_PLUS_PLUS || current.kind == TOK_MINUS_MINUS) {
-            // Token op = *parser_advance(p);
-            //
-            // AstNode* postfix = arena_alloc(p -> arena, sizeof(*postfix));
-            //
-            // postfix -> kind = AST_POSTFIX;
-            //
-            // postfix -> postfix.operand = expr;
-            // postfix -> postfix.op = op.type;
-            //
-            // expr = postfix;
-            //
-            // continue;
-        }
+    return index;
+}
 
-        break;
-    }
+static AstNode* parse_member(MythrilContext* ctx, Parser* p, AstNode* object, Token* op, u8 right_prec) {
+    (void) right_prec;
 
-    return node;
-}
+    Token* member = parser_advance(p);
 
-Token* parser_peek(Parser* p) {
-    if (p -> index >= p -> count) {
-        return &p -> tokens -> items[p -> count];
-    }
+    if (member -> kind != TOK_IDENTIFIER) {
+        error_at_current(
+            ctx,
+            p,
+            "expected identifier",
+            "add object identifier"
+        );
 
-    return &p -> tokens -> items[p -> index];
-}
+        object -> kind = AST_ERROR;
 
-Token* parser_peek_previous(Parser* p) {
-    if (p -> index >= p -> count) {
-        return &p -> tokens -> items[p -> count];
+        return object;
     }
 
-    return &p -> tokens -> items[p -> index - 1];
-}
+    AstNode* access = arena_alloc(p -> arena, sizeof(*access));
 
-Token* parser_advance(Parser* p) {
-    if (p -> index >= p -> count) {
-        return &p -> tokens -> items[p -> count];
-    }
+    access -> kind = AST_MEMBER_ACCESS;
 
-    return &p -> tokens -> items[p -> index++];
-}
+    access -> member_access.object = object;
+    access -> member_access.op = op -> kind;
+    access -> member_access.member = slice_from_token(member);
 
-b8 parser_check_current(Parser* p, TokenKind kind) {
-    Token* tok = parser_peek(p);
-    return tok -> kind == kind;
+    return access;
 }
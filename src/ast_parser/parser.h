@@ -5,34 +5,60 @@
 #include "types.h"
 
 #include "../mythril/types.h"
+#include "../utils/macros.h"
 
 // errors and recovery 
 #include "errors/errors.h"
 #include "recovery/recovery.h"
 
 // precedence 
-#include "precedence/precedence.h"
-
-//delimiters 
-#include "delimiters/delimiters.h"
+#include "precedence/types.h"
 
 #define MAX_PATH_SEGMENTS 32
 #define SEGMENTS_SIZE (sizeof(AstSlice) * MAX_PATH_SEGMENTS)
 
+// the error budget is spent, loops over declarations, members and
+// statements bail out at their next iteration
+#define PARSE_ABORTED(ctx) MEOW_UNLIKELY((ctx) -> diag_ctx -> aborted)
+
+// expression handlers, see PREFIX_RULES and INFIX_RULES in parser.c
+typedef AstNode* (*PrefixParseFn)(MythrilContext* ctx, Parser* p, Token* token);
+typedef AstNode* (*InfixParseFn)(MythrilContext* ctx, Parser* p, AstNode* left, Token* op, u8 right_prec);
+
 //
 //  movement and token consumption
 //
+//  the token stream always ends in TOK_EOP sentinels, so the cursor never
+//  checks bounds. Advancing stops on TOK_EOP, the index never leaves the
+//  stream however often a caller advances at its end
+//
+
+static inline Token* parser_peek(Parser* p) {
+    return &p -> items[p -> index];
+}
+
+// the first token is its own previous
+static inline Token* parser_peek_previous(Parser* p) {
+    return &p -> items[p -> index - (p -> index > 0)];
+}
+
+static inline Token* parser_advance(Parser* p) {
+    Token* token = &p -> items[p -> index];
+
+    p -> index += token -> kind != TOK_EOP;
 
-Token* parser_peek(Parser* p);
-Token* parser_peek_previous(Parser* p);
-Token* parser_advance(Parser* p);
+    return token;
+}
 
-b8 parser_check_current(Parser* p, TokenKind kind);
+static inline b8 parser_check_current(Parser* p, TokenKind kind) {
+    return p -> items[p -> index].kind == kind;
+}
 
 //
 //  ast parsing
 //
 
+AstNode* parse_top_level_decl(MythrilContext* ctx, Parser* p);
 AstNode* parse_module_decl(MythrilContext* ctx, Parser* p);
 AstNode* parse_import_decl(MythrilContext* ctx, Parser* p);
 AstNode* parse_enum_decl(MythrilContext* ctx, Parser* p);
@@ -51,8 +77,6 @@ AstNode* parse_return_stmt(MythrilContext* ctx, Parser* p);
 
 AstNode* parse_expression(MythrilContext* ctx, Parser* p);
 AstNode* parse_expr_prec(MythrilContext* ctx, Parser* p, u32 prec);
-AstNode* parse_primary(MythrilContext* ctx, Parser* p);
-AstNode* parse_postfix(MythrilContext* ctx, Parser* p, AstNode* node);
 
 AstType* parse_type(MythrilContext* ctx, Parser* p);
 
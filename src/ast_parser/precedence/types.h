@@ -4,59 +4,72 @@
 
 #include "../../tokens/types.h"
 
-#define UNARY_PRECEDENCE 12
+#define UNARY_PRECEDENCE   12
+#define POSTFIX_PRECEDENCE 13
 
-static const u8 PRECEDENCE_MAP[256] = {
-    [TOK_STAR]                  = 11,
-    [TOK_SLASH]                 = 11,
-    [TOK_PERCENT]               = 11,
+/*
+*
+*   left is the precedence of a token in infix position, 0 if it can't
+*   be one. right is the minimum precedence of the operand that follows,
+*   one above left for left associative operators, postfix operators
+*   take no operand after them
+*
+*/
+typedef struct {
+    u8 left;
+    u8 right;
+} BindingPower;
+
+#define LEFT_ASSOC(prec)  { (prec), (prec) + 1 }
+#define RIGHT_ASSOC(prec) { (prec), (prec) }
+#define POSTFIX           { POSTFIX_PRECEDENCE, 0 }
+
+static const BindingPower BINDING_POWER[256] = {
+    [TOK_LEFT_PAREN]            = POSTFIX,
+    [TOK_LEFT_SQUARE]           = POSTFIX,
+    [TOK_DOT]                   = POSTFIX,
+
+    [TOK_STAR]                  = LEFT_ASSOC(11),
+    [TOK_SLASH]                 = LEFT_ASSOC(11),
+    [TOK_PERCENT]               = LEFT_ASSOC(11),
     
-    [TOK_PLUS]                  = 10,
-    [TOK_MINUS]                 = 10,
+    [TOK_PLUS]                  = LEFT_ASSOC(10),
+    [TOK_MINUS]                 = LEFT_ASSOC(10),
     
-    [TOK_BIT_SHIFT_LEFT]        = 9,
-    [TOK_BIT_SHIFT_RIGHT]       = 9,
+    [TOK_BIT_SHIFT_LEFT]        = LEFT_ASSOC(9),
+    [TOK_BIT_SHIFT_RIGHT]       = LEFT_ASSOC(9),
     
-    [TOK_LESS_THAN]             = 8,
-    [TOK_LESS_THAN_EQUALS]      = 8,
-    [TOK_GREATER_THAN]          = 8,
-    [TOK_GREATER_THAN_EQUALS]   = 8,
+    [TOK_LESS_THAN]             = LEFT_ASSOC(8),
+    [TOK_LESS_THAN_EQUALS]      = LEFT_ASSOC(8),
+    [TOK_GREATER_THAN]          = LEFT_ASSOC(8),
+    [TOK_GREATER_THAN_EQUALS]   = LEFT_ASSOC(8),
     
-    [TOK_EQUALS_EQUALS]         = 7,
-    [TOK_BANG_EQUALS]           = 7,
+    [TOK_EQUALS_EQUALS]         = LEFT_ASSOC(7),
+    [TOK_BANG_EQUALS]           = LEFT_ASSOC(7),
     
-    [TOK_AMPERSAND]             = 6,
+    [TOK_AMPERSAND]             = LEFT_ASSOC(6),
     
-    [TOK_BIT_XOR]               = 5,
+    [TOK_BIT_XOR]               = LEFT_ASSOC(5),
     
-    [TOK_BIT_OR]                = 4,
+    [TOK_BIT_OR]                = LEFT_ASSOC(4),
     
-    [TOK_COND_AND]              = 3,
+    [TOK_COND_AND]              = LEFT_ASSOC(3),
     
-    [TOK_COND_OR]               = 2,
+    [TOK_COND_OR]               = LEFT_ASSOC(2),
     
-    [TOK_EQUALS]                = 1,
-    [TOK_PLUS_EQUALS]           = 1,
-    [TOK_MINUS_EQUALS]          = 1,
-    [TOK_STAR_EQUALS]           = 1,
-    [TOK_SLASH_EQUALS]          = 1,
-    [TOK_BIT_AND_EQUALS]        = 1,
-    [TOK_BIT_OR_EQUALS]         = 1,
-    [TOK_BIT_XOR_EQUALS]        = 1,
-    [TOK_BIT_NOT_EQUALS]        = 1,
-};
-
-static const b32 RIGHT_ASSOC_MAP[256] = {
-    [TOK_EQUALS]            = true,
-    [TOK_PLUS_EQUALS]       = true,
-    [TOK_MINUS_EQUALS]      = true,
-    [TOK_STAR_EQUALS]       = true,
-    [TOK_SLASH_EQUALS]      = true,
-    [TOK_BIT_AND_EQUALS]    = true,
-    [TOK_BIT_OR_EQUALS]     = true,
-    [TOK_BIT_XOR_EQUALS]    = true,
-    [TOK_BIT_NOT_EQUALS]    = true,
+    [TOK_EQUALS]                = RIGHT_ASSOC(1),
+    [TOK_PLUS_EQUALS]           = RIGHT_ASSOC(1),
+    [TOK_MINUS_EQUALS]          = RIGHT_ASSOC(1),
+    [TOK_STAR_EQUALS]           = RIGHT_ASSOC(1),
+    [TOK_SLASH_EQUALS]          = RIGHT_ASSOC(1),
+    [TOK_BIT_AND_EQUALS]        = RIGHT_ASSOC(1),
+    [TOK_BIT_OR_EQUALS]         = RIGHT_ASSOC(1),
+    [TOK_BIT_XOR_EQUALS]        = RIGHT_ASSOC(1),
+    [TOK_BIT_NOT_EQUALS]        = RIGHT_ASSOC(1),
 };
 
+#undef LEFT_ASSOC
+#undef RIGHT_ASSOC
+#undef POSTFIX
 
 #endif // !MYTHRIL_AST_PARSER_PRECEDENCE_TYPES_H
@@ -1,75 +1,100 @@
 #include "recovery.h"
+#include "types.h"
 
-void recover_to_top_level_decl(Parser* p) {
-    TokenKind kind = parser_peek(p) -> kind;
-
-    while (
-        kind != TOK_MODULE    &&
-        kind != TOK_IMPORT    &&
-        kind != TOK_STRUCT    &&
-        kind != TOK_ENUM      &&
-        kind != TOK_IMPL      &&
-        kind != TOK_FUNCTION  &&
-        kind != TOK_STATIC    &&
-        kind != TOK_CONST     &&
-        kind != TOK_EOF       &&
-        kind != TOK_EOP
-    ) {
-        parser_advance(p);
-        
-        kind = parser_peek(p) -> kind;
-    }
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// shared by every recovery point
+static const TokenSet TOP_LEVEL_DECL_START = TOKEN_SET(X_TOP_LEVEL_DECL_START);
+static const TokenSet SYNC_TOP_LEVEL = TOKEN_SET(X_SYNC_TOP_LEVEL);
+static const TokenSet SYNC_FN_BODY_START = TOKEN_SET(X_SYNC_FN_BODY_START);
+static const TokenSet SYNC_FN_PARAMS = TOKEN_SET(X_SYNC_FN_PARAMS);
+static const TokenSet SYNC_STATEMENT = TOKEN_SET(X_SYNC_STATEMENT);
+
+b8 is_top_level_decl_start(TokenKind kind) {
+    return TOKEN_SET_HAS(&TOP_LEVEL_DECL_START, kind);
 }
 
-void recover_to_fn_body(Parser* p) {
-    TokenKind kind = parser_peek(p) -> kind;
+usize scan_to_sync(const Tokens* tokens, usize from, usize to, const TokenSet* set) {
+    const u8* kinds = tokens -> kinds;
 
-    while (
-        kind != TOK_LEFT_BRACE  &&
-        kind != TOK_EOF         &&
-        kind != TOK_EOP
-    ) {
-        parser_advance(p);
+    usize i = from;
 
-        kind = parser_peek(p) -> kind;
-    }
-}
+#ifdef __AVX2__
+    // shufti, a kind is a member if the set bits picked by its low and
+    // high nibble overlap. 32 kinds per step
+    const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) set -> nibbles));
+    const __m256i high_table = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0
+    );
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
 
-void recover_in_fn_params(Parser* p) {
-    TokenKind kind = parser_peek(p) -> kind;
-
-    while (
-        kind != TOK_COMMA       &&
-        kind != TOK_RIGHT_PAREN &&
-        kind != TOK_EOF         &&
-        kind != TOK_EOP
-    ) {
-        parser_advance(p);
+    while (i + 32 <= to) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*) (kinds + i));
+
+        const __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(chunk, low_mask));
+        const __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), low_mask));
+
+        const __m256i hits = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), zero);
+        const u32 mask = ~(u32) _mm256_movemask_epi8(hits);
+
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
 
-        kind = parser_peek(p) -> kind;
+        i += 32;
     }
+#endif
 
-    if (kind == TOK_COMMA) {
-        parser_advance(p);
+    for (; i < to; i++) {
+        if (TOKEN_SET_HAS(set, kinds[i])) {
+            return i;
+        }
     }
+
+    return i;
 }
 
+static void skip_to(Parser* p, const TokenSet* set) {
+    p -> index = scan_to_sync(p -> tokens, p -> index, p -> count, set);
+}
 
-void recover_in_fn_body(Parser* p) {
-    TokenKind kind = parser_peek(p) -> kind;
-
-    while (
-        kind != TOK_SEMI_COLON  &&
-        kind != TOK_RIGHT_BRACE &&
-        kind != TOK_EOF         &&
-        kind != TOK_EOP
-    ) {
-        parser_advance(p);
+// every recovery ends here, the region the error poisoned ends with it
+static void recovered(Parser* p) {
+    p -> recovered_at = p -> index;
+
+    parser_resync(p);
+}
+
+void recover_to_top_level_decl(Parser* p) {
+    skip_to(p, &SYNC_TOP_LEVEL);
+    recovered(p);
+}
+
+void recover_to_fn_body(Parser* p) {
+    skip_to(p, &SYNC_FN_BODY_START);
+    recovered(p);
+}
 
-        kind = parser_peek(p) -> kind;
+void recover_in_fn_params(Parser* p) {
+    skip_to(p, &SYNC_FN_PARAMS);
+
+    if (parser_peek(p) -> kind == TOK_COMMA) {
+        parser_advance(p);
     }
 
-    if (kind == TOK_SEMI_COLON) {
+    recovered(p);
+}
+
+void recover_in_fn_body(Parser* p) {
+    skip_to(p, &SYNC_STATEMENT);
+
+    if (parser_peek(p) -> kind == TOK_SEMI_COLON) {
         parser_advance(p);
     }
+
+    recovered(p);
 }
@@ -2,9 +2,34 @@
 #ifndef MYTHRIL_AST_PARSER_RECOVERY_H
 #define MYTHRIL_AST_PARSER_RECOVERY_H
 
+#include "types.h"
+
 #include "../parser.h"
 
+/*
+*
+*   the parser is back in step with the source, the next error starts a
+*   region of its own and is reported. Every recover_*() ends in one, so
+*   does the start of a declaration, member or statement
+*
+*/
+static inline void parser_resync(Parser* p) {
+    p -> poisoned = false;
+}
+
+// keywords that begin a top level declaration, recovery stops at them
+b8 is_top_level_decl_start(TokenKind kind);
+
+/*
+*
+*   index of the first token in [from, to) whose kind is in set, to if
+*   there is none. Reads only Tokens.kinds
+*
+*/
+usize scan_to_sync(const Tokens* tokens, usize from, usize to, const TokenSet* set);
+
 void recover_to_top_level_decl(Parser* p);
+void recover_to_fn_body(Parser* p);
 void recover_in_path_segment(Parser* p);
 void recover_in_fn_params(Parser* p);
 void recover_in_fn_body(Parser* p);
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef MYTHRIL_AST_PARSER_RECOVERY_TYPES_H
+#define MYTHRIL_AST_PARSER_RECOVERY_TYPES_H
+
+#include "../../tokens/types.h"
+#include "../../utils/types.h"
+
+_Static_assert(TOK_KIND_COUNT <= 128, "TokenSet holds at most 128 token kinds");
+
+/*
+*
+*   set of token kinds recovery synchronises on
+*
+*   bits has bit k set for every member k. nibbles is the same set laid
+*   out for a byte shuffle: nibbles[k & 15] has bit (k >> 4) set for every
+*   member k, which is exact as long as every kind is below 128
+*
+*/
+typedef struct {
+    u64 bits[2];
+    u8 nibbles[16];
+} TokenSet;
+
+#define TOKEN_SET_HAS(set, kind) (((set) -> bits[(kind) >> 6] >> ((kind) & 63)) & 1)
+
+//
+//  a TokenSet is built at compile time from a list macro LIST(X, arg)
+//  that expands X(kind, arg) for every member
+//
+
+#define TOKEN_SET_BIT(kind, word) | ((u64) ((kind) >> 6 == (word)) << ((kind) & 63))
+#define TOKEN_SET_NIBBLE(kind, low) | (((kind) & 15) == (low) ? 1 << ((kind) >> 4) : 0)
+
+#define TOKEN_SET_NIBBLES(LIST, low) (u8) (0 LIST(TOKEN_SET_NIBBLE, low))
+
+#define TOKEN_SET(LIST) {                                                                       \
+    .bits = { 0 LIST(TOKEN_SET_BIT, 0), 0 LIST(TOKEN_SET_BIT, 1) },                             \
+    .nibbles = {                                                                                \
+        TOKEN_SET_NIBBLES(LIST, 0),  TOKEN_SET_NIBBLES(LIST, 1),  TOKEN_SET_NIBBLES(LIST, 2),   \
+        TOKEN_SET_NIBBLES(LIST, 3),  TOKEN_SET_NIBBLES(LIST, 4),  TOKEN_SET_NIBBLES(LIST, 5),   \
+        TOKEN_SET_NIBBLES(LIST, 6),  TOKEN_SET_NIBBLES(LIST, 7),  TOKEN_SET_NIBBLES(LIST, 8),   \
+        TOKEN_SET_NIBBLES(LIST, 9),  TOKEN_SET_NIBBLES(LIST, 10), TOKEN_SET_NIBBLES(LIST, 11),  \
+        TOKEN_SET_NIBBLES(LIST, 12), TOKEN_SET_NIBBLES(LIST, 13), TOKEN_SET_NIBBLES(LIST, 14),  \
+        TOKEN_SET_NIBBLES(LIST, 15)                                                             \
+    }                                                                                           \
+}
+
+#define X_END_OF_INPUT(X, arg)  \
+    X(TOK_EOF, arg)             \
+    X(TOK_EOP, arg)
+
+#define X_TOP_LEVEL_DECL_START(X, arg)  \
+    X(TOK_MODULE, arg)                  \
+    X(TOK_IMPORT, arg)                  \
+    X(TOK_STRUCT, arg)                  \
+    X(TOK_ENUM, arg)                    \
+    X(TOK_IMPL, arg)                    \
+    X(TOK_FUNCTION, arg)                \
+    X(TOK_STATIC, arg)                  \
+    X(TOK_CONST, arg)
+
+#define X_SYNC_TOP_LEVEL(X, arg)        \
+    X_TOP_LEVEL_DECL_START(X, arg)      \
+    X_END_OF_INPUT(X, arg)
+
+#define X_SYNC_FN_BODY_START(X, arg)    \
+    X(TOK_LEFT_BRACE, arg)              \
+    X_END_OF_INPUT(X, arg)
+
+#define X_SYNC_FN_PARAMS(X, arg)        \
+    X(TOK_COMMA, arg)                   \
+    X(TOK_RIGHT_PAREN, arg)             \
+    X_END_OF_INPUT(X, arg)
+
+#define X_SYNC_STATEMENT(X, arg)        \
+    X(TOK_SEMI_COLON, arg)              \
+    X(TOK_RIGHT_BRACE, arg)             \
+    X_END_OF_INPUT(X, arg)
+
+#endif // !MYTHRIL_AST_PARSER_RECOVERY_TYPES_H
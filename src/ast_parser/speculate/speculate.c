@@ -0,0 +1,139 @@
+#include "speculate.h"
+#include "types.h"
+
+#include "../../utils/macros.h"
+
+static usize memo_key(usize index, SpeculateRule rule);
+static SpeculateMemo* memo_find(Parser* p, usize key);
+static void memo_reserve(Parser* p);
+
+ParserCheckpoint parser_checkpoint(MythrilContext* ctx, Parser* p) {
+    const DiagContext* diag_ctx = ctx -> diag_ctx;
+
+    return (ParserCheckpoint) {
+        .index = p -> index,
+        .recovered_at = p -> recovered_at,
+        .mark = arena_mark(p -> arena),
+        .diag_items = diag_ctx -> items,
+        .diag_capacity = diag_ctx -> capacity,
+        .diag_count = diag_ctx -> count,
+        .warning_count = diag_ctx -> warning_count,
+        .error_count = diag_ctx -> error_count,
+        .note_count = diag_ctx -> note_count,
+        .aborted = diag_ctx -> aborted,
+        .poisoned = p -> poisoned
+    };
+}
+
+void parser_rollback(MythrilContext* ctx, Parser* p, const ParserCheckpoint* checkpoint) {
+    DiagContext* diag_ctx = ctx -> diag_ctx;
+
+    p -> index = checkpoint -> index;
+    p -> recovered_at = checkpoint -> recovered_at;
+    p -> poisoned = checkpoint -> poisoned;
+
+    // the diagnostics may sit on the same arena, a list that grew
+    // during the attempt goes with it
+    arena_rewind(p -> arena, checkpoint -> mark);
+
+    diag_ctx -> items = checkpoint -> diag_items;
+    diag_ctx -> capacity = checkpoint -> diag_capacity;
+    diag_ctx -> count = checkpoint -> diag_count;
+    diag_ctx -> warning_count = checkpoint -> warning_count;
+    diag_ctx -> error_count = checkpoint -> error_count;
+    diag_ctx -> note_count = checkpoint -> note_count;
+    diag_ctx -> aborted = checkpoint -> aborted;
+}
+
+AstNode* parser_speculate(MythrilContext* ctx, Parser* p, SpeculateRule rule, SpeculateFn production) {
+    const usize key = memo_key(p -> index, rule);
+
+    if (p -> memo) {
+        SpeculateMemo* memo = memo_find(p, key);
+
+        if (memo -> key == key) {
+            if (memo -> node) {
+                p -> index = memo -> end;
+            }
+
+            return memo -> node;
+        }
+    }
+
+    // grown before the mark, a rollback must not take the table with it.
+    // Inner attempts never store, their node could be rolled back by ours
+    const b8 outermost = p -> speculating == 0;
+
+    if (outermost) {
+        memo_reserve(p);
+    }
+
+    const ParserCheckpoint checkpoint = parser_checkpoint(ctx, p);
+
+    // nothing reported during the attempt is streamed before it is kept
+    p -> speculating++;
+    ctx -> diag_ctx -> hold++;
+
+    AstNode* node = production(ctx, p);
+
+    ctx -> diag_ctx -> hold--;
+    p -> speculating--;
+
+    const b8 failed = !node || node -> kind == AST_ERROR || ctx -> diag_ctx -> error_count != checkpoint.error_count;
+
+    if (failed) {
+        parser_rollback(ctx, p, &checkpoint);
+        node = nullptr;
+    }
+
+    if (outermost) {
+        SpeculateMemo* memo = memo_find(p, key);
+
+        *memo = (SpeculateMemo) {
+            .key = key,
+            .end = p -> index,
+            .node = node
+        };
+
+        p -> memo_count++;
+    }
+
+    return node;
+}
+
+// never 0, that marks a free slot
+static usize memo_key(usize index, SpeculateRule rule) {
+    return index * SPECULATE_RULE_COUNT + rule + 1;
+}
+
+// the slot holding key, or the free slot it would go in
+static SpeculateMemo* memo_find(Parser* p, usize key) {
+    const usize mask = p -> memo_capacity - 1;
+
+    usize slot = (key * 0x9E3779B97F4A7C15ull) & mask;
+
+    while (p -> memo[slot].key != 0 && p -> memo[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
+
+    return &p -> memo[slot];
+}
+
+// room for one more entry at no more than half load
+static void memo_reserve(Parser* p) {
+    if (MEOW_LIKELY(p -> memo && (p -> memo_count + 1) * 2 <= p -> memo_capacity)) {
+        return;
+    }
+
+    SpeculateMemo* old = p -> memo;
+    const usize old_capacity = p -> memo_capacity;
+
+    p -> memo_capacity = old ? old_capacity * 2 : SPECULATE_MEMO_INIT_CAPACITY;
+    p -> memo = arena_array_zero(p -> arena, SpeculateMemo, p -> memo_capacity);
+
+    for (usize i = 0; i < old_capacity; i++) {
+        if (old[i].key != 0) {
+            *memo_find(p, old[i].key) = old[i];
+        }
+    }
+}
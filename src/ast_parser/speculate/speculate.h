@@ -0,0 +1,34 @@
+#pragma once
+#ifndef MYTHRIL_AST_PARSER_SPECULATE_H
+#define MYTHRIL_AST_PARSER_SPECULATE_H
+
+#include "types.h"
+
+#include "../parser.h"
+
+typedef AstNode* (*SpeculateFn)(MythrilContext* ctx, Parser* p);
+
+ParserCheckpoint parser_checkpoint(MythrilContext* ctx, Parser* p);
+
+/*
+*
+*   puts the cursor, the arena and the diagnostics back to where they
+*   were at checkpoint, nodes allocated since are gone
+*
+*/
+void parser_rollback(MythrilContext* ctx, Parser* p, const ParserCheckpoint* checkpoint);
+
+/*
+*
+*   tries production at the cursor. It succeeds if it returns a node that
+*   is not AST_ERROR without reporting an error, the cursor is then past
+*   it. On failure nullptr is returned with the parser rolled back, none
+*   of its diagnostics are kept.
+*
+*   Outcomes are memoized per rule and token index, a production is run
+*   at most once at any index so backtracking stays linear
+*
+*/
+AstNode* parser_speculate(MythrilContext* ctx, Parser* p, SpeculateRule rule, SpeculateFn production);
+
+#endif // !MYTHRIL_AST_PARSER_SPECULATE_H
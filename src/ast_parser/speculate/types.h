@@ -0,0 +1,62 @@
+#pragma once
+#ifndef MYTHRIL_AST_PARSER_SPECULATE_TYPES_H
+#define MYTHRIL_AST_PARSER_SPECULATE_TYPES_H
+
+#include "../../arena/arena.h"
+#include "../../ast/types.h"
+#include "../../diagnostics/types.h"
+#include "../../utils/types.h"
+
+#define SPECULATE_MEMO_INIT_CAPACITY 64
+
+// every production that is ever tried speculatively, part of the memo key
+#define X_SPECULATE_RULES(X)            \
+    X(SPECULATE_EXPRESSION_STATEMENT)   \
+                                        \
+    X(SPECULATE_RULE_COUNT)
+
+typedef enum {
+    X_SPECULATE_RULES(GENERATE_ENUM)
+} SpeculateRule;
+
+/*
+*
+*   outcome of a production tried at a token index. A failure keeps node
+*   as nullptr, a success the node it produced and the index after it.
+*   key 0 marks a free slot, see memo_key() in speculate.c
+*
+*/
+typedef struct {
+    usize key;
+    usize end;
+    AstNode* node;
+} SpeculateMemo;
+
+/*
+*
+*   everything an attempt can change: where the cursor was, how much of
+*   the arena was used, whether an error had poisoned the region and how
+*   many diagnostics had been reported. The
+*   diagnostic list may have grown past the mark, the one from before
+*   is still intact and is put back
+*
+*/
+typedef struct {
+    usize index;
+    usize recovered_at;
+    ArenaMark mark;
+
+    Diagnostic* diag_items;
+    u32 diag_capacity;
+
+    u32 diag_count;
+    u32 warning_count;
+    u32 error_count;
+    u32 note_count;
+
+    b8 aborted;
+    b8 poisoned;
+    u8 _padding[2];
+} ParserCheckpoint;
+
+#endif // !MYTHRIL_AST_PARSER_SPECULATE_TYPES_H
@@ -8,13 +8,22 @@
 #include "../tokens/types.h"
 #include "../utils/types.h"
 
-#include "delimiters/types.h"
+#include "speculate/types.h"
+
+typedef enum {
+    PARSE_NONE        = 0,
+    PARSE_LAZY_BODIES = 1 << 0  // skip function bodies and record their token ranges, for --outline
+} ParseFlags;
 
 typedef struct {
     ArenaAllocator* arena;
     Tokens* tokens;
     Program* program;
 
+    // tokens -> items, the cursor reads through it without bounds checks,
+    // the stream ends in TOKEN_SENTINEL_PADDING + 1 TOK_EOP
+    Token* items;
+
     const char* path;
 
     usize index;
@@ -26,7 +35,27 @@ typedef struct {
     // const char* current_fn;
     // const char* current_impl;
 
-    DelimiterStack delimiters;
+    u32 flags; // ParseFlags
+
+    // nesting of parser_speculate(), only the outermost attempt is memoized
+    u32 speculating;
+
+    // open addressed, allocated by the first attempt
+    SpeculateMemo* memo;
+    usize memo_capacity;
+    usize memo_count;
+
+    // index the last recover_*() stopped at
+    usize recovered_at;
+
+    // set by the first error since the last recovery point. The errors
+    // after it come from the same mistake and are not reported, see
+    // errors.c. Cleared once the parser is back in step with the source
+    b8 poisoned;
+    u8 _padding[3];
+
+    // expressions and blocks entered and not yet left, see PARSER_MAX_DEPTH
+    u32 depth;
 } Parser;
 
 #endif // !MYTHRIL_AST_PARSER_TYPES_H
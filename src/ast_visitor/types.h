@@ -0,0 +1,54 @@
+#pragma once
+#ifndef MYTHRIL_AST_VISITOR_TYPES_H
+#define MYTHRIL_AST_VISITOR_TYPES_H
+
+#include "../arena/arena.h"
+#include "../ast/types.h"
+#include "../utils/types.h"
+
+#define VISITOR_STACK_INIT_CAPACITY 64
+
+typedef enum {
+    VISIT_CONTINUE, // descend into the children of the node
+    VISIT_SKIP,     // do not descend, the post callback still runs
+    VISIT_STOP      // abandon the whole walk
+} VisitAction;
+
+/*
+*
+*   one entry of the explicit traversal stack, handed to the callbacks
+*
+*   slot is the index of the node within the parents child array,
+*   e.g. the statement index in a block or the variant index of an
+*   enum value, 0 when the parent has no such array
+*
+*/
+typedef struct {
+    AstNode* node;
+    AstNode* parent;
+
+    u32 depth;
+    u32 slot;
+
+    b8 expanded; // pre already ran, next pop is the post visit
+    u8 _padding[7];
+} VisitFrame;
+
+typedef struct AstVisitor AstVisitor;
+
+typedef VisitAction (*AstVisitFn)(AstVisitor* v, VisitFrame* frame);
+
+typedef struct AstVisitor {
+    ArenaAllocator* arena;
+    void* user;
+
+    // callbacks indexed by AstKind, nullptr means nothing to do
+    AstVisitFn pre[AST_KIND_COUNT];
+    AstVisitFn post[AST_KIND_COUNT];
+
+    VisitFrame* stack;
+    usize capacity;
+    usize count;
+} AstVisitor;
+
+#endif // !MYTHRIL_AST_VISITOR_TYPES_H
@@ -0,0 +1,306 @@
+#include "visitor.h"
+#include "types.h"
+
+#include "../utils/macros.h"
+
+/*
+*
+*   children are pushed in reverse so they pop in source order, every
+*   pushed node is prefetched since it is about to be visited and the
+*   arena rarely lays siblings out next to each other
+*
+*/
+
+static void push_frame(AstVisitor* v, AstNode* node, AstNode* parent, u32 depth, u32 slot);
+static void push_type(AstVisitor* v, AstType* type, AstNode* parent, u32 depth, u32 slot);
+static void push_block(AstVisitor* v, AstNode** items, usize count, AstNode* parent, u32 depth);
+static void push_children(AstVisitor* v, usize index);
+
+void init_visitor(AstVisitor* v, ArenaAllocator* arena, void* user) {
+    v -> arena = arena;
+    v -> user = user;
+
+    for (u32 i = 0; i < AST_KIND_COUNT; i++) {
+        v -> pre[i] = nullptr;
+        v -> post[i] = nullptr;
+    }
+
+    v -> stack = nullptr;
+    v -> capacity = 0;
+    v -> count = 0;
+}
+
+void visitor_on_all(AstVisitor* v, AstVisitFn pre, AstVisitFn post) {
+    for (u32 i = 0; i < AST_KIND_COUNT; i++) {
+        v -> pre[i] = pre;
+        v -> post[i] = post;
+    }
+}
+
+b8 visit_node(AstVisitor* v, AstNode* root, u32 depth) {
+    // walks may nest from inside a callback, only unwind our own frames
+    const usize base = v -> count;
+
+    push_frame(v, root, nullptr, depth, 0);
+
+    while (v -> count > base) {
+        const usize top = v -> count - 1;
+        VisitFrame* frame = &v -> stack[top];
+
+        const AstKind kind = frame -> node -> kind;
+
+        if (frame -> expanded) {
+            AstVisitFn post = v -> post[kind];
+            VisitAction action = post ? post(v, frame) : VISIT_CONTINUE;
+
+            v -> count = top;
+
+            if (MEOW_UNLIKELY(action == VISIT_STOP)) {
+                v -> count = base;
+                return false;
+            }
+
+            continue;
+        }
+
+        frame -> expanded = true;
+
+        AstVisitFn pre = v -> pre[kind];
+        VisitAction action = pre ? pre(v, frame) : VISIT_CONTINUE;
+
+        if (MEOW_UNLIKELY(action == VISIT_STOP)) {
+            v -> count = base;
+            return false;
+        }
+
+        if (action == VISIT_CONTINUE) {
+            push_children(v, top);
+        }
+    }
+
+    return true;
+}
+
+b8 visit_program(AstVisitor* v, Program* program) {
+    for (usize i = 0; i < program -> count; i++) {
+        if (i + 1 < program -> count) {
+            __builtin_prefetch(program -> declarations[i + 1]);
+        }
+
+        if (!visit_node(v, program -> declarations[i], 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void push_frame(AstVisitor* v, AstNode* node, AstNode* parent, u32 depth, u32 slot) {
+    if (!node) {
+        return;
+    }
+
+    __builtin_prefetch(node);
+
+    if (MEOW_UNLIKELY(v -> count >= v -> capacity)) {
+        if (v -> capacity == 0) {
+            v -> stack = arena_array(v -> arena, VisitFrame, VISITOR_STACK_INIT_CAPACITY);
+            v -> capacity = VISITOR_STACK_INIT_CAPACITY;
+        } else {
+            usize size = v -> capacity * sizeof(VisitFrame);
+
+            v -> stack = arena_realloc(v -> arena, v -> stack, size, size * 2);
+            v -> capacity *= 2;
+        }
+    }
+
+    v -> stack[v -> count++] = (VisitFrame) {
+        .node = node,
+        .parent = parent,
+        .depth = depth,
+        .slot = slot,
+        .expanded = false
+    };
+}
+
+static void push_type(AstVisitor* v, AstType* type, AstNode* parent, u32 depth, u32 slot) {
+    // only array sizes hold expressions, walk down the pointer/array chain
+    while (type) {
+        if (type -> kind == TYPE_POINTER) {
+            type = type -> pointee;
+        } else if (type -> kind == TYPE_ARRAY) {
+            push_frame(v, type -> array.size_expr, parent, depth, slot);
+            type = type -> array.element_type;
+        } else {
+            return;
+        }
+    }
+}
+
+static void push_block(AstVisitor* v, AstNode** items, usize count, AstNode* parent, u32 depth) {
+    for (usize i = count; i > 0; i--) {
+        push_frame(v, items[i - 1], parent, depth, i - 1);
+    }
+}
+
+static void push_children(AstVisitor* v, usize index) {
+    AstNode* node = v -> stack[index].node;
+    const u32 depth = v -> stack[index].depth + 1;
+
+    switch (node -> kind) {
+        case AST_STRUCT_DECL: {
+            AstStructDecl* decl = &node -> struct_decl;
+
+            for (usize i = decl -> count; i > 0; i--) {
+                push_type(v, decl -> fields[i - 1] -> type, node, depth, i - 1);
+            }
+        } break;
+
+        case AST_UNION_DECL: {
+            AstUnionDecl* decl = &node -> union_decl;
+
+            for (usize i = decl -> count; i > 0; i--) {
+                push_type(v, decl -> variants[i - 1] -> type, node, depth, i - 1);
+            }
+        } break;
+
+        case AST_ENUM_DECL: {
+            AstEnumDecl* decl = &node -> enum_decl;
+
+            for (usize i = decl -> count; i > 0; i--) {
+                push_frame(v, decl -> variants[i - 1] -> value, node, depth, i - 1);
+            }
+        } break;
+
+        case AST_IMPL_DECL: {
+            push_block(v, node -> impl_decl.functions, node -> impl_decl.fn_count, node, depth);
+        } break;
+
+        case AST_FUNCTION_DECL: {
+            AstFunctionDecl* decl = &node -> function_decl;
+
+            push_block(v, decl -> statements, decl -> stmt_count, node, depth);
+            push_type(v, decl -> return_type, node, depth, 0);
+
+            for (usize i = decl -> param_count; i > 0; i--) {
+                push_type(v, decl -> parameters[i - 1].type, node, depth, i - 1);
+            }
+        } break;
+
+        case AST_STATIC_DECL: {
+            push_frame(v, node -> static_decl.value, node, depth, 0);
+            push_type(v, node -> static_decl.type, node, depth, 0);
+        } break;
+
+        case AST_CONST_DECL: {
+            push_frame(v, node -> const_decl.value, node, depth, 0);
+            push_type(v, node -> const_decl.type, node, depth, 0);
+        } break;
+
+        case AST_VAR_DECL: {
+            push_frame(v, node -> var_decl.value, node, depth, 0);
+            push_type(v, node -> var_decl.type, node, depth, 0);
+        } break;
+
+        case AST_ASSIGNMENT: {
+            push_frame(v, node -> assignment.rvalue, node, depth, 0);
+            push_frame(v, node -> assignment.lvalue, node, depth, 0);
+        } break;
+
+        case AST_IF_STMT: {
+            AstIfStmt* stmt = &node -> if_stmt;
+
+            push_frame(v, stmt -> else_stmt, node, depth, 0);
+            push_block(v, stmt -> statements, stmt -> stmt_count, node, depth);
+            push_frame(v, stmt -> expression, node, depth, 0);
+        } break;
+
+        case AST_MATCH_STMT: {
+            AstMatchStmt* stmt = &node -> match_stmt;
+
+            // the default arm gets slot arm_count, every other arm its index
+            for (usize i = stmt -> stmt_count; i > 0; i--) {
+                push_frame(v, stmt -> statements[i - 1], node, depth, stmt -> arm_count);
+            }
+
+            for (usize i = stmt -> arm_count; i > 0; i--) {
+                AstMatchArm* arm = &stmt -> arms[i - 1];
+
+                for (usize j = arm -> stmt_count; j > 0; j--) {
+                    push_frame(v, arm -> statements[j - 1], node, depth, i - 1);
+                }
+
+                push_frame(v, arm -> pattern, node, depth, i - 1);
+            }
+
+            push_frame(v, stmt -> expression, node, depth, 0);
+        } break;
+
+        case AST_LOOP_STMT: {
+            push_block(v, node -> loop_stmt.statements, node -> loop_stmt.stmt_count, node, depth);
+        } break;
+
+        case AST_WHILE_STMT: {
+            AstWhileStmt* stmt = &node -> while_stmt;
+
+            push_block(v, stmt -> statements, stmt -> stmt_count, node, depth);
+            push_frame(v, stmt -> cond, node, depth, 0);
+        } break;
+
+        case AST_FOR_STMT: {
+            AstForStmt* stmt = &node -> for_stmt;
+
+            push_block(v, stmt -> statements, stmt -> stmt_count, node, depth);
+            push_frame(v, stmt -> step, node, depth, 0);
+            push_frame(v, stmt -> cond, node, depth, 0);
+            push_frame(v, stmt -> init, node, depth, 0);
+        } break;
+
+        case AST_RETURN_STMT: {
+            push_frame(v, node -> return_stmt.expression, node, depth, 0);
+        } break;
+
+        case AST_EXPR_STMT: {
+            push_frame(v, node -> expr_stmt.expression, node, depth, 0);
+        } break;
+
+        case AST_UNARY: {
+            push_frame(v, node -> unary.operand, node, depth, 0);
+        } break;
+
+        case AST_BINARY: {
+            push_frame(v, node -> binary.right, node, depth, 0);
+            push_frame(v, node -> binary.left, node, depth, 0);
+        } break;
+
+        case AST_FUNCTION_CALL: {
+            AstFunctionCall* call = &node -> function_call;
+
+            push_block(v, call -> arguments, call -> arg_count, node, depth);
+
+            if (call -> callee) {
+                push_frame(v, call -> callee, node, depth, 0);
+            }
+        } break;
+
+        case AST_ARRAY_INDEX: {
+            push_frame(v, node -> array_index.index, node, depth, 0);
+            push_frame(v, node -> array_index.array, node, depth, 0);
+        } break;
+
+        case AST_MEMBER_ACCESS: {
+            push_frame(v, node -> member_access.object, node, depth, 0);
+        } break;
+
+        case AST_PATTERN_VARIANT: {
+            AstPatternVariant* pattern = &node -> pattern_variant;
+
+            push_block(v, pattern -> patterns, pattern -> count, node, depth);
+        } break;
+
+        default: {
+            // leaves: modules, imports, break, continue, identifiers,
+            // literals, simple patterns and errors
+        } break;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MYTHRIL_AST_VISITOR_H
+#define MYTHRIL_AST_VISITOR_H
+
+#include "types.h"
+
+/*
+*
+*   prepares a visitor with empty callback tables, the traversal
+*   stack is allocated lazily on the arena and reused between walks
+*
+*/
+void init_visitor(AstVisitor* v, ArenaAllocator* arena, void* user);
+
+/*
+*
+*   installs the same pre/post callback for every AstKind
+*
+*/
+void visitor_on_all(AstVisitor* v, AstVisitFn pre, AstVisitFn post);
+
+/*
+*
+*   walks the tree below root without recursion, pre runs before
+*   the children of a node and post after them. Children are visited
+*   in source order. Returns false if a callback answered VISIT_STOP
+*
+*/
+b8 visit_node(AstVisitor* v, AstNode* root, u32 depth);
+
+/*
+*
+*   walks every top level declaration of the program at depth 0
+*
+*/
+b8 visit_program(AstVisitor* v, Program* program);
+
+#endif // !MYTHRIL_AST_VISITOR_H
@@ -0,0 +1,678 @@
+#include "cache.h"
+#include "types.h"
+
+#include "../diagnostics/diagnostics.h"
+#include "../hash/hash.h"
+#include "../serialize/serialize.h"
+#include "../tokens/tokens.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_ALIGN(size) (((size) + 7) & ~(usize) 7)
+
+// an entry on disk as eviction sees it
+typedef struct {
+    char* path;
+    usize size;
+    struct timespec used;
+} CacheFile;
+
+static i32 make_directory(const char* path);
+static void entry_path(const Cache* cache, const CacheKey* key, char* out, usize size);
+static i32 write_entry(const Cache* cache, const CacheKey* key, const u8* data, usize len);
+static b8 check_entry(const u8* base, usize size, usize source_len);
+static b8 check_string(const u8* base, usize size, u32 strings, u32 offset, usize min_len);
+static b8 slice_message(u8 message);
+static u32 copy_string(u8* base, usize* cursor, const char* text, usize len);
+static void evict(Cache* cache, CacheStats* stats);
+static void print_stats(const Cache* cache, const CacheStats* stats);
+
+i32 open_cache(Cache* cache, const char* dir, usize limit) {
+    if (make_directory(dir) == -1) {
+        fprintf(stderr, "Error: Failed to create cache directory '%s': %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    *cache = (Cache) {
+        .dir = dir,
+        .limit = limit,
+        .hits = 0,
+        .misses = 0,
+        .stores = 0,
+        .stored_bytes = 0
+    };
+
+    return 0;
+}
+
+/*
+*
+*   runs share the stats file, it is locked while it is read, added to
+*   and written back. An eviction runs under the same lock so only one
+*   run at a time walks the cache
+*
+*/
+void close_cache(Cache* cache, b8 print_stats_too) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache -> dir, CACHE_STATS_NAME);
+
+    CacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    const i32 fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (fd != -1 && flock(fd, LOCK_EX) == 0) {
+        // a missing or foreign stats file knows nothing of what is on disk
+        const b8 known = pread(fd, &stats, sizeof(stats), 0) == sizeof(stats)
+            && stats.magic == CACHE_MAGIC
+            && stats.version == CACHE_VERSION;
+
+        if (!known) {
+            memset(&stats, 0, sizeof(stats));
+            stats.magic = CACHE_MAGIC;
+            stats.version = CACHE_VERSION;
+        }
+
+        stats.hits += cache -> hits;
+        stats.misses += cache -> misses;
+        stats.stores += cache -> stores;
+        stats.bytes += cache -> stored_bytes;
+        stats.entries += cache -> stores;
+
+        if (!known || stats.bytes > cache -> limit) {
+            evict(cache, &stats);
+        }
+
+        if (pwrite(fd, &stats, sizeof(stats), 0) != sizeof(stats)) {
+            fprintf(stderr, "Error: Failed to update cache stats '%s'\n", path);
+        }
+
+        flock(fd, LOCK_UN);
+    }
+
+    if (fd != -1) {
+        close(fd);
+    }
+
+    if (print_stats_too) {
+        print_stats(cache, &stats);
+    }
+}
+
+CacheKey cache_key(const char* source, usize len, u32 flags) {
+    const u32 prefix[2] = { CACHE_VERSION, flags };
+
+    Sha256 sha;
+    init_sha256(&sha);
+
+    sha256_update(&sha, prefix, sizeof(prefix));
+    sha256_update(&sha, source, len);
+
+    CacheKey key;
+    sha256_final(&sha, key.bytes);
+
+    return key;
+}
+
+i32 cache_lookup(Cache* cache, const CacheKey* key, usize source_len, u32 parts, CacheEntry* entry) {
+    char path[PATH_MAX];
+    entry_path(cache, key, path, sizeof(path));
+
+    const i32 fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        cache -> misses++;
+        return -1;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1 || (usize) st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        cache -> misses++;
+        return -1;
+    }
+
+    const usize size = (usize) st.st_size;
+    const u8* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        cache -> misses++;
+        return -1;
+    }
+
+    const CacheHeader* header = (const CacheHeader*) base;
+
+    if (
+        header -> magic != CACHE_MAGIC                                                      ||
+        header -> version != CACHE_VERSION                                                  ||
+        memcmp(&header -> key, key, sizeof(*key)) != 0                                      ||
+        header -> source_len != source_len                                                  ||
+        header -> total_size != size                                                        ||
+        (header -> parts & parts) != parts                                                  ||
+        header -> diagnostics + (usize) header -> diagnostic_count * sizeof(CacheDiagnostic) > size ||
+        header -> lex_diagnostic_count > header -> diagnostic_count                         ||
+        header -> tokens + (usize) header -> token_count * sizeof(CacheToken) > size        ||
+        ((header -> parts & CACHE_HAS_TOKENS) && header -> token_count == 0)                ||
+        (usize) header -> ast + header -> ast_size > size                                   ||
+        header -> strings > size                                                            ||
+        !check_entry(base, size, source_len)
+    ) {
+        munmap((void*) base, size);
+        cache -> misses++;
+        return -1;
+    }
+
+    // the modification time is when the entry was last used, eviction goes by it
+    utimensat(AT_FDCWD, path, nullptr, 0);
+
+    entry -> base = base;
+    entry -> size = size;
+    entry -> header = header;
+
+    cache -> hits++;
+
+    return 0;
+}
+
+void unload_cache_entry(CacheEntry* entry) {
+    if (entry -> base) {
+        munmap((void*) entry -> base, entry -> size);
+    }
+
+    entry -> base = nullptr;
+    entry -> size = 0;
+    entry -> header = nullptr;
+}
+
+i32 cache_open_ast(const CacheEntry* entry, AstCacheView* view) {
+    const CacheHeader* header = entry -> header;
+
+    if (!(header -> parts & CACHE_HAS_AST) || header -> ast_size < sizeof(AstCacheHeader)) {
+        return -1;
+    }
+
+    const u8* ast = entry -> base + header -> ast;
+
+    // the key already matched the source, the AST only has to agree with itself
+    const AstCacheHeader* ast_header = (const AstCacheHeader*) ast;
+
+    return open_ast_cache(view, ast, header -> ast_size, ast_header -> source_digest, ast_header -> source_len);
+}
+
+void cache_replay_tokens(const CacheEntry* entry, Tokens* tokens, ArenaAllocator* arena, const char* source) {
+    const CacheHeader* header = entry -> header;
+    const CacheToken* cached = (const CacheToken*) (entry -> base + header -> tokens);
+
+    // a whole number of words, the u8 kind table sized from it must not misalign the arena
+    tokens -> capacity = CACHE_ALIGN(header -> token_count);
+    tokens -> items = arena_array(arena, Token, tokens -> capacity);
+    tokens -> count = header -> token_count;
+
+    for (u32 i = 0; i < header -> token_count; i++) {
+        tokens -> items[i] = (Token) {
+            .lexeme = cached[i].offset == CACHE_NO_OFFSET ? nullptr : source + cached[i].offset,
+            .length = cached[i].length,
+            .kind = cached[i].kind,
+            .file = tokens -> file
+        };
+    }
+
+    pad_end_of_program(tokens, arena);
+}
+
+void cache_replay_diagnostics(const CacheEntry* entry, DiagContext* ctx, u16 file, const char* source, b8 lex_only) {
+    const CacheHeader* header = entry -> header;
+    const CacheDiagnostic* cached = (const CacheDiagnostic*) (entry -> base + header -> diagnostics);
+    const u32 count = lex_only ? header -> lex_diagnostic_count : header -> diagnostic_count;
+
+    #define TEXT(offset) ((offset) == CACHE_NO_STRING ? nullptr : (const char*) entry -> base + (offset))
+
+    for (u32 i = 0; i < count; i++) {
+        const CacheDiagnostic* diag = &cached[i];
+
+        add_diagnostic(ctx, (Diagnostic) {
+            .pointer = diag -> offset == CACHE_NO_OFFSET ? nullptr : source + diag -> offset,
+            .help = TEXT(diag -> help),
+            .args = { TEXT(diag -> args[0]), TEXT(diag -> args[1]) },
+            .arg_length = diag -> arg_length,
+            .length = diag -> length,
+            .sequence = 0,
+            .file = file,
+            .level = diag -> level,
+            .message = diag -> message
+        });
+    }
+
+    #undef TEXT
+}
+
+i32 cache_store(
+    Cache* cache,
+    ArenaAllocator* arena,
+    const CacheKey* key,
+    const char* source,
+    usize source_len,
+    const Tokens* tokens,
+    const AstCacheBlob* ast,
+    const DiagContext* ctx,
+    u16 file,
+    u32 lex_diagnostics
+) {
+    u32 diagnostic_count = 0;
+    usize string_bytes = 0;
+
+    for (u32 i = 0; i < ctx -> count; i++) {
+        const Diagnostic* diag = &ctx -> items[i];
+
+        if (diag -> file != file) {
+            continue;
+        }
+
+        // a place that is not in the source cannot be found again
+        if (diag -> pointer && (diag -> pointer < source || diag -> pointer > source + source_len)) {
+            return -1;
+        }
+
+        diagnostic_count++;
+
+        string_bytes += diag -> help ? strlen(diag -> help) + 1 : 0;
+
+        if (diag -> args[0]) {
+            string_bytes += (slice_message(diag -> message) ? diag -> arg_length : strlen(diag -> args[0])) + 1;
+        }
+
+        string_bytes += diag -> args[1] ? strlen(diag -> args[1]) + 1 : 0;
+    }
+
+    const usize diagnostics = CACHE_ALIGN(sizeof(CacheHeader));
+    const usize token_section = diagnostics + CACHE_ALIGN(diagnostic_count * sizeof(CacheDiagnostic));
+    const usize ast_section = token_section + CACHE_ALIGN(tokens -> count * sizeof(CacheToken));
+    const usize strings = ast_section + CACHE_ALIGN(ast ? ast -> len : 0);
+    const usize total = strings + string_bytes;
+
+    if (total > UINT32_MAX) {
+        return -1;
+    }
+
+    // arena allocations are unaligned, the sections are built in place, a whole word of slack keeps the arena aligned after
+    u8* data = (u8*) CACHE_ALIGN((usize) arena_alloc(arena, CACHE_ALIGN(total) + 8));
+    arena_memset(data, 0, CACHE_ALIGN(total));
+
+    *(CacheHeader*) data = (CacheHeader) {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .key = *key,
+        .source_len = source_len,
+        .total_size = (u32) total,
+        .parts = CACHE_HAS_TOKENS | (ast ? CACHE_HAS_AST : 0),
+        .diagnostic_count = diagnostic_count,
+        .diagnostics = (u32) diagnostics,
+        .lex_diagnostic_count = lex_diagnostics < diagnostic_count ? lex_diagnostics : diagnostic_count,
+        .token_count = (u32) tokens -> count,
+        .tokens = (u32) token_section,
+        .ast = (u32) ast_section,
+        .ast_size = ast ? (u32) ast -> len : 0,
+        .strings = (u32) strings,
+        ._padding = 0
+    };
+
+    CacheDiagnostic* out = (CacheDiagnostic*) (data + diagnostics);
+    usize cursor = strings;
+
+    for (u32 i = 0; i < ctx -> count; i++) {
+        const Diagnostic* diag = &ctx -> items[i];
+
+        if (diag -> file != file) {
+            continue;
+        }
+
+        const char* first = diag -> args[0];
+        const char* second = diag -> args[1];
+
+        *out++ = (CacheDiagnostic) {
+            .offset = diag -> pointer ? (u32) (diag -> pointer - source) : CACHE_NO_OFFSET,
+            .length = diag -> length,
+            .help = diag -> help ? copy_string(data, &cursor, diag -> help, strlen(diag -> help)) : CACHE_NO_STRING,
+            .args = {
+                first ? copy_string(data, &cursor, first, slice_message(diag -> message) ? diag -> arg_length : strlen(first)) : CACHE_NO_STRING,
+                second ? copy_string(data, &cursor, second, strlen(second)) : CACHE_NO_STRING
+            },
+            .arg_length = diag -> arg_length,
+            .level = diag -> level,
+            .message = diag -> message
+        };
+    }
+
+    CacheToken* token_out = (CacheToken*) (data + token_section);
+
+    for (usize i = 0; i < tokens -> count; i++) {
+        const Token* token = &tokens -> items[i];
+        const b8 inside = token -> lexeme && token -> lexeme >= source && token -> lexeme <= source + source_len;
+
+        token_out[i] = (CacheToken) {
+            .offset = inside ? (u32) (token -> lexeme - source) : CACHE_NO_OFFSET,
+            .length = token -> length,
+            .kind = token -> kind
+        };
+    }
+
+    if (ast) {
+        memcpy(data + ast_section, ast -> data, ast -> len);
+    }
+
+    if (write_entry(cache, key, data, total) == -1) {
+        return -1;
+    }
+
+    cache -> stores++;
+    cache -> stored_bytes += total;
+
+    return 0;
+}
+
+static i32 make_directory(const char* path) {
+    char partial[PATH_MAX];
+
+    if (snprintf(partial, sizeof(partial), "%s", path) >= (i32) sizeof(partial)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    // every parent first, the ones that are there already are fine
+    for (char* slash = strchr(partial + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = 0;
+
+        if (mkdir(partial, 0755) == -1 && errno != EEXIST) {
+            return -1;
+        }
+
+        *slash = '/';
+    }
+
+    if (mkdir(partial, 0755) == -1 && errno != EEXIST) {
+        return -1;
+    }
+
+    struct stat st;
+
+    if (stat(partial, &st) == -1 || !S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return -1;
+    }
+
+    return 0;
+}
+
+// dir/xx/yyyy...CACHE_EXTENSION, xx the first byte of the key in hex
+static void entry_path(const Cache* cache, const CacheKey* key, char* out, usize size) {
+    char hex[SHA256_DIGEST_SIZE * 2 + 1];
+
+    for (u32 i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        snprintf(hex + i * 2, 3, "%02x", key -> bytes[i]);
+    }
+
+    snprintf(out, size, "%s/%.2s/%s%s", cache -> dir, hex, hex + 2, CACHE_EXTENSION);
+}
+
+// written next to its place and renamed into it, a reader never maps half an entry
+static i32 write_entry(const Cache* cache, const CacheKey* key, const u8* data, usize len) {
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX + 32];
+
+    entry_path(cache, key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, getpid());
+
+    i32 fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd == -1 && errno == ENOENT) {
+        // first entry under this byte of the key
+        char* slash = strrchr(path, '/');
+
+        *slash = 0;
+        mkdir(path, 0755);
+        *slash = '/';
+
+        fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    while (len > 0) {
+        const ssize written = write(fd, data, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            close(fd);
+            unlink(tmp_path);
+            return -1;
+        }
+
+        data += written;
+        len -= (usize) written;
+    }
+
+    close(fd);
+
+    if (rename(tmp_path, path) == -1) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+// the SLICE messages quote arg_length bytes of the source, args[0] has no NUL of its own
+/*
+*
+*   every offset the replays follow, the section bounds in the header
+*   are checked already. A token or diagnostic has to point into the source
+*   and a string has to end inside the entry
+*
+*/
+static b8 check_entry(const u8* base, usize size, usize source_len) {
+    const CacheHeader* header = (const CacheHeader*) base;
+
+    if (header -> diagnostics % 8 != 0 || header -> tokens % 8 != 0 || header -> strings < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    const CacheToken* tokens = (const CacheToken*) (base + header -> tokens);
+
+    for (u32 i = 0; i < header -> token_count; i++) {
+        const CacheToken* token = &tokens[i];
+
+        if (token -> kind >= TOK_KIND_COUNT) {
+            return false;
+        }
+
+        // TOK_EOF covers the NUL after the source
+        if (token -> offset != CACHE_NO_OFFSET && (usize) token -> offset + token -> length > source_len + 1) {
+            return false;
+        }
+    }
+
+    const CacheDiagnostic* diagnostics = (const CacheDiagnostic*) (base + header -> diagnostics);
+
+    for (u32 i = 0; i < header -> diagnostic_count; i++) {
+        const CacheDiagnostic* diag = &diagnostics[i];
+
+        if (diag -> level > DIAGNOSTIC_NOTE || diag -> message >= DIAG_MESSAGE_COUNT) {
+            return false;
+        }
+
+        // like a token, a place at the end covers the NUL after the source
+        if (diag -> offset != CACHE_NO_OFFSET && (usize) diag -> offset + diag -> length > source_len + 1) {
+            return false;
+        }
+
+        // a slice is read by its length, not up to its NUL
+        const usize first_len = slice_message(diag -> message) ? diag -> arg_length : 0;
+
+        if (
+            !check_string(base, size, header -> strings, diag -> help, 0)                   ||
+            !check_string(base, size, header -> strings, diag -> args[0], first_len)        ||
+            !check_string(base, size, header -> strings, diag -> args[1], 0)
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static b8 check_string(const u8* base, usize size, u32 strings, u32 offset, usize min_len) {
+    if (offset == CACHE_NO_STRING) {
+        return true;
+    }
+
+    if (offset < strings || offset >= size || size - offset <= min_len) {
+        return false;
+    }
+
+    return memchr(base + offset + min_len, 0, size - offset - min_len) != nullptr;
+}
+
+static b8 slice_message(u8 message) {
+    return message == DIAG_UNKNOWN_TOKEN || message == DIAG_UNEXPECTED_TOP_LEVEL;
+}
+
+static u32 copy_string(u8* base, usize* cursor, const char* text, usize len) {
+    const u32 offset = (u32) *cursor;
+
+    memcpy(base + offset, text, len);
+    base[offset + len] = 0;
+
+    *cursor += len + 1;
+
+    return offset;
+}
+
+static i32 compare_used(const void* a, const void* b) {
+    const struct timespec* x = &((const CacheFile*) a) -> used;
+    const struct timespec* y = &((const CacheFile*) b) -> used;
+
+    if (x -> tv_sec != y -> tv_sec) {
+        return x -> tv_sec < y -> tv_sec ? -1 : 1;
+    }
+
+    return (x -> tv_nsec > y -> tv_nsec) - (x -> tv_nsec < y -> tv_nsec);
+}
+
+/*
+*
+*   walks every entry, which also puts right whatever the running totals
+*   got wrong, and removes the least recently used ones until the cache
+*   is back to CACHE_EVICT_TARGET percent of its limit
+*
+*/
+static void evict(Cache* cache, CacheStats* stats) {
+    const usize ext_len = sizeof(CACHE_EXTENSION) - 1;
+
+    CacheFile* files = nullptr;
+    usize count = 0;
+    usize capacity = 0;
+    usize total = 0;
+
+    for (u32 byte = 0; byte < 256; byte++) {
+        char dir_path[PATH_MAX];
+        snprintf(dir_path, sizeof(dir_path), "%s/%02x", cache -> dir, byte);
+
+        DIR* dir = opendir(dir_path);
+
+        if (!dir) {
+            continue;
+        }
+
+        struct dirent* item;
+
+        while ((item = readdir(dir))) {
+            const usize name_len = strlen(item -> d_name);
+
+            if (name_len <= ext_len || strcmp(item -> d_name + name_len - ext_len, CACHE_EXTENSION) != 0) {
+                continue;
+            }
+
+            char path[PATH_MAX];
+            const i32 path_len = snprintf(path, sizeof(path), "%s/%s", dir_path, item -> d_name);
+
+            struct stat st;
+
+            if (path_len >= (i32) sizeof(path) || stat(path, &st) == -1) {
+                continue;
+            }
+
+            if (count == capacity) {
+                capacity = capacity > 0 ? capacity * 2 : 256;
+                files = realloc(files, capacity * sizeof(CacheFile));
+            }
+
+            files[count++] = (CacheFile) {
+                .path = strdup(path),
+                .size = (usize) st.st_size,
+                .used = st.st_mtim
+            };
+
+            total += (usize) st.st_size;
+        }
+
+        closedir(dir);
+    }
+
+    if (total > cache -> limit) {
+        const usize target = cache -> limit / 100 * CACHE_EVICT_TARGET;
+
+        qsort(files, count, sizeof(CacheFile), compare_used);
+
+        for (usize i = 0; i < count && total > target; i++) {
+            if (unlink(files[i].path) == 0) {
+                total -= files[i].size;
+                stats -> evictions++;
+            }
+        }
+    }
+
+    stats -> bytes = total;
+    stats -> entries = 0;
+
+    for (usize i = 0; i < count; i++) {
+        stats -> entries += access(files[i].path, F_OK) == 0;
+        free(files[i].path);
+    }
+
+    free(files);
+}
+
+static void print_stats(const Cache* cache, const CacheStats* stats) {
+    const u64 lookups = stats -> hits + stats -> misses;
+
+    fprintf(stderr, "\ncache %s\n", cache -> dir);
+    fprintf(stderr, "  %-10s %12s %12s\n", "", "this run", "total");
+    fprintf(stderr, "  %-10s %12llu %12llu\n", "hits", (unsigned long long) cache -> hits, (unsigned long long) stats -> hits);
+    fprintf(stderr, "  %-10s %12llu %12llu\n", "misses", (unsigned long long) cache -> misses, (unsigned long long) stats -> misses);
+    fprintf(stderr, "  %-10s %12llu %12llu\n", "stores", (unsigned long long) cache -> stores, (unsigned long long) stats -> stores);
+    fprintf(stderr, "  %-10s %12s %12llu\n", "evictions", "", (unsigned long long) stats -> evictions);
+    fprintf(stderr, "  %-10s %12s %12llu\n", "entries", "", (unsigned long long) stats -> entries);
+    // --cache-limit counts in MiB, so does the size
+    fprintf(stderr, "  %-10s %12s %9.1f MiB of %.1f MiB\n", "size", "", stats -> bytes / (1024.0 * 1024.0), cache -> limit / (1024.0 * 1024.0));
+
+    if (lookups > 0) {
+        fprintf(stderr, "  %-10s %12s %11.1f%%\n", "hit rate", "", 100.0 * stats -> hits / lookups);
+    }
+}
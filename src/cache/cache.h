@@ -0,0 +1,82 @@
+#pragma once
+#ifndef MYTHRIL_CACHE_H
+#define MYTHRIL_CACHE_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+#include "../diagnostics/types.h"
+#include "../serialize/types.h"
+#include "../tokens/types.h"
+
+/*
+*
+*   creates dir if it is missing. limit is in bytes, the cache is
+*   brought back under it when the run is closed
+*
+*/
+i32 open_cache(Cache* cache, const char* dir, usize limit);
+
+/*
+*
+*   adds the counts of the run to the stats file, evicts the least
+*   recently used entries if the cache grew past its limit and prints
+*   the stats to stderr if asked to
+*
+*/
+void close_cache(Cache* cache, b8 print_stats);
+
+/*
+*
+*   SHA-256 of CACHE_VERSION, flags and the source. flags are whatever
+*   changes what lexing and parsing the source produce
+*
+*/
+CacheKey cache_key(const char* source, usize len, u32 flags);
+
+/*
+*
+*   maps the entry of key if there is one holding every one of parts
+*   and marks it as used. Returns -1 on a miss
+*
+*/
+i32 cache_lookup(Cache* cache, const CacheKey* key, usize source_len, u32 parts, CacheEntry* entry);
+
+void unload_cache_entry(CacheEntry* entry);
+
+// a view of the AST of entry, which has to stay loaded as long as the view
+i32 cache_open_ast(const CacheEntry* entry, AstCacheView* view);
+
+// the tokens of entry into tokens, lexemes pointing into source again
+void cache_replay_tokens(const CacheEntry* entry, Tokens* tokens, ArenaAllocator* arena, const char* source);
+
+/*
+*
+*   reports the diagnostics of entry to ctx as if file had just been
+*   lexed, and parsed unless lex_only. Their text stays in the entry
+*
+*/
+void cache_replay_diagnostics(const CacheEntry* entry, DiagContext* ctx, u16 file, const char* source, b8 lex_only);
+
+/*
+*
+*   writes what the run produced for file: its diagnostics in ctx, the
+*   first lex_diagnostics of them the lexer's, its tokens and ast unless
+*   that is nullptr. Returns -1 and writes nothing if any of it cannot
+*   be stored
+*
+*/
+i32 cache_store(
+    Cache* cache,
+    ArenaAllocator* arena,
+    const CacheKey* key,
+    const char* source,
+    usize source_len,
+    const Tokens* tokens,
+    const AstCacheBlob* ast,
+    const DiagContext* ctx,
+    u16 file,
+    u32 lex_diagnostics
+);
+
+#endif // !MYTHRIL_CACHE_H
@@ -0,0 +1,145 @@
+#pragma once
+#ifndef MYTHRIL_CACHE_TYPES_H
+#define MYTHRIL_CACHE_TYPES_H
+
+#include "../hash/types.h"
+#include "../utils/types.h"
+
+#define CACHE_MAGIC         0x4843594d /* "MYCH" */
+
+// part of every key, raised whenever the lexer, parser or a format changes what an entry holds
+#define CACHE_VERSION       3
+
+#define CACHE_EXTENSION     ".mycache"
+#define CACHE_STATS_NAME    "stats"
+
+// --cache-limit=MIB
+#define CACHE_DEFAULT_LIMIT (512 * 1024 * 1024)
+
+// evicting stops once the cache is down to this share of the limit, in percent
+#define CACHE_EVICT_TARGET  90
+
+#define CACHE_NO_STRING     UINT32_MAX
+#define CACHE_NO_OFFSET     UINT32_MAX
+
+typedef enum {
+    CACHE_HAS_TOKENS = 1 << 0,
+    CACHE_HAS_AST    = 1 << 1
+} CacheParts;
+
+typedef struct {
+    u8 bytes[SHA256_DIGEST_SIZE];
+} CacheKey;
+
+/*
+*
+*   Entry format
+*
+*   One file per key, named by the key in hex below a directory named
+*   by its first byte. Used straight out of a read only mapping, every
+*   section starts 8 byte aligned at an offset from the start of the
+*   file. Source positions are byte offsets into the source, strings
+*   offsets of NUL terminated text in the string section
+*
+*       CacheHeader
+*       CacheDiagnostic diagnostics[diagnostic_count]
+*       CacheToken tokens[token_count]
+*       the serialized AST, see serialize/types.h
+*       string bytes
+*
+*/
+typedef struct {
+    u32 magic;
+    u32 version;
+
+    CacheKey key;
+    u64 source_len;
+
+    u32 total_size;
+    u32 parts;  // CacheParts
+
+    u32 diagnostic_count;
+    u32 diagnostics;
+
+    // the first ones are the lexer's, all a run that stops after lexing gets to see
+    u32 lex_diagnostic_count;
+
+    u32 token_count;
+    u32 tokens;
+
+    u32 ast;
+    u32 ast_size;
+
+    u32 strings;
+    u32 _padding;
+} CacheHeader;
+
+typedef struct {
+    u32 offset;     // CACHE_NO_OFFSET where the diagnostic points nowhere
+    u32 length;
+
+    u32 help;
+    u32 args[2];
+    u32 arg_length;
+
+    u8 level;       // DiagnosticLevel
+    u8 message;     // DiagMessage
+    u8 _padding[2];
+} CacheDiagnostic;
+
+typedef struct {
+    u32 offset;     // CACHE_NO_OFFSET for a lexeme outside the source
+    u32 length;
+    u32 kind;       // TokenKind
+} CacheToken;
+
+/*
+*
+*   counts kept in CACHE_STATS_NAME across runs, bytes and entries are
+*   brought up to date by every eviction and only added to in between
+*
+*/
+typedef struct {
+    u32 magic;
+    u32 version;
+
+    u64 hits;
+    u64 misses;
+    u64 stores;
+    u64 evictions;
+
+    u64 bytes;
+    u64 entries;
+} CacheStats;
+
+/*
+*
+*   a cache directory in use by one run, the counts are the runs own
+*   until close_cache() adds them to the stats file
+*
+*/
+typedef struct {
+    const char* dir;
+    usize limit;
+
+    u64 hits;
+    u64 misses;
+    u64 stores;
+
+    // bytes and entries written by this run
+    u64 stored_bytes;
+} Cache;
+
+/*
+*
+*   an entry found by cache_lookup(), base is the read only mapping
+*
+*/
+typedef struct {
+    const u8* base;
+    usize size;
+
+    const CacheHeader* header;
+} CacheEntry;
+
+#endif // !MYTHRIL_CACHE_TYPES_H
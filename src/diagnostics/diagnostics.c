@@ -2,39 +2,109 @@
 #include "types.h"
 
 #include "../tokens/types.h"
+#include "../unit/unit.h"
 #include "../utils/ansi_codes.h"
+#include "../utils/macros.h"
+#include "../writer/writer.h"
+#include "stream/stream.h"
 
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <unistd.h>
 
-void add_diagnostic(
-    DiagContext* ctx,
-    DiagnosticLevel level,
-    SourceLocation location,
-    const char* msg,
-    const char* help
-) {
-    if (level == DIAGNOSTIC_WARN) {
+static const char* DIAG_FORMATS[] = {
+    X_DIAG_MESSAGES(GENERATE_DIAG_FORMAT)
+};
+
+static b8 same_diagnostic(const Diagnostic* a, const Diagnostic* b);
+static b8 repeats_last(const DiagContext* ctx, const Diagnostic* diag);
+
+void add_diagnostic(DiagContext* ctx, Diagnostic diag) {
+    if (MEOW_UNLIKELY(ctx -> aborted)) {
+        return;
+    }
+
+    if (repeats_last(ctx, &diag)) {
+        return;
+    }
+
+    if (diag.level == DIAGNOSTIC_WARN) {
         ctx -> warning_count++;
-    } else if (level == DIAGNOSTIC_ERROR) {
+    } else if (diag.level == DIAGNOSTIC_ERROR) {
         ctx -> error_count++;
-    } else if (level == DIAGNOSTIC_NOTE) {
+
+        if (ctx -> max_errors > 0 && ctx -> error_count >= ctx -> max_errors) {
+            ctx -> aborted = true;
+        }
+    } else if (diag.level == DIAGNOSTIC_NOTE) {
         ctx -> note_count++;
     }
 
-    u32 total = ctx -> warning_count + ctx -> error_count + ctx -> note_count;
+    if (MEOW_UNLIKELY(ctx -> count >= ctx -> capacity)) {
+        const u32 capacity = ctx -> capacity > 0 ? ctx -> capacity * 2 : DIAGNOSTICS_INIT_CAPACITY;
+
+        ctx -> items = ctx -> items
+            ? arena_realloc(ctx -> arena, ctx -> items, ctx -> capacity * sizeof(Diagnostic), capacity * sizeof(Diagnostic))
+            : arena_array(ctx -> arena, Diagnostic, capacity);
+
+        ctx -> capacity = capacity;
+    }
+
+    diag.sequence = ctx -> count;
+    ctx -> items[ctx -> count++] = diag;
+
+    if (ctx -> stream && ctx -> hold == 0) {
+        diagnostics_flush_stream(ctx);
+    }
+}
+
+/*
+*
+*   diag says what one of the diagnostics last recorded at its place
+*   already says. Nothing is collapsed while held, a speculative attempt
+*   is told to have failed by the errors it reports
+*
+*/
+static b8 repeats_last(const DiagContext* ctx, const Diagnostic* diag) {
+    if (ctx -> hold > 0) {
+        return false;
+    }
+
+    for (u32 i = ctx -> count; i > 0; i--) {
+        const Diagnostic* last = &ctx -> items[i - 1];
+
+        if (last -> file != diag -> file || last -> pointer != diag -> pointer) {
+            return false;
+        }
+
+        if (same_diagnostic(last, diag)) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
-    if (total >= MAX_DIAGNOSTICS) {
+void diagnostics_flush_stream(DiagContext* ctx) {
+    if (!ctx -> stream) {
         return;
     }
 
-    Diagnostic* diag = &ctx -> nodes[ctx -> index++];
+    while (ctx -> streamed < ctx -> count) {
+        diag_stream_write(ctx -> stream, ctx, &ctx -> items[ctx -> streamed++]);
+    }
+}
+
+void diagnostics_append(DiagContext* ctx, const DiagContext* src) {
+    for (u32 i = 0; i < src -> count; i++) {
+        add_diagnostic(ctx, src -> items[i]);
+    }
+}
 
-    diag -> level = level;
-    diag -> location = location;
-    diag -> message = msg;
-    diag -> help = help;
+// the arena does not align, text shares it with the diagnostic list
+static char* alloc_text(ArenaAllocator* arena, usize size) {
+    return arena_alloc(arena, (size + 7) & ~(usize) 7);
 }
 
 char* format_message(ArenaAllocator* arena, const char* fmt, va_list va_args) {
@@ -48,95 +118,125 @@ char* format_message(ArenaAllocator* arena, const char* fmt, va_list va_args) {
         return nullptr;
     }
 
-    char* buffer = arena_alloc(arena, size + 1);
+    char* buffer = alloc_text(arena, size + 1);
     vsnprintf(buffer, size + 1, fmt, va_args);
 
     return buffer;
 }
 
-void diag_error(DiagContext* ctx, SourceLocation loc, const char* fmt, ...) {
+static Diagnostic diagnostic_at(const Token* token, DiagnosticLevel level, DiagMessage message) {
+    return (Diagnostic) {
+        .pointer = token -> lexeme,
+        .help = nullptr,
+        .args = { nullptr, nullptr },
+        .arg_length = 0,
+        .length = token -> length,
+        .sequence = 0,
+        .file = token -> file,
+        .level = (u8) level,
+        .message = (u8) message
+    };
+}
+
+static void diag_formatted(DiagContext* ctx, const Token* token, DiagnosticLevel level, const char* fmt, va_list args) {
+    // nothing would be recorded, do not format it either
+    if (MEOW_UNLIKELY(ctx -> aborted)) {
+        return;
+    }
+
+    Diagnostic diag = diagnostic_at(token, level, DIAG_TEXT);
+    diag.args[0] = format_message(ctx -> arena, fmt, args);
+
+    add_diagnostic(ctx, diag);
+}
+
+void diag_error(DiagContext* ctx, const Token* token, const char* fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
-    char* message = format_message(ctx -> arena, fmt, args);
+    diag_formatted(ctx, token, DIAGNOSTIC_ERROR, fmt, args);
     va_end(args);
-    
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, message, NULL);
 }
 
-void diag_warning(DiagContext* ctx, SourceLocation loc, const char* fmt, ...) {
+void diag_warning(DiagContext* ctx, const Token* token, const char* fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
-    char* message = format_message(ctx -> arena, fmt, args);
+    diag_formatted(ctx, token, DIAGNOSTIC_WARN, fmt, args);
     va_end(args);
-    
-    add_diagnostic(ctx, DIAGNOSTIC_WARN, loc, message, NULL);
 }
 
-void diag_note(DiagContext* ctx, SourceLocation loc, const char* fmt, ...) {
+void diag_note(DiagContext* ctx, const Token* token, const char* fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
-    char* message = format_message(ctx -> arena, fmt, args);
+    diag_formatted(ctx, token, DIAGNOSTIC_NOTE, fmt, args);
     va_end(args);
-    
-    add_diagnostic(ctx, DIAGNOSTIC_NOTE, loc, message, NULL);
 }
 
-void diag_error_help(DiagContext* ctx, SourceLocation loc, const char* message, const char* help) {
-    usize msg_len = strlen(message);
-    usize help_len = strlen(help);
-    
-    char* msg_copy = arena_alloc(ctx -> arena, msg_len + 1);
-    char* help_copy = arena_alloc(ctx -> arena, help_len + 1);
-    
-    arena_memcpy(msg_copy, message, msg_len + 1);
-    arena_memcpy(help_copy, help, help_len + 1);
-    
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, msg_copy, help_copy);
+void diag_error_help(DiagContext* ctx, const Token* token, const char* message, const char* help) {
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, DIAG_TEXT);
+
+    diag.args[0] = message;
+    diag.help = help;
+
+    add_diagnostic(ctx, diag);
+}
+
+void diag_error_token(DiagContext* ctx, const Token* token, DiagMessage message) {
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, message);
+
+    diag.args[0] = token -> lexeme;
+    diag.arg_length = token -> length;
+
+    add_diagnostic(ctx, diag);
 }
 
 /*
 *   nice premade helper things
 */
 
-void diag_expected(DiagContext* ctx, SourceLocation loc, const char* expected, const char* help) {
-    char* msg = arena_alloc(ctx -> arena, 256);
+void diag_expected(DiagContext* ctx, const Token* token, const char* expected, const char* help) {
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, DIAG_EXPECTED);
 
-    snprintf(msg, 256, "expected %s", expected);
+    diag.args[0] = expected;
+    diag.help = help;
 
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, msg, help);
+    add_diagnostic(ctx, diag);
 }
 
-void diag_expected_found(DiagContext* ctx, SourceLocation loc, const char* expected, const char* found) {
-    char* msg = arena_alloc(ctx -> arena, 512);
+void diag_expected_found(DiagContext* ctx, const Token* token, const char* expected, const char* found) {
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, DIAG_EXPECTED_FOUND);
 
-    snprintf(msg, 512, "expected %s, found %s", expected, found);
+    diag.args[0] = expected;
+    diag.args[1] = found;
 
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, msg, NULL);
+    add_diagnostic(ctx, diag);
 }
 
 void diag_undefined(
     DiagContext* ctx,
-    SourceLocation loc,
+    const Token* token,
     const char* what,
     const char* name,
     const char* help
 ) {
-    char* msg = arena_alloc(ctx -> arena, 512);
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, DIAG_UNDEFINED);
 
-    snprintf(msg, 512, "undefined %s '%s'", what, name);
+    diag.args[0] = what;
+    diag.args[1] = name;
+    diag.help = help;
 
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, msg, help);
+    add_diagnostic(ctx, diag);
 }
 
-void diag_redefined(DiagContext* ctx, SourceLocation loc, const char* type, const char* name) {
-    char* msg = arena_alloc(ctx -> arena, 512);
+void diag_redefined(DiagContext* ctx, const Token* token, const char* type, const char* name) {
+    Diagnostic diag = diagnostic_at(token, DIAGNOSTIC_ERROR, DIAG_REDEFINED);
 
-    snprintf(msg, 512, "%s '%s' is already defined", type, name);
+    diag.args[0] = type;
+    diag.args[1] = name;
 
-    add_diagnostic(ctx, DIAGNOSTIC_ERROR, loc, msg, NULL);
+    add_diagnostic(ctx, diag);
 }
 
 SourceLocation source_location_from_token(const char* path, const char* source, Token* token) {
@@ -166,6 +266,135 @@ SourceLocation source_location_from_token(const char* path, const char* source,
     };
 }
 
+SourceLocation diagnostic_location(const DiagContext* ctx, const Diagnostic* diag) {
+    Token token = {
+        .lexeme = diag -> pointer,
+        .length = diag -> length,
+        .file = diag -> file
+    };
+
+    if (ctx -> units && diag -> file < ctx -> unit_count) {
+        return unit_location(&ctx -> units[diag -> file], &token);
+    }
+
+    return source_location_from_token(ctx -> path, ctx -> source_buffer, &token);
+}
+
+const char* diagnostic_message(ArenaAllocator* arena, const Diagnostic* diag) {
+    const char* fmt = DIAG_FORMATS[diag -> message];
+    const char* first = diag -> args[0];
+    const char* second = diag -> args[1];
+
+    char* message;
+    i32 size;
+
+    switch (diag -> message) {
+        case DIAG_TEXT: {
+            return first;
+        }
+
+        case DIAG_UNKNOWN_TOKEN:
+        case DIAG_UNEXPECTED_TOP_LEVEL: {
+            size = snprintf(NULL, 0, fmt, (i32) diag -> arg_length, first);
+            message = alloc_text(arena, size + 1);
+            snprintf(message, size + 1, fmt, (i32) diag -> arg_length, first);
+        } break;
+
+        case DIAG_EXPECTED: {
+            size = snprintf(NULL, 0, fmt, first);
+            message = alloc_text(arena, size + 1);
+            snprintf(message, size + 1, fmt, first);
+        } break;
+
+        default: {
+            size = snprintf(NULL, 0, fmt, first, second);
+            message = alloc_text(arena, size + 1);
+            snprintf(message, size + 1, fmt, first, second);
+        } break;
+    }
+
+    return message;
+}
+
+static i32 compare_diagnostics(const void* a, const void* b) {
+    const Diagnostic* x = a;
+    const Diagnostic* y = b;
+
+    if (x -> file != y -> file) {
+        return x -> file < y -> file ? -1 : 1;
+    }
+
+    if (x -> pointer != y -> pointer) {
+        return x -> pointer < y -> pointer ? -1 : 1;
+    }
+
+    return x -> sequence < y -> sequence ? -1 : x -> sequence > y -> sequence;
+}
+
+static b8 same_text(const char* a, const char* b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static b8 same_diagnostic(const Diagnostic* a, const Diagnostic* b) {
+    if (
+        a -> level != b -> level            ||
+        a -> message != b -> message        ||
+        a -> length != b -> length          ||
+        a -> arg_length != b -> arg_length  ||
+        !same_text(a -> help, b -> help)
+    ) {
+        return false;
+    }
+
+    if (a -> message == DIAG_UNKNOWN_TOKEN || a -> message == DIAG_UNEXPECTED_TOP_LEVEL) {
+        return memcmp(a -> args[0], b -> args[0], a -> arg_length) == 0;
+    }
+
+    return same_text(a -> args[0], b -> args[0]) && same_text(a -> args[1], b -> args[1]);
+}
+
+void diagnostics_sort(DiagContext* ctx) {
+    if (ctx -> count == 0) {
+        return;
+    }
+
+    qsort(ctx -> items, ctx -> count, sizeof(Diagnostic), compare_diagnostics);
+
+    u32 kept = 0;
+    u32 run = 0; // first kept diagnostic at the current place
+
+    for (u32 i = 0; i < ctx -> count; i++) {
+        const Diagnostic* diag = &ctx -> items[i];
+
+        if (kept > 0 && (ctx -> items[run].file != diag -> file || ctx -> items[run].pointer != diag -> pointer)) {
+            run = kept;
+        }
+
+        b8 repeat = false;
+
+        for (u32 j = run; j < kept && !repeat; j++) {
+            repeat = same_diagnostic(&ctx -> items[j], diag);
+        }
+
+        if (!repeat) {
+            ctx -> items[kept++] = *diag;
+        }
+    }
+
+    ctx -> count = kept;
+    ctx -> error_count = 0;
+    ctx -> warning_count = 0;
+    ctx -> note_count = 0;
+
+    for (u32 i = 0; i < kept; i++) {
+        switch (ctx -> items[i].level) {
+            case DIAGNOSTIC_ERROR:  ctx -> error_count++; break;
+            case DIAGNOSTIC_WARN:   ctx -> warning_count++; break;
+            case DIAGNOSTIC_NOTE:   ctx -> note_count++; break;
+        }
+    }
+}
+
 void get_source_line(const char* source, const char* ptr, const char** line_start, usize* line_len) {
     const char* start = ptr;
     const char* end = ptr;
@@ -215,7 +444,26 @@ const char* get_line_col_indent(usize line) {
     return "";
 }
 
-void diagnostics_print(DiagContext* ctx, Diagnostic* diag) {
+// "<indent> |" in front of the lines around the source line
+static void write_gutter(Writer* w, const char* indent, const char* bold, const char* reset) {
+    writer_str(w, indent);
+    writer_char(w, ' ');
+    writer_str(w, bold);
+    writer_char(w, '|');
+    writer_str(w, reset);
+}
+
+static void write_count(Writer* w, u32 count, const char* what) {
+    writer_u64(w, count);
+    writer_char(w, ' ');
+    writer_str(w, what);
+
+    if (count != 1) {
+        writer_char(w, 's');
+    }
+}
+
+void diagnostics_print(Writer* w, DiagContext* ctx, Diagnostic* diag) {
     b8 colour_support = ctx -> stderr_supports_colours;
 
     const char* colour = colour_support ? level_colour(diag -> level) : "";
@@ -224,108 +472,129 @@ void diagnostics_print(DiagContext* ctx, Diagnostic* diag) {
 
     const char* green   = colour_support ? ANSI_GREEN : "";
     const char* magenta = colour_support ? ANSI_MAGENTA : "";
+
+    // nothing is looked up or formatted before it is printed
+    const SourceLocation location = diagnostic_location(ctx, diag);
+    const char* message = diagnostic_message(ctx -> arena, diag);
     
     // header
-    fprintf(
-        stderr,
-        "%s%s%s%s: %s%s%s\n",
-        bold,
-        colour,
-        level_strings(diag -> level),
-        reset,
-        bold,
-        diag -> message,
-        reset
-    );
+    writer_str(w, bold);
+    writer_str(w, colour);
+    writer_str(w, level_strings(diag -> level));
+    writer_str(w, reset);
+    writer_write(w, ": ", 2);
+    writer_str(w, bold);
+    writer_str(w, message);
+    writer_str(w, reset);
+    writer_char(w, '\n');
     
     // location
-    fprintf(
-        stderr,
-        " %s%s-->%s %s:%zu:%zu\n",
-        magenta,
-        bold,
-        reset,
-        diag -> location.path,
-        diag -> location.line,
-        diag -> location.column
-    );
+    writer_char(w, ' ');
+    writer_str(w, magenta);
+    writer_str(w, bold);
+    writer_write(w, "-->", 3);
+    writer_str(w, reset);
+    writer_char(w, ' ');
+    writer_str(w, location.path);
+    writer_char(w, ':');
+    writer_u64(w, location.line);
+    writer_char(w, ':');
+    writer_u64(w, location.column);
+    writer_char(w, '\n');
     
     // source line
     const char* line_start;
     usize line_len;
 
-    get_source_line(diag -> location.source_buffer, diag -> location.pointer, &line_start, &line_len);
-    usize line = diag -> location.line;
+    get_source_line(location.source_buffer, location.pointer, &line_start, &line_len);
+    usize line = location.line;
     const char* indent = get_line_col_indent(line);
     
     // source context
-    fprintf(stderr, "%s %s|%s\n", indent, bold, reset);
-    fprintf(stderr, "%zu %s|%s ", line, bold, reset);
-    fprintf(stderr, "%.*s\n", (i32) line_len, line_start);
-    fprintf(stderr, "%s %s|%s ", indent, bold, reset);
-    
-    usize spaces = diag -> location.column - 1;
-
-    for (usize i = 0; i < spaces; i++) {
-        fprintf(stderr, " ");
-    }
+    write_gutter(w, indent, bold, reset);
+    writer_char(w, '\n');
+
+    writer_u64(w, line);
+    writer_char(w, ' ');
+    writer_str(w, bold);
+    writer_char(w, '|');
+    writer_str(w, reset);
+    writer_char(w, ' ');
+    // a NUL inside the line ends it, the terminal would drop the rest anyway
+    writer_write(w, line_start, strnlen(line_start, line_len));
+    writer_char(w, '\n');
+
+    write_gutter(w, indent, bold, reset);
+    writer_char(w, ' ');
+
+    writer_repeat(w, ' ', location.column - 1);
     
-    fprintf(stderr, "%s%s", green, bold);
+    writer_str(w, green);
+    writer_str(w, bold);
 
-    usize caret_len = diag -> location.length > 0 ? diag -> location.length : 1;
-
-    for (usize i = 0; i < caret_len; i++) {
-        fprintf(stderr, "^");
-    }
+    writer_repeat(w, '^', location.length > 0 ? location.length : 1);
 
-    fprintf(stderr, "%s", reset);
+    writer_str(w, reset);
     
     if (diag -> help) {
-        fprintf(stderr, " %s%shelp: %s%s", bold, green, diag -> help, reset);
+        writer_char(w, ' ');
+        writer_str(w, bold);
+        writer_str(w, green);
+        writer_write(w, "help: ", 6);
+        writer_str(w, diag -> help);
+        writer_str(w, reset);
     }
     
-    fprintf(stderr, "\n");
-    fprintf(stderr, "%s %s|%s\n", indent, bold, reset);
+    writer_char(w, '\n');
+    write_gutter(w, indent, bold, reset);
+    writer_char(w, '\n');
 }
 
 void diagnostics_print_all(DiagContext* ctx) {
     b8 colour_support = ctx -> stderr_supports_colours;
+
+    diagnostics_sort(ctx);
+
+    const u32 limit = ctx -> display_limit;
+    const u32 shown = limit > 0 && ctx -> count > limit ? limit : ctx -> count;
+
+    // stderr is unbuffered, everything goes out in as few writes as fit the buffer
+    Writer w;
+    init_writer(&w, ctx -> arena, STDERR_FILENO, 0);
     
-    for (u32 i = 0; i < ctx -> index; i++) {
-        diagnostics_print(ctx, &ctx -> nodes[i]);
-        fprintf(stderr, "\n");
+    for (u32 i = 0; i < shown; i++) {
+        diagnostics_print(&w, ctx, &ctx -> items[i]);
+        writer_char(&w, '\n');
     }
     
-    usize total_count = ctx -> error_count + ctx -> warning_count + ctx -> note_count;
-
-    if (total_count > MAX_DIAGNOSTICS) {
-        fprintf(
-            stderr,
-            "... and %zu more diagnostic%s not shown\n\n",
-            total_count - MAX_DIAGNOSTICS,
-            (total_count - MAX_DIAGNOSTICS) == 1 ? "" : "s"
-        );
+    if (ctx -> count > shown) {
+        writer_write(&w, "... and ", 8);
+        writer_u64(&w, ctx -> count - shown);
+        writer_str(&w, ctx -> count - shown == 1 ? " more diagnostic not shown\n\n" : " more diagnostics not shown\n\n");
     }
     
     if (ctx -> error_count > 0 || ctx -> warning_count > 0) {
-        fprintf(
-            stderr,
-            "compilation %sfailed%s due to %u error%s",
-            colour_support ? ANSI_RED : "",
-            colour_support ? ANSI_RESET : "",
-            ctx -> error_count,
-            ctx -> error_count == 1 ? "" : "s"
-        );
+        writer_str(&w, "compilation ");
+        writer_str(&w, colour_support ? ANSI_RED : "");
+        writer_str(&w, "failed");
+        writer_str(&w, colour_support ? ANSI_RESET : "");
+        writer_str(&w, " due to ");
+        write_count(&w, ctx -> error_count, "error");
         
         if (ctx -> warning_count > 0) {
-            fprintf(
-                stderr,
-                " and %u warning%s",
-                ctx -> warning_count,
-                ctx -> warning_count == 1 ? "" : "s"
-            );
+            writer_str(&w, " and ");
+            write_count(&w, ctx -> warning_count, "warning");
         }
         
-        fprintf(stderr, "%s\n", colour_support ? ANSI_RESET : "");
+        writer_str(&w, colour_support ? ANSI_RESET : "");
+        writer_char(&w, '\n');
     }
+
+    if (ctx -> aborted) {
+        writer_str(&w, "compilation stopped after ");
+        write_count(&w, ctx -> max_errors, "error");
+        writer_char(&w, '\n');
+    }
+
+    writer_flush(&w);
 }
@@ -5,76 +5,85 @@
 #include "types.h"
 
 #include "../tokens/types.h"
+#include "../writer/types.h"
 
 #include <stdarg.h>
 
 /*
 *
-*   adds a diagnostic to the array, no more than 32 diagnostics 
-*   will be in the array. Warning/Error counts continue to 
-*   increment regardless though, this is just to limit the output
-*   to MAX_DIAGNOSTICS (defined in types.h)
+*   records a diagnostic, the list grows on the arena of ctx. The error
+*   budget stops recording, once it is spent every later diagnostic is
+*   ignored. So is one that repeats a diagnostic recorded right before
+*   it at the same place, it is not counted either
 *
 */
-void add_diagnostic(
-    DiagContext* ctx,
-    DiagnosticLevel level,
-    SourceLocation location,
-    const char* msg,
-    const char* help
-);
+void add_diagnostic(DiagContext* ctx, Diagnostic diag);
 
 /*
 *
-*   simply formats the message based on the parameters
-*   fmt, va_args and allocates the message on the arena
-*   it's a C string, null terminated
+*   writes every diagnostic not yet on ctx -> stream, the ones held back
+*   by a speculative parse included
 *
 */
-char* format_message(ArenaAllocator* arena, const char* fmt, va_list va_args);
+void diagnostics_flush_stream(DiagContext* ctx);
 
 /*
 *
-*   Add an error to the array
+*   adds every diagnostic of src to ctx in order, as if they had been
+*   reported to ctx directly
 *
 */
-void diag_error(DiagContext* ctx, SourceLocation loc, const char* fmt, ...);
+void diagnostics_append(DiagContext* ctx, const DiagContext* src);
 
 /*
 *
-*   Add a warning to the array
+*   simply formats the message based on the parameters
+*   fmt, va_args and allocates the message on the arena
+*   it's a C string, null terminated
 *
 */
-void diag_warning(DiagContext* ctx, SourceLocation loc, const char* fmt, ...);
+char* format_message(ArenaAllocator* arena, const char* fmt, va_list va_args);
 
 /*
 *
-*   Add a note to the array
+*   printf style diagnostics at the text of token, these are formatted
+*   right away. The helpers further down keep their arguments and are
+*   only formatted if they are ever rendered
 *
 */
-void diag_note(DiagContext* ctx, SourceLocation loc, const char* fmt, ...);
+void diag_error(DiagContext* ctx, const Token* token, const char* fmt, ...);
+void diag_warning(DiagContext* ctx, const Token* token, const char* fmt, ...);
+void diag_note(DiagContext* ctx, const Token* token, const char* fmt, ...);
 
+/*
+*
+*   Add error message, with a help/potential fix. Both are kept as
+*   pointers, string literals in practice
+*
+*/
+void diag_error_help(DiagContext* ctx, const Token* token, const char* message, const char* help);
 
 /*
 *
-*   Add error message, with a help/potential fix
+*   error whose message quotes the text of token, message is one of
+*   the SLICE messages like DIAG_UNKNOWN_TOKEN
 *
 */
-void diag_error_help(DiagContext* ctx, SourceLocation loc, const char* message, const char* help);
+void diag_error_token(DiagContext* ctx, const Token* token, DiagMessage message);
 
 /*
 *
 *   Premade expected error
 *
 */
-void diag_expected(DiagContext* ctx, SourceLocation loc, const char* expected, const char* help);
+void diag_expected(DiagContext* ctx, const Token* token, const char* expected, const char* help);
 
 /*
 *
 *   Premade expected, but found error
 *
 */
-void diag_expected_found(DiagContext* ctx, SourceLocation loc, const char* expected, const char* found);
+void diag_expected_found(DiagContext* ctx, const Token* token, const char* expected, const char* found);
 
 /*
 *
@@ -83,7 +92,7 @@ void diag_expected_found(DiagContext* ctx, SourceLocation loc, const char* expec
 */
 void diag_undefined(
     DiagContext* ctx,
-    SourceLocation loc,
+    const Token* token,
     const char* what,
     const char* name,
     const char* help
@@ -94,7 +103,7 @@ void diag_undefined(
 *   Premade redefined error
 *
 */
-void diag_redefined(DiagContext* ctx, SourceLocation loc, const char* type, const char* name);
+void diag_redefined(DiagContext* ctx, const Token* token, const char* type, const char* name);
 
 /*
 *
@@ -103,6 +112,31 @@ void diag_redefined(DiagContext* ctx, SourceLocation loc, const char* type, cons
 */
 SourceLocation source_location_from_token(const char* path, const char* source, Token* token);
 
+/*
+*
+*   where diag points, through the line table of its unit. Diagnostics
+*   of contexts without units are found in path and source_buffer
+*
+*/
+SourceLocation diagnostic_location(const DiagContext* ctx, const Diagnostic* diag);
+
+/*
+*
+*   the message of diag, formatted on the arena. DIAG_TEXT messages are
+*   returned as they are
+*
+*/
+const char* diagnostic_message(ArenaAllocator* arena, const Diagnostic* diag);
+
+/*
+*
+*   orders the diagnostics by file and offset, report order between
+*   those at the same place, and drops repeats of the same message at
+*   the same place. The counts are those of what is left
+*
+*/
+void diagnostics_sort(DiagContext* ctx);
+
 /*
 *
 *   get the full line of code where the error is present
@@ -126,14 +160,15 @@ const char* level_string(DiagnosticLevel level);
 
 /*
 *
-*   print single diagnostic
+*   renders a single diagnostic into w
 *
 */
-void diagnostics_print(DiagContext* ctx, Diagnostic* diag);
+void diagnostics_print(Writer* w, DiagContext* ctx, Diagnostic* diag);
 
 /*
 *
-*   print all diagnostic
+*   sorts, then prints up to display_limit diagnostics and a summary to
+*   stderr. Rendered into one buffer and written out in one go
 *
 */
 void diagnostics_print_all(DiagContext* ctx);
@@ -0,0 +1,119 @@
+#include "stream.h"
+#include "types.h"
+
+#include "../diagnostics.h"
+#include "../../writer/writer.h"
+
+#include <string.h>
+
+#define SARIF_HEADER                                                                    \
+    "{\"version\":\"2.1.0\","                                                           \
+    "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","                    \
+    "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"mythril\"}},\"results\":[\n"
+
+#define SARIF_FOOTER "]}]}\n"
+
+static const char* LEVEL_NAMES[] = {
+    [DIAGNOSTIC_ERROR] = "error",
+    [DIAGNOSTIC_WARN] = "warning",
+    [DIAGNOSTIC_NOTE] = "note"
+};
+
+static void write_string(Writer* w, const char* str) {
+    writer_json_string(w, str, strlen(str));
+}
+
+void init_diag_stream(DiagStream* stream, ArenaAllocator* arena, i32 fd, DiagFormat format) {
+    init_writer(&stream -> writer, arena, fd, DIAG_STREAM_CAPACITY);
+
+    stream -> format = format;
+    stream -> written = 0;
+
+    if (format == DIAG_FORMAT_SARIF) {
+        writer_str(&stream -> writer, SARIF_HEADER);
+        writer_flush(&stream -> writer);
+    }
+}
+
+static void write_json(Writer* w, const SourceLocation* location, usize offset, const Diagnostic* diag, const char* message) {
+    writer_str(w, "{\"file\":");
+    write_string(w, location -> path);
+    writer_str(w, ",\"line\":");
+    writer_u64(w, location -> line);
+    writer_str(w, ",\"column\":");
+    writer_u64(w, location -> column);
+    writer_str(w, ",\"offset\":");
+    writer_u64(w, offset);
+    writer_str(w, ",\"length\":");
+    writer_u64(w, location -> length);
+    writer_str(w, ",\"level\":\"");
+    writer_str(w, LEVEL_NAMES[diag -> level]);
+    writer_str(w, "\",\"message\":");
+    write_string(w, message);
+    writer_str(w, ",\"help\":");
+
+    if (diag -> help) {
+        write_string(w, diag -> help);
+    } else {
+        writer_str(w, "null");
+    }
+
+    writer_str(w, "}\n");
+}
+
+static void write_sarif(Writer* w, const SourceLocation* location, usize offset, const Diagnostic* diag, const char* message, b8 first) {
+    if (!first) {
+        writer_str(w, ",\n");
+    }
+
+    writer_str(w, "{\"level\":\"");
+    writer_str(w, LEVEL_NAMES[diag -> level]);
+    writer_str(w, "\",\"message\":{\"text\":");
+    write_string(w, message);
+    writer_str(w, "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":");
+    write_string(w, location -> path);
+    writer_str(w, "},\"region\":{\"startLine\":");
+    writer_u64(w, location -> line);
+    writer_str(w, ",\"startColumn\":");
+    writer_u64(w, location -> column);
+    writer_str(w, ",\"byteOffset\":");
+    writer_u64(w, offset);
+    writer_str(w, ",\"byteLength\":");
+    writer_u64(w, location -> length);
+    writer_str(w, "}}}]");
+
+    if (diag -> help) {
+        writer_str(w, ",\"properties\":{\"help\":");
+        write_string(w, diag -> help);
+        writer_char(w, '}');
+    }
+
+    writer_char(w, '}');
+}
+
+void diag_stream_write(DiagStream* stream, const DiagContext* ctx, const Diagnostic* diag) {
+    Writer* w = &stream -> writer;
+
+    const SourceLocation location = diagnostic_location(ctx, diag);
+    const char* message = diagnostic_message(ctx -> arena, diag);
+
+    const usize offset = (usize) (location.pointer - location.source_buffer);
+
+    if (stream -> format == DIAG_FORMAT_SARIF) {
+        write_sarif(w, &location, offset, diag, message, stream -> written == 0);
+    } else {
+        write_json(w, &location, offset, diag, message);
+    }
+
+    stream -> written++;
+
+    writer_flush(w);
+}
+
+void finish_diag_stream(DiagStream* stream) {
+    if (stream -> format == DIAG_FORMAT_SARIF) {
+        writer_str(&stream -> writer, stream -> written > 0 ? "\n" SARIF_FOOTER : SARIF_FOOTER);
+    }
+
+    writer_flush(&stream -> writer);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#ifndef MYTHRIL_DIAGNOSTICS_STREAM_H
+#define MYTHRIL_DIAGNOSTICS_STREAM_H
+
+#include "types.h"
+
+#include "../types.h"
+
+/*
+*
+*   machine readable diagnostics on fd, written the moment they are
+*   reported instead of once compilation is over. A SARIF log gets its
+*   header right away and is only a complete document once finished
+*
+*/
+void init_diag_stream(DiagStream* stream, ArenaAllocator* arena, i32 fd, DiagFormat format);
+
+// writes diag and hands it to the fd
+void diag_stream_write(DiagStream* stream, const DiagContext* ctx, const Diagnostic* diag);
+
+// closes the SARIF document, nothing to do for JSON lines
+void finish_diag_stream(DiagStream* stream);
+
+#endif // !MYTHRIL_DIAGNOSTICS_STREAM_H
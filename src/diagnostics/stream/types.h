@@ -0,0 +1,24 @@
+#pragma once
+#ifndef MYTHRIL_DIAGNOSTICS_STREAM_TYPES_H
+#define MYTHRIL_DIAGNOSTICS_STREAM_TYPES_H
+
+#include "../../utils/types.h"
+#include "../../writer/types.h"
+
+// the records are small, a diagnostic is written out as soon as it is in
+#define DIAG_STREAM_CAPACITY (64 * 1024)
+
+typedef enum {
+    DIAG_FORMAT_TEXT,   // rendered for people once everything is in
+    DIAG_FORMAT_JSON,   // one JSON object per line
+    DIAG_FORMAT_SARIF   // a SARIF 2.1.0 log, one result per diagnostic
+} DiagFormat;
+
+typedef struct {
+    Writer writer;
+
+    u32 format; // DiagFormat
+    u32 written;
+} DiagStream;
+
+#endif // !MYTHRIL_DIAGNOSTICS_STREAM_TYPES_H
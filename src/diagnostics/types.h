@@ -3,15 +3,44 @@
 #define MYTHRIL_DIAGNOSTICS_TYPES_H
 
 #include "../arena/arena.h"
+#include "stream/types.h"
+#include "../unit/types.h"
 #include "../utils/types.h"
 
-#define MAX_DIAGNOSTICS 32
+// shown by default, everything past it is only counted when rendering
+#define DIAGNOSTICS_DEFAULT_LIMIT 32
+
+#define DIAGNOSTICS_INIT_CAPACITY 16
 
 typedef enum {
     DIAGNOSTIC_ERROR,
     DIAGNOSTIC_WARN,
     DIAGNOSTIC_NOTE
 } DiagnosticLevel;
+
+/*
+*
+*   message id and its printf format. DIAG_TEXT is a finished message,
+*   the SLICE ones take the text of the diagnostic's first argument
+*   with its length, the others one or two C strings
+*
+*/
+#define X_DIAG_MESSAGES(X)                                                      \
+    X(DIAG_TEXT,                    "%s")                                       \
+    X(DIAG_UNKNOWN_TOKEN,           "unknown token found '%.*s'")               \
+    X(DIAG_UNEXPECTED_TOP_LEVEL,    "unexpected top level declaration '%.*s'")  \
+    X(DIAG_EXPECTED,                "expected %s")                              \
+    X(DIAG_EXPECTED_FOUND,          "expected %s, found %s")                    \
+    X(DIAG_UNDEFINED,               "undefined %s '%s'")                        \
+    X(DIAG_REDEFINED,               "%s '%s' is already defined")
+
+#define GENERATE_DIAG_MESSAGE(ID, FORMAT) ID,
+#define GENERATE_DIAG_FORMAT(ID, FORMAT) FORMAT,
+
+typedef enum {
+    X_DIAG_MESSAGES(GENERATE_DIAG_MESSAGE)
+    DIAG_MESSAGE_COUNT
+} DiagMessage;
  
 typedef struct {
     const char* path; 
@@ -24,12 +53,27 @@ typedef struct {
     usize length;
 } SourceLocation;
 
+/*
+*
+*   a reported diagnostic as recorded, nothing is formatted and no line
+*   is looked up until it is rendered. pointer and length are the text
+*   it points at in the buffer of unit file, args and help are kept as
+*   pointers and have to live as long as the context
+*
+*/
 typedef struct {
-    DiagnosticLevel level;
-    SourceLocation  location;
-
-    const char* message;    // COMPLETE formatted message
+    const char* pointer;
     const char* help;       // suggested fix 
+
+    const char* args[2];
+    u32 arg_length;         // of args[0] for the SLICE messages
+
+    u32 length;
+    u32 sequence;           // report order, ties are rendered in it
+
+    u16 file;
+    u8 level;               // DiagnosticLevel
+    u8 message;             // DiagMessage
 } Diagnostic;
 
 typedef struct {
@@ -37,14 +81,41 @@ typedef struct {
     const char* path;
     const char* source_buffer;
 
-    Diagnostic nodes[MAX_DIAGNOSTICS];
-    u32 index;
+    // indexed by Token.file, nullptr when tokens do not come from units,
+    // locations are then found in path and source_buffer
+    const CompilationUnit* units;
+
+    // nullptr unless diagnostics are written out as they come in
+    DiagStream* stream;
+
+    // every diagnostic reported, in report order until rendered
+    Diagnostic* items;
+    u32 count;
+    u32 capacity;
 
     u32 warning_count;
     u32 error_count;
     u32 note_count;
 
+    // error budget, 0 is unlimited. Once error_count reaches it aborted
+    // is set, later diagnostics are dropped and the lexer and parser
+    // stop at their next check
+    u32 max_errors;
+
+    // rendered at most, 0 renders all of them
+    u32 display_limit;
+
+    u32 unit_count;
+
+    // items before streamed are written to the stream. While hold is
+    // above 0 a speculative parse may still take diagnostics back, they
+    // wait until it is over
+    u32 streamed;
+    u32 hold;
+
     b8 stderr_supports_colours;
+    b8 aborted;
+    u8 _padding[6];
 } DiagContext;
 
 #endif // !MYTHRIL_DIAGNOSTICS_TYPES_H
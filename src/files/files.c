@@ -0,0 +1,154 @@
+#include "files.h"
+#include "types.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+i32 load_file(FileBuffer* file, ArenaAllocator* arena, const char* path) {
+    const b8 from_stdin = strcmp(path, FILE_STDIN_PATH) == 0;
+
+    i32 fd = from_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+
+    if (fd == -1) {
+        fprintf(stderr, "Error: Failed to open file '%s'\n", path);
+        return -1;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1) {
+        if (!from_stdin) {
+            close(fd);
+        }
+
+        fprintf(stderr, "Error: Failed to stat file '%s'\n", path);
+        return -1;
+    }
+
+    // /proc and friends claim to be empty, only a non empty regular file has a size to go by
+    const b8 known_size = S_ISREG(st.st_mode) && st.st_size > 0;
+    const usize size = known_size ? (usize) st.st_size : 0;
+
+    i32 result;
+
+    if (known_size && size >= FILE_MAP_THRESHOLD) {
+        result = map_source(file, fd, size);
+    } else {
+        result = read_source(file, arena, fd, known_size ? size : FILE_STREAM_CHUNK, known_size);
+    }
+
+    if (!from_stdin) {
+        close(fd);
+    }
+
+    if (result == -1) {
+        fprintf(stderr, "Error: Failed to read file '%s'\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void unload_file(FileBuffer* file) {
+    if (file -> mapped > 0) {
+        munmap(file -> ptr, file -> mapped);
+    }
+
+    file -> ptr = nullptr;
+    file -> len = 0;
+    file -> mapped = 0;
+}
+
+char* alloc_source(ArenaAllocator* arena, usize size, usize* capacity) {
+    // the arena does not align, later allocations would inherit an odd size
+    *capacity = (size + FILE_TAIL_PADDING + 7) & ~(usize) 7;
+
+    char* buffer = arena_alloc(arena, *capacity);
+    memset(buffer + size, 0, *capacity - size);
+
+    return buffer;
+}
+
+/*
+*
+*   the file is mapped over anonymous zero pages reserved for it and the
+*   padding. Past the end of the file the last file page reads as zero,
+*   past that page the reservation does, so the padding holds whatever
+*   the size. Nothing is ever written to the mapping
+*
+*/
+i32 map_source(FileBuffer* file, i32 fd, usize size) {
+    const usize page = (usize) sysconf(_SC_PAGESIZE);
+    const usize total = (size + FILE_TAIL_PADDING + page - 1) & ~(page - 1);
+
+    char* base = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    char* text = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0);
+
+    if (text == MAP_FAILED) {
+        munmap(base, total);
+        return -1;
+    }
+
+    // hints only, a kernel without them maps the file all the same
+    madvise(base, total, MADV_SEQUENTIAL);
+
+    if (size >= FILE_HUGEPAGE_THRESHOLD) {
+        madvise(base, total, MADV_HUGEPAGE);
+    }
+
+    file -> ptr = base;
+    file -> len = size + 1;
+    file -> mapped = total;
+
+    return 0;
+}
+
+// input of unknown size doubles the buffer whenever it runs into the padding
+i32 read_source(FileBuffer* file, ArenaAllocator* arena, i32 fd, usize size, b8 known_size) {
+    usize capacity;
+    char* buffer = alloc_source(arena, size, &capacity);
+
+    usize len = 0;
+
+    while (!known_size || len < size) {
+        if (capacity - len <= FILE_TAIL_PADDING) {
+            buffer = arena_realloc(arena, buffer, capacity, capacity * 2);
+            capacity *= 2;
+        }
+
+        const ssize got = read(fd, buffer + len, capacity - FILE_TAIL_PADDING - len);
+
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        // a file that shrank since fstat() ends early
+        if (got == 0) {
+            break;
+        }
+
+        len += (usize) got;
+    }
+
+    memset(buffer + len, 0, capacity - len);
+
+    file -> ptr = buffer;
+    file -> len = len + 1;
+    file -> mapped = 0;
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MYTHRIL_FILES_H
+#define MYTHRIL_FILES_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+
+/*
+*
+*   loads the source at path, FILE_STDIN_PATH reads stdin. Regular files
+*   below FILE_MAP_THRESHOLD are read into arena, larger ones are mapped
+*   and prefaulted. Pipes, stdin and files whose size stat() does not
+*   know are read in chunks until the end. Reports the failure and
+*   returns -1 if the input cannot be read
+*
+*/
+i32 load_file(FileBuffer* file, ArenaAllocator* arena, const char* path);
+
+// unmaps a mapped file, one on an arena goes with the arena
+void unload_file(FileBuffer* file);
+
+/*
+*
+*   the pieces of load_file(), for loaders that open and read files
+*   themselves. alloc_source() returns room for size bytes of text on
+*   arena with the padding after them zeroed, capacity is what was
+*   allocated. map_source() maps size bytes of fd with the padding after
+*   them. read_source() reads fd to its end into arena, size is the
+*   buffer to start with, the whole file when known_size is set, which
+*   stops the reading once that many bytes arrived
+*
+*/
+char* alloc_source(ArenaAllocator* arena, usize size, usize* capacity);
+i32 map_source(FileBuffer* file, i32 fd, usize size);
+i32 read_source(FileBuffer* file, ArenaAllocator* arena, i32 fd, usize size, b8 known_size);
+
+#endif // !MYTHRIL_FILES_H
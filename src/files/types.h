@@ -4,11 +4,32 @@
 
 #include "../utils/types.h"
 
+// zeroed bytes after every loaded source, a lexer may read a vector past the end
+#define FILE_TAIL_PADDING 64
+
+// smaller files are read into the arena, larger ones are mapped
+#define FILE_MAP_THRESHOLD (256 * 1024)
+
+// mappings from this size on are worth transparent huge pages
+#define FILE_HUGEPAGE_THRESHOLD (2 * 1024 * 1024)
+
+// first buffer for input of unknown size, pipes and stdin
+#define FILE_STREAM_CHUNK (64 * 1024)
+
+// path of the source read from stdin
+#define FILE_STDIN_PATH "-"
+
+/*
+*
+*   a loaded source. len counts the NUL after the text, at least
+*   FILE_TAIL_PADDING zeroed bytes follow the text. mapped is the size
+*   of the mapping ptr points into, 0 when ptr is on an arena
+*
+*/
 typedef struct {
     char* ptr;
     usize len;
-    b8 needs_free;
-    u8 _padding[7];
+    usize mapped;
 } FileBuffer;
 
 #endif // !MYTHRIL_FILES_TYPES_H
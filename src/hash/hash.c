@@ -1,4 +1,22 @@
 #include "hash.h"
+#include "types.h"
+
+#include <string.h>
+
+static const u32 SHA256_ROUNDS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(Sha256* sha, const u8* block);
 
 u64 hash_fnv1a(const char* ptr, const usize len) {
     u64 hash = 2166136261u;
@@ -10,3 +28,126 @@ u64 hash_fnv1a(const char* ptr, const usize len) {
 
     return hash;
 } 
+
+void init_sha256(Sha256* sha) {
+    static const u32 INITIAL[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(sha -> state, INITIAL, sizeof(INITIAL));
+
+    sha -> length = 0;
+    sha -> used = 0;
+}
+
+void sha256_update(Sha256* sha, const void* data, usize len) {
+    const u8* bytes = data;
+
+    sha -> length += len;
+
+    if (sha -> used > 0) {
+        const usize take = len < SHA256_BLOCK_SIZE - sha -> used ? len : SHA256_BLOCK_SIZE - sha -> used;
+
+        memcpy(sha -> block + sha -> used, bytes, take);
+        sha -> used += (u32) take;
+        bytes += take;
+        len -= take;
+
+        if (sha -> used < SHA256_BLOCK_SIZE) {
+            return;
+        }
+
+        sha256_block(sha, sha -> block);
+        sha -> used = 0;
+    }
+
+    // whole blocks straight from the input
+    while (len >= SHA256_BLOCK_SIZE) {
+        sha256_block(sha, bytes);
+        bytes += SHA256_BLOCK_SIZE;
+        len -= SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(sha -> block, bytes, len);
+    sha -> used = (u32) len;
+}
+
+void sha256_final(Sha256* sha, u8 digest[SHA256_DIGEST_SIZE]) {
+    const u64 bits = sha -> length * 8;
+
+    sha -> block[sha -> used++] = 0x80;
+
+    // no room left for the length, it goes into a block of its own
+    if (sha -> used > SHA256_BLOCK_SIZE - 8) {
+        memset(sha -> block + sha -> used, 0, SHA256_BLOCK_SIZE - sha -> used);
+        sha256_block(sha, sha -> block);
+        sha -> used = 0;
+    }
+
+    memset(sha -> block + sha -> used, 0, SHA256_BLOCK_SIZE - 8 - sha -> used);
+
+    for (u32 i = 0; i < 8; i++) {
+        sha -> block[SHA256_BLOCK_SIZE - 1 - i] = (u8) (bits >> (i * 8));
+    }
+
+    sha256_block(sha, sha -> block);
+
+    for (u32 i = 0; i < 8; i++) {
+        digest[i * 4 + 0] = (u8) (sha -> state[i] >> 24);
+        digest[i * 4 + 1] = (u8) (sha -> state[i] >> 16);
+        digest[i * 4 + 2] = (u8) (sha -> state[i] >> 8);
+        digest[i * 4 + 3] = (u8) (sha -> state[i]);
+    }
+}
+
+static void sha256_block(Sha256* sha, const u8* block) {
+    u32 w[64];
+
+    for (u32 i = 0; i < 16; i++) {
+        w[i] = (u32) block[i * 4] << 24 | (u32) block[i * 4 + 1] << 16 | (u32) block[i * 4 + 2] << 8 | block[i * 4 + 3];
+    }
+
+    for (u32 i = 16; i < 64; i++) {
+        const u32 s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const u32 s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    u32 a = sha -> state[0];
+    u32 b = sha -> state[1];
+    u32 c = sha -> state[2];
+    u32 d = sha -> state[3];
+    u32 e = sha -> state[4];
+    u32 f = sha -> state[5];
+    u32 g = sha -> state[6];
+    u32 h = sha -> state[7];
+
+    for (u32 i = 0; i < 64; i++) {
+        const u32 s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        const u32 choice = (e & f) ^ (~e & g);
+        const u32 t1 = h + s1 + choice + SHA256_ROUNDS[i] + w[i];
+
+        const u32 s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        const u32 majority = (a & b) ^ (a & c) ^ (b & c);
+        const u32 t2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    sha -> state[0] += a;
+    sha -> state[1] += b;
+    sha -> state[2] += c;
+    sha -> state[3] += d;
+    sha -> state[4] += e;
+    sha -> state[5] += f;
+    sha -> state[6] += g;
+    sha -> state[7] += h;
+}
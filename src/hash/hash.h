@@ -2,8 +2,21 @@
 #ifndef MYTHRIL_HASH_H
 #define MYTHRIL_HASH_H
 
+#include "types.h"
+
 #include "../utils/types.h"
 
 u64 hash_fnv1a(const char* ptr, const usize len);
 
+/*
+*
+*   SHA-256, for keys a collision must never be mistaken for a match
+*   under. Fed in pieces with sha256_update(), digest is written by
+*   sha256_final()
+*
+*/
+void init_sha256(Sha256* sha);
+void sha256_update(Sha256* sha, const void* data, usize len);
+void sha256_final(Sha256* sha, u8 digest[SHA256_DIGEST_SIZE]);
+
 #endif // !MYTHRIL_HASH_H
@@ -0,0 +1,25 @@
+#pragma once
+#ifndef MYTHRIL_HASH_TYPES_H
+#define MYTHRIL_HASH_TYPES_H
+
+#include "../utils/types.h"
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE  64
+
+/*
+*
+*   a SHA-256 in progress, bytes that do not fill a block yet wait in
+*   block until the next update or the final one
+*
+*/
+typedef struct {
+    u32 state[8];
+    u64 length;     // bytes hashed so far
+
+    u8 block[SHA256_BLOCK_SIZE];
+    u32 used;
+    u8 _padding[4];
+} Sha256;
+
+#endif // !MYTHRIL_HASH_TYPES_H
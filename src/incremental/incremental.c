@@ -0,0 +1,434 @@
+#include "incremental.h"
+#include "types.h"
+
+#include "../ast_parser/parser.h"
+#include "../lexer/lexer.h"
+#include "../mythril/types.h"
+#include "../tokens/tokens.h"
+#include "../utils/macros.h"
+
+#include <string.h>
+
+static MythrilContext document_context(Document* doc, Tokens* tokens);
+static void document_parse_all(Document* doc);
+static usize span_start(const Document* doc, const DeclSpan* span);
+static usize span_end(const Document* doc, const DeclSpan* span);
+static DeclSpan* find_span(Document* doc, usize offset, usize removed);
+static b8 diagnostics_clear(const Document* doc, const DeclSpan* span, const char* old_source, usize old_len);
+static b8 reparse_span(Document* doc, DeclSpan* span, const char* old_source, usize removed, usize inserted);
+
+void init_document(Document* doc, ArenaAllocator* arena, const char* path, const char* text, usize len) {
+    doc -> arena = arena;
+    doc -> path = path;
+
+    // rounded up so the tokens allocated after it stay aligned
+    doc -> source = arena_alloc(arena, (len + 1 + 7) & ~(usize) 7);
+    doc -> len = len + 1;
+
+    memcpy(doc -> source, text, len);
+    doc -> source[len] = 0;
+
+    doc -> tokens = (Tokens) {
+        .items = arena_array(arena, Token, DOCUMENT_INIT_CAPACITY),
+        .count = 0,
+        .capacity = DOCUMENT_INIT_CAPACITY
+    };
+
+    doc -> program = (Program) {
+        .declarations = arena_array(arena, AstNode*, DOCUMENT_INIT_CAPACITY),
+        .capacity = DOCUMENT_INIT_CAPACITY,
+        .count = 0
+    };
+
+    doc -> diag_ctx = (DiagContext) {
+        .arena = arena,
+        .path = path,
+        .source_buffer = doc -> source,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .warning_count = 0,
+        .error_count = 0,
+        .note_count = 0,
+        .stderr_supports_colours = false
+    };
+
+    doc -> spans = arena_array(arena, DeclSpan, DOCUMENT_INIT_CAPACITY);
+    doc -> span_capacity = DOCUMENT_INIT_CAPACITY;
+    doc -> span_count = 0;
+
+    document_parse_all(doc);
+}
+
+ReparseKind document_edit(Document* doc, usize offset, usize removed, const char* text, usize inserted) {
+    const usize text_len = doc -> len - 1;
+
+    if (offset > text_len || removed > text_len - offset) {
+        return REPARSE_INVALID;
+    }
+
+    char* old_source = doc -> source;
+    const usize old_len = doc -> len;
+    const usize len = doc -> len - removed + inserted;
+
+    // the old text stays untouched, reused tokens and nodes still point into it
+    char* source = arena_alloc(doc -> arena, (len + 7) & ~(usize) 7);
+
+    memcpy(source, old_source, offset);
+    memcpy(source + offset, text, inserted);
+    memcpy(source + offset + inserted, old_source + offset + removed, doc -> len - offset - removed);
+
+    doc -> source = source;
+    doc -> len = len;
+    doc -> diag_ctx.source_buffer = source;
+
+    DeclSpan* span = find_span(doc, offset, removed);
+
+    if (
+        span                                                    &&
+        span -> decl != DOCUMENT_NO_DECL                        &&
+        diagnostics_clear(doc, span, old_source, old_len)       &&
+        reparse_span(doc, span, old_source, removed, inserted)
+    ) {
+        // what was reported elsewhere still holds, only its location moves
+        for (u32 i = 0; i < doc -> diag_ctx.count; i++) {
+            Diagnostic* diag = &doc -> diag_ctx.items[i];
+            usize at = (usize) (diag -> pointer - old_source);
+
+            if (at >= offset + removed) {
+                at = at - removed + inserted;
+            }
+
+            diag -> pointer = source + at;
+        }
+
+        return REPARSE_DECL;
+    }
+
+    document_parse_all(doc);
+
+    return REPARSE_FULL;
+}
+
+DeclSpan* document_span_at(Document* doc, usize offset) {
+    DeclSpan* span = find_span(doc, offset, 0);
+
+    return span && span -> decl != DOCUMENT_NO_DECL ? span : nullptr;
+}
+
+usize document_token_offset(const Document* doc, usize index) {
+    const Token* token = &doc -> tokens.items[index];
+
+    usize lo = 0;
+    usize hi = doc -> span_count;
+
+    // first span starting after index
+    while (lo < hi) {
+        const usize mid = lo + (hi - lo) / 2;
+
+        if (doc -> spans[mid].token_start <= index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // TOK_EOF follows every span and is kept in the current text
+    if (lo == 0 || index >= doc -> spans[lo - 1].token_end) {
+        return (usize) (token -> lexeme - doc -> source);
+    }
+
+    return document_offset(&doc -> spans[lo - 1], token -> lexeme);
+}
+
+usize document_offset(const DeclSpan* span, const char* ptr) {
+    return (usize) ptr - span -> origin;
+}
+
+static MythrilContext document_context(Document* doc, Tokens* tokens) {
+    return (MythrilContext) {
+        .arena = doc -> arena,
+        .diag_ctx = &doc -> diag_ctx,
+        .tokens = tokens,
+        .program = &doc -> program,
+        .buffer_start = doc -> source,
+        .buffer_end = doc -> source + doc -> len
+    };
+}
+
+static void document_parse_all(Document* doc) {
+    doc -> tokens.count = 0;
+    doc -> program.count = 0;
+    doc -> span_count = 0;
+
+    doc -> diag_ctx.count = 0;
+    doc -> diag_ctx.warning_count = 0;
+    doc -> diag_ctx.error_count = 0;
+    doc -> diag_ctx.note_count = 0;
+    doc -> diag_ctx.path = doc -> path;
+    doc -> diag_ctx.source_buffer = doc -> source;
+
+    MythrilContext ctx = document_context(doc, &doc -> tokens);
+
+    tokenize(&ctx);
+    push_end_of_program(&doc -> tokens, doc -> arena);
+
+    Parser parser = {
+        .arena = doc -> arena,
+        .tokens = &doc -> tokens,
+        .program = &doc -> program,
+        .items = doc -> tokens.items,
+        .path = doc -> path,
+        .index = 0,
+        .count = doc -> tokens.count,
+        .flags = PARSE_NONE
+    };
+
+    Program* program = &doc -> program;
+
+    while (true) {
+        const TokenKind kind = parser_peek(&parser) -> kind;
+
+        if (kind == TOK_EOF || kind == TOK_EOP) {
+            break;
+        }
+
+        const usize start = parser.index;
+
+        AstNode* node = parse_top_level_decl(&ctx, &parser);
+
+        if (doc -> span_count >= doc -> span_capacity) {
+            usize size = doc -> span_capacity * sizeof(DeclSpan);
+
+            doc -> spans = arena_realloc(doc -> arena, doc -> spans, size, size * 2);
+            doc -> span_capacity *= 2;
+        }
+
+        // stray tokens, already reported, still get a span so their offsets can be found
+        if (!node) {
+            if (parser.index == start) {
+                continue;
+            }
+
+            doc -> spans[doc -> span_count++] = (DeclSpan) {
+                .token_start = start,
+                .token_end = parser.index,
+                .decl = DOCUMENT_NO_DECL,
+                .origin = (usize) doc -> source
+            };
+
+            continue;
+        }
+
+        if (program -> count >= program -> capacity) {
+            usize size = program -> capacity * sizeof(AstNode*);
+
+            program -> declarations = arena_realloc(doc -> arena, program -> declarations, size, size * 2);
+            program -> capacity *= 2;
+        }
+
+        doc -> spans[doc -> span_count++] = (DeclSpan) {
+            .token_start = start,
+            .token_end = parser.index,
+            .decl = program -> count,
+            .origin = (usize) doc -> source
+        };
+
+        program -> declarations[program -> count++] = node;
+    }
+}
+
+// offset of the first byte of the first token of span in the current text
+static usize span_start(const Document* doc, const DeclSpan* span) {
+    return document_offset(span, doc -> tokens.items[span -> token_start].lexeme);
+}
+
+// one past the last byte of the last token of span in the current text
+static usize span_end(const Document* doc, const DeclSpan* span) {
+    const Token* last = &doc -> tokens.items[span -> token_end - 1];
+
+    return document_offset(span, last -> lexeme) + last -> length;
+}
+
+/*
+*
+*   binary search over the spans, offsets are those of the text the
+*   spans were last moved for. The edit has to start and end within the
+*   first and last token of a span
+*
+*/
+static DeclSpan* find_span(Document* doc, usize offset, usize removed) {
+    usize lo = 0;
+    usize hi = doc -> span_count;
+
+    // first span starting after offset
+    while (lo < hi) {
+        const usize mid = lo + (hi - lo) / 2;
+
+        if (span_start(doc, &doc -> spans[mid]) <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return nullptr;
+    }
+
+    DeclSpan* span = &doc -> spans[lo - 1];
+
+    if (offset + removed > span_end(doc, span)) {
+        return nullptr;
+    }
+
+    return span;
+}
+
+/*
+*
+*   whether no diagnostic sits in span or on the tokens either side of
+*   it. Those may have come from parsing span, the parser reports at the
+*   token before and the token after what it consumed, so they could go
+*   away or change with it. Anything else was reported for a declaration
+*   the splice leaves alone
+*
+*/
+static b8 diagnostics_clear(const Document* doc, const DeclSpan* span, const char* old_source, usize old_len) {
+    const DeclSpan* spans_end = doc -> spans + doc -> span_count;
+
+    const usize lo = span > doc -> spans
+        ? document_token_offset(doc, span[-1].token_end - 1)
+        : 0;
+
+    const usize hi = span + 1 < spans_end
+        ? span_start(doc, span + 1) + doc -> tokens.items[span[1].token_start].length
+        : old_len;
+
+    for (u32 i = 0; i < doc -> diag_ctx.count; i++) {
+        const char* pointer = doc -> diag_ctx.items[i].pointer;
+
+        // nowhere in the text, no telling what it belongs to
+        if (!pointer || pointer < old_source || pointer > old_source + old_len) {
+            return false;
+        }
+
+        const usize at = (usize) (pointer - old_source);
+
+        if (at >= lo && at <= hi) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static b8 reparse_span(Document* doc, DeclSpan* span, const char* old_source, usize removed, usize inserted) {
+    Tokens* tokens = &doc -> tokens;
+
+    const usize byte_start = span_start(doc, span);
+    const usize byte_end = span_end(doc, span) - removed + inserted;
+
+    if (byte_end <= byte_start) {
+        return false;
+    }
+
+    Tokens scratch = {
+        .items = arena_array(doc -> arena, Token, DOCUMENT_INIT_CAPACITY),
+        .count = 0,
+        .capacity = DOCUMENT_INIT_CAPACITY
+    };
+
+    MythrilContext ctx = document_context(doc, &scratch);
+
+    const u32 reported = doc -> diag_ctx.count;
+
+    // a comment, string or token running past the old end changes what follows
+    char* stop = tokenize_range(&ctx, doc -> source + byte_start, doc -> source + byte_end);
+
+    if (stop != doc -> source + byte_end || scratch.count == 0) {
+        return false;
+    }
+
+    push_end_of_program(&scratch, doc -> arena);
+
+    Parser parser = {
+        .arena = doc -> arena,
+        .tokens = &scratch,
+        .program = &doc -> program,
+        .items = scratch.items,
+        .path = doc -> path,
+        .index = 0,
+        .count = scratch.count,
+        .flags = PARSE_NONE
+    };
+
+    AstNode* node = parse_top_level_decl(&ctx, &parser);
+
+    // has to be exactly one clean declaration spanning every token
+    if (
+        !node                                                                   ||
+        node -> kind == AST_ERROR                                               ||
+        parser.index != scratch.count - 1                                       ||
+        doc -> diag_ctx.count != reported
+    ) {
+        return false;
+    }
+
+    const usize old_count = span -> token_end - span -> token_start;
+    const usize new_count = scratch.count - 1;
+    const usize count = tokens -> count - old_count + new_count;
+
+    if (count > tokens -> capacity) {
+        usize capacity = tokens -> capacity;
+
+        while (capacity < count) {
+            capacity *= 2;
+        }
+
+        tokens -> items = arena_realloc(
+            doc -> arena,
+            tokens -> items,
+            tokens -> capacity * sizeof(Token),
+            capacity * sizeof(Token)
+        );
+
+        tokens -> capacity = capacity;
+    }
+
+    memmove(
+        tokens -> items + span -> token_start + new_count,
+        tokens -> items + span -> token_end,
+        (tokens -> count - span -> token_end) * sizeof(Token)
+    );
+
+    memcpy(tokens -> items + span -> token_start, scratch.items, new_count * sizeof(Token));
+
+    tokens -> count = count;
+
+    // the slots after the moved TOK_EOP still hold whatever was there before
+    pad_end_of_program(tokens, doc -> arena);
+
+    // no token is rebased, the spans after this one only move their origin
+    const DeclSpan* spans_end = doc -> spans + doc -> span_count;
+
+    for (DeclSpan* next = span + 1; next < spans_end; next++) {
+        next -> token_start = next -> token_start + new_count - old_count;
+        next -> token_end = next -> token_end + new_count - old_count;
+        next -> origin = next -> origin + removed - inserted;
+    }
+
+    span -> token_end = span -> token_start + new_count;
+    span -> origin = (usize) doc -> source;
+
+    // except TOK_EOF and anything after it, which belong to no span
+    const usize tail = doc -> spans[doc -> span_count - 1].token_end;
+
+    for (usize i = tail; i < count && tokens -> items[i].lexeme; i++) {
+        tokens -> items[i].lexeme = doc -> source + (tokens -> items[i].lexeme - old_source) - removed + inserted;
+    }
+
+    doc -> program.declarations[span -> decl] = node;
+
+    return true;
+}
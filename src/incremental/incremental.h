@@ -0,0 +1,51 @@
+#pragma once
+#ifndef MYTHRIL_INCREMENTAL_H
+#define MYTHRIL_INCREMENTAL_H
+
+#include "types.h"
+
+/*
+*
+*   copies text into the document and does a full lex and parse,
+*   recording the token span of every top level declaration
+*
+*/
+void init_document(Document* doc, ArenaAllocator* arena, const char* path, const char* text, usize len);
+
+/*
+*
+*   replaces removed bytes at offset with inserted bytes of text. If the
+*   edit lies inside a single declaration only that declaration is lexed
+*   and parsed again and spliced into the program, tokens and nodes of
+*   every other declaration are reused. Anything the splice cannot prove
+*   safe (a diagnostic in or next to the declaration, edits between
+*   declarations, a comment or string that now leaks out) falls back to
+*   a full parse
+*
+*/
+ReparseKind document_edit(Document* doc, usize offset, usize removed, const char* text, usize inserted);
+
+/*
+*
+*   the span whose tokens cover offset, nullptr if offset is between
+*   declarations or on stray tokens
+*
+*/
+DeclSpan* document_span_at(Document* doc, usize offset);
+
+/*
+*
+*   offset in the current text of the token at index, which must not be
+*   TOK_EOP
+*
+*/
+usize document_token_offset(const Document* doc, usize index);
+
+/*
+*
+*   offset in the current text of a pointer taken from the tree of span
+*
+*/
+usize document_offset(const DeclSpan* span, const char* ptr);
+
+#endif // !MYTHRIL_INCREMENTAL_H
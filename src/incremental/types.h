@@ -0,0 +1,67 @@
+#pragma once
+#ifndef MYTHRIL_INCREMENTAL_TYPES_H
+#define MYTHRIL_INCREMENTAL_TYPES_H
+
+#include "../arena/arena.h"
+#include "../ast/types.h"
+#include "../diagnostics/types.h"
+#include "../tokens/types.h"
+#include "../utils/types.h"
+
+#define DOCUMENT_INIT_CAPACITY 64
+#define DOCUMENT_NO_DECL       SIZE_MAX // span of stray tokens that parsed to nothing
+
+typedef enum {
+    REPARSE_DECL,   // only the enclosing declaration was lexed and parsed again
+    REPARSE_FULL,   // the whole document was lexed and parsed again
+    REPARSE_INVALID // the edit does not fit the document, nothing changed
+} ReparseKind;
+
+/*
+*
+*   tokens of one top level declaration and where its node lives in
+*   program.declarations
+*
+*   tokens and slices of a reused declaration keep pointing into the
+*   text they were lexed from, origin is chosen so that (ptr - origin)
+*   is the offset of ptr in the current text. Nothing but origin moves
+*   when an edit before the declaration shifts it
+*
+*/
+typedef struct {
+    usize token_start;
+    usize token_end; // one past the last token
+
+    usize decl;
+    usize origin;
+} DeclSpan;
+
+/*
+*
+*   a single file kept alive between edits, every edit produces a new
+*   copy of the text on the arena, older copies stay valid as long as
+*   the arena does
+*
+*   every token up to TOK_EOF belongs to a span, see document_token_offset().
+*   tokens.matches and tokens.kinds describe the last full parse only,
+*   a splice keeps just the items in order
+*
+*/
+typedef struct {
+    ArenaAllocator* arena;
+    const char* path;
+
+    // NUL terminated, len includes the NUL like a mapped file
+    char* source;
+    usize len;
+
+    Tokens tokens;
+    Program program;
+    DiagContext diag_ctx;
+
+    DeclSpan* spans;
+    usize span_capacity;
+    usize span_count;
+} Document;
+
+#endif // !MYTHRIL_INCREMENTAL_TYPES_H
@@ -0,0 +1,494 @@
+#include "json.h"
+#include "types.h"
+
+#include "../utils/macros.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// where parsing is, end is one past the last byte of the text
+typedef struct {
+    ArenaAllocator* arena;
+    const char* cursor;
+    const char* end;
+    u32 depth;
+    u8 _padding[4];
+} JsonParser;
+
+static JsonValue* parse_value(JsonParser* p);
+static JsonValue* parse_string_value(JsonParser* p);
+static b8 parse_string(JsonParser* p, const char** out, usize* out_len);
+static JsonValue* parse_number(JsonParser* p);
+static JsonValue* parse_array(JsonParser* p);
+static JsonValue* parse_object(JsonParser* p);
+static b8 parse_literal(JsonParser* p, const char* word);
+static void skip_whitespace(JsonParser* p);
+static JsonValue* new_value(JsonParser* p, JsonKind kind);
+
+JsonValue* json_parse(ArenaAllocator* arena, const char* text, usize len) {
+    JsonParser p = {
+        .arena = arena,
+        .cursor = text,
+        .end = text + len,
+        .depth = 0
+    };
+
+    JsonValue* value = parse_value(&p);
+
+    skip_whitespace(&p);
+
+    return value && p.cursor == p.end ? value : nullptr;
+}
+
+const JsonValue* json_get(const JsonValue* value, const char* key) {
+    if (!value || value -> kind != JSON_OBJECT) {
+        return nullptr;
+    }
+
+    const usize len = strlen(key);
+
+    for (usize i = 0; i < value -> object.count; i++) {
+        const JsonMember* member = &value -> object.members[i];
+
+        if (member -> key_len == len && memcmp(member -> key, key, len) == 0) {
+            return member -> value;
+        }
+    }
+
+    return nullptr;
+}
+
+const char* json_string(const JsonValue* value, usize* len) {
+    if (!value || value -> kind != JSON_STRING) {
+        return nullptr;
+    }
+
+    if (len) {
+        *len = value -> string.len;
+    }
+
+    return value -> string.ptr;
+}
+
+f64 json_number(const JsonValue* value, f64 fallback) {
+    return value && value -> kind == JSON_NUMBER ? value -> number : fallback;
+}
+
+b8 json_bool(const JsonValue* value, b8 fallback) {
+    return value && value -> kind == JSON_BOOL ? value -> boolean : fallback;
+}
+
+static JsonValue* parse_value(JsonParser* p) {
+    skip_whitespace(p);
+
+    if (p -> cursor >= p -> end) {
+        return nullptr;
+    }
+
+    switch (*p -> cursor) {
+        case '{': return parse_object(p);
+        case '[': return parse_array(p);
+        case '"': return parse_string_value(p);
+
+        case 't': {
+            JsonValue* value = parse_literal(p, "true") ? new_value(p, JSON_BOOL) : nullptr;
+
+            if (value) {
+                value -> boolean = true;
+            }
+
+            return value;
+        }
+
+        case 'f': return parse_literal(p, "false") ? new_value(p, JSON_BOOL) : nullptr;
+        case 'n': return parse_literal(p, "null") ? new_value(p, JSON_NULL) : nullptr;
+
+        default: return parse_number(p);
+    }
+}
+
+static JsonValue* parse_string_value(JsonParser* p) {
+    const char* ptr;
+    usize len;
+
+    if (!parse_string(p, &ptr, &len)) {
+        return nullptr;
+    }
+
+    JsonValue* value = new_value(p, JSON_STRING);
+
+    value -> string.ptr = ptr;
+    value -> string.len = len;
+
+    return value;
+}
+
+static i32 hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+
+    return -1;
+}
+
+// the four hex digits after \u
+static i32 parse_hex4(JsonParser* p) {
+    if (p -> end - p -> cursor < 4) {
+        return -1;
+    }
+
+    i32 value = 0;
+
+    for (u32 i = 0; i < 4; i++) {
+        const i32 digit = hex_digit(p -> cursor[i]);
+
+        if (digit < 0) {
+            return -1;
+        }
+
+        value = value * 16 + digit;
+    }
+
+    p -> cursor += 4;
+
+    return value;
+}
+
+static usize put_utf8(char* out, u32 code) {
+    if (code < 0x80) {
+        out[0] = (char) code;
+        return 1;
+    }
+
+    if (code < 0x800) {
+        out[0] = (char) (0xc0 | (code >> 6));
+        out[1] = (char) (0x80 | (code & 0x3f));
+        return 2;
+    }
+
+    if (code < 0x10000) {
+        out[0] = (char) (0xe0 | (code >> 12));
+        out[1] = (char) (0x80 | ((code >> 6) & 0x3f));
+        out[2] = (char) (0x80 | (code & 0x3f));
+        return 3;
+    }
+
+    out[0] = (char) (0xf0 | (code >> 18));
+    out[1] = (char) (0x80 | ((code >> 12) & 0x3f));
+    out[2] = (char) (0x80 | ((code >> 6) & 0x3f));
+    out[3] = (char) (0x80 | (code & 0x3f));
+    return 4;
+}
+
+/*
+*
+*   the string at the cursor with its escapes resolved. Escapes only
+*   ever shrink the text, the raw length is enough room for the result
+*
+*/
+static b8 parse_string(JsonParser* p, const char** out, usize* out_len) {
+    // the opening quote
+    p -> cursor++;
+
+    const char* start = p -> cursor;
+    const char* close = start;
+
+    while (close < p -> end && *close != '"') {
+        close += *close == '\\' && close + 1 < p -> end ? 2 : 1;
+    }
+
+    if (close >= p -> end) {
+        return false;
+    }
+
+    char* text = arena_alloc(p -> arena, ((usize) (close - start) + 1 + 7) & ~(usize) 7);
+    usize len = 0;
+
+    while (p -> cursor < close) {
+        const char c = *p -> cursor++;
+
+        if (MEOW_UNLIKELY((u8) c < 0x20)) {
+            return false;
+        }
+
+        if (MEOW_LIKELY(c != '\\')) {
+            text[len++] = c;
+            continue;
+        }
+
+        const char escape = *p -> cursor++;
+
+        switch (escape) {
+            case '"':  text[len++] = '"'; break;
+            case '\\': text[len++] = '\\'; break;
+            case '/':  text[len++] = '/'; break;
+            case 'b':  text[len++] = '\b'; break;
+            case 'f':  text[len++] = '\f'; break;
+            case 'n':  text[len++] = '\n'; break;
+            case 'r':  text[len++] = '\r'; break;
+            case 't':  text[len++] = '\t'; break;
+
+            case 'u': {
+                i32 code = parse_hex4(p);
+
+                if (code < 0) {
+                    return false;
+                }
+
+                // a surrogate pair is one character in two escapes
+                if (code >= 0xd800 && code < 0xdc00 && close - p -> cursor >= 6 && p -> cursor[0] == '\\' && p -> cursor[1] == 'u') {
+                    p -> cursor += 2;
+
+                    const i32 low = parse_hex4(p);
+
+                    if (low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+
+                len += put_utf8(text + len, (u32) code);
+            } break;
+
+            default: return false;
+        }
+    }
+
+    // the closing quote
+    p -> cursor++;
+
+    text[len] = 0;
+
+    *out = text;
+    *out_len = len;
+
+    return true;
+}
+
+static JsonValue* parse_number(JsonParser* p) {
+    const char* start = p -> cursor;
+    const char* c = start;
+
+    #define DIGITS(c) while (c < p -> end && *c >= '0' && *c <= '9') c++
+
+    if (c < p -> end && *c == '-') {
+        c++;
+    }
+
+    const char* digits = c;
+    DIGITS(c);
+
+    if (c == digits) {
+        return nullptr;
+    }
+
+    if (c < p -> end && *c == '.') {
+        c++;
+        digits = c;
+        DIGITS(c);
+
+        if (c == digits) {
+            return nullptr;
+        }
+    }
+
+    if (c < p -> end && (*c == 'e' || *c == 'E')) {
+        c++;
+
+        if (c < p -> end && (*c == '+' || *c == '-')) {
+            c++;
+        }
+
+        digits = c;
+        DIGITS(c);
+
+        if (c == digits) {
+            return nullptr;
+        }
+    }
+
+    #undef DIGITS
+
+    // strtod wants a NUL, the text goes on with whatever follows
+    char buffer[64];
+    const usize len = (usize) (c - start);
+
+    if (len >= sizeof(buffer)) {
+        return nullptr;
+    }
+
+    memcpy(buffer, start, len);
+    buffer[len] = 0;
+
+    p -> cursor = c;
+
+    JsonValue* value = new_value(p, JSON_NUMBER);
+    value -> number = strtod(buffer, nullptr);
+
+    return value;
+}
+
+static JsonValue* parse_array(JsonParser* p) {
+    if (++p -> depth > JSON_MAX_DEPTH) {
+        return nullptr;
+    }
+
+    // the bracket
+    p -> cursor++;
+
+    JsonValue* value = new_value(p, JSON_ARRAY);
+
+    usize capacity = JSON_INIT_CAPACITY;
+    JsonValue** items = arena_array(p -> arena, JsonValue*, capacity);
+    usize count = 0;
+
+    skip_whitespace(p);
+
+    if (p -> cursor < p -> end && *p -> cursor == ']') {
+        p -> cursor++;
+    } else {
+        while (true) {
+            JsonValue* item = parse_value(p);
+
+            if (!item) {
+                return nullptr;
+            }
+
+            if (count == capacity) {
+                items = arena_realloc(p -> arena, items, capacity * sizeof(JsonValue*), capacity * 2 * sizeof(JsonValue*));
+                capacity *= 2;
+            }
+
+            items[count++] = item;
+
+            skip_whitespace(p);
+
+            if (p -> cursor >= p -> end) {
+                return nullptr;
+            }
+
+            const char c = *p -> cursor++;
+
+            if (c == ']') {
+                break;
+            }
+
+            if (c != ',') {
+                return nullptr;
+            }
+        }
+    }
+
+    value -> array.items = items;
+    value -> array.count = count;
+
+    p -> depth--;
+
+    return value;
+}
+
+static JsonValue* parse_object(JsonParser* p) {
+    if (++p -> depth > JSON_MAX_DEPTH) {
+        return nullptr;
+    }
+
+    // the brace
+    p -> cursor++;
+
+    JsonValue* value = new_value(p, JSON_OBJECT);
+
+    usize capacity = JSON_INIT_CAPACITY;
+    JsonMember* members = arena_array(p -> arena, JsonMember, capacity);
+    usize count = 0;
+
+    skip_whitespace(p);
+
+    if (p -> cursor < p -> end && *p -> cursor == '}') {
+        p -> cursor++;
+    } else {
+        while (true) {
+            skip_whitespace(p);
+
+            if (p -> cursor >= p -> end || *p -> cursor != '"') {
+                return nullptr;
+            }
+
+            JsonMember member;
+
+            if (!parse_string(p, &member.key, &member.key_len)) {
+                return nullptr;
+            }
+
+            skip_whitespace(p);
+
+            if (p -> cursor >= p -> end || *p -> cursor++ != ':') {
+                return nullptr;
+            }
+
+            member.value = parse_value(p);
+
+            if (!member.value) {
+                return nullptr;
+            }
+
+            if (count == capacity) {
+                members = arena_realloc(p -> arena, members, capacity * sizeof(JsonMember), capacity * 2 * sizeof(JsonMember));
+                capacity *= 2;
+            }
+
+            members[count++] = member;
+
+            skip_whitespace(p);
+
+            if (p -> cursor >= p -> end) {
+                return nullptr;
+            }
+
+            const char c = *p -> cursor++;
+
+            if (c == '}') {
+                break;
+            }
+
+            if (c != ',') {
+                return nullptr;
+            }
+        }
+    }
+
+    value -> object.members = members;
+    value -> object.count = count;
+
+    p -> depth--;
+
+    return value;
+}
+
+static b8 parse_literal(JsonParser* p, const char* word) {
+    const usize len = strlen(word);
+
+    if ((usize) (p -> end - p -> cursor) < len || memcmp(p -> cursor, word, len) != 0) {
+        return false;
+    }
+
+    p -> cursor += len;
+
+    return true;
+}
+
+static void skip_whitespace(JsonParser* p) {
+    while (p -> cursor < p -> end && (*p -> cursor == ' ' || *p -> cursor == '\t' || *p -> cursor == '\n' || *p -> cursor == '\r')) {
+        p -> cursor++;
+    }
+}
+
+static JsonValue* new_value(JsonParser* p, JsonKind kind) {
+    JsonValue* value = arena_alloc(p -> arena, sizeof(JsonValue));
+
+    value -> kind = kind;
+    value -> boolean = false;
+    value -> number = 0;
+
+    return value;
+}
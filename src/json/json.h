@@ -0,0 +1,30 @@
+#pragma once
+#ifndef MYTHRIL_JSON_H
+#define MYTHRIL_JSON_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+
+/*
+*
+*   parses len bytes of text as one JSON value with nothing but
+*   whitespace around it. Returns nullptr if the text is not JSON
+*
+*/
+JsonValue* json_parse(ArenaAllocator* arena, const char* text, usize len);
+
+// the member key of an object, nullptr if value is no object or has no such member
+const JsonValue* json_get(const JsonValue* value, const char* key);
+
+/*
+*
+*   the contents of value if it is of the kind, fallback otherwise.
+*   json_string() hands out nullptr for anything but a string
+*
+*/
+const char* json_string(const JsonValue* value, usize* len);
+f64 json_number(const JsonValue* value, f64 fallback);
+b8 json_bool(const JsonValue* value, b8 fallback);
+
+#endif // !MYTHRIL_JSON_H
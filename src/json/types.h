@@ -0,0 +1,62 @@
+#pragma once
+#ifndef MYTHRIL_JSON_TYPES_H
+#define MYTHRIL_JSON_TYPES_H
+
+#include "../utils/types.h"
+
+// arrays and objects nested deeper are refused, the parser recurses
+#define JSON_MAX_DEPTH          128
+
+#define JSON_INIT_CAPACITY      8
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonKind;
+
+typedef struct JsonValue JsonValue;
+
+typedef struct {
+    const char* key;
+    usize key_len;
+
+    JsonValue* value;
+} JsonMember;
+
+/*
+*
+*   one parsed value, everything on the arena it was parsed on. Strings
+*   are unescaped, NUL terminated and may hold NULs of their own, len
+*   is what counts. Members keep the order of the text
+*
+*/
+typedef struct JsonValue {
+    u8 kind; // JsonKind
+    b8 boolean;
+    u8 _padding[6];
+
+    union {
+        f64 number;
+
+        struct {
+            const char* ptr;
+            usize len;
+        } string;
+
+        struct {
+            JsonValue** items;
+            usize count;
+        } array;
+
+        struct {
+            JsonMember* members;
+            usize count;
+        } object;
+    };
+} JsonValue;
+
+#endif // !MYTHRIL_JSON_TYPES_H
@@ -2,6 +2,8 @@
 #include "types.h"
 
 #include "../diagnostics/diagnostics.h"
+#include "../tokens/tokens.h"
+#include "../utils/macros.h"
 #include "../utils/types.h"
 #include "../utils/vec.h"
 
@@ -15,11 +17,23 @@
 
 #define word_match(str, len, ptr) ((len) == sizeof((str)) - 1 && strncmp((str), (ptr), (len)) == 0) 
 
+// the token may not be stamped with its file yet, see index_tokens()
+static const Token* reported_token(MythrilContext* ctx, Token* token) {
+    token -> file = ctx -> tokens -> file;
+
+    return token;
+}
+
 void tokenize(MythrilContext* ctx) {
-    char* cursor = ctx -> buffer_start;
-    char* end = ctx -> buffer_end;
+    tokenize_range(ctx, ctx -> buffer_start, ctx -> buffer_end);
+}
 
-    while (cursor < end) {
+char* tokenize_range(MythrilContext* ctx, char* cursor, char* end) {
+    const usize first = ctx -> tokens -> count;
+    const DiagContext* diag_ctx = ctx -> diag_ctx;
+
+    // a spent error budget ends the file early, it is never checked again
+    while (cursor < end && MEOW_LIKELY(!diag_ctx -> aborted)) {
         SKIP_WHITESPACE(cursor);
 
         char c = *cursor;
@@ -38,6 +52,122 @@ void tokenize(MythrilContext* ctx) {
             cursor = parse_invalid_tokens(ctx, cursor);
         }
     }
+
+    index_tokens(ctx, first);
+    report_unbalanced(ctx, first);
+
+    return cursor;
+}
+
+// 0, 1 or 2 for the opening bracket kinds
+static inline usize bracket_slot(TokenKind kind) {
+    return kind == TOK_LEFT_PAREN ? 0 : kind == TOK_LEFT_SQUARE ? 1 : 2;
+}
+
+void index_tokens(MythrilContext* ctx, usize first) {
+    Tokens* tokens = ctx -> tokens;
+    ArenaAllocator* arena = ctx -> arena;
+
+    reserve_token_tables(tokens, arena);
+
+    u32* matches = tokens -> matches;
+    u8* kinds = tokens -> kinds;
+
+    // indices of the open brackets, grows with the nesting, no fixed limit
+    usize capacity = BRACKET_STACK_INIT_CAPACITY;
+    usize top = 0;
+    u32* open = arena_array(arena, u32, capacity);
+
+    // how many of each kind are on the stack, indexed by bracket_slot()
+    usize open_count[3] = { 0 };
+
+    const u16 file = tokens -> file;
+
+    for (usize i = first; i < tokens -> count; i++) {
+        const TokenKind kind = tokens -> items[i].kind;
+
+        tokens -> items[i].file = file;
+
+        matches[i] = TOKEN_UNMATCHED;
+        kinds[i] = (u8) kind;
+
+        if (kind == TOK_LEFT_PAREN || kind == TOK_LEFT_SQUARE || kind == TOK_LEFT_BRACE) {
+            if (top >= capacity) {
+                open = arena_realloc(arena, open, capacity * sizeof(u32), capacity * 2 * sizeof(u32));
+                capacity *= 2;
+            }
+
+            open[top++] = i;
+            open_count[bracket_slot(kind)]++;
+            continue;
+        }
+
+        TokenKind opener;
+
+        switch (kind) {
+            case TOK_RIGHT_PAREN:  opener = TOK_LEFT_PAREN; break;
+            case TOK_RIGHT_SQUARE: opener = TOK_LEFT_SQUARE; break;
+            case TOK_RIGHT_BRACE:  opener = TOK_LEFT_BRACE; break;
+
+            case TOK_EOF: {
+                // brackets never pair across files
+                top = 0;
+                memset(open_count, 0, sizeof(open_count));
+                continue;
+            }
+
+            default: continue;
+        }
+
+        // a closer without an opener is unmatched, the stack is left alone
+        if (open_count[bracket_slot(opener)] == 0) {
+            continue;
+        }
+
+        // close the nearest opener of the same kind, anything still open
+        // above it stays unmatched and is popped, so every opener is
+        // looked at once at most
+        while (tokens -> items[open[top - 1]].kind != opener) {
+            open_count[bracket_slot(tokens -> items[open[--top]].kind)]--;
+        }
+
+        const u32 pair = open[--top];
+
+        open_count[bracket_slot(opener)]--;
+
+        matches[pair] = i;
+        matches[i] = pair;
+    }
+}
+
+void report_unbalanced(MythrilContext* ctx, usize first) {
+    Tokens* tokens = ctx -> tokens;
+    DiagContext* diag_ctx = ctx -> diag_ctx;
+
+    const u32* matches = tokens -> matches;
+    const u8* kinds = tokens -> kinds;
+
+    for (usize i = first; i < tokens -> count; i++) {
+        if (matches[i] != TOKEN_UNMATCHED) {
+            continue;
+        }
+
+        const char* message;
+        const char* help;
+
+        switch (kinds[i]) {
+            case TOK_LEFT_PAREN:    message = "unclosed '('"; help = "add a matching ')'"; break;
+            case TOK_LEFT_SQUARE:   message = "unclosed '['"; help = "add a matching ']'"; break;
+            case TOK_LEFT_BRACE:    message = "unclosed '{'"; help = "add a matching '}'"; break;
+            case TOK_RIGHT_PAREN:   message = "unexpected ')'"; help = "no '(' opens it"; break;
+            case TOK_RIGHT_SQUARE:  message = "unexpected ']'"; help = "no '[' opens it"; break;
+            case TOK_RIGHT_BRACE:   message = "unexpected '}'"; help = "no '{' opens it"; break;
+
+            default: continue;
+        }
+
+        diag_error_help(diag_ctx, &tokens -> items[i], message, help);
+    }
 }
 
 char* parse_word(MythrilContext* ctx, char* cursor) {
@@ -409,20 +539,7 @@ char* parse_operator(MythrilContext* ctx, char* cursor) {
 
     token -> kind = TOK_ERROR;
 
-    DiagContext* diag_ctx = ctx -> diag_ctx;
-    SourceLocation location = source_location_from_token(
-        diag_ctx -> path,
-        ctx -> buffer_start,
-        token
-    );
-
-    diag_error(
-        diag_ctx,
-        location,
-        "unknown token found '%.*s'",
-        token -> length,
-        token -> lexeme
-    ); 
+    diag_error_token(ctx -> diag_ctx, reported_token(ctx, token), DIAG_UNKNOWN_TOKEN);
 
     return cursor;
 }
@@ -488,15 +605,9 @@ char* parse_string_literal(MythrilContext* ctx, char* cursor) {
         token -> lexeme = start;
         token -> length = cursor - start;
 
-        SourceLocation location = source_location_from_token(
-            ctx -> diag_ctx -> path,
-            ctx -> buffer_start,
-            token
-        );
-
         diag_error_help(
             ctx -> diag_ctx,
-            location,
+            reported_token(ctx, token),
             "unterminated string",
             "add '\"' to terminate the string"
         );
@@ -543,20 +654,7 @@ char* parse_invalid_tokens(MythrilContext* ctx, char* cursor) {
     token -> lexeme = start;
     token -> length = len;
 
-    DiagContext* diag_ctx = ctx -> diag_ctx;
-    SourceLocation location = source_location_from_token(
-        diag_ctx -> path,
-        ctx -> buffer_start,
-        token
-    );
-
-    diag_error(
-        diag_ctx,
-        location,
-        "unknown token found '%.*s'",
-        token -> length,
-        token -> lexeme
-    ); 
+    diag_error_token(ctx -> diag_ctx, reported_token(ctx, token), DIAG_UNKNOWN_TOKEN);
 
     return cursor;
 }
@@ -8,6 +8,32 @@
 
 void tokenize(MythrilContext* ctx);
 
+/*
+*
+*   lexes [cursor, end) of the current buffer, locations stay relative to
+*   ctx -> buffer_start. The last token may run past end, the returned
+*   cursor is where lexing actually stopped
+*
+*/
+char* tokenize_range(MythrilContext* ctx, char* cursor, char* end);
+
+/*
+*
+*   fills Tokens.matches and Tokens.kinds for every token from first on
+*   and stamps Tokens.file into each
+*
+*/
+void index_tokens(MythrilContext* ctx, usize first);
+
+/*
+*
+*   one error for every bracket from first on that index_tokens() left
+*   unmatched, in source order. Nesting depth has no limit, the parser
+*   then takes block ends straight from Tokens.matches
+*
+*/
+void report_unbalanced(MythrilContext* ctx, usize first);
+
 char* parse_word(MythrilContext* ctx, char* cursor);
 char* parse_number(MythrilContext* ctx, char* cursor);
 char* parse_operator(MythrilContext* ctx, char* cursor);
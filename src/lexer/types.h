@@ -4,6 +4,8 @@
 
 #include "../utils/types.h"
 
+#define BRACKET_STACK_INIT_CAPACITY 64
+
 #define IS_DIGIT(c) (char_map[(unsigned char)(c)] & 1)
 #define IS_ALPHA(c) (char_map[(unsigned char)(c)] & 2)
 #define IS_OPERATOR(c) (char_map[(unsigned char)(c)] & 4)
@@ -0,0 +1,242 @@
+#include "loader.h"
+#include "types.h"
+
+#include "../files/files.h"
+
+#include <dirent.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static i32 add_input(PathList* paths, ArenaAllocator* arena, const char* arg, u32 depth);
+static i32 add_response_file(PathList* paths, ArenaAllocator* arena, const char* path, u32 depth);
+static i32 add_pattern(PathList* paths, ArenaAllocator* arena, const char* pattern);
+static i32 add_directory(PathList* paths, ArenaAllocator* arena, const char* path);
+static void push_path(PathList* paths, ArenaAllocator* arena, char* path);
+static char* alloc_path(ArenaAllocator* arena, usize len);
+static char* copy_path(ArenaAllocator* arena, const char* path, usize len);
+
+i32 expand_inputs(PathList* paths, ArenaAllocator* arena, char** args, u32 count) {
+    paths -> capacity = count > LOADER_PATHS_INIT_CAPACITY ? count : LOADER_PATHS_INIT_CAPACITY;
+    paths -> items = arena_array(arena, char*, paths -> capacity);
+    paths -> count = 0;
+
+    i32 result = 0;
+
+    // keeps going past a bad argument, every one of them is reported
+    for (u32 i = 0; i < count; i++) {
+        if (add_input(paths, arena, args[i], 0) == -1) {
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+static b8 is_directory(const char* path) {
+    struct stat st;
+
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static i32 add_input(PathList* paths, ArenaAllocator* arena, const char* arg, u32 depth) {
+    if (arg[0] == '@' && arg[1] != 0) {
+        return add_response_file(paths, arena, arg + 1, depth);
+    }
+
+    if (strpbrk(arg, "*?[")) {
+        return add_pattern(paths, arena, arg);
+    }
+
+    if (is_directory(arg)) {
+        return add_directory(paths, arena, arg);
+    }
+
+    // a missing file is the loaders to report, together with every other
+    push_path(paths, arena, copy_path(arena, arg, strlen(arg)));
+
+    return 0;
+}
+
+static i32 add_response_file(PathList* paths, ArenaAllocator* arena, const char* path, u32 depth) {
+    if (depth >= LOADER_RESPONSE_DEPTH) {
+        fprintf(stderr, "Error: Response file '%s' is nested more than %u deep\n", path, LOADER_RESPONSE_DEPTH);
+        return -1;
+    }
+
+    FileBuffer file;
+
+    if (load_file(&file, arena, path) == -1) {
+        return -1;
+    }
+
+    i32 result = 0;
+
+    const char* cursor = file.ptr;
+    const char* end = file.ptr + file.len - 1;
+
+    while (cursor < end) {
+        const char* line = cursor;
+
+        while (cursor < end && *cursor != '\n') {
+            cursor++;
+        }
+
+        const char* line_end = cursor++;
+
+        while (line < line_end && (*line == ' ' || *line == '\t')) {
+            line++;
+        }
+
+        while (line_end > line && (line_end[-1] == ' ' || line_end[-1] == '\t' || line_end[-1] == '\r')) {
+            line_end--;
+        }
+
+        if (line == line_end || *line == '#') {
+            continue;
+        }
+
+        // the entry needs a NUL of its own, a mapped file is read only
+        const char* entry = copy_path(arena, line, line_end - line);
+
+        if (add_input(paths, arena, entry, depth + 1) == -1) {
+            result = -1;
+        }
+    }
+
+    unload_file(&file);
+
+    return result;
+}
+
+static i32 add_pattern(PathList* paths, ArenaAllocator* arena, const char* pattern) {
+    glob_t matches;
+
+    const i32 found = glob(pattern, 0, nullptr, &matches);
+
+    if (found == GLOB_NOMATCH) {
+        fprintf(stderr, "Error: No files match '%s'\n", pattern);
+        return -1;
+    }
+
+    if (found != 0) {
+        fprintf(stderr, "Error: Failed to expand '%s'\n", pattern);
+        return -1;
+    }
+
+    i32 result = 0;
+
+    // already sorted, a matched directory is searched like a named one
+    for (usize i = 0; i < matches.gl_pathc; i++) {
+        const char* match = matches.gl_pathv[i];
+
+        if (is_directory(match)) {
+            if (add_directory(paths, arena, match) == -1) {
+                result = -1;
+            }
+        } else {
+            push_path(paths, arena, copy_path(arena, match, strlen(match)));
+        }
+    }
+
+    globfree(&matches);
+
+    return result;
+}
+
+static i32 compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+// every source below path, the entries of each directory in sorted order
+static i32 add_directory(PathList* paths, ArenaAllocator* arena, const char* path) {
+    DIR* dir = opendir(path);
+
+    if (!dir) {
+        fprintf(stderr, "Error: Failed to open directory '%s'\n", path);
+        return -1;
+    }
+
+    const usize path_len = strlen(path);
+    const b8 slash = path_len > 0 && path[path_len - 1] == '/';
+    const usize ext_len = sizeof(LOADER_SOURCE_EXTENSION) - 1;
+
+    PathList entries = {
+        .items = arena_array(arena, char*, LOADER_PATHS_INIT_CAPACITY),
+        .count = 0,
+        .capacity = LOADER_PATHS_INIT_CAPACITY
+    };
+
+    struct dirent* entry;
+
+    while ((entry = readdir(dir))) {
+        // hidden entries, . and .. among them
+        if (entry -> d_name[0] == '.') {
+            continue;
+        }
+
+        const usize name_len = strlen(entry -> d_name);
+        const usize len = path_len + !slash + name_len;
+
+        char* full = alloc_path(arena, len);
+
+        memcpy(full, path, path_len);
+
+        if (!slash) {
+            full[path_len] = '/';
+        }
+
+        memcpy(full + path_len + !slash, entry -> d_name, name_len);
+
+        push_path(&entries, arena, full);
+    }
+
+    closedir(dir);
+
+    qsort(entries.items, entries.count, sizeof(char*), compare_names);
+
+    i32 result = 0;
+
+    for (u32 i = 0; i < entries.count; i++) {
+        char* full = entries.items[i];
+        const usize len = strlen(full);
+
+        if (is_directory(full)) {
+            if (add_directory(paths, arena, full) == -1) {
+                result = -1;
+            }
+        } else if (len > ext_len && memcmp(full + len - ext_len, LOADER_SOURCE_EXTENSION, ext_len) == 0) {
+            push_path(paths, arena, full);
+        }
+    }
+
+    return result;
+}
+
+static void push_path(PathList* paths, ArenaAllocator* arena, char* path) {
+    if (paths -> count >= paths -> capacity) {
+        paths -> items = arena_realloc(arena, paths -> items, paths -> capacity * sizeof(char*), paths -> capacity * 2 * sizeof(char*));
+        paths -> capacity *= 2;
+    }
+
+    paths -> items[paths -> count++] = path;
+}
+
+// room for len bytes and a NUL after them, the arena does not align so neither may the size
+static char* alloc_path(ArenaAllocator* arena, usize len) {
+    char* path = arena_alloc(arena, (len + 1 + 7) & ~(usize) 7);
+
+    path[len] = 0;
+
+    return path;
+}
+
+static char* copy_path(ArenaAllocator* arena, const char* path, usize len) {
+    char* copy = alloc_path(arena, len);
+
+    memcpy(copy, path, len);
+
+    return copy;
+}
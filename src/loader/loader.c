@@ -0,0 +1,552 @@
+#include "loader.h"
+#include "types.h"
+
+#include "../files/files.h"
+#include "uring/uring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// user_data of a ring operation, the slot index and what it does
+#define RING_OP_OPEN 0
+#define RING_OP_STAT 1
+#define RING_OP_READ 2
+#define RING_USER_DATA(index, op) (((u64) (index) << 2) | (op))
+
+static const u8 RING_OPS[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ };
+
+static void open_slot(LoadSlot* slot);
+static void prepare_slot(Loader* loader, u32 index);
+static u32 read_slot(LoadSlot* slot, FileBuffer* buffer);
+static u32 finish_read(LoadSlot* slot, FileBuffer* buffer);
+static u32 fail_slot(LoadSlot* slot, LoadStep step, i32 error);
+static void close_slot(LoadSlot* slot);
+static void report_slot(const LoadSlot* slot);
+
+static void open_ring(Loader* loader);
+static void pump_ring(Loader* loader, u32 wait);
+static void queue_read(Loader* loader, u32 index);
+
+static u32 start_threads(Loader* loader, u32 wanted, void* (*worker)(void*));
+static void join_threads(Loader* loader);
+static void* open_worker(void* arg);
+static void* read_worker(void* arg);
+
+i32 init_loader(Loader* loader, ArenaAllocator* arena, char** paths, FileBuffer* buffers, u32 count, u32 jobs) {
+    *loader = (Loader) {
+        .arena = arena,
+        .buffers = buffers,
+        .count = count,
+        .backend = LOADER_SERIAL,
+        .next = 0,
+        .thread_count = 0,
+        .stopping = false
+    };
+
+    init_arena(&loader -> scratch, 0);
+    pthread_mutex_init(&loader -> lock, nullptr);
+    pthread_cond_init(&loader -> ready, nullptr);
+
+    loader -> slots = arena_array_zero(&loader -> scratch, LoadSlot, count > 0 ? count : 1);
+
+    for (u32 i = 0; i < count; i++) {
+        loader -> slots[i].path = paths[i];
+        loader -> slots[i].fd = -1;
+        loader -> slots[i].state = LOAD_PENDING;
+    }
+
+    if (count >= LOADER_BATCH_MIN) {
+        const b8 ring = init_io_ring(&loader -> ring, LOADER_RING_ENTRIES, RING_OPS, sizeof(RING_OPS)) == 0;
+
+        loader -> backend = ring ? LOADER_URING : LOADER_THREADS;
+    }
+
+    // the threads wait on the disk, not the cpu, more than --jobs pay off
+    u32 threads = jobs > LOADER_MIN_THREADS ? jobs : LOADER_MIN_THREADS;
+    threads = threads > LOADER_MAX_THREADS ? LOADER_MAX_THREADS : threads;
+    threads = threads > count ? count : threads;
+
+    switch (loader -> backend) {
+        case LOADER_SERIAL: {
+            for (u32 i = 0; i < count; i++) {
+                open_slot(&loader -> slots[i]);
+            }
+        } break;
+
+        case LOADER_URING: {
+            open_ring(loader);
+        } break;
+
+        case LOADER_THREADS: {
+            // the calling thread opens files too
+            start_threads(loader, threads - 1, open_worker);
+            open_worker(loader);
+            join_threads(loader);
+        } break;
+    }
+
+    u32 failed = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (loader -> slots[i].state == LOAD_FAILED) {
+            report_slot(&loader -> slots[i]);
+            failed++;
+        }
+    }
+
+    if (failed > 0) {
+        return -1;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        prepare_slot(loader, i);
+    }
+
+    loader -> next = 0;
+
+    if (loader -> backend == LOADER_URING) {
+        pump_ring(loader, 0);
+    } else if (loader -> backend == LOADER_THREADS && start_threads(loader, threads, read_worker) == 0) {
+        loader -> backend = LOADER_SERIAL;
+    }
+
+    return 0;
+}
+
+i32 loader_take(Loader* loader, u32 index) {
+    LoadSlot* slot = &loader -> slots[index];
+
+    switch (loader -> backend) {
+        case LOADER_SERIAL: {
+            if (slot -> state == LOAD_PENDING) {
+                slot -> state = read_slot(slot, &loader -> buffers[index]);
+            }
+        } break;
+
+        case LOADER_URING: {
+            while (slot -> state == LOAD_PENDING) {
+                pump_ring(loader, 1);
+            }
+        } break;
+
+        case LOADER_THREADS: {
+            pthread_mutex_lock(&loader -> lock);
+
+            while (slot -> state == LOAD_PENDING) {
+                pthread_cond_wait(&loader -> ready, &loader -> lock);
+            }
+
+            pthread_mutex_unlock(&loader -> lock);
+        } break;
+    }
+
+    if (slot -> state == LOAD_FAILED) {
+        report_slot(slot);
+        return -1;
+    }
+
+    return 0;
+}
+
+void finish_loader(Loader* loader) {
+    __atomic_store_n(&loader -> stopping, true, __ATOMIC_RELAXED);
+
+    if (loader -> backend == LOADER_THREADS) {
+        join_threads(loader);
+    }
+
+    if (loader -> backend == LOADER_URING) {
+        // the kernel may still write into buffers, wait until it is done
+        u64 user_data;
+        i32 result;
+
+        while (loader -> ring.pending + loader -> ring.in_flight > 0) {
+            if (io_ring_submit(&loader -> ring, 1) == -1) {
+                break;
+            }
+
+            while (io_ring_reap(&loader -> ring, &user_data, &result));
+        }
+
+        free_io_ring(&loader -> ring);
+    }
+
+    for (u32 i = 0; i < loader -> count; i++) {
+        close_slot(&loader -> slots[i]);
+    }
+
+    pthread_cond_destroy(&loader -> ready);
+    pthread_mutex_destroy(&loader -> lock);
+
+    arena_free(&loader -> scratch);
+}
+
+//
+//  one file at a time, on the calling thread or a thread of the pool
+//
+
+static void open_slot(LoadSlot* slot) {
+    const b8 from_stdin = strcmp(slot -> path, FILE_STDIN_PATH) == 0;
+
+    slot -> fd = from_stdin ? STDIN_FILENO : open(slot -> path, O_RDONLY | O_CLOEXEC);
+
+    if (slot -> fd == -1) {
+        slot -> state = fail_slot(slot, LOAD_STEP_OPEN, errno);
+        return;
+    }
+
+    struct stat st;
+
+    if (fstat(slot -> fd, &st) == -1) {
+        slot -> state = fail_slot(slot, LOAD_STEP_STAT, errno);
+        return;
+    }
+
+    slot -> regular = S_ISREG(st.st_mode);
+    slot -> size = slot -> regular ? (usize) st.st_size : 0;
+}
+
+/*
+*
+*   on the calling thread, the arena is not shared. Pipes, stdin and
+*   files that claim to be empty are read to their end right away, large
+*   files are mapped. Only small files are left for the background reads,
+*   their buffer is allocated here
+*
+*/
+static void prepare_slot(Loader* loader, u32 index) {
+    LoadSlot* slot = &loader -> slots[index];
+    FileBuffer* buffer = &loader -> buffers[index];
+
+    if (!slot -> regular || slot -> size == 0) {
+        if (read_source(buffer, loader -> arena, slot -> fd, FILE_STREAM_CHUNK, false) == -1) {
+            slot -> state = fail_slot(slot, LOAD_STEP_READ, errno);
+        } else {
+            slot -> state = LOAD_READY;
+        }
+
+        close_slot(slot);
+        return;
+    }
+
+    if (slot -> size >= FILE_MAP_THRESHOLD) {
+        if (map_source(buffer, slot -> fd, slot -> size) == -1) {
+            slot -> state = fail_slot(slot, LOAD_STEP_READ, errno);
+        } else {
+            slot -> state = LOAD_READY;
+        }
+
+        close_slot(slot);
+        return;
+    }
+
+    usize capacity;
+
+    buffer -> ptr = alloc_source(loader -> arena, slot -> size, &capacity);
+    buffer -> len = slot -> size + 1;
+    buffer -> mapped = 0;
+
+    slot -> read = true;
+}
+
+// returns the LoadState the slot ends up in, the caller publishes it
+static u32 read_slot(LoadSlot* slot, FileBuffer* buffer) {
+    while (slot -> done < slot -> size) {
+        const ssize got = pread(slot -> fd, buffer -> ptr + slot -> done, slot -> size - slot -> done, (off_t) slot -> done);
+
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return fail_slot(slot, LOAD_STEP_READ, errno);
+        }
+
+        if (got == 0) {
+            break;
+        }
+
+        slot -> done += (usize) got;
+    }
+
+    return finish_read(slot, buffer);
+}
+
+// a file that shrank since it was opened ends early, the rest of its buffer is zeroed
+static u32 finish_read(LoadSlot* slot, FileBuffer* buffer) {
+    memset(buffer -> ptr + slot -> done, 0, slot -> size - slot -> done);
+
+    buffer -> len = slot -> done + 1;
+
+    close_slot(slot);
+
+    return LOAD_READY;
+}
+
+// returns LOAD_FAILED, the caller publishes it
+static u32 fail_slot(LoadSlot* slot, LoadStep step, i32 error) {
+    slot -> step = (u8) step;
+    slot -> error = error;
+
+    close_slot(slot);
+
+    return LOAD_FAILED;
+}
+
+static void close_slot(LoadSlot* slot) {
+    if (slot -> fd != -1 && strcmp(slot -> path, FILE_STDIN_PATH) != 0) {
+        close(slot -> fd);
+    }
+
+    slot -> fd = -1;
+}
+
+static void report_slot(const LoadSlot* slot) {
+    static const char* STEPS[] = {
+        [LOAD_STEP_OPEN] = "open",
+        [LOAD_STEP_STAT] = "stat",
+        [LOAD_STEP_READ] = "read"
+    };
+
+    fprintf(stderr, "Error: Failed to %s file '%s': %s\n", STEPS[slot -> step], slot -> path, strerror(slot -> error));
+}
+
+//
+//  io_uring, every file is opened and sized by path in one batch after
+//  the other, the reads follow in file order as the ring has room
+//
+
+static void open_ring(Loader* loader) {
+    IoRing* ring = &loader -> ring;
+
+    struct statx* stats = arena_array(&loader -> scratch, struct statx, loader -> count);
+
+    u32 next = 0;
+
+    while (next < loader -> count || ring -> pending + ring -> in_flight > 0) {
+        while (next < loader -> count) {
+            LoadSlot* slot = &loader -> slots[next];
+
+            // there is no path to open
+            if (strcmp(slot -> path, FILE_STDIN_PATH) == 0) {
+                open_slot(slot);
+                next++;
+                continue;
+            }
+
+            if (ring -> pending + ring -> in_flight + 2 > ring -> entries) {
+                break;
+            }
+
+            struct io_uring_sqe* open_sqe = io_ring_sqe(ring);
+
+            open_sqe -> opcode = IORING_OP_OPENAT;
+            open_sqe -> fd = AT_FDCWD;
+            open_sqe -> addr = (u64) (uintptr_t) slot -> path;
+            open_sqe -> open_flags = O_RDONLY | O_CLOEXEC;
+            open_sqe -> user_data = RING_USER_DATA(next, RING_OP_OPEN);
+
+            struct io_uring_sqe* stat_sqe = io_ring_sqe(ring);
+
+            stat_sqe -> opcode = IORING_OP_STATX;
+            stat_sqe -> fd = AT_FDCWD;
+            stat_sqe -> addr = (u64) (uintptr_t) slot -> path;
+            stat_sqe -> len = STATX_TYPE | STATX_SIZE;
+            stat_sqe -> off = (u64) (uintptr_t) &stats[next];
+            stat_sqe -> user_data = RING_USER_DATA(next, RING_OP_STAT);
+
+            next++;
+        }
+
+        if (ring -> pending + ring -> in_flight == 0) {
+            continue;
+        }
+
+        if (io_ring_submit(ring, 1) == -1) {
+            // nothing more goes through the ring, what is left is opened here
+            const i32 error = errno;
+
+            for (u32 i = 0; i < loader -> count; i++) {
+                if (loader -> slots[i].state == LOAD_PENDING && loader -> slots[i].fd == -1) {
+                    loader -> slots[i].state = fail_slot(&loader -> slots[i], LOAD_STEP_OPEN, error);
+                }
+            }
+
+            return;
+        }
+
+        u64 user_data;
+        i32 result;
+
+        while (io_ring_reap(ring, &user_data, &result)) {
+            const u32 index = (u32) (user_data >> 2);
+            LoadSlot* slot = &loader -> slots[index];
+
+            if ((user_data & 3) == RING_OP_OPEN) {
+                if (result < 0) {
+                    slot -> state = fail_slot(slot, LOAD_STEP_OPEN, -result);
+                } else if (slot -> state == LOAD_FAILED) {
+                    // the statx failed first
+                    close(result);
+                } else {
+                    slot -> fd = result;
+                }
+            } else if (result < 0) {
+                // a failed open says more than a failed statx
+                if (slot -> state != LOAD_FAILED) {
+                    slot -> state = fail_slot(slot, LOAD_STEP_STAT, -result);
+                }
+            } else {
+                slot -> regular = S_ISREG(stats[index].stx_mode);
+                slot -> size = slot -> regular ? (usize) stats[index].stx_size : 0;
+            }
+        }
+    }
+}
+
+/*
+*
+*   queues the reads of the following files while the ring has room,
+*   submits them and handles whatever completed. wait is the number of
+*   completions to wait for
+*
+*/
+static void pump_ring(Loader* loader, u32 wait) {
+    IoRing* ring = &loader -> ring;
+
+    while (loader -> next < loader -> count && ring -> pending + ring -> in_flight < ring -> entries) {
+        const u32 index = loader -> next++;
+
+        if (loader -> slots[index].read) {
+            queue_read(loader, index);
+        }
+    }
+
+    if (io_ring_submit(ring, ring -> pending + ring -> in_flight > 0 ? wait : 0) == -1) {
+        // the ring is broken, every read still waiting on it fails
+        const i32 error = errno;
+
+        for (u32 i = 0; i < loader -> count; i++) {
+            if (loader -> slots[i].read && loader -> slots[i].state == LOAD_PENDING) {
+                loader -> slots[i].state = fail_slot(&loader -> slots[i], LOAD_STEP_READ, error);
+            }
+        }
+
+        return;
+    }
+
+    u64 user_data;
+    i32 result;
+
+    while (io_ring_reap(ring, &user_data, &result)) {
+        const u32 index = (u32) (user_data >> 2);
+
+        LoadSlot* slot = &loader -> slots[index];
+        FileBuffer* buffer = &loader -> buffers[index];
+
+        if (result == -EINTR || result == -EAGAIN) {
+            queue_read(loader, index);
+        } else if (result < 0) {
+            slot -> state = fail_slot(slot, LOAD_STEP_READ, -result);
+        } else if (result > 0 && slot -> done + (usize) result < slot -> size) {
+            // a short read, the rest is asked for again
+            slot -> done += (usize) result;
+            queue_read(loader, index);
+        } else {
+            slot -> done += (usize) result;
+            slot -> state = finish_read(slot, buffer);
+        }
+    }
+}
+
+// the rest of a file, a read that finds no room in the ring is done right away
+static void queue_read(Loader* loader, u32 index) {
+    LoadSlot* slot = &loader -> slots[index];
+    FileBuffer* buffer = &loader -> buffers[index];
+
+    struct io_uring_sqe* sqe = io_ring_sqe(&loader -> ring);
+
+    if (!sqe) {
+        slot -> state = read_slot(slot, buffer);
+        return;
+    }
+
+    sqe -> opcode = IORING_OP_READ;
+    sqe -> fd = slot -> fd;
+    sqe -> addr = (u64) (uintptr_t) (buffer -> ptr + slot -> done);
+    sqe -> len = (u32) (slot -> size - slot -> done);
+    sqe -> off = slot -> done;
+    sqe -> user_data = RING_USER_DATA(index, RING_OP_READ);
+}
+
+//
+//  thread pool, the workers take files in order through loader -> next
+//
+
+static u32 start_threads(Loader* loader, u32 wanted, void* (*worker)(void*)) {
+    loader -> thread_count = 0;
+
+    for (u32 i = 0; i < wanted; i++) {
+        if (pthread_create(&loader -> threads[loader -> thread_count], nullptr, worker, loader) == 0) {
+            loader -> thread_count++;
+        }
+    }
+
+    return loader -> thread_count;
+}
+
+static void join_threads(Loader* loader) {
+    for (u32 i = 0; i < loader -> thread_count; i++) {
+        pthread_join(loader -> threads[i], nullptr);
+    }
+
+    loader -> thread_count = 0;
+}
+
+static void* open_worker(void* arg) {
+    Loader* loader = arg;
+
+    while (true) {
+        const u32 index = __atomic_fetch_add(&loader -> next, 1, __ATOMIC_RELAXED);
+
+        if (index >= loader -> count) {
+            break;
+        }
+
+        open_slot(&loader -> slots[index]);
+    }
+
+    return nullptr;
+}
+
+static void* read_worker(void* arg) {
+    Loader* loader = arg;
+
+    while (!__atomic_load_n(&loader -> stopping, __ATOMIC_RELAXED)) {
+        const u32 index = __atomic_fetch_add(&loader -> next, 1, __ATOMIC_RELAXED);
+
+        if (index >= loader -> count) {
+            break;
+        }
+
+        LoadSlot* slot = &loader -> slots[index];
+
+        if (!slot -> read) {
+            continue;
+        }
+
+        const u32 state = read_slot(slot, &loader -> buffers[index]);
+
+        pthread_mutex_lock(&loader -> lock);
+        slot -> state = state;
+        pthread_cond_broadcast(&loader -> ready);
+        pthread_mutex_unlock(&loader -> lock);
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MYTHRIL_LOADER_H
+#define MYTHRIL_LOADER_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+#include "../files/types.h"
+
+/*
+*
+*   turns the file arguments into the paths to compile. @FILE reads more
+*   arguments from FILE, one per line, blank lines and lines starting
+*   with '#' skipped. A directory stands for every LOADER_SOURCE_EXTENSION
+*   file below it and a pattern with '*', '?' or '[' for the paths
+*   glob() finds, both in sorted order. Anything else is kept as it is.
+*   Reports every argument that leads nowhere and returns -1 if any did
+*
+*/
+i32 expand_inputs(PathList* paths, ArenaAllocator* arena, char** args, u32 count);
+
+/*
+*
+*   opens and sizes every one of paths, then starts reading them into
+*   buffers. Small files are read into arena in the background, large
+*   ones are mapped, pipes and stdin are read right away. Every file
+*   that cannot be opened is reported and -1 returned. The loader has
+*   to be finished either way
+*
+*/
+i32 init_loader(Loader* loader, ArenaAllocator* arena, char** paths, FileBuffer* buffers, u32 count, u32 jobs);
+
+// waits until buffers[index] holds the file, reports it and returns -1 if it could not be read
+i32 loader_take(Loader* loader, u32 index);
+
+// stops the reads still running and closes every file, the buffers stay with the caller
+void finish_loader(Loader* loader);
+
+#endif // !MYTHRIL_LOADER_H
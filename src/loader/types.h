@@ -0,0 +1,112 @@
+#pragma once
+#ifndef MYTHRIL_LOADER_TYPES_H
+#define MYTHRIL_LOADER_TYPES_H
+
+#include "../arena/arena.h"
+#include "../files/types.h"
+#include "../utils/types.h"
+
+#include "uring/types.h"
+
+#include <pthread.h>
+
+// fewer files are opened and read one after the other on the calling thread
+#define LOADER_BATCH_MIN 8
+
+// operations in flight at once, the reads run this far ahead of the lexer
+#define LOADER_RING_ENTRIES 256
+
+// the thread pool is io bound, it gets at least this many threads whatever --jobs says
+#define LOADER_MIN_THREADS 4
+#define LOADER_MAX_THREADS 64
+
+// @files nested in @files
+#define LOADER_RESPONSE_DEPTH 8
+
+// what a directory argument picks up
+#define LOADER_SOURCE_EXTENSION ".myth"
+
+#define LOADER_PATHS_INIT_CAPACITY 64
+
+typedef enum {
+    LOADER_SERIAL,
+    LOADER_URING,
+    LOADER_THREADS
+} LoaderBackend;
+
+typedef enum {
+    LOAD_PENDING,
+    LOAD_READY,
+    LOAD_FAILED
+} LoadState;
+
+// what a failed file was doing, picks the message
+typedef enum {
+    LOAD_STEP_OPEN,
+    LOAD_STEP_STAT,
+    LOAD_STEP_READ
+} LoadStep;
+
+/*
+*
+*   one input file. Opening finds fd and size, a file that is read
+*   later has its buffer allocated by then and done counts the bytes
+*   that arrived. state is LoadState, written under the lock of the
+*   thread pool
+*
+*/
+typedef struct {
+    const char* path;
+
+    usize size;
+    usize done;
+
+    i32 fd;
+    i32 error; // errno of the step that failed
+
+    u32 state;
+    u8 step;   // LoadStep
+    b8 regular;
+    b8 read;   // left for the background reads, see prepare_slot()
+    u8 _padding;
+} LoadSlot;
+
+/*
+*
+*   loads many files at once. Every file is opened before anything is
+*   read, so each one that is missing is known up front. The reads of
+*   small files then run in the background, through io_uring where the
+*   kernel has it and on a thread pool where not, while the caller works
+*   through the files in order
+*
+*/
+typedef struct {
+    ArenaAllocator* arena;  // the text of small files
+    ArenaAllocator scratch; // everything that goes with the loader
+
+    LoadSlot* slots;
+    FileBuffer* buffers;    // the callers, one per slot
+    u32 count;
+
+    u32 backend;            // LoaderBackend
+    u32 next;               // next slot to open or read, atomic on the thread pool
+
+    u32 thread_count;
+    pthread_t threads[LOADER_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+    IoRing ring;
+
+    b8 stopping;
+    u8 _padding[7];
+} Loader;
+
+// the paths expand_inputs() found
+typedef struct {
+    char** items;
+    u32 count;
+    u32 capacity;
+} PathList;
+
+#endif // !MYTHRIL_LOADER_TYPES_H
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef MYTHRIL_LOADER_URING_TYPES_H
+#define MYTHRIL_LOADER_URING_TYPES_H
+
+#include "../../utils/types.h"
+
+#include <linux/io_uring.h>
+
+/*
+*
+*   an io_uring set up through the raw system calls. The kernel shares
+*   the heads and tails with us, the rest is ours. tail runs ahead of
+*   the shared one by the sqes filled in since the last submit. pending
+*   ones were not taken by the kernel yet, in_flight ones were and have
+*   not completed
+*
+*/
+typedef struct {
+    i32 fd;
+    u32 entries;
+
+    u32* sq_head;
+    u32* sq_tail;
+    u32* sq_array;
+    u32 sq_mask;
+
+    u32 cq_mask;
+    u32* cq_head;
+    u32* cq_tail;
+    struct io_uring_cqe* cqes;
+
+    struct io_uring_sqe* sqes;
+
+    void* sq_ring;
+    usize sq_ring_size;
+    void* cq_ring;
+    usize cq_ring_size;
+    usize sqes_size;
+
+    u32 tail;
+    u32 pending;
+    u32 in_flight;
+    u8 _padding[4];
+} IoRing;
+
+#endif // !MYTHRIL_LOADER_URING_TYPES_H
@@ -0,0 +1,199 @@
+#include "uring.h"
+#include "types.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// big enough for every opcode a probe reports
+#define IO_RING_PROBE_OPS 256
+
+static i32 ring_setup(u32 entries, struct io_uring_params* params) {
+    return (i32) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static i32 ring_enter(i32 fd, u32 submit, u32 wait, u32 flags) {
+    return (i32) syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0);
+}
+
+static i32 ring_register(i32 fd, u32 opcode, void* arg, u32 count) {
+    return (i32) syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static b8 supports_ops(i32 fd, const u8* ops, u32 op_count) {
+    union {
+        struct io_uring_probe probe;
+        u8 bytes[sizeof(struct io_uring_probe) + IO_RING_PROBE_OPS * sizeof(struct io_uring_probe_op)];
+    } storage;
+
+    memset(&storage, 0, sizeof(storage));
+
+    // a kernel without probing predates the opcodes a loader needs
+    if (ring_register(fd, IORING_REGISTER_PROBE, &storage.probe, IO_RING_PROBE_OPS) < 0) {
+        return false;
+    }
+
+    for (u32 i = 0; i < op_count; i++) {
+        if (ops[i] >= storage.probe.ops_len || !(storage.probe.ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+i32 init_io_ring(IoRing* ring, u32 entries, const u8* ops, u32 op_count) {
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring -> fd = ring_setup(entries, &params);
+
+    if (ring -> fd < 0) {
+        return -1;
+    }
+
+    if (!supports_ops(ring -> fd, ops, op_count)) {
+        close(ring -> fd);
+        return -1;
+    }
+
+    ring -> entries = params.sq_entries;
+
+    ring -> sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring -> cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // one mapping serves both rings on any kernel from 5.4 on
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring -> cq_ring_size > ring -> sq_ring_size) {
+            ring -> sq_ring_size = ring -> cq_ring_size;
+        }
+
+        ring -> cq_ring_size = ring -> sq_ring_size;
+    }
+
+    ring -> sq_ring = mmap(nullptr, ring -> sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring -> fd, IORING_OFF_SQ_RING);
+
+    if (ring -> sq_ring == MAP_FAILED) {
+        close(ring -> fd);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring -> cq_ring = ring -> sq_ring;
+    } else {
+        ring -> cq_ring = mmap(nullptr, ring -> cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring -> fd, IORING_OFF_CQ_RING);
+
+        if (ring -> cq_ring == MAP_FAILED) {
+            munmap(ring -> sq_ring, ring -> sq_ring_size);
+            close(ring -> fd);
+            return -1;
+        }
+    }
+
+    ring -> sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring -> sqes = mmap(nullptr, ring -> sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring -> fd, IORING_OFF_SQES);
+
+    if (ring -> sqes == MAP_FAILED) {
+        if (ring -> cq_ring != ring -> sq_ring) {
+            munmap(ring -> cq_ring, ring -> cq_ring_size);
+        }
+
+        munmap(ring -> sq_ring, ring -> sq_ring_size);
+        close(ring -> fd);
+        return -1;
+    }
+
+    u8* sq = ring -> sq_ring;
+    u8* cq = ring -> cq_ring;
+
+    ring -> sq_head = (u32*) (sq + params.sq_off.head);
+    ring -> sq_tail = (u32*) (sq + params.sq_off.tail);
+    ring -> sq_mask = *(u32*) (sq + params.sq_off.ring_mask);
+    ring -> sq_array = (u32*) (sq + params.sq_off.array);
+
+    ring -> cq_head = (u32*) (cq + params.cq_off.head);
+    ring -> cq_tail = (u32*) (cq + params.cq_off.tail);
+    ring -> cq_mask = *(u32*) (cq + params.cq_off.ring_mask);
+    ring -> cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    ring -> tail = *ring -> sq_tail;
+
+    return 0;
+}
+
+void free_io_ring(IoRing* ring) {
+    munmap(ring -> sqes, ring -> sqes_size);
+
+    if (ring -> cq_ring != ring -> sq_ring) {
+        munmap(ring -> cq_ring, ring -> cq_ring_size);
+    }
+
+    munmap(ring -> sq_ring, ring -> sq_ring_size);
+    close(ring -> fd);
+}
+
+/*
+*
+*   no more than entries are ever pending or in flight together, the
+*   completion ring holds twice that and can never overflow
+*
+*/
+struct io_uring_sqe* io_ring_sqe(IoRing* ring) {
+    if (ring -> pending + ring -> in_flight >= ring -> entries) {
+        return nullptr;
+    }
+
+    const u32 index = ring -> tail++ & ring -> sq_mask;
+
+    struct io_uring_sqe* sqe = &ring -> sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    ring -> sq_array[index] = index;
+    ring -> pending++;
+
+    return sqe;
+}
+
+i32 io_ring_submit(IoRing* ring, u32 wait) {
+    // the kernel reads the entries once it sees the new tail
+    __atomic_store_n(ring -> sq_tail, ring -> tail, __ATOMIC_RELEASE);
+
+    const u32 flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    while (true) {
+        const i32 submitted = ring_enter(ring -> fd, ring -> pending, wait, flags);
+
+        if (submitted >= 0) {
+            ring -> pending -= (u32) submitted;
+            ring -> in_flight += (u32) submitted;
+
+            return 0;
+        }
+
+        if (errno != EINTR && errno != EAGAIN) {
+            return -1;
+        }
+    }
+}
+
+b8 io_ring_reap(IoRing* ring, u64* user_data, i32* result) {
+    const u32 head = *ring -> cq_head;
+
+    if (head == __atomic_load_n(ring -> cq_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    const struct io_uring_cqe* cqe = &ring -> cqes[head & ring -> cq_mask];
+
+    *user_data = cqe -> user_data;
+    *result = cqe -> res;
+
+    __atomic_store_n(ring -> cq_head, head + 1, __ATOMIC_RELEASE);
+    ring -> in_flight--;
+
+    return true;
+}
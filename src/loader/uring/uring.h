@@ -0,0 +1,28 @@
+#pragma once
+#ifndef MYTHRIL_LOADER_URING_H
+#define MYTHRIL_LOADER_URING_H
+
+#include "types.h"
+
+/*
+*
+*   sets up a ring of entries submissions and checks that the kernel
+*   knows every opcode in ops. Returns -1 when it does not, when
+*   io_uring is missing or when it is not allowed, the caller does the
+*   same work some other way
+*
+*/
+i32 init_io_ring(IoRing* ring, u32 entries, const u8* ops, u32 op_count);
+
+void free_io_ring(IoRing* ring);
+
+// the next submission, zeroed, or nullptr while every entry is in use
+struct io_uring_sqe* io_ring_sqe(IoRing* ring);
+
+// hands the pending submissions to the kernel, waits for wait completions
+i32 io_ring_submit(IoRing* ring, u32 wait);
+
+// takes one completion off the ring, false when there is none
+b8 io_ring_reap(IoRing* ring, u64* user_data, i32* result);
+
+#endif // !MYTHRIL_LOADER_URING_H
@@ -0,0 +1,620 @@
+#include "lsp.h"
+#include "types.h"
+
+#include "../ast_visitor/visitor.h"
+#include "../incremental/incremental.h"
+#include "../writer/writer.h"
+
+#include <string.h>
+
+// the nearest declaration of a name before limit, filled in by the walk over a function
+typedef struct {
+    const char* name;
+    usize len;
+
+    const DeclSpan* span;
+    usize limit;
+
+    const AstNode* found;
+    const AstSlice* found_name;
+    usize found_offset;
+} LocalSearch;
+
+static const Token* token_at(const Document* doc, usize offset, usize* index);
+static b8 find_local(ArenaAllocator* arena, const DeclSpan* span, AstNode* decl, const Token* token, usize limit, LspDefinition* out);
+static b8 find_member(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out);
+static b8 find_variant(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out);
+static b8 find_top_level(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out);
+static const AstSlice* decl_name(const AstNode* decl);
+static void write_signature(Writer* w, const AstNode* node);
+static void write_type(Writer* w, const AstType* type);
+static void write_symbol(Writer* w, const LspServer* server, const LspDocument* d, const DeclSpan* span, const AstSlice* name, LspSymbolKind kind, usize start, usize end);
+static b8 same_name(const AstSlice* slice, const Token* token);
+
+void lsp_write_symbols(Writer* w, const LspServer* server, LspDocument* d) {
+    Document* doc = &d -> doc;
+    const Token* tokens = doc -> tokens.items;
+
+    writer_char(w, '[');
+
+    b8 first = true;
+
+    for (usize i = 0; i < doc -> span_count; i++) {
+        const DeclSpan* span = &doc -> spans[i];
+
+        if (span -> decl == DOCUMENT_NO_DECL) {
+            continue;
+        }
+
+        const AstNode* decl = doc -> program.declarations[span -> decl];
+        const AstSlice* name = decl_name(decl);
+
+        if (!name || name -> len == 0) {
+            continue;
+        }
+
+        const Token* last = &tokens[span -> token_end - 1];
+
+        const usize start = document_offset(span, tokens[span -> token_start].lexeme);
+        const usize end = document_offset(span, last -> lexeme) + last -> length;
+
+        LspSymbolKind kind = LSP_SYMBOL_VARIABLE;
+
+        switch (decl -> kind) {
+            case AST_STRUCT_DECL:   kind = LSP_SYMBOL_STRUCT; break;
+            case AST_UNION_DECL:    kind = LSP_SYMBOL_STRUCT; break;
+            case AST_ENUM_DECL:     kind = LSP_SYMBOL_ENUM; break;
+            case AST_IMPL_DECL:     kind = LSP_SYMBOL_OBJECT; break;
+            case AST_FUNCTION_DECL: kind = LSP_SYMBOL_FUNCTION; break;
+            case AST_CONST_DECL:    kind = LSP_SYMBOL_CONSTANT; break;
+            default: break;
+        }
+
+        if (!first) {
+            writer_char(w, ',');
+        }
+
+        first = false;
+
+        write_symbol(w, server, d, span, name, kind, start, end);
+
+        writer_str(w, ",\"children\":[");
+
+        // members only have their names to show for a range
+        b8 first_child = true;
+
+        #define CHILD(child_name, child_kind) do {                                  \
+            const AstSlice* child = (child_name);                                   \
+            if (child -> len == 0) break;                                           \
+            const usize child_start = document_offset(span, child -> ptr);          \
+            if (!first_child) writer_char(w, ',');                                  \
+            first_child = false;                                                    \
+            write_symbol(w, server, d, span, child, (child_kind), child_start, child_start + child -> len); \
+            writer_str(w, "}");                                                     \
+        } while (0)
+
+        if (decl -> kind == AST_STRUCT_DECL) {
+            for (usize j = 0; j < decl -> struct_decl.count; j++) {
+                CHILD(&decl -> struct_decl.fields[j] -> identifier, LSP_SYMBOL_FIELD);
+            }
+        } else if (decl -> kind == AST_UNION_DECL) {
+            for (usize j = 0; j < decl -> union_decl.count; j++) {
+                CHILD(&decl -> union_decl.variants[j] -> identifier, LSP_SYMBOL_FIELD);
+            }
+        } else if (decl -> kind == AST_ENUM_DECL) {
+            for (usize j = 0; j < decl -> enum_decl.count; j++) {
+                CHILD(&decl -> enum_decl.variants[j] -> identifier, LSP_SYMBOL_ENUM_MEMBER);
+            }
+        } else if (decl -> kind == AST_IMPL_DECL) {
+            for (usize j = 0; j < decl -> impl_decl.fn_count; j++) {
+                const AstNode* method = decl -> impl_decl.functions[j];
+
+                if (method && method -> kind == AST_FUNCTION_DECL) {
+                    CHILD(&method -> function_decl.identifier, LSP_SYMBOL_METHOD);
+                }
+            }
+        }
+
+        #undef CHILD
+
+        writer_str(w, "]}");
+    }
+
+    writer_char(w, ']');
+}
+
+b8 lsp_find_definition(ArenaAllocator* arena, LspDocument* d, usize offset, usize* name_start, usize* name_end, LspDefinition* out) {
+    Document* doc = &d -> doc;
+
+    usize index;
+    const Token* token = token_at(doc, offset, &index);
+
+    if (!token) {
+        return false;
+    }
+
+    *name_start = document_token_offset(doc, index);
+    *name_end = *name_start + token -> length;
+
+    const TokenKind before = index > 0 ? doc -> tokens.items[index - 1].kind : TOK_EOF;
+
+    if (before == TOK_DOT) {
+        return find_member(arena, doc, token, out);
+    }
+
+    if (before == TOK_COLON_COLON) {
+        return find_variant(arena, doc, token, out) || find_member(arena, doc, token, out);
+    }
+
+    DeclSpan* span = document_span_at(doc, *name_start);
+
+    if (span && find_local(arena, span, doc -> program.declarations[span -> decl], token, *name_start, out)) {
+        return true;
+    }
+
+    // variants are named without their enum too
+    return find_top_level(arena, doc, token, out) || find_variant(arena, doc, token, out);
+}
+
+// the identifier whose text holds offset, or ends right at it
+static const Token* token_at(const Document* doc, usize offset, usize* index) {
+    const Token* tokens = doc -> tokens.items;
+
+    usize lo = 0;
+    usize hi = doc -> tokens.count;
+
+    // first token starting after offset, TOK_EOP and its padding have no lexeme
+    while (lo < hi) {
+        const usize mid = lo + (hi - lo) / 2;
+        const Token* token = &tokens[mid];
+
+        if (token -> lexeme && document_token_offset(doc, mid) <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return nullptr;
+    }
+
+    const Token* token = &tokens[lo - 1];
+
+    // x| in f(x) is on the ')' but means x
+    if (token -> kind != TOK_IDENTIFIER && lo > 1 && document_token_offset(doc, lo - 1) == offset) {
+        lo--;
+        token = &tokens[lo - 1];
+    }
+
+    const usize start = document_token_offset(doc, lo - 1);
+
+    if (token -> kind != TOK_IDENTIFIER || offset > start + token -> length) {
+        return nullptr;
+    }
+
+    *index = lo - 1;
+
+    return token;
+}
+
+static void define(ArenaAllocator* arena, const DeclSpan* span, const AstSlice* name, const AstNode* node, LspDefinition* out) {
+    Writer w;
+    init_memory_writer(&w, arena, 256);
+
+    write_signature(&w, node);
+    writer_char(&w, 0);
+
+    out -> offset = document_offset(span, name -> ptr);
+    out -> len = name -> len;
+    out -> signature = w.buffer;
+}
+
+static VisitAction find_local_node(AstVisitor* v, VisitFrame* frame) {
+    LocalSearch* search = v -> user;
+    const AstNode* node = frame -> node;
+
+    const AstSlice* name = nullptr;
+
+    if (node -> kind == AST_VAR_DECL) {
+        name = &node -> var_decl.identifier;
+    } else if (node -> kind == AST_PATTERN_IDENT) {
+        name = &node -> pattern_ident.identifier;
+    } else if (node -> kind == AST_FOR_STMT && node -> for_stmt.init) {
+        // for x = 0; ... brings x in
+        const AstNode* init = node -> for_stmt.init;
+
+        if (init -> kind == AST_ASSIGNMENT && init -> assignment.lvalue && init -> assignment.lvalue -> kind == AST_IDENTIFIER) {
+            name = &init -> assignment.lvalue -> identifier.value;
+        } else if (init -> kind == AST_BINARY && init -> binary.op == TOK_EQUALS && init -> binary.left && init -> binary.left -> kind == AST_IDENTIFIER) {
+            name = &init -> binary.left -> identifier.value;
+        }
+    }
+
+    if (!name || name -> len != search -> len || memcmp(name -> ptr, search -> name, name -> len) != 0) {
+        return VISIT_CONTINUE;
+    }
+
+    const usize offset = document_offset(search -> span, name -> ptr);
+
+    // a later one shadows, one after the use is not there yet
+    if (offset <= search -> limit && (!search -> found || offset >= search -> found_offset)) {
+        search -> found = node;
+        search -> found_name = name;
+        search -> found_offset = offset;
+    }
+
+    return VISIT_CONTINUE;
+}
+
+/*
+*
+*   the function around the name, a method when decl is an impl, is
+*   searched for its parameters and for locals declared before the
+*   name. Blocks are not told apart, the nearest one before it wins
+*
+*/
+static b8 find_local(ArenaAllocator* arena, const DeclSpan* span, AstNode* decl, const Token* token, usize limit, LspDefinition* out) {
+    AstNode* function = nullptr;
+
+    if (decl -> kind == AST_FUNCTION_DECL) {
+        function = decl;
+    } else if (decl -> kind == AST_IMPL_DECL) {
+        // the last method that starts before the name
+        for (usize i = 0; i < decl -> impl_decl.fn_count; i++) {
+            AstNode* method = decl -> impl_decl.functions[i];
+
+            if (method && method -> kind == AST_FUNCTION_DECL && document_offset(span, method -> function_decl.identifier.ptr) <= limit) {
+                function = method;
+            }
+        }
+    }
+
+    if (!function) {
+        return false;
+    }
+
+    LocalSearch search = {
+        .name = token -> lexeme,
+        .len = token -> length,
+        .span = span,
+        .limit = limit,
+        .found = nullptr,
+        .found_name = nullptr,
+        .found_offset = 0
+    };
+
+    AstVisitor visitor;
+    init_visitor(&visitor, arena, &search);
+
+    visitor.pre[AST_VAR_DECL] = find_local_node;
+    visitor.pre[AST_PATTERN_IDENT] = find_local_node;
+    visitor.pre[AST_FOR_STMT] = find_local_node;
+
+    for (usize i = 0; i < function -> function_decl.stmt_count; i++) {
+        visit_node(&visitor, function -> function_decl.statements[i], 1);
+    }
+
+    if (search.found) {
+        define(arena, span, search.found_name, search.found, out);
+        return true;
+    }
+
+    for (usize i = 0; i < function -> function_decl.param_count; i++) {
+        const AstParameter* param = &function -> function_decl.parameters[i];
+
+        if (same_name(&param -> identifier, token)) {
+            Writer w;
+            init_memory_writer(&w, arena, 256);
+
+            writer_write(&w, param -> identifier.ptr, param -> identifier.len);
+
+            if (param -> type) {
+                writer_str(&w, ": ");
+                write_type(&w, param -> type);
+            }
+
+            writer_char(&w, 0);
+
+            out -> offset = document_offset(span, param -> identifier.ptr);
+            out -> len = param -> identifier.len;
+            out -> signature = w.buffer;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// fields and union variants of every type and the methods of every impl, types are not known yet
+static b8 find_member(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out) {
+    for (usize i = 0; i < doc -> span_count; i++) {
+        const DeclSpan* span = &doc -> spans[i];
+
+        if (span -> decl == DOCUMENT_NO_DECL) {
+            continue;
+        }
+
+        const AstNode* decl = doc -> program.declarations[span -> decl];
+
+        for (usize j = 0; decl -> kind == AST_STRUCT_DECL && j < decl -> struct_decl.count; j++) {
+            const AstStructField* field = decl -> struct_decl.fields[j];
+
+            if (same_name(&field -> identifier, token)) {
+                Writer w;
+                init_memory_writer(&w, arena, 256);
+
+                writer_write(&w, decl -> struct_decl.identifier.ptr, decl -> struct_decl.identifier.len);
+                writer_char(&w, '.');
+                writer_write(&w, field -> identifier.ptr, field -> identifier.len);
+                writer_str(&w, ": ");
+                write_type(&w, field -> type);
+                writer_char(&w, 0);
+
+                out -> offset = document_offset(span, field -> identifier.ptr);
+                out -> len = field -> identifier.len;
+                out -> signature = w.buffer;
+
+                return true;
+            }
+        }
+
+        for (usize j = 0; decl -> kind == AST_IMPL_DECL && j < decl -> impl_decl.fn_count; j++) {
+            const AstNode* method = decl -> impl_decl.functions[j];
+
+            if (method && method -> kind == AST_FUNCTION_DECL && same_name(&method -> function_decl.identifier, token)) {
+                define(arena, span, &method -> function_decl.identifier, method, out);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// the Variant of Enum::Variant and Union::Variant
+static b8 find_variant(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out) {
+    for (usize i = 0; i < doc -> span_count; i++) {
+        const DeclSpan* span = &doc -> spans[i];
+
+        if (span -> decl == DOCUMENT_NO_DECL) {
+            continue;
+        }
+
+        const AstNode* decl = doc -> program.declarations[span -> decl];
+
+        const AstSlice* owner = decl_name(decl);
+        const AstSlice* found = nullptr;
+
+        for (usize j = 0; decl -> kind == AST_ENUM_DECL && j < decl -> enum_decl.count && !found; j++) {
+            if (same_name(&decl -> enum_decl.variants[j] -> identifier, token)) {
+                found = &decl -> enum_decl.variants[j] -> identifier;
+            }
+        }
+
+        for (usize j = 0; decl -> kind == AST_UNION_DECL && j < decl -> union_decl.count && !found; j++) {
+            if (same_name(&decl -> union_decl.variants[j] -> identifier, token)) {
+                found = &decl -> union_decl.variants[j] -> identifier;
+            }
+        }
+
+        if (found) {
+            Writer w;
+            init_memory_writer(&w, arena, 256);
+
+            writer_write(&w, owner -> ptr, owner -> len);
+            writer_str(&w, "::");
+            writer_write(&w, found -> ptr, found -> len);
+            writer_char(&w, 0);
+
+            out -> offset = document_offset(span, found -> ptr);
+            out -> len = found -> len;
+            out -> signature = w.buffer;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static b8 find_top_level(ArenaAllocator* arena, Document* doc, const Token* token, LspDefinition* out) {
+    for (usize i = 0; i < doc -> span_count; i++) {
+        const DeclSpan* span = &doc -> spans[i];
+
+        if (span -> decl == DOCUMENT_NO_DECL) {
+            continue;
+        }
+
+        const AstNode* decl = doc -> program.declarations[span -> decl];
+        const AstSlice* name = decl_name(decl);
+
+        if (decl -> kind != AST_IMPL_DECL && name && same_name(name, token)) {
+            define(arena, span, name, decl, out);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// the name a declaration introduces, the target of an impl, nullptr for the rest
+static const AstSlice* decl_name(const AstNode* decl) {
+    switch (decl -> kind) {
+        case AST_STRUCT_DECL:   return &decl -> struct_decl.identifier;
+        case AST_UNION_DECL:    return &decl -> union_decl.identifier;
+        case AST_ENUM_DECL:     return &decl -> enum_decl.identifier;
+        case AST_IMPL_DECL:     return &decl -> impl_decl.target;
+        case AST_FUNCTION_DECL: return &decl -> function_decl.identifier;
+        case AST_STATIC_DECL:   return &decl -> static_decl.identifier;
+        case AST_CONST_DECL:    return &decl -> const_decl.identifier;
+        case AST_VAR_DECL:      return &decl -> var_decl.identifier;
+
+        default: return nullptr;
+    }
+}
+
+// the declaration the way it is written, without its body or value
+static void write_signature(Writer* w, const AstNode* node) {
+    switch (node -> kind) {
+        case AST_FUNCTION_DECL: {
+            const AstFunctionDecl* fn = &node -> function_decl;
+
+            writer_str(w, "fn ");
+            writer_write(w, fn -> identifier.ptr, fn -> identifier.len);
+            writer_char(w, '(');
+
+            for (usize i = 0; i < fn -> param_count; i++) {
+                if (i > 0) {
+                    writer_str(w, ", ");
+                }
+
+                writer_write(w, fn -> parameters[i].identifier.ptr, fn -> parameters[i].identifier.len);
+
+                if (fn -> parameters[i].type) {
+                    writer_str(w, ": ");
+                    write_type(w, fn -> parameters[i].type);
+                }
+            }
+
+            writer_char(w, ')');
+
+            if (fn -> return_type) {
+                writer_str(w, ": ");
+                write_type(w, fn -> return_type);
+            }
+        } break;
+
+        case AST_STRUCT_DECL: {
+            writer_str(w, "struct ");
+            writer_write(w, node -> struct_decl.identifier.ptr, node -> struct_decl.identifier.len);
+        } break;
+
+        case AST_UNION_DECL: {
+            writer_str(w, "union ");
+            writer_write(w, node -> union_decl.identifier.ptr, node -> union_decl.identifier.len);
+        } break;
+
+        case AST_ENUM_DECL: {
+            writer_str(w, "enum ");
+            writer_write(w, node -> enum_decl.identifier.ptr, node -> enum_decl.identifier.len);
+
+            if (node -> enum_decl.type.len > 0) {
+                writer_str(w, ": ");
+                writer_write(w, node -> enum_decl.type.ptr, node -> enum_decl.type.len);
+            }
+        } break;
+
+        case AST_STATIC_DECL: {
+            writer_str(w, "static ");
+            writer_write(w, node -> static_decl.identifier.ptr, node -> static_decl.identifier.len);
+
+            if (node -> static_decl.type) {
+                writer_str(w, ": ");
+                write_type(w, node -> static_decl.type);
+            }
+        } break;
+
+        case AST_CONST_DECL: {
+            writer_str(w, "const ");
+            writer_write(w, node -> const_decl.identifier.ptr, node -> const_decl.identifier.len);
+
+            if (node -> const_decl.type) {
+                writer_str(w, ": ");
+                write_type(w, node -> const_decl.type);
+            }
+        } break;
+
+        case AST_VAR_DECL: {
+            writer_str(w, node -> var_decl.is_mutable ? "let mut " : "let ");
+            writer_write(w, node -> var_decl.identifier.ptr, node -> var_decl.identifier.len);
+
+            if (node -> var_decl.type) {
+                writer_str(w, ": ");
+                write_type(w, node -> var_decl.type);
+            }
+        } break;
+
+        case AST_PATTERN_IDENT: {
+            writer_write(w, node -> pattern_ident.identifier.ptr, node -> pattern_ident.identifier.len);
+        } break;
+
+        case AST_FOR_STMT: {
+            const AstNode* init = node -> for_stmt.init;
+            const AstNode* target = init -> kind == AST_ASSIGNMENT ? init -> assignment.lvalue : init -> binary.left;
+
+            writer_str(w, "for ");
+            writer_write(w, target -> identifier.value.ptr, target -> identifier.value.len);
+        } break;
+
+        default: break;
+    }
+}
+
+static void write_type(Writer* w, const AstType* type) {
+    if (!type) {
+        return;
+    }
+
+    switch (type -> kind) {
+        case TYPE_BASIC: {
+            writer_str(w, type -> is_ref ? "&" : "");
+            writer_str(w, type -> is_mutable ? "mut " : "");
+            writer_write(w, type -> identifier.ptr, type -> identifier.len);
+        } break;
+
+        case TYPE_POINTER: {
+            write_type(w, type -> pointee);
+            writer_char(w, '*');
+        } break;
+
+        case TYPE_ARRAY: {
+            const AstNode* size = type -> array.size_expr;
+
+            write_type(w, type -> array.element_type);
+            writer_char(w, '[');
+
+            if (size && size -> kind == AST_LITERAL) {
+                writer_write(w, size -> literal.value.ptr, size -> literal.value.len);
+            } else if (size && size -> kind == AST_IDENTIFIER) {
+                writer_write(w, size -> identifier.value.ptr, size -> identifier.value.len);
+            } else if (size) {
+                writer_str(w, "...");
+            }
+
+            writer_char(w, ']');
+        } break;
+
+        case TYPE_ERR: break;
+    }
+}
+
+// an open DocumentSymbol, the caller adds children if it has any and closes it
+static void write_symbol(Writer* w, const LspServer* server, const LspDocument* d, const DeclSpan* span, const AstSlice* name, LspSymbolKind kind, usize start, usize end) {
+    const usize name_start = document_offset(span, name -> ptr);
+
+    writer_str(w, "{\"name\":");
+
+    if (kind == LSP_SYMBOL_OBJECT) {
+        // impl Target
+        writer_str(w, "\"impl ");
+        writer_write(w, name -> ptr, name -> len);
+        writer_char(w, '"');
+    } else {
+        writer_json_string(w, name -> ptr, name -> len);
+    }
+
+    writer_str(w, ",\"kind\":");
+    writer_u64(w, kind);
+
+    writer_str(w, ",\"range\":");
+    lsp_write_range(w, server, d, start, end);
+
+    writer_str(w, ",\"selectionRange\":");
+    lsp_write_range(w, server, d, name_start, name_start + name -> len);
+}
+
+static b8 same_name(const AstSlice* slice, const Token* token) {
+    return slice -> len == token -> length && memcmp(slice -> ptr, token -> lexeme, slice -> len) == 0;
+}
@@ -0,0 +1,871 @@
+#include "lsp.h"
+#include "types.h"
+
+#include "../diagnostics/diagnostics.h"
+#include "../incremental/incremental.h"
+#include "../json/json.h"
+#include "../writer/writer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define LSP_HEADER_MAX 4096
+
+static i32 read_message(LspServer* server, usize* header_len, usize* body_len);
+static b8 handle_message(LspServer* server, const char* body, usize len);
+static void dispatch(LspServer* server, const JsonValue* id, const char* method, usize method_len, const JsonValue* params);
+static void send_body(LspServer* server, const Writer* body);
+static void begin_response(Writer* w, const JsonValue* id);
+static void send_result(LspServer* server, const JsonValue* id, const Writer* result);
+static void send_error(LspServer* server, const JsonValue* id, i32 code, const char* message);
+static void handle_initialize(LspServer* server, const JsonValue* id, const JsonValue* params);
+static void handle_open(LspServer* server, const JsonValue* params);
+static void handle_change(LspServer* server, const JsonValue* params);
+static void handle_close(LspServer* server, const JsonValue* params);
+static void handle_symbols(LspServer* server, const JsonValue* id, const JsonValue* params);
+static void handle_hover(LspServer* server, const JsonValue* id, const JsonValue* params);
+static void handle_definition(LspServer* server, const JsonValue* id, const JsonValue* params);
+static LspDocument* find_document(LspServer* server, const JsonValue* params, u32* index);
+static void open_document(LspDocument* d, const char* text, usize len);
+static void compact_document(LspDocument* d);
+static void free_document(LspDocument* d);
+static void build_lines(LspDocument* d);
+static void update_lines(LspDocument* d, usize offset, usize removed, const char* text, usize inserted);
+static usize offset_at(const LspServer* server, const LspDocument* d, const JsonValue* position);
+static void write_position(Writer* w, const LspServer* server, const LspDocument* d, usize offset);
+static void publish_diagnostics(LspServer* server, LspDocument* d);
+static void write_utf8(Writer* w, const char* str);
+static b8 method_is(const char* method, usize len, const char* name);
+
+i32 run_lsp(i32 in_fd, i32 out_fd) {
+    LspServer server = {
+        .in_fd = in_fd,
+        .out_fd = out_fd,
+        .input = malloc(LSP_READ_CHUNK),
+        .input_len = 0,
+        .input_capacity = LSP_READ_CHUNK,
+        .documents = nullptr,
+        .document_count = 0,
+        .document_capacity = 0,
+        .utf8 = false,
+        .initialized = false,
+        .shutdown = false
+    };
+
+    init_arena(&server.arena, 65536);
+    init_arena(&server.scratch, 65536);
+
+    init_writer(&server.out, &server.arena, out_fd, 0);
+
+    i32 exit_code = 1;
+
+    while (true) {
+        usize header_len;
+        usize body_len;
+
+        const i32 got = read_message(&server, &header_len, &body_len);
+
+        if (got <= 0) {
+            exit_code = got == 0 && server.shutdown ? 0 : 1;
+            break;
+        }
+
+        const b8 done = handle_message(&server, server.input + header_len, body_len);
+
+        const usize consumed = header_len + body_len;
+
+        memmove(server.input, server.input + consumed, server.input_len - consumed);
+        server.input_len -= consumed;
+
+        arena_reset(&server.scratch);
+
+        if (done) {
+            exit_code = server.shutdown ? 0 : 1;
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < server.document_count; i++) {
+        free_document(server.documents[i]);
+    }
+
+    free(server.input);
+
+    arena_free(&server.scratch);
+    arena_free(&server.arena);
+
+    return exit_code;
+}
+
+void lsp_write_range(Writer* w, const LspServer* server, const LspDocument* d, usize start, usize end) {
+    writer_str(w, "{\"start\":");
+    write_position(w, server, d, start);
+    writer_str(w, ",\"end\":");
+    write_position(w, server, d, end);
+    writer_char(w, '}');
+}
+
+/*
+*
+*   reads until input holds a whole message, its headers are the first
+*   header_len bytes and its body the body_len after them. Returns 1
+*   for a message, 0 at the end of the input and -1 on an error
+*
+*/
+static i32 read_message(LspServer* server, usize* header_len, usize* body_len) {
+    while (true) {
+        const char* input = server -> input;
+        const usize len = server -> input_len;
+
+        usize end = 0;
+
+        while (end + 4 <= len && memcmp(input + end, "\r\n\r\n", 4) != 0) {
+            end++;
+        }
+
+        if (end + 4 <= len) {
+            usize content_length = 0;
+            b8 found = false;
+
+            for (usize line = 0; line < end; ) {
+                usize line_end = line;
+
+                while (line_end < end && input[line_end] != '\r') {
+                    line_end++;
+                }
+
+                if (line_end - line > sizeof("Content-Length:") - 1 && strncasecmp(input + line, "Content-Length:", sizeof("Content-Length:") - 1) == 0) {
+                    content_length = strtoull(input + line + sizeof("Content-Length:") - 1, nullptr, 10);
+                    found = true;
+                }
+
+                line = line_end + 2;
+            }
+
+            if (!found || content_length > LSP_MAX_MESSAGE) {
+                fprintf(stderr, "Error: message without a valid Content-Length\n");
+                return -1;
+            }
+
+            *header_len = end + 4;
+            *body_len = content_length;
+
+            if (len >= *header_len + content_length) {
+                return 1;
+            }
+
+            if (server -> input_capacity < *header_len + content_length) {
+                server -> input_capacity = *header_len + content_length;
+                server -> input = realloc(server -> input, server -> input_capacity);
+            }
+        } else if (len > LSP_HEADER_MAX) {
+            fprintf(stderr, "Error: message header too long\n");
+            return -1;
+        }
+
+        if (server -> input_capacity - server -> input_len < LSP_READ_CHUNK / 4) {
+            server -> input_capacity += LSP_READ_CHUNK;
+            server -> input = realloc(server -> input, server -> input_capacity);
+        }
+
+        const ssize got = read(server -> in_fd, server -> input + server -> input_len, server -> input_capacity - server -> input_len);
+
+        if (got == 0) {
+            return 0;
+        }
+
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, "Error: Failed to read a message: %s\n", strerror(errno));
+            return -1;
+        }
+
+        server -> input_len += (usize) got;
+    }
+}
+
+// returns true once the client said exit
+static b8 handle_message(LspServer* server, const char* body, usize len) {
+    const JsonValue* message = json_parse(&server -> scratch, body, len);
+
+    if (!message || message -> kind != JSON_OBJECT) {
+        send_error(server, nullptr, LSP_PARSE_ERROR, "message is not a JSON object");
+        return false;
+    }
+
+    const JsonValue* id = json_get(message, "id");
+
+    usize method_len;
+    const char* method = json_string(json_get(message, "method"), &method_len);
+
+    if (!method) {
+        // a response to a request this server never sends
+        if (id && !json_get(message, "result") && !json_get(message, "error")) {
+            send_error(server, id, LSP_INVALID_REQUEST, "message has no method");
+        }
+
+        return false;
+    }
+
+    if (method_is(method, method_len, "exit")) {
+        return true;
+    }
+
+    dispatch(server, id, method, method_len, json_get(message, "params"));
+
+    return false;
+}
+
+static void dispatch(LspServer* server, const JsonValue* id, const char* method, usize method_len, const JsonValue* params) {
+    if (method_is(method, method_len, "initialize")) {
+        handle_initialize(server, id, params);
+        return;
+    }
+
+    if (!server -> initialized || server -> shutdown) {
+        if (id) {
+            send_error(
+                server, id,
+                server -> shutdown ? LSP_INVALID_REQUEST : LSP_NOT_INITIALIZED,
+                server -> shutdown ? "server is shutting down" : "server is not initialized"
+            );
+        }
+
+        return;
+    }
+
+    if (method_is(method, method_len, "shutdown")) {
+        server -> shutdown = true;
+
+        Writer result;
+        init_memory_writer(&result, &server -> scratch, 16);
+        writer_str(&result, "null");
+
+        send_result(server, id, &result);
+    } else if (method_is(method, method_len, "textDocument/didOpen")) {
+        handle_open(server, params);
+    } else if (method_is(method, method_len, "textDocument/didChange")) {
+        handle_change(server, params);
+    } else if (method_is(method, method_len, "textDocument/didClose")) {
+        handle_close(server, params);
+    } else if (method_is(method, method_len, "textDocument/documentSymbol")) {
+        handle_symbols(server, id, params);
+    } else if (method_is(method, method_len, "textDocument/hover")) {
+        handle_hover(server, id, params);
+    } else if (method_is(method, method_len, "textDocument/definition")) {
+        handle_definition(server, id, params);
+    } else if (id) {
+        // notifications the server does not know are dropped, "initialized" among them
+        send_error(server, id, LSP_METHOD_NOT_FOUND, "method not supported");
+    }
+}
+
+// the headers and body of one message to the client
+static void send_body(LspServer* server, const Writer* body) {
+    writer_str(&server -> out, "Content-Length: ");
+    writer_u64(&server -> out, body -> len);
+    writer_str(&server -> out, "\r\n\r\n");
+    writer_write(&server -> out, body -> buffer, body -> len);
+    writer_flush(&server -> out);
+}
+
+static void begin_response(Writer* w, const JsonValue* id) {
+    writer_str(w, "{\"jsonrpc\":\"2.0\",\"id\":");
+
+    if (id && id -> kind == JSON_STRING) {
+        writer_json_string(w, id -> string.ptr, id -> string.len);
+    } else if (id && id -> kind == JSON_NUMBER) {
+        writer_i64(w, (i64) id -> number);
+    } else {
+        writer_str(w, "null");
+    }
+}
+
+static void send_result(LspServer* server, const JsonValue* id, const Writer* result) {
+    Writer w;
+    init_memory_writer(&w, &server -> scratch, result -> len + 64);
+
+    begin_response(&w, id);
+    writer_str(&w, ",\"result\":");
+    writer_write(&w, result -> buffer, result -> len);
+    writer_char(&w, '}');
+
+    send_body(server, &w);
+}
+
+static void send_error(LspServer* server, const JsonValue* id, i32 code, const char* message) {
+    Writer w;
+    init_memory_writer(&w, &server -> scratch, 256);
+
+    begin_response(&w, id);
+    writer_str(&w, ",\"error\":{\"code\":");
+    writer_i64(&w, code);
+    writer_str(&w, ",\"message\":");
+    writer_json_string(&w, message, strlen(message));
+    writer_str(&w, "}}");
+
+    send_body(server, &w);
+}
+
+/*
+*
+*   positions are counted in bytes if the client offers utf-8, which
+*   spares walking the line on every conversion, UTF-16 otherwise
+*
+*/
+static void handle_initialize(LspServer* server, const JsonValue* id, const JsonValue* params) {
+    if (server -> initialized) {
+        send_error(server, id, LSP_INVALID_REQUEST, "server is already initialized");
+        return;
+    }
+
+    const JsonValue* encodings = json_get(json_get(json_get(params, "capabilities"), "general"), "positionEncodings");
+
+    for (usize i = 0; encodings && encodings -> kind == JSON_ARRAY && i < encodings -> array.count; i++) {
+        usize len;
+        const char* encoding = json_string(encodings -> array.items[i], &len);
+
+        if (encoding && len == sizeof("utf-8") - 1 && memcmp(encoding, "utf-8", len) == 0) {
+            server -> utf8 = true;
+        }
+    }
+
+    server -> initialized = true;
+
+    Writer result;
+    init_memory_writer(&result, &server -> scratch, 512);
+
+    writer_str(&result, "{\"capabilities\":{\"positionEncoding\":");
+    writer_str(&result, server -> utf8 ? "\"utf-8\"" : "\"utf-16\"");
+    writer_str(&result, ",\"textDocumentSync\":{\"openClose\":true,\"change\":2}");
+    writer_str(&result, ",\"documentSymbolProvider\":true,\"hoverProvider\":true,\"definitionProvider\":true}");
+    writer_str(&result, ",\"serverInfo\":{\"name\":\"mythril\"}}");
+
+    send_result(server, id, &result);
+}
+
+static void handle_open(LspServer* server, const JsonValue* params) {
+    const JsonValue* item = json_get(params, "textDocument");
+
+    usize uri_len;
+    const char* uri = json_string(json_get(item, "uri"), &uri_len);
+
+    usize text_len;
+    const char* text = json_string(json_get(item, "text"), &text_len);
+
+    if (!uri || !text || text_len >= LSP_MAX_MESSAGE) {
+        return;
+    }
+
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    if (d) {
+        // opened again without a close, the new text wins
+        open_document(d, text, text_len);
+        publish_diagnostics(server, d);
+        return;
+    }
+
+    if (server -> document_count == server -> document_capacity) {
+        const u32 capacity = server -> document_capacity ? server -> document_capacity * 2 : LSP_DOCUMENTS_INIT_CAPACITY;
+
+        server -> documents = server -> documents
+            ? arena_realloc(&server -> arena, server -> documents, server -> document_capacity * sizeof(LspDocument*), capacity * sizeof(LspDocument*))
+            : arena_array(&server -> arena, LspDocument*, capacity);
+
+        server -> document_capacity = capacity;
+    }
+
+    d = malloc(sizeof(LspDocument));
+
+    d -> uri = malloc(uri_len + 1);
+    memcpy(d -> uri, uri, uri_len);
+    d -> uri[uri_len] = 0;
+    d -> uri_len = uri_len;
+
+    d -> arena = nullptr;
+    d -> parsed_usage = 0;
+    d -> lines = nullptr;
+    d -> line_count = 0;
+    d -> line_capacity = 0;
+
+    open_document(d, text, text_len);
+
+    server -> documents[server -> document_count++] = d;
+
+    publish_diagnostics(server, d);
+}
+
+/*
+*
+*   applies the changes in order, each one against the text the one
+*   before left. A change with a range goes through document_edit and
+*   moves only the lines after it, one without a range is a new text
+*
+*/
+static void handle_change(LspServer* server, const JsonValue* params) {
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    const JsonValue* changes = json_get(params, "contentChanges");
+
+    if (!d || !changes || changes -> kind != JSON_ARRAY) {
+        return;
+    }
+
+    for (usize i = 0; i < changes -> array.count; i++) {
+        const JsonValue* change = changes -> array.items[i];
+        const JsonValue* range = json_get(change, "range");
+
+        usize text_len;
+        const char* text = json_string(json_get(change, "text"), &text_len);
+
+        if (!text) {
+            continue;
+        }
+
+        if (!range) {
+            open_document(d, text, text_len);
+            continue;
+        }
+
+        const usize start = offset_at(server, d, json_get(range, "start"));
+        const usize end = offset_at(server, d, json_get(range, "end"));
+
+        if (end < start || d -> doc.len - 1 - (end - start) + text_len >= LSP_MAX_MESSAGE) {
+            continue;
+        }
+
+        if (document_edit(&d -> doc, start, end - start, text, text_len) == REPARSE_INVALID) {
+            // the client and the server disagree about the text, nothing to do but wait for the next open
+            fprintf(stderr, "Error: edit at %zu does not fit %s\n", start, d -> uri);
+            continue;
+        }
+
+        update_lines(d, start, end - start, text, text_len);
+    }
+
+    if (total_usage(d -> arena) - d -> parsed_usage > LSP_COMPACT_FACTOR * d -> parsed_usage + LSP_COMPACT_MINIMUM) {
+        compact_document(d);
+    }
+
+    publish_diagnostics(server, d);
+}
+
+static void handle_close(LspServer* server, const JsonValue* params) {
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    if (!d) {
+        return;
+    }
+
+    free_document(d);
+
+    server -> documents[index] = server -> documents[--server -> document_count];
+
+    // the client forgets the diagnostics of a closed document only when told to
+    Writer w;
+    init_memory_writer(&w, &server -> scratch, 256);
+
+    usize uri_len;
+    const char* uri = json_string(json_get(json_get(params, "textDocument"), "uri"), &uri_len);
+
+    writer_str(&w, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    writer_json_string(&w, uri, uri_len);
+    writer_str(&w, ",\"diagnostics\":[]}}");
+
+    send_body(server, &w);
+}
+
+static void handle_symbols(LspServer* server, const JsonValue* id, const JsonValue* params) {
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    Writer result;
+    init_memory_writer(&result, &server -> scratch, 4096);
+
+    if (d) {
+        lsp_write_symbols(&result, server, d);
+    } else {
+        writer_str(&result, "null");
+    }
+
+    send_result(server, id, &result);
+}
+
+static void handle_hover(LspServer* server, const JsonValue* id, const JsonValue* params) {
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    Writer result;
+    init_memory_writer(&result, &server -> scratch, 512);
+
+    usize name_start;
+    usize name_end;
+    LspDefinition definition;
+
+    if (d && lsp_find_definition(&server -> scratch, d, offset_at(server, d, json_get(params, "position")), &name_start, &name_end, &definition)) {
+        const usize len = strlen(definition.signature);
+
+        // a fenced block so the client highlights it
+        Writer value;
+        init_memory_writer(&value, &server -> scratch, len + 32);
+
+        writer_str(&value, "```mythril\n");
+        writer_write(&value, definition.signature, len);
+        writer_str(&value, "\n```");
+
+        writer_str(&result, "{\"contents\":{\"kind\":\"markdown\",\"value\":");
+        writer_json_string(&result, value.buffer, value.len);
+        writer_str(&result, "},\"range\":");
+        lsp_write_range(&result, server, d, name_start, name_end);
+        writer_char(&result, '}');
+    } else {
+        writer_str(&result, "null");
+    }
+
+    send_result(server, id, &result);
+}
+
+static void handle_definition(LspServer* server, const JsonValue* id, const JsonValue* params) {
+    u32 index;
+    LspDocument* d = find_document(server, params, &index);
+
+    Writer result;
+    init_memory_writer(&result, &server -> scratch, 512);
+
+    usize name_start;
+    usize name_end;
+    LspDefinition definition;
+
+    if (d && lsp_find_definition(&server -> scratch, d, offset_at(server, d, json_get(params, "position")), &name_start, &name_end, &definition)) {
+        writer_str(&result, "{\"uri\":");
+        writer_json_string(&result, d -> uri, d -> uri_len);
+        writer_str(&result, ",\"range\":");
+        lsp_write_range(&result, server, d, definition.offset, definition.offset + definition.len);
+        writer_char(&result, '}');
+    } else {
+        writer_str(&result, "null");
+    }
+
+    send_result(server, id, &result);
+}
+
+// the open document params.textDocument.uri names, nullptr if it is not open
+static LspDocument* find_document(LspServer* server, const JsonValue* params, u32* index) {
+    usize len;
+    const char* uri = json_string(json_get(json_get(params, "textDocument"), "uri"), &len);
+
+    for (u32 i = 0; uri && i < server -> document_count; i++) {
+        LspDocument* d = server -> documents[i];
+
+        if (d -> uri_len == len && memcmp(d -> uri, uri, len) == 0) {
+            *index = i;
+            return d;
+        }
+    }
+
+    return nullptr;
+}
+
+// parses text on a fresh arena, whatever d held before is let go
+static void open_document(LspDocument* d, const char* text, usize len) {
+    ArenaAllocator* old = d -> arena;
+
+    d -> arena = malloc(sizeof(ArenaAllocator));
+    init_arena(d -> arena, 65536);
+
+    init_document(&d -> doc, d -> arena, d -> uri, text, len);
+    d -> parsed_usage = total_usage(d -> arena);
+
+    build_lines(d);
+
+    if (old) {
+        arena_free(old);
+        free(old);
+    }
+}
+
+/*
+*
+*   the text as it is now parsed again on a new arena, dropping the
+*   copies every edit left behind. The lines stay as they are
+*
+*/
+static void compact_document(LspDocument* d) {
+    ArenaAllocator* old = d -> arena;
+
+    d -> arena = malloc(sizeof(ArenaAllocator));
+    init_arena(d -> arena, 65536);
+
+    init_document(&d -> doc, d -> arena, d -> uri, d -> doc.source, d -> doc.len - 1);
+    d -> parsed_usage = total_usage(d -> arena);
+
+    arena_free(old);
+    free(old);
+}
+
+static void free_document(LspDocument* d) {
+    arena_free(d -> arena);
+    free(d -> arena);
+    free(d -> lines);
+    free(d -> uri);
+    free(d);
+}
+
+static void reserve_lines(LspDocument* d, usize count) {
+    if (count <= d -> line_capacity) {
+        return;
+    }
+
+    usize capacity = d -> line_capacity ? d -> line_capacity : LSP_LINES_INIT_CAPACITY;
+
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    d -> lines = realloc(d -> lines, capacity * sizeof(u32));
+    d -> line_capacity = capacity;
+}
+
+static void build_lines(LspDocument* d) {
+    const char* source = d -> doc.source;
+    const usize len = d -> doc.len - 1;
+
+    d -> line_count = 0;
+
+    reserve_lines(d, 1);
+    d -> lines[d -> line_count++] = 0;
+
+    for (const char* c = memchr(source, '\n', len); c; c = memchr(c + 1, '\n', len - (usize) (c + 1 - source))) {
+        reserve_lines(d, d -> line_count + 1);
+        d -> lines[d -> line_count++] = (u32) (c + 1 - source);
+    }
+}
+
+// the first line that starts after offset
+static usize line_after(const LspDocument* d, usize offset) {
+    usize lo = 0;
+    usize hi = d -> line_count;
+
+    while (lo < hi) {
+        const usize mid = lo + (hi - lo) / 2;
+
+        if (d -> lines[mid] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+*
+*   the lines that started inside the removed bytes go, the newlines of
+*   the inserted text come in and the lines after move by the difference
+*
+*/
+static void update_lines(LspDocument* d, usize offset, usize removed, const char* text, usize inserted) {
+    const usize first = line_after(d, offset);
+    const usize last = line_after(d, offset + removed);
+
+    usize added = 0;
+
+    for (usize i = 0; i < inserted; i++) {
+        added += text[i] == '\n';
+    }
+
+    const usize tail = d -> line_count - last;
+
+    reserve_lines(d, first + added + tail);
+
+    memmove(d -> lines + first + added, d -> lines + last, tail * sizeof(u32));
+
+    for (usize i = first + added; i < first + added + tail; i++) {
+        d -> lines[i] = (u32) (d -> lines[i] + inserted - removed);
+    }
+
+    usize line = first;
+
+    for (usize i = 0; i < inserted; i++) {
+        if (text[i] == '\n') {
+            d -> lines[line++] = (u32) (offset + i + 1);
+        }
+    }
+
+    d -> line_count = first + added + tail;
+}
+
+// bytes a character takes by its first byte, a stray continuation byte counts alone
+static u32 utf8_length(u8 lead) {
+    if (lead >= 0xf0) return 4;
+    if (lead >= 0xe0) return 3;
+    if (lead >= 0xc0) return 2;
+
+    return 1;
+}
+
+// a Position as a byte offset, clamped to its line and to the text
+static usize offset_at(const LspServer* server, const LspDocument* d, const JsonValue* position) {
+    const usize len = d -> doc.len - 1;
+
+    const f64 line_number = json_number(json_get(position, "line"), 0);
+    const f64 character = json_number(json_get(position, "character"), 0);
+
+    if (line_number < 0 || line_number >= (f64) d -> line_count) {
+        return line_number < 0 ? 0 : len;
+    }
+
+    const usize line = (usize) line_number;
+    const usize start = d -> lines[line];
+
+    // the newline closing the line is not part of it
+    const usize end = line + 1 < d -> line_count ? d -> lines[line + 1] - 1 : len;
+    const usize wanted = character > 0 ? (usize) character : 0;
+
+    if (server -> utf8) {
+        return start + (wanted < end - start ? wanted : end - start);
+    }
+
+    usize offset = start;
+    usize units = 0;
+
+    while (offset < end && units < wanted) {
+        const u32 bytes = utf8_length((u8) d -> doc.source[offset]);
+
+        // outside the basic plane it takes a surrogate pair
+        units += bytes == 4 ? 2 : 1;
+        offset = offset + bytes < end ? offset + bytes : end;
+    }
+
+    return offset;
+}
+
+static void write_position(Writer* w, const LspServer* server, const LspDocument* d, usize offset) {
+    const usize line = line_after(d, offset) - 1;
+    const usize start = d -> lines[line];
+
+    usize character = offset - start;
+
+    if (!server -> utf8) {
+        character = 0;
+
+        for (usize i = start; i < offset; ) {
+            const u32 bytes = utf8_length((u8) d -> doc.source[i]);
+
+            character += bytes == 4 ? 2 : 1;
+            i += bytes;
+        }
+    }
+
+    writer_str(w, "{\"line\":");
+    writer_u64(w, line);
+    writer_str(w, ",\"character\":");
+    writer_u64(w, character);
+    writer_char(w, '}');
+}
+
+/*
+*
+*   every diagnostic of the document, the whole set each time as the
+*   protocol wants. A diagnostic whose pointer is not in the current
+*   text is put at its start
+*
+*/
+static void publish_diagnostics(LspServer* server, LspDocument* d) {
+    const DiagContext* ctx = &d -> doc.diag_ctx;
+    const char* source = d -> doc.source;
+    const usize len = d -> doc.len - 1;
+
+    Writer w;
+    init_memory_writer(&w, &server -> scratch, 4096);
+
+    writer_str(&w, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    writer_json_string(&w, d -> uri, d -> uri_len);
+    writer_str(&w, ",\"diagnostics\":[");
+
+    for (u32 i = 0; i < ctx -> count; i++) {
+        const Diagnostic* diag = &ctx -> items[i];
+
+        usize start = 0;
+
+        if (diag -> pointer >= source && diag -> pointer <= source + len) {
+            start = (usize) (diag -> pointer - source);
+        }
+
+        const usize end = start + diag -> length < len ? start + diag -> length : len;
+
+        if (i > 0) {
+            writer_char(&w, ',');
+        }
+
+        writer_str(&w, "{\"range\":");
+        lsp_write_range(&w, server, d, start, end);
+
+        writer_str(&w, ",\"severity\":");
+        writer_u64(&w, diag -> level == DIAGNOSTIC_ERROR ? 1 : diag -> level == DIAGNOSTIC_WARN ? 2 : 3);
+
+        const char* message = diagnostic_message(&server -> scratch, diag);
+
+        Writer text;
+        init_memory_writer(&text, &server -> scratch, 256);
+
+        write_utf8(&text, message);
+
+        if (diag -> help) {
+            writer_str(&text, "\nhelp: ");
+            write_utf8(&text, diag -> help);
+        }
+
+        writer_str(&w, ",\"source\":\"mythril\",\"message\":");
+        writer_json_string(&w, text.buffer, text.len);
+        writer_char(&w, '}');
+    }
+
+    writer_str(&w, "]}}");
+
+    send_body(server, &w);
+}
+
+/*
+*
+*   str with every byte that starts no whole UTF-8 character replaced
+*   by U+FFFD, a message quoting a token can cut a character in half
+*   and the protocol only carries valid UTF-8
+*
+*/
+static void write_utf8(Writer* w, const char* str) {
+    const u8* c = (const u8*) str;
+
+    while (*c) {
+        const u32 bytes = utf8_length(*c);
+        b8 valid = *c < 0x80 || (*c >= 0xc2 && *c <= 0xf4);
+
+        for (u32 i = 1; i < bytes && valid; i++) {
+            valid = (c[i] & 0xc0) == 0x80;
+        }
+
+        if (valid) {
+            writer_write(w, (const char*) c, bytes);
+            c += bytes;
+        } else {
+            writer_str(w, "\xef\xbf\xbd");
+            c++;
+        }
+    }
+}
+
+static b8 method_is(const char* method, usize len, const char* name) {
+    return len == strlen(name) && memcmp(method, name, len) == 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef MYTHRIL_LSP_H
+#define MYTHRIL_LSP_H
+
+#include "types.h"
+
+#include "../writer/types.h"
+
+/*
+*
+*   a language server on in_fd and out_fd until the client says exit.
+*   Open documents are kept as incremental Documents, an edit inside a
+*   declaration lexes and parses only that declaration again. Every
+*   change publishes the diagnostics of the document, symbols, hovers
+*   and definitions are answered from its tree. Returns the exit code,
+*   0 if the client asked for a shutdown first
+*
+*/
+i32 run_lsp(i32 in_fd, i32 out_fd);
+
+/*
+*
+*   the text between the byte offsets start and end of d as a Range,
+*   positions counted the way the client was told
+*
+*/
+void lsp_write_range(Writer* w, const LspServer* server, const LspDocument* d, usize start, usize end);
+
+// the top level declarations of d as a DocumentSymbol array, members as their children
+void lsp_write_symbols(Writer* w, const LspServer* server, LspDocument* d);
+
+/*
+*
+*   where the name at offset was declared: a local or parameter of the
+*   function it is in, the nearest one before it, then a member after
+*   '.', a variant or method after '::' and otherwise a top level
+*   declaration or a variant. Returns false if offset is on no name
+*   or nothing declares it
+*
+*/
+b8 lsp_find_definition(ArenaAllocator* arena, LspDocument* d, usize offset, usize* name_start, usize* name_end, LspDefinition* out);
+
+#endif // !MYTHRIL_LSP_H
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef MYTHRIL_LSP_TYPES_H
+#define MYTHRIL_LSP_TYPES_H
+
+#include "../arena/arena.h"
+#include "../incremental/types.h"
+#include "../utils/types.h"
+#include "../writer/types.h"
+
+// a message body larger than this is refused, the framing is lost then
+#define LSP_MAX_MESSAGE         (64 * 1024 * 1024)
+
+#define LSP_READ_CHUNK          (64 * 1024)
+#define LSP_DOCUMENTS_INIT_CAPACITY 16
+#define LSP_LINES_INIT_CAPACITY 256
+
+/*
+*
+*   every edit leaves a copy of the text on the arena of a document.
+*   Once what edits added takes up this many times what the last full
+*   parse used, plus the minimum, the document is parsed afresh on a
+*   new arena and the old one let go. A full parse then comes once in
+*   that many edits' worth of memory and costs each edit a fraction
+*
+*/
+#define LSP_COMPACT_FACTOR      2
+#define LSP_COMPACT_MINIMUM     (1024 * 1024)
+
+// JSON-RPC error codes
+#define LSP_PARSE_ERROR         -32700
+#define LSP_INVALID_REQUEST     -32600
+#define LSP_METHOD_NOT_FOUND    -32601
+#define LSP_INVALID_PARAMS      -32602
+#define LSP_NOT_INITIALIZED     -32002
+
+// the SymbolKind numbers of the protocol
+typedef enum {
+    LSP_SYMBOL_MODULE       = 2,
+    LSP_SYMBOL_METHOD       = 6,
+    LSP_SYMBOL_FIELD        = 8,
+    LSP_SYMBOL_ENUM         = 10,
+    LSP_SYMBOL_FUNCTION     = 12,
+    LSP_SYMBOL_VARIABLE     = 13,
+    LSP_SYMBOL_CONSTANT     = 14,
+    LSP_SYMBOL_OBJECT       = 19,
+    LSP_SYMBOL_ENUM_MEMBER  = 22,
+    LSP_SYMBOL_STRUCT       = 23
+} LspSymbolKind;
+
+/*
+*
+*   an open document. Its text, tokens and tree are those of the
+*   incremental Document, lines the byte offset every line starts at,
+*   kept up to date edit by edit
+*
+*/
+typedef struct {
+    char* uri;
+    usize uri_len;
+
+    ArenaAllocator* arena;
+    Document doc;
+
+    // total_usage() of arena right after the last full parse
+    usize parsed_usage;
+
+    u32* lines;
+    usize line_count;
+    usize line_capacity;
+} LspDocument;
+
+/*
+*
+*   the server between messages. scratch holds one message, its parse
+*   and its replies and is reset after each
+*
+*/
+typedef struct {
+    i32 in_fd;
+    i32 out_fd;
+
+    ArenaAllocator arena;
+    ArenaAllocator scratch;
+
+    Writer out;
+
+    // what came in and has not been handled yet
+    char* input;
+    usize input_len;
+    usize input_capacity;
+
+    LspDocument** documents;
+    u32 document_count;
+    u32 document_capacity;
+
+    // positions count bytes when the client can take that, UTF-16 code units otherwise
+    b8 utf8;
+    b8 initialized;
+    b8 shutdown;
+    u8 _padding[5];
+} LspServer;
+
+/*
+*
+*   where a name at a position was declared, offset and len of the
+*   declaring name in the current text, signature the text of a hover
+*
+*/
+typedef struct {
+    usize offset;
+    usize len;
+
+    const char* signature;
+} LspDefinition;
+
+#endif // !MYTHRIL_LSP_TYPES_H
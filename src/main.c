@@ -1,58 +1,57 @@
-#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 #include "arena/arena.h"
 #include "ast/ast.h"
 #include "ast/types.h"
+#include "ast_visitor/visitor.h"
+#include "cache/cache.h"
 #include "diagnostics/diagnostics.h"
-#include "files/types.h"
-#include "lexer/lexer.h"
+#include "diagnostics/stream/stream.h"
+#include "files/files.h"
 #include "mythril/types.h"
+#include "loader/loader.h"
+#include "lsp/lsp.h"
+#include "options/options.h"
+#include "serialize/serialize.h"
+#include "server/server.h"
+#include "timing/timing.h"
+#include "trace/trace.h"
 #include "tokens/tokens.h"
+#include "unit/unit.h"
 #include "utils/types.h"
+#include "watch/watch.h"
+#include "writer/writer.h"
 
 static ArenaAllocator arena = {0};
 
-i32 map_file(FileBuffer* file_buffer, char* path) {
-    i32 fd = open(path, O_RDONLY);
-    if (fd == -1) {
-        fprintf(stderr, "Error: Failed to open file '%s'\n", path);
-        fprintf(stderr, "compilation failed\n");
-        return -1;
-    }
-
-    struct stat st;
-    if (fstat(fd, &st) == -1) {
-        close(fd);
-        fprintf(stderr, "Error: Failed to stat file '%s'\n", path);
-        fprintf(stderr, "compilation failed\n");
-        return -1;
-    }
+static b8 stays_local(i32 argc, char** argv);
+static i32 serve(MythrilOptions* options);
+static i32 serve_request(i32 argc, char** argv, void* user);
+static i32 compile(MythrilOptions* options, WarmState* warm);
+static i32 show_cache_stats(MythrilOptions* options);
 
-    usize len = st.st_size + 1;
+static char* ast_cache_path(const char* path) {
+    const usize len = strlen(path) + sizeof(AST_CACHE_EXTENSION);
 
-    char* buffer = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // the arena does not align, a whole number of words keeps what follows on 8 bytes
+    char* cache_path = arena_alloc(&arena, (len + 7) & ~(usize) 7);
+    snprintf(cache_path, len, "%s%s", path, AST_CACHE_EXTENSION);
 
-    if (buffer == MAP_FAILED || !buffer) {
-        close(fd);
-        fprintf(stderr, "Error: Failed to mmap() file '%s'\n", path);
-        fprintf(stderr, "compilation failed\n");
-        return -1;
-    }
+    return cache_path;
+}
 
-    buffer[len - 1] = 0;
+static VisitAction count_node(AstVisitor* v, VisitFrame* frame) {
+    (void) frame;
 
-    file_buffer -> ptr = buffer;
-    file_buffer -> len = len;
-    file_buffer -> needs_free = true;
+    (*(usize*) v -> user)++;
 
-    return 0;
+    return VISIT_CONTINUE;
 }
 
 i32 main(i32 argc, char* argv[]) {
@@ -65,101 +64,547 @@ i32 main(i32 argc, char* argv[]) {
 
     #endif /* ifdef MYTHRIL_DEBUG */
 
-    if (argc == 1) {
-        fprintf(stderr, "Usage: %s <files>\n", argv[0]);
-        return 1;
+    // a client hands the whole run to a server when one is up
+    const char* server = getenv(SERVER_ENV);
+
+    if (server && !stays_local(argc, argv)) {
+        char socket_path[PATH_MAX];
+        i32 exit_code;
+
+        if (server_socket_path(socket_path, sizeof(socket_path), server) == 0 && forward_to_server(socket_path, argc, argv, &exit_code) == 0) {
+            return exit_code;
+        }
     }
 
     init_arena(&arena, 65536);
 
+    MythrilOptions options;
+
+    if (parse_options(&options, &arena, argc, argv) == -1) {
+        return 1;
+    }
+
+    if (options.server) {
+        return serve(&options);
+    }
+
+    if (options.watch) {
+        return run_watch(&options) == -1 ? 1 : 0;
+    }
+
+    if (options.lsp) {
+        return run_lsp(STDIN_FILENO, STDOUT_FILENO);
+    }
+
+    return compile(&options, nullptr);
+}
+
+// a server itself and a run that never ends are not handed over
+static b8 stays_local(i32 argc, char** argv) {
+    for (i32 i = 1; i < argc; i++) {
+        if (
+            strcmp(argv[i], "--server") == 0                                    ||
+            strncmp(argv[i], "--server=", sizeof("--server=") - 1) == 0         ||
+            strcmp(argv[i], "--watch") == 0                                     ||
+            strcmp(argv[i], "--lsp") == 0
+        ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static i32 serve(MythrilOptions* options) {
+    char socket_path[PATH_MAX];
+
+    if (server_socket_path(socket_path, sizeof(socket_path), options -> server_socket) == -1) {
+        return 1;
+    }
+
+    WarmState warm;
+    init_warm_state(&warm, SERVER_MEMO_LIMIT);
+
+    const i32 result = run_server(socket_path, serve_request, &warm);
+
+    free_warm_state(&warm);
+
+    return result == -1 ? 1 : 0;
+}
+
+// one run on behalf of a client, in the arena the last one left behind
+static i32 serve_request(i32 argc, char** argv, void* user) {
+    WarmState* warm = user;
+
+    arena_reset(&arena);
+
+    MythrilOptions options;
+
+    if (parse_options(&options, &arena, argc, argv) == -1) {
+        return 1;
+    }
+
+    if (options.server) {
+        fprintf(stderr, "Error: --server cannot be passed on to a server\n");
+        return 1;
+    }
+
+    if (options.watch) {
+        fprintf(stderr, "Error: --watch cannot be passed on to a server\n");
+        return 1;
+    }
+
+    if (options.lsp) {
+        fprintf(stderr, "Error: --lsp cannot be passed on to a server\n");
+        return 1;
+    }
+
+    const i32 exit_code = compile(&options, warm);
+
+    memo_trim(&warm -> memo);
+
+    return exit_code;
+}
+
+/*
+*
+*   everything a run does once the options are in. warm is nullptr for a
+*   run of its own, a server passes what it keeps between requests
+*
+*/
+static i32 compile(MythrilOptions* options, WarmState* warm) {
+    if (options -> file_count == 0) {
+        return show_cache_stats(options);
+    }
+
+    // @files, directories and patterns turned into the files they name
+    PathList inputs;
+
+    if (expand_inputs(&inputs, &arena, options -> file_paths, options -> file_count) == -1) {
+        fprintf(stderr, "compilation failed\n");
+        return 1;
+    }
+
+    if (inputs.count == 0) {
+        fprintf(stderr, "Error: No source files to compile\n");
+        return 1;
+    }
+
+    options -> file_paths = inputs.items;
+    options -> file_count = inputs.count;
+
     i32 exit_code = 0;
 
-    char** file_paths = argv + 1;
-    u32 file_count = argc - 1;
+    TimeReport report;
+    init_time_report(&report, options -> time_report);
 
-    FileBuffer buffers[file_count];
-    memset(buffers, 0, sizeof(buffers));
+    // every span nullptr when not tracing, no clock is read then
+    Trace trace_events;
+    Trace* trace = nullptr;
+
+    if (options -> trace_path) {
+        init_trace(&trace_events, &arena, (usize) options -> file_count * TRACE_EVENTS_PER_FILE + TRACE_EVENTS_BASE);
+        trace = &trace_events;
+    }
+
+    // the cache holds ASTs, a run that stops after lexing needs the tokens
+    const b8 use_cache = options -> ast_cache && options -> stop_after >= STOP_AFTER_PARSE;
+
+    // what a server remembers, a thawed unit has neither tokens to emit nor bodies left out
+    const b8 use_memo = warm && options -> stop_after >= STOP_AFTER_PARSE && !(options -> emit & EMIT_TOKENS) && !options -> outline;
+
+    // sema and codegen have no pass yet, stopping after them is stopping after the parse
+    const b8 run_parser = options -> stop_after >= STOP_AFTER_PARSE;
+
+    // before the store is open, nothing to close on the way out
+    char** file_paths = options -> file_paths;
+    u32 file_count = options -> file_count;
+
+    if (file_count > UNIT_MAX_COUNT) {
+        fprintf(stderr, "Error: Too many files, at most %u can be compiled at once\n", UNIT_MAX_COUNT);
+        return 1;
+    }
+
+    // a thawed function always has its body, an outline is made fresh every time
+    Cache store;
+    const b8 use_store = options -> cache_dir && !options -> outline;
+
+    if (use_store && open_cache(&store, options -> cache_dir, (usize) options -> cache_limit * 1024 * 1024) == -1) {
+        return 1;
+    }
+
+    // what a hit has to hold for this run
+    const u32 store_parts = CACHE_HAS_TOKENS | (run_parser ? CACHE_HAS_AST : 0);
+
+    u32 jobs = options -> jobs;
+
+    if (jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (u32) cpus : 1;
+    }
+
+    // thousands of files are no rarity, none of this goes on the stack
+    FileBuffer* buffers = arena_array_zero(&arena, FileBuffer, file_count);
+
+    // one per file that was read, in file order
+    CompilationUnit* units = arena_array(&arena, CompilationUnit, file_count);
+    u32 unit_count = 0;
 
     DiagContext diag_ctx = {
         .arena = &arena,
-        .index = 0,
+        .units = units,
+        .stream = nullptr,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
         .warning_count = 0,
         .error_count = 0,
-        .stderr_supports_colours = false
+        .max_errors = options -> syntax_only ? 1 : options -> max_errors,
+        .display_limit = options -> diagnostics_limit,
+        .unit_count = 0,
+        .streamed = 0,
+        .hold = 0,
+        .stderr_supports_colours = false,
+        .aborted = false
     };
 
     if (isatty(STDERR_FILENO)) {
         diag_ctx.stderr_supports_colours = true;
     }
 
-    Tokens tokens = {
-        .items = arena_alloc(&arena, sizeof(Token) * 64),
-        .capacity = 128,
-        .count = 0
-    };
+    DiagStream diag_stream;
 
-    Program program = {
-        .declarations = nullptr, // Allocate in parse() initial capacity of tokens.count
-        .capacity = 0,
-        .count = 0
-    };
+    if (options -> diagnostics_format != DIAG_FORMAT_TEXT) {
+        init_diag_stream(&diag_stream, &arena, STDERR_FILENO, options -> diagnostics_format);
+        diag_ctx.stream = &diag_stream;
+    }
 
-    MythrilContext mythril_ctx = {
-        .arena = &arena,
-        .diag_ctx = &diag_ctx,
-        .tokens = &tokens,
-        .program = &program,
-    };
+    // units whose AST came out of the cache are neither lexed nor parsed
+    AstCacheView* cache_views = arena_array_zero(&arena, AstCacheView, file_count);
+    char** cache_paths = arena_array(&arena, char*, file_count);
 
-    for (u32 i = 0; i < file_count; i++) {
-        i32 ok = map_file(&buffers[i], file_paths[i]);
+    // the SHA-256 of every source keys the side-car caches, the memo and the store alike
+    CacheKey* cache_keys = arena_array(&arena, CacheKey, file_count);
+
+    // units found in the store are neither lexed nor parsed either, their entries stay mapped to the end
+    CacheEntry* cache_entries = arena_array_zero(&arena, CacheEntry, file_count);
+
+    // the arena does not align, an even count keeps everything after it on 8 bytes
+    u32* lex_diagnostics = arena_array(&arena, u32, (file_count + 1) & ~1u);
+
+    CompilationUnit** parse_units = arena_array(&arena, CompilationUnit*, file_count);
+    u32 parse_count = 0;
+
+    // every file is opened up front, the reads keep going while the lexer works
+    phase_begin(&report, PHASE_LOAD);
+    const u64 open_start = trace_start(trace);
+
+    Loader loader;
+    const i32 loaded = init_loader(&loader, &arena, file_paths, buffers, file_count, jobs);
+
+    trace_span(trace, "open", nullptr, 0, open_start);
+    phase_end(&report, PHASE_LOAD);
 
-        if (ok == -1) {
+    if (loaded == -1) {
+        fprintf(stderr, "compilation failed\n");
+        exit_code = 1;
+        goto cleanup;
+    }
+
+    // a spent error budget leaves the remaining files unread
+    for (u32 i = 0; i < file_count && !diag_ctx.aborted; i++) {
+        phase_begin(&report, PHASE_LOAD);
+        const u64 load_start = trace_start(trace);
+
+        if (loader_take(&loader, i) == -1) {
+            phase_end(&report, PHASE_LOAD);
+            fprintf(stderr, "compilation failed\n");
             exit_code = 1;
             goto cleanup;
         }
 
-        diag_ctx.path = file_paths[i];
-        diag_ctx.source_buffer = buffers[i].ptr;
+        CompilationUnit* unit = &units[unit_count];
+
+        ArenaAllocator warm_arena;
+        const b8 reuse = warm && take_warm_arena(warm, &warm_arena);
+
+        init_unit(unit, unit_count, file_paths[i], buffers[i], reuse ? &warm_arena : nullptr);
+        diag_ctx.unit_count = ++unit_count;
+
+        b8 cached = false;
+
+        if (use_cache || use_memo || use_store) {
+            // the NUL after the text is not part of the source
+            cache_keys[i] = cache_key(buffers[i].ptr, buffers[i].len - 1, PARSE_NONE);
+        }
+
+        if (use_memo) {
+            const MemoEntry* entry = memo_find(&warm -> memo, cache_keys[i].bytes, buffers[i].len - 1);
+
+            cached = entry && open_ast_cache(&cache_views[i], entry -> data, entry -> size, cache_keys[i].bytes, buffers[i].len - 1) == 0;
+        }
+
+        if (use_store && !cached) {
+            if (cache_lookup(&store, &cache_keys[i], buffers[i].len - 1, store_parts, &cache_entries[i]) == 0) {
+                cached = !run_parser || cache_open_ast(&cache_entries[i], &cache_views[i]) == 0;
+
+                if (!cached) {
+                    unload_cache_entry(&cache_entries[i]);
+                }
+            }
+
+            if (cached) {
+                cache_replay_diagnostics(&cache_entries[i], &diag_ctx, (u16) unit -> id, buffers[i].ptr, !run_parser);
+
+                if (options -> emit & EMIT_TOKENS) {
+                    cache_replay_tokens(&cache_entries[i], &unit -> tokens, &unit -> arena, buffers[i].ptr);
+                }
+            }
+        }
+
+        if (use_cache) {
+            cache_paths[i] = ast_cache_path(file_paths[i]);
+
+            if (!cached) {
+                cached = load_ast_cache(&cache_views[i], cache_paths[i], cache_keys[i].bytes, buffers[i].len - 1) == 0;
+            }
+        }
+
+        phase_end(&report, PHASE_LOAD);
+        trace_span(trace, "load", file_paths[i], 0, load_start);
+        phase_account(&report, PHASE_LOAD, buffers[i].len - 1, 0, total_usage(&unit -> arena));
+
+        if (cached) {
+            continue;
+        }
+
+        parse_units[parse_count++] = unit;
+
+        const usize lex_usage = total_usage(&unit -> arena);
+
+        phase_begin(&report, PHASE_LEX);
+        const u64 lex_start = trace_start(trace);
+
+        const u32 diagnostics_before = diag_ctx.count;
+
+        lex_unit(unit, &diag_ctx);
+
+        lex_diagnostics[i] = diag_ctx.count - diagnostics_before;
+
+        trace_span(trace, "tokenize", file_paths[i], 0, lex_start);
+        phase_end(&report, PHASE_LEX);
+
+        phase_account(&report, PHASE_LEX, buffers[i].len - 1, unit -> tokens.count, total_usage(&unit -> arena) - lex_usage);
+    }
+
+    if (run_parser) {
+        phase_begin(&report, PHASE_PARSE);
+        const u64 parse_start = trace_start(trace);
+
+        const usize parse_usage = parse_parallel(
+            parse_units,
+            parse_count,
+            &diag_ctx,
+            options -> outline ? PARSE_LAZY_BODIES : PARSE_NONE,
+            jobs,
+            trace
+        );
+
+        trace_span(trace, "parse", nullptr, 0, parse_start);
+        phase_end(&report, PHASE_PARSE);
+
+        if (report.enabled) {
+            usize bytes = 0;
+            usize nodes = 0;
+
+            // counted after the clock stopped, the walk is not part of the parse
+            AstVisitor visitor;
+            init_visitor(&visitor, &arena, &nodes);
+            visitor_on_all(&visitor, count_node, nullptr);
+
+            for (u32 i = 0; i < parse_count; i++) {
+                bytes += parse_units[i] -> buffer.len - 1;
+                visit_program(&visitor, &parse_units[i] -> program);
+            }
+
+            phase_account(&report, PHASE_PARSE, bytes, nodes, parse_usage);
+        }
+    }
+
+    // only a clean and complete parse is worth keeping
+    const b8 keep_asts = (use_cache || use_memo) && run_parser && diag_ctx.error_count == 0 && !options -> outline && !options -> syntax_only;
+
+    // the store keeps errors too, they are replayed, but not a run cut short
+    const b8 keep_units = use_store && !diag_ctx.aborted && !options -> syntax_only;
+
+    if (keep_asts || keep_units) {
+        for (u32 i = 0; i < unit_count; i++) {
+            if (cache_views[i].base || cache_entries[i].base) {
+                continue;
+            }
+
+            const u64 cache_start = trace_start(trace);
+
+            AstCacheBlob blob;
+
+            if (run_parser) {
+                serialize_declarations(
+                    &blob,
+                    &arena,
+                    units[i].program.declarations,
+                    units[i].program.count,
+                    cache_keys[i].bytes,
+                    buffers[i].len - 1
+                );
+            }
+
+            if (keep_asts && use_cache && write_ast_cache(&blob, cache_paths[i]) == -1) {
+                fprintf(stderr, "Error: Failed to write AST cache '%s': %s\n", cache_paths[i], strerror(errno));
+            }
+
+            if (keep_asts && use_memo) {
+                memo_store(&warm -> memo, &blob, cache_keys[i].bytes, buffers[i].len - 1);
+            }
+
+            if (keep_units) {
+                cache_store(
+                    &store,
+                    &arena,
+                    &cache_keys[i],
+                    buffers[i].ptr,
+                    buffers[i].len - 1,
+                    &units[i].tokens,
+                    run_parser ? &blob : nullptr,
+                    &diag_ctx,
+                    (u16) units[i].id,
+                    lex_diagnostics[i]
+                );
+            }
+
+            trace_span(trace, "cache write", file_paths[i], 0, cache_start);
+        }
+    }
+
+    // every unit in file order, cached ones thawed in place
+    usize total = 0;
+
+    for (u32 i = 0; i < unit_count; i++) {
+        if (cache_views[i].base) {
+            const u64 thaw_start = trace_start(trace);
 
-        mythril_ctx.buffer_start = buffers[i].ptr;
-        mythril_ctx.buffer_end = buffers[i].ptr + buffers[i].len;
+            Program* cached = &units[i].program;
 
-        tokenize(&mythril_ctx);
+            cached -> count = ast_cache_decl_count(&cache_views[i]);
+            cached -> capacity = cached -> count;
+            cached -> declarations = arena_array(&units[i].arena, AstNode*, cached -> count > 0 ? cached -> count : 1);
+
+            thaw_declarations(&cache_views[i], &units[i].arena, cached -> declarations);
+
+            trace_span(trace, "cache thaw", file_paths[i], 0, thaw_start);
+        }
+
+        total += units[i].program.count;
     }
 
-    Token end_of_program_token = {
-        .kind = TOK_EOP,
-        .lexeme = nullptr,
-        .length = 0
+    Program program = {
+        .declarations = arena_array(&arena, AstNode*, total > 0 ? total : 1),
+        .capacity = total > 0 ? total : 1,
+        .count = 0
     };
 
-    mythril_ctx.tokens -> items[mythril_ctx.tokens -> count++] = end_of_program_token;
+    for (u32 i = 0; i < unit_count; i++) {
+        memcpy(program.declarations + program.count, units[i].program.declarations, units[i].program.count * sizeof(AstNode*));
+        program.count += units[i].program.count;
+    }
 
-    parse(&mythril_ctx, file_paths, buffers, file_count);
+    if (options -> emit != EMIT_NONE) {
+        phase_begin(&report, PHASE_EMIT);
+        const u64 emit_start = trace_start(trace);
 
-    #ifdef MYTHRIL_DEBUG
-        print_tokens(tokens);
-        print_program(&program);
-    #endif /* ifdef MYTHRIL_DEBUG */
+        Writer writer;
+        init_writer(&writer, &arena, STDOUT_FILENO, 0);
+
+        if (options -> emit & EMIT_TOKENS) {
+            // a unit thawed from an AST has no tokens, one out of the store has them back
+            for (u32 i = 0; i < unit_count; i++) {
+                print_tokens(&writer, &units[i].tokens);
+            }
+        }
+
+        if (options -> emit & EMIT_AST) {
+            print_program(&writer, &arena, &program);
+        }
+
+        writer_flush(&writer);
+
+        trace_span(trace, "emit", nullptr, 0, emit_start);
+        phase_end(&report, PHASE_EMIT);
+    }
 
     printf("\n");
 
     if (diag_ctx.error_count == 0) {
         // codegen()
         exit_code = 0;
-        printf("compiled successfully\n");
+        printf("%s\n", stop_after_message(options -> stop_after));
     } else {
-        diagnostics_print_all(&diag_ctx);
+        const u64 render_start = trace_start(trace);
+
+        // streamed diagnostics are out already
+        if (!diag_ctx.stream) {
+            diagnostics_print_all(&diag_ctx);
+        }
+
         exit_code = 1;
+
+        trace_span(trace, "diagnostics", nullptr, 0, render_start);
     }
 
+    print_time_report(&report);
+
 cleanup:
-    for (u32 i = 0; i < file_count; i++) {
-        if (buffers[i].needs_free) {
-            munmap(buffers[i].ptr, buffers[i].len);
+    finish_loader(&loader);
+
+    if (diag_ctx.stream) {
+        diagnostics_flush_stream(&diag_ctx);
+        finish_diag_stream(diag_ctx.stream);
+    }
+
+    // a failed run is worth a trace too
+    if (trace && write_trace(trace, &arena, options -> trace_path) == -1) {
+        exit_code = 1;
+    }
+
+    for (u32 i = 0; i < unit_count; i++) {
+        if (warm) {
+            keep_warm_arena(warm, &units[i].arena);
+        } else {
+            free_unit(&units[i]);
         }
     }
 
+    for (u32 i = 0; i < file_count; i++) {
+        unload_ast_cache(&cache_views[i]);
+        unload_cache_entry(&cache_entries[i]);
+        unload_file(&buffers[i]);
+    }
+
+    if (use_store) {
+        close_cache(&store, options -> cache_stats);
+    }
+
     return exit_code;
 }
+
+// --cache-stats without files
+static i32 show_cache_stats(MythrilOptions* options) {
+    Cache store;
+
+    if (open_cache(&store, options -> cache_dir, (usize) options -> cache_limit * 1024 * 1024) == -1) {
+        return 1;
+    }
+
+    close_cache(&store, true);
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include "options.h"
+#include "types.h"
+
+#include "../cache/types.h"
+#include "../diagnostics/stream/types.h"
+#include "../diagnostics/types.h"
+#include "../server/types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define option_match(opt, arg) (strcmp((opt), (arg)) == 0)
+#define option_prefix(opt, arg) (strncmp((opt), (arg), sizeof((opt)) - 1) == 0)
+
+static i32 parse_count(const char* option, const char* value, u32* out) {
+    char* end = nullptr;
+
+    const unsigned long count = strtoul(value, &end, 10);
+
+    if (*value == 0 || *end != 0 || count > UINT32_MAX) {
+        fprintf(stderr, "Error: invalid value '%s' for %s\n", value, option);
+        return -1;
+    }
+
+    *out = (u32) count;
+
+    return 0;
+}
+
+static i32 parse_emit(MythrilOptions* options, const char* list) {
+    const char* cursor = list;
+
+    while (*cursor) {
+        const char* end = strchr(cursor, ',');
+        usize len = end ? (usize) (end - cursor) : strlen(cursor);
+
+        if (len == 6 && strncmp(cursor, "tokens", 6) == 0) {
+            options -> emit |= EMIT_TOKENS;
+        } else if (len == 3 && strncmp(cursor, "ast", 3) == 0) {
+            options -> emit |= EMIT_AST;
+        } else {
+            fprintf(stderr, "Error: unknown emit kind '%.*s', expected 'tokens' or 'ast'\n", (i32) len, cursor);
+            return -1;
+        }
+
+        cursor += len;
+
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+
+    return 0;
+}
+
+static i32 parse_stop_after(MythrilOptions* options, const char* phase) {
+    static const char* PHASES[] = { "lex", "parse", "sema", "codegen" };
+
+    for (u32 i = 0; i < sizeof(PHASES) / sizeof(PHASES[0]); i++) {
+        if (strcmp(phase, PHASES[i]) == 0) {
+            options -> stop_after = (u8) i;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "Error: unknown phase '%s', expected 'lex', 'parse', 'sema' or 'codegen'\n", phase);
+
+    return -1;
+}
+
+static i32 parse_diagnostics_format(MythrilOptions* options, const char* format) {
+    if (strcmp(format, "text") == 0) {
+        options -> diagnostics_format = DIAG_FORMAT_TEXT;
+    } else if (strcmp(format, "json") == 0) {
+        options -> diagnostics_format = DIAG_FORMAT_JSON;
+    } else if (strcmp(format, "sarif") == 0) {
+        options -> diagnostics_format = DIAG_FORMAT_SARIF;
+    } else {
+        fprintf(stderr, "Error: unknown diagnostics format '%s', expected 'text', 'json' or 'sarif'\n", format);
+        return -1;
+    }
+
+    return 0;
+}
+
+i32 parse_options(MythrilOptions* options, ArenaAllocator* arena, i32 argc, char** argv) {
+    options -> file_paths = arena_array(arena, char*, argc);
+    options -> file_count = 0;
+    options -> emit = EMIT_NONE;
+    options -> outline = false;
+    options -> ast_cache = false;
+    options -> jobs = 1;
+    options -> max_errors = 0;
+    options -> diagnostics_limit = DIAGNOSTICS_DEFAULT_LIMIT;
+    options -> diagnostics_format = DIAG_FORMAT_TEXT;
+    options -> syntax_only = false;
+    options -> stop_after = STOP_AFTER_CODEGEN;
+    options -> time_report = false;
+    options -> trace_path = nullptr;
+    options -> server = false;
+    options -> server_socket = nullptr;
+    options -> cache_dir = nullptr;
+    options -> cache_limit = CACHE_DEFAULT_LIMIT / (1024 * 1024);
+    options -> cache_stats = false;
+    options -> watch = false;
+    options -> lsp = false;
+
+    for (i32 i = 1; i < argc; i++) {
+        char* arg = argv[i];
+
+        if (arg[0] != '-' || arg[1] == 0) {
+            options -> file_paths[options -> file_count++] = arg;
+            continue;
+        }
+
+        if (option_prefix("--emit=", arg)) {
+            if (parse_emit(options, arg + sizeof("--emit=") - 1) == -1) {
+                return -1;
+            }
+        } else if (option_match("--outline", arg)) {
+            options -> outline = true;
+        } else if (option_match("--ast-cache", arg)) {
+            options -> ast_cache = true;
+        } else if (option_prefix("--ast-cache=", arg)) {
+            options -> cache_dir = arg + sizeof("--ast-cache=") - 1;
+
+            if (*options -> cache_dir == 0) {
+                fprintf(stderr, "Error: --ast-cache= needs a directory\n");
+                return -1;
+            }
+        } else if (option_prefix("--cache-dir=", arg)) {
+            options -> cache_dir = arg + sizeof("--cache-dir=") - 1;
+
+            if (*options -> cache_dir == 0) {
+                fprintf(stderr, "Error: --cache-dir needs a directory\n");
+                return -1;
+            }
+        } else if (option_prefix("--cache-limit=", arg)) {
+            if (parse_count("--cache-limit", arg + sizeof("--cache-limit=") - 1, &options -> cache_limit) == -1) {
+                return -1;
+            }
+        } else if (option_match("--cache-stats", arg)) {
+            options -> cache_stats = true;
+        } else if (option_prefix("--jobs=", arg)) {
+            if (parse_count("--jobs", arg + sizeof("--jobs=") - 1, &options -> jobs) == -1) {
+                return -1;
+            }
+        } else if (option_prefix("--max-errors=", arg)) {
+            if (parse_count("--max-errors", arg + sizeof("--max-errors=") - 1, &options -> max_errors) == -1) {
+                return -1;
+            }
+        } else if (option_prefix("--diagnostics-limit=", arg)) {
+            if (parse_count("--diagnostics-limit", arg + sizeof("--diagnostics-limit=") - 1, &options -> diagnostics_limit) == -1) {
+                return -1;
+            }
+        } else if (option_prefix("--diagnostics-format=", arg)) {
+            if (parse_diagnostics_format(options, arg + sizeof("--diagnostics-format=") - 1) == -1) {
+                return -1;
+            }
+        } else if (option_match("-fsyntax-only", arg)) {
+            options -> syntax_only = true;
+        } else if (option_prefix("--stop-after=", arg)) {
+            if (parse_stop_after(options, arg + sizeof("--stop-after=") - 1) == -1) {
+                return -1;
+            }
+        } else if (option_match("-ftime-report", arg)) {
+            options -> time_report = true;
+        } else if (option_prefix("--trace=", arg)) {
+            options -> trace_path = arg + sizeof("--trace=") - 1;
+
+            if (*options -> trace_path == 0) {
+                fprintf(stderr, "Error: --trace needs a file name\n");
+                return -1;
+            }
+        } else if (option_match("--server", arg)) {
+            options -> server = true;
+        } else if (option_prefix("--server=", arg)) {
+            options -> server = true;
+            options -> server_socket = arg + sizeof("--server=") - 1;
+        } else if (option_match("--watch", arg)) {
+            options -> watch = true;
+        } else if (option_match("--lsp", arg)) {
+            options -> lsp = true;
+        } else if (option_match("--help", arg) || option_match("-h", arg)) {
+            print_usage(argv[0]);
+            return -1;
+        } else {
+            fprintf(stderr, "Error: unknown option '%s'\n", arg);
+            return -1;
+        }
+    }
+
+    if (options -> server && options -> file_count > 0) {
+        fprintf(stderr, "Error: --server takes its files from clients, not the command line\n");
+        return -1;
+    }
+
+    if (options -> watch && (options -> server || options -> emit != EMIT_NONE || options -> trace_path || options -> cache_dir)) {
+        fprintf(stderr, "Error: --watch only reports diagnostics, it cannot be combined with --server, --emit, --trace or --cache-dir\n");
+        return -1;
+    }
+
+    if (options -> watch && options -> file_count == 0) {
+        fprintf(stderr, "Error: --watch needs the files or directories to watch\n");
+        return -1;
+    }
+
+    if (options -> lsp && (options -> file_count > 0 || options -> server || options -> watch)) {
+        fprintf(stderr, "Error: --lsp takes its documents from the client, it cannot be combined with files, --server or --watch\n");
+        return -1;
+    }
+
+    if (options -> cache_stats && !options -> cache_dir) {
+        fprintf(stderr, "Error: --cache-stats needs a cache, see --cache-dir\n");
+        return -1;
+    }
+
+    // --cache-stats on its own only shows the stats
+    if (options -> file_count == 0 && !options -> server && !options -> cache_stats && !options -> lsp) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if ((options -> emit & EMIT_AST) && options -> stop_after == STOP_AFTER_LEX) {
+        fprintf(stderr, "Error: --emit=ast needs the parser, it cannot be combined with --stop-after=lex\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+const char* stop_after_message(u8 stop_after) {
+    // sema has no pass yet, stopping after it is stopping after the parse
+    static const char* MESSAGES[] = {
+        "lexed successfully",
+        "parsed successfully",
+        "parsed successfully",
+        "compiled successfully"
+    };
+
+    return MESSAGES[stop_after];
+}
+
+void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] <files>\n\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -                    read a source file from stdin\n");
+    fprintf(stderr, "  @FILE                read more arguments from FILE, one per line\n");
+    fprintf(stderr, "  DIR, 'PATTERN'       compile every .myth file below DIR or matching PATTERN\n");
+    fprintf(stderr, "  --emit=tokens,ast    dump the token stream and/or the AST to stdout\n");
+    fprintf(stderr, "  --outline            parse declarations only, function bodies are skipped\n");
+    fprintf(stderr, "  --ast-cache          reuse parsed ASTs of unchanged files, stored next to the source\n");
+    fprintf(stderr, "  --ast-cache=DIR      the same as --cache-dir=DIR\n");
+    fprintf(stderr, "  --cache-dir=DIR      reuse tokens, ASTs and diagnostics of any source seen before, kept in DIR\n");
+    fprintf(stderr, "  --cache-limit=MIB    evict the least recently used entries past MIB MiB (default 512)\n");
+    fprintf(stderr, "  --cache-stats        print hits, misses and size of the cache\n");
+    fprintf(stderr, "  --jobs=N             parse with N threads, 0 uses every cpu (default 1)\n");
+    fprintf(stderr, "  --max-errors=N       stop lexing and parsing after N errors, 0 is unlimited (default)\n");
+    fprintf(stderr, "  --diagnostics-limit=N  show the first N diagnostics, 0 shows all (default 32)\n");
+    fprintf(stderr, "  --diagnostics-format=text|json|sarif\n");
+    fprintf(stderr, "                       json and sarif go to stderr as soon as they are reported\n");
+    fprintf(stderr, "  -fsyntax-only        check syntax only, stop at the first error\n");
+    fprintf(stderr, "  --stop-after=PHASE   stop after lex, parse, sema or codegen (default)\n");
+    fprintf(stderr, "  -ftime-report        print time, throughput and arena bytes of every phase\n");
+    fprintf(stderr, "  --trace=FILE         write Chrome trace events of every phase to FILE\n");
+    fprintf(stderr, "  --watch              compile again whenever a source is saved, directories take in new files\n");
+    fprintf(stderr, "  --lsp                serve the language server protocol on stdin and stdout\n");
+    fprintf(stderr, "  --server[=SOCKET]    stay resident and compile for clients connecting to SOCKET\n");
+    fprintf(stderr, "                       a run with " SERVER_ENV " set hands its arguments to that server\n");
+}
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef MYTHRIL_OPTIONS_H
+#define MYTHRIL_OPTIONS_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+
+/*
+*
+*   fills options from argv, unknown or malformed options are
+*   reported on stderr. Returns -1 on error, 0 otherwise
+*
+*/
+i32 parse_options(MythrilOptions* options, ArenaAllocator* arena, i32 argc, char** argv);
+
+/*
+*
+*   the line printed after a clean build, names the last phase that
+*   actually ran so --stop-after=lex does not claim a compile
+*
+*/
+const char* stop_after_message(u8 stop_after);
+
+/*
+*
+*   prints the usage line and the list of options
+*
+*/
+void print_usage(const char* program);
+
+#endif // !MYTHRIL_OPTIONS_H
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef MYTHRIL_OPTIONS_TYPES_H
+#define MYTHRIL_OPTIONS_TYPES_H
+
+#include "../utils/types.h"
+
+typedef enum {
+    EMIT_NONE   = 0,
+    EMIT_TOKENS = 1 << 0,
+    EMIT_AST    = 1 << 1
+} EmitFlags;
+
+// --stop-after=PHASE, the last phase that runs
+typedef enum {
+    STOP_AFTER_LEX,
+    STOP_AFTER_PARSE,
+    STOP_AFTER_SEMA,
+    STOP_AFTER_CODEGEN
+} StopAfter;
+
+typedef struct {
+    // everything on the command line that isn't an option
+    char** file_paths;
+    u32 file_count;
+
+    u32 emit; // EmitFlags
+
+    // declarations only, function bodies are skipped
+    b8 outline;
+
+    // --ast-cache, the AST of each source next to it. With a directory
+    // it is --cache-dir, there is one cache keyed by content
+    b8 ast_cache;
+    u8 _padding[2];
+
+    // --jobs=N parser threads, 0 picks one per online cpu
+    u32 jobs;
+
+    // --max-errors=N stops lexing and parsing after N errors, 0 is unlimited
+    u32 max_errors;
+
+    // --diagnostics-limit=N shows the first N diagnostics, 0 shows all
+    u32 diagnostics_limit;
+    u8 _padding3[4];
+
+    // -fsyntax-only, stop at the first error and produce nothing but diagnostics
+    b8 syntax_only;
+
+    u8 stop_after; // StopAfter
+
+    // --diagnostics-format=text|json|sarif
+    u8 diagnostics_format; // DiagFormat
+
+    // -ftime-report, time and throughput of every phase to stderr
+    b8 time_report;
+
+    // --server[=SOCKET], stay resident and compile what clients send, no files needed
+    b8 server;
+
+    // --cache-stats, the stats of the cache to stderr, no files needed
+    b8 cache_stats;
+
+    // --watch, compile the files again whenever they are saved
+    b8 watch;
+
+    // --lsp, a language server on stdin and stdout, no files needed
+    b8 lsp;
+
+    // --trace=FILE, Chrome trace events of every phase
+    char* trace_path;
+
+    // nullptr for the default socket
+    char* server_socket;
+
+    // --cache-dir=DIR, tokens, ASTs and diagnostics of every source by its content
+    char* cache_dir;
+
+    // --cache-limit=MIB, the cache is evicted back under it at the end of a run
+    u32 cache_limit;
+    u8 _padding4[4];
+} MythrilOptions;
+
+#endif // !MYTHRIL_OPTIONS_TYPES_H
@@ -0,0 +1,1378 @@
+#include "serialize.h"
+#include "types.h"
+
+#include "../hash/hash.h"
+#include "../utils/macros.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FLAT_ALIGN                8
+#define FLAT_INIT_CAPACITY        (64 * 1024)
+#define FLAT_STRINGS_INIT_CAPACITY 256 // power of two, doubles as intern table size
+#define FLAT_WORK_INIT_CAPACITY   64
+
+#define FLAT_AT(w, type, offset) ((type*) ((w) -> out.data + (offset)))
+
+/*
+*
+*   What the generic FlatNode fields hold per AstKind
+*
+*       module, import      entries: path segments
+*       struct, union       name, entries: name + type
+*       enum                name, extra: backing type, entries: name + node (value)
+*       impl                name: target, list: functions
+*       function            name, entries: parameters, type: return type, list: body
+*       static, const, var  name, type, a: value, op: is_mutable (var)
+*       assignment          op, a: lvalue, b: rvalue
+*       if                  a: condition, list: body, b: else
+*       match               a: expression, entries: node (pattern) + list (body),
+*                           list: default arm
+*       loop, while, for    a, b, c: init/cond/step, list: body
+*       return, expr        a
+*       unary, binary       op, a, b
+*       call                name, list: arguments
+*       index               a: array, b: index
+*       member              a: object, op, name: member
+*       identifier          name
+*       literal             op: literal kind, name: value
+*       pattern ident       name
+*       pattern literal     op: literal kind, name: value
+*       pattern variant     name, list: patterns
+*
+*/
+
+typedef struct {
+    u8* data;
+    usize len;
+    usize capacity;
+} FlatBuffer;
+
+typedef struct {
+    const AstNode* node;
+    u32 field; // offset of the i32 that has to point at the node
+    u32 _padding;
+} FlatWork;
+
+typedef struct {
+    ArenaAllocator* arena;
+
+    FlatBuffer out;
+    FlatBuffer bytes;
+
+    // open addressing, slots hold string id + 1 and 0 marks a free slot
+    u32* slots;
+    FlatString* strings;
+    u32 string_count;
+    u32 string_capacity;
+
+    FlatWork* work;
+    usize work_count;
+    usize work_capacity;
+} FlatWriter;
+
+typedef struct {
+    const FlatNode* src;
+    AstNode** dst;
+} ThawWork;
+
+typedef struct {
+    const AstCacheView* view;
+    ArenaAllocator* arena;
+
+    ThawWork* work;
+    usize work_count;
+    usize work_capacity;
+} ThawState;
+
+typedef enum {
+    FLAT_RECORD_NODE,
+    FLAT_RECORD_TYPE,
+    FLAT_RECORD_LIST,
+    FLAT_RECORD_ENTRIES
+} FlatRecord;
+
+typedef struct {
+    u32 offset;
+    u32 record; // FlatRecord
+} VerifyWork;
+
+/*
+*
+*   walks every record reachable from the declarations before a view is
+*   handed out, thawing trusts what passed. Records live in [begin, end),
+*   references only ever point forward so no walk can loop, and budget
+*   caps the visits at what a tree of that size could have
+*
+*/
+typedef struct {
+    const u8* data;
+    const AstCacheHeader* header;
+
+    u32 begin;
+    u32 end;
+    usize budget;
+
+    VerifyWork* work;
+    usize work_count;
+    usize work_capacity;
+} FlatVerifier;
+
+static void flat_grow(ArenaAllocator* arena, FlatBuffer* buf, usize needed);
+static void* flat_alloc(ArenaAllocator* arena, usize size);
+static void* flat_realloc(ArenaAllocator* arena, void* ptr, usize old_size, usize new_size);
+static u32 flat_reserve(FlatWriter* w, usize size);
+static void flat_link(FlatWriter* w, u32 field, u32 target);
+static u32 flat_intern(FlatWriter* w, AstSlice slice);
+static void flat_push(FlatWriter* w, const AstNode* node, u32 field);
+static void flat_type(FlatWriter* w, const AstType* type, u32 field);
+static void flat_nodes(FlatWriter* w, AstNode** items, usize count, u32 field);
+static u32 flat_entries(FlatWriter* w, usize count, u32 field);
+static void flat_segments(FlatWriter* w, AstSlice* segments, usize count, u32 field);
+static void flat_node(FlatWriter* w, const AstNode* node, u32 field);
+
+static void thaw_push(ThawState* t, const FlatNode* src, AstNode** dst);
+static AstType* thaw_type(ThawState* t, const FlatType* src);
+static void thaw_block(ThawState* t, const i32* field, AstNode*** items, usize* capacity, usize* count);
+static void thaw_node(ThawState* t, const FlatNode* src, AstNode** dst);
+
+static b8 verify_cache(const u8* data, const AstCacheHeader* header);
+static b8 verify_ref(FlatVerifier* v, u32 field, FlatRecord record);
+static b8 verify_record(FlatVerifier* v, VerifyWork work);
+
+void serialize_declarations(
+    AstCacheBlob* blob,
+    ArenaAllocator* arena,
+    AstNode** declarations,
+    usize count,
+    const u8 source_digest[SHA256_DIGEST_SIZE],
+    u64 source_len
+) {
+    FlatWriter w = {
+        .arena = arena,
+        .out = {
+            .data = flat_alloc(arena, FLAT_INIT_CAPACITY),
+            .len = 0,
+            .capacity = FLAT_INIT_CAPACITY
+        },
+        .bytes = {
+            .data = arena_alloc(arena, FLAT_INIT_CAPACITY),
+            .len = 0,
+            .capacity = FLAT_INIT_CAPACITY
+        },
+        .slots = memset(flat_alloc(arena, FLAT_STRINGS_INIT_CAPACITY * sizeof(u32)), 0, FLAT_STRINGS_INIT_CAPACITY * sizeof(u32)),
+        .strings = flat_alloc(arena, FLAT_STRINGS_INIT_CAPACITY * sizeof(FlatString)),
+        .string_count = 0,
+        .string_capacity = FLAT_STRINGS_INIT_CAPACITY,
+        .work = flat_alloc(arena, FLAT_WORK_INIT_CAPACITY * sizeof(FlatWork)),
+        .work_count = 0,
+        .work_capacity = FLAT_WORK_INIT_CAPACITY
+    };
+
+    const u32 header = flat_reserve(&w, sizeof(AstCacheHeader));
+    const u32 decls = flat_reserve(&w, sizeof(FlatList) + count * sizeof(i32));
+
+    FLAT_AT(&w, FlatList, decls) -> count = count;
+
+    for (usize i = count; i > 0; i--) {
+        flat_push(&w, declarations[i - 1], decls + offsetof(FlatList, items) + (i - 1) * sizeof(i32));
+    }
+
+    while (w.work_count > 0) {
+        FlatWork work = w.work[--w.work_count];
+        flat_node(&w, work.node, work.field);
+    }
+
+    // the string table and the bytes go last, offsets become file relative
+    const u32 strings = flat_reserve(&w, w.string_count * sizeof(FlatString));
+    const u32 bytes = flat_reserve(&w, w.bytes.len);
+
+    memcpy(w.out.data + bytes, w.bytes.data, w.bytes.len);
+
+    FlatString* table = FLAT_AT(&w, FlatString, strings);
+
+    for (u32 i = 0; i < w.string_count; i++) {
+        table[i] = w.strings[i];
+        table[i].offset += bytes;
+    }
+
+    *FLAT_AT(&w, AstCacheHeader, header) = (AstCacheHeader) {
+        .magic = AST_CACHE_MAGIC,
+        .version = AST_CACHE_VERSION,
+        .source_len = source_len,
+        .total_size = w.out.len,
+        .decl_count = count,
+        .decls = decls,
+        .string_count = w.string_count,
+        .strings = strings
+    };
+
+    memcpy(FLAT_AT(&w, AstCacheHeader, header) -> source_digest, source_digest, SHA256_DIGEST_SIZE);
+
+    blob -> data = w.out.data;
+    blob -> len = w.out.len;
+}
+
+i32 write_ast_cache(const AstCacheBlob* blob, const char* path) {
+    char tmp_path[4096];
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, getpid()) >= (i32) sizeof(tmp_path)) {
+        return -1;
+    }
+
+    i32 fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+
+    const u8* ptr = blob -> data;
+    usize len = blob -> len;
+
+    while (len > 0) {
+        ssize written = write(fd, ptr, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            close(fd);
+            unlink(tmp_path);
+            return -1;
+        }
+
+        ptr += written;
+        len -= written;
+    }
+
+    close(fd);
+
+    if (rename(tmp_path, path) == -1) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+i32 load_ast_cache(AstCacheView* view, const char* path, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len) {
+    i32 fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (usize) st.st_size < sizeof(AstCacheHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    const u8* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    if (open_ast_cache(view, base, st.st_size, source_digest, source_len) == -1) {
+        munmap((void*) base, st.st_size);
+        return -1;
+    }
+
+    view -> mapped = true;
+
+    return 0;
+}
+
+i32 open_ast_cache(AstCacheView* view, const u8* data, usize size, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len) {
+    if (size < sizeof(AstCacheHeader)) {
+        return -1;
+    }
+
+    const AstCacheHeader* header = (const AstCacheHeader*) data;
+
+    if (
+        header -> magic != AST_CACHE_MAGIC                                      ||
+        header -> version != AST_CACHE_VERSION                                  ||
+        header -> source_len != source_len                                      ||
+        memcmp(header -> source_digest, source_digest, SHA256_DIGEST_SIZE) != 0 ||
+        header -> total_size != size                                            ||
+        !verify_cache(data, header)
+    ) {
+        return -1;
+    }
+
+    view -> base = data;
+    view -> size = size;
+    view -> header = header;
+    view -> strings = (const FlatString*) (data + header -> strings);
+    view -> mapped = false;
+
+    return 0;
+}
+
+void unload_ast_cache(AstCacheView* view) {
+    if (view -> mapped) {
+        munmap((void*) view -> base, view -> size);
+    }
+
+    view -> base = nullptr;
+    view -> size = 0;
+    view -> mapped = false;
+}
+
+usize ast_cache_decl_count(const AstCacheView* view) {
+    return view -> header -> decl_count;
+}
+
+const FlatNode* ast_cache_decl(const AstCacheView* view, usize index) {
+    const FlatList* decls = (const FlatList*) (view -> base + view -> header -> decls);
+
+    return flat_deref(&decls -> items[index]);
+}
+
+const void* flat_deref(const i32* field) {
+    if (*field == 0) {
+        return nullptr;
+    }
+
+    return (const u8*) field + *field;
+}
+
+AstSlice flat_string(const AstCacheView* view, u32 id) {
+    // entries that carry no name leave it zeroed, with no strings at all that is no id either
+    if (id == FLAT_NO_STRING || id >= view -> header -> string_count) {
+        return (AstSlice) { .ptr = nullptr, .len = 0, .hash = 0 };
+    }
+
+    const FlatString* str = &view -> strings[id];
+
+    return (AstSlice) {
+        .ptr = (const char*) view -> base + str -> offset,
+        .len = str -> len,
+        .hash = str -> hash
+    };
+}
+
+void thaw_declarations(const AstCacheView* view, ArenaAllocator* arena, AstNode** out) {
+    ThawState t = {
+        .view = view,
+        .arena = arena,
+        .work = flat_alloc(arena, FLAT_WORK_INIT_CAPACITY * sizeof(ThawWork)),
+        .work_count = 0,
+        .work_capacity = FLAT_WORK_INIT_CAPACITY
+    };
+
+    const usize count = ast_cache_decl_count(view);
+
+    for (usize i = count; i > 0; i--) {
+        thaw_push(&t, ast_cache_decl(view, i - 1), &out[i - 1]);
+    }
+
+    while (t.work_count > 0) {
+        ThawWork work = t.work[--t.work_count];
+        thaw_node(&t, work.src, work.dst);
+    }
+}
+
+/*
+*
+*   the arena hands out memory wherever its last allocation ended, the
+*   records are cast in place and thawed nodes are read through
+*   pointers, so the writer and the thaw align their own memory. Whole
+*   words plus one keep an aligned arena aligned for whoever is next
+*
+*/
+static void* flat_alloc(ArenaAllocator* arena, usize size) {
+    const usize words = (size + FLAT_ALIGN - 1) & ~(usize) (FLAT_ALIGN - 1);
+    const uintptr_t ptr = (uintptr_t) arena_alloc(arena, words + FLAT_ALIGN);
+
+    return (void*) ((ptr + FLAT_ALIGN - 1) & ~(uintptr_t) (FLAT_ALIGN - 1));
+}
+
+static void* flat_realloc(ArenaAllocator* arena, void* ptr, usize old_size, usize new_size) {
+    return memcpy(flat_alloc(arena, new_size), ptr, old_size);
+}
+
+static void flat_grow(ArenaAllocator* arena, FlatBuffer* buf, usize needed) {
+    usize capacity = buf -> capacity;
+
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    if (capacity != buf -> capacity) {
+        buf -> data = flat_realloc(arena, buf -> data, buf -> capacity, capacity);
+        buf -> capacity = capacity;
+    }
+}
+
+/*
+*
+*   returns the offset of a zeroed, aligned record, pointers into the
+*   output do not survive this call since the buffer may move
+*
+*/
+static u32 flat_reserve(FlatWriter* w, usize size) {
+    const usize offset = (w -> out.len + FLAT_ALIGN - 1) & ~(usize) (FLAT_ALIGN - 1);
+
+    flat_grow(w -> arena, &w -> out, offset + size);
+    memset(w -> out.data + w -> out.len, 0, offset + size - w -> out.len);
+
+    w -> out.len = offset + size;
+
+    return offset;
+}
+
+static void flat_link(FlatWriter* w, u32 field, u32 target) {
+    *FLAT_AT(w, i32, field) = (i32) target - (i32) field;
+}
+
+static u32 flat_intern(FlatWriter* w, AstSlice slice) {
+    if (!slice.ptr) {
+        return FLAT_NO_STRING;
+    }
+
+    const u64 hash = hash_fnv1a(slice.ptr, slice.len);
+    u32 mask = w -> string_capacity - 1;
+    u32 slot = hash & mask;
+
+    while (w -> slots[slot] != 0) {
+        const FlatString* str = &w -> strings[w -> slots[slot] - 1];
+
+        if (
+            str -> hash == hash &&
+            str -> len == slice.len &&
+            memcmp(w -> bytes.data + str -> offset, slice.ptr, slice.len) == 0
+        ) {
+            return w -> slots[slot] - 1;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    const u32 id = w -> string_count++;
+
+    flat_grow(w -> arena, &w -> bytes, w -> bytes.len + slice.len);
+    memcpy(w -> bytes.data + w -> bytes.len, slice.ptr, slice.len);
+
+    w -> strings[id] = (FlatString) {
+        .offset = w -> bytes.len,
+        .len = slice.len,
+        .hash = hash
+    };
+
+    w -> bytes.len += slice.len;
+    w -> slots[slot] = id + 1;
+
+    // keep the table at most half full, the string array grows with it
+    if (MEOW_UNLIKELY(w -> string_count * 2 > w -> string_capacity)) {
+        const u32 capacity = w -> string_capacity * 2;
+        const usize size = w -> string_capacity * sizeof(FlatString);
+
+        w -> strings = flat_realloc(w -> arena, w -> strings, size, size * 2);
+        w -> slots = memset(flat_alloc(w -> arena, capacity * sizeof(u32)), 0, capacity * sizeof(u32));
+        w -> string_capacity = capacity;
+
+        mask = capacity - 1;
+
+        for (u32 i = 0; i < w -> string_count; i++) {
+            u32 s = w -> strings[i].hash & mask;
+
+            while (w -> slots[s] != 0) {
+                s = (s + 1) & mask;
+            }
+
+            w -> slots[s] = i + 1;
+        }
+    }
+
+    return id;
+}
+
+static void flat_push(FlatWriter* w, const AstNode* node, u32 field) {
+    if (!node) {
+        return;
+    }
+
+    if (MEOW_UNLIKELY(w -> work_count >= w -> work_capacity)) {
+        usize size = w -> work_capacity * sizeof(FlatWork);
+
+        w -> work = flat_realloc(w -> arena, w -> work, size, size * 2);
+        w -> work_capacity *= 2;
+    }
+
+    w -> work[w -> work_count++] = (FlatWork) {
+        .node = node,
+        .field = field
+    };
+}
+
+static void flat_type(FlatWriter* w, const AstType* type, u32 field) {
+    while (type) {
+        const u32 offset = flat_reserve(w, sizeof(FlatType));
+        flat_link(w, field, offset);
+
+        FlatType* flat = FLAT_AT(w, FlatType, offset);
+
+        flat -> kind = type -> kind;
+        flat -> is_mutable = type -> is_mutable;
+        flat -> is_ref = type -> is_ref;
+        flat -> name = FLAT_NO_STRING;
+
+        switch (type -> kind) {
+            case TYPE_BASIC: {
+                flat -> name = flat_intern(w, type -> identifier);
+                type = nullptr;
+            } break;
+
+            case TYPE_POINTER: {
+                field = offset + offsetof(FlatType, inner);
+                type = type -> pointee;
+            } break;
+
+            case TYPE_ARRAY: {
+                flat_push(w, type -> array.size_expr, offset + offsetof(FlatType, size_expr));
+
+                field = offset + offsetof(FlatType, inner);
+                type = type -> array.element_type;
+            } break;
+
+            default: {
+                type = nullptr;
+            } break;
+        }
+    }
+}
+
+static void flat_nodes(FlatWriter* w, AstNode** items, usize count, u32 field) {
+    if (count == 0) {
+        return;
+    }
+
+    const u32 offset = flat_reserve(w, sizeof(FlatList) + count * sizeof(i32));
+    flat_link(w, field, offset);
+
+    FLAT_AT(w, FlatList, offset) -> count = count;
+
+    for (usize i = count; i > 0; i--) {
+        flat_push(w, items[i - 1], offset + offsetof(FlatList, items) + (i - 1) * sizeof(i32));
+    }
+}
+
+// returns the offset of the first entry, 0 if there are none
+static u32 flat_entries(FlatWriter* w, usize count, u32 field) {
+    if (count == 0) {
+        return 0;
+    }
+
+    const u32 offset = flat_reserve(w, sizeof(FlatEntryList) + count * sizeof(FlatEntry));
+    flat_link(w, field, offset);
+
+    FLAT_AT(w, FlatEntryList, offset) -> count = count;
+
+    return offset + offsetof(FlatEntryList, items);
+}
+
+static void flat_segments(FlatWriter* w, AstSlice* segments, usize count, u32 field) {
+    const u32 entries = flat_entries(w, count, field);
+
+    for (usize i = 0; i < count; i++) {
+        const u32 name = flat_intern(w, segments[i]);
+
+        FLAT_AT(w, FlatEntry, entries + i * sizeof(FlatEntry)) -> name = name;
+    }
+}
+
+static void flat_node(FlatWriter* w, const AstNode* node, u32 field) {
+    const u32 offset = flat_reserve(w, sizeof(FlatNode));
+    flat_link(w, field, offset);
+
+    #define FIELD(member) (offset + offsetof(FlatNode, member))
+    #define NODE FLAT_AT(w, FlatNode, offset)
+    #define ENTRY(base, i) FLAT_AT(w, FlatEntry, (base) + (i) * sizeof(FlatEntry))
+    #define ENTRY_FIELD(base, i, member) ((base) + (i) * sizeof(FlatEntry) + offsetof(FlatEntry, member))
+
+    NODE -> kind = node -> kind;
+    NODE -> name = FLAT_NO_STRING;
+    NODE -> extra = FLAT_NO_STRING;
+
+    switch (node -> kind) {
+        case AST_MODULE_DECL: {
+            flat_segments(w, node -> module_decl.segments, node -> module_decl.count, FIELD(entries));
+        } break;
+
+        case AST_IMPORT_DECL: {
+            flat_segments(w, node -> import_decl.segments, node -> import_decl.count, FIELD(entries));
+        } break;
+
+        case AST_STRUCT_DECL: {
+            const AstStructDecl* decl = &node -> struct_decl;
+
+            const u32 name = flat_intern(w, decl -> identifier);
+            NODE -> name = name;
+
+            const u32 entries = flat_entries(w, decl -> count, FIELD(entries));
+
+            for (usize i = 0; i < decl -> count; i++) {
+                const u32 field_name = flat_intern(w, decl -> fields[i] -> identifier);
+                ENTRY(entries, i) -> name = field_name;
+
+                flat_type(w, decl -> fields[i] -> type, ENTRY_FIELD(entries, i, type));
+            }
+        } break;
+
+        case AST_UNION_DECL: {
+            const AstUnionDecl* decl = &node -> union_decl;
+
+            const u32 name = flat_intern(w, decl -> identifier);
+            NODE -> name = name;
+
+            const u32 entries = flat_entries(w, decl -> count, FIELD(entries));
+
+            for (usize i = 0; i < decl -> count; i++) {
+                const u32 variant_name = flat_intern(w, decl -> variants[i] -> identifier);
+                ENTRY(entries, i) -> name = variant_name;
+
+                flat_type(w, decl -> variants[i] -> type, ENTRY_FIELD(entries, i, type));
+            }
+        } break;
+
+        case AST_ENUM_DECL: {
+            const AstEnumDecl* decl = &node -> enum_decl;
+
+            const u32 name = flat_intern(w, decl -> identifier);
+            const u32 type = flat_intern(w, decl -> type);
+
+            NODE -> name = name;
+            NODE -> extra = type;
+
+            const u32 entries = flat_entries(w, decl -> count, FIELD(entries));
+
+            for (usize i = 0; i < decl -> count; i++) {
+                const u32 variant_name = flat_intern(w, decl -> variants[i] -> identifier);
+                ENTRY(entries, i) -> name = variant_name;
+
+                flat_push(w, decl -> variants[i] -> value, ENTRY_FIELD(entries, i, node));
+            }
+        } break;
+
+        case AST_IMPL_DECL: {
+            const AstImplDecl* decl = &node -> impl_decl;
+
+            const u32 name = flat_intern(w, decl -> target);
+            NODE -> name = name;
+
+            flat_nodes(w, decl -> functions, decl -> fn_count, FIELD(list));
+        } break;
+
+        case AST_FUNCTION_DECL: {
+            const AstFunctionDecl* decl = &node -> function_decl;
+
+            const u32 name = flat_intern(w, decl -> identifier);
+            NODE -> name = name;
+
+            const u32 entries = flat_entries(w, decl -> param_count, FIELD(entries));
+
+            for (usize i = 0; i < decl -> param_count; i++) {
+                const u32 param_name = flat_intern(w, decl -> parameters[i].identifier);
+                ENTRY(entries, i) -> name = param_name;
+
+                flat_type(w, decl -> parameters[i].type, ENTRY_FIELD(entries, i, type));
+            }
+
+            flat_type(w, decl -> return_type, FIELD(type));
+            flat_nodes(w, decl -> statements, decl -> stmt_count, FIELD(list));
+        } break;
+
+        case AST_STATIC_DECL: {
+            const u32 name = flat_intern(w, node -> static_decl.identifier);
+            NODE -> name = name;
+
+            flat_type(w, node -> static_decl.type, FIELD(type));
+            flat_push(w, node -> static_decl.value, FIELD(a));
+        } break;
+
+        case AST_CONST_DECL: {
+            const u32 name = flat_intern(w, node -> const_decl.identifier);
+            NODE -> name = name;
+
+            flat_type(w, node -> const_decl.type, FIELD(type));
+            flat_push(w, node -> const_decl.value, FIELD(a));
+        } break;
+
+        case AST_VAR_DECL: {
+            const u32 name = flat_intern(w, node -> var_decl.identifier);
+
+            NODE -> name = name;
+            NODE -> op = node -> var_decl.is_mutable;
+
+            flat_type(w, node -> var_decl.type, FIELD(type));
+            flat_push(w, node -> var_decl.value, FIELD(a));
+        } break;
+
+        case AST_ASSIGNMENT: {
+            NODE -> op = node -> assignment.op;
+
+            flat_push(w, node -> assignment.lvalue, FIELD(a));
+            flat_push(w, node -> assignment.rvalue, FIELD(b));
+        } break;
+
+        case AST_IF_STMT: {
+            const AstIfStmt* stmt = &node -> if_stmt;
+
+            flat_push(w, stmt -> expression, FIELD(a));
+            flat_nodes(w, stmt -> statements, stmt -> stmt_count, FIELD(list));
+            flat_push(w, stmt -> else_stmt, FIELD(b));
+        } break;
+
+        case AST_MATCH_STMT: {
+            const AstMatchStmt* stmt = &node -> match_stmt;
+
+            flat_push(w, stmt -> expression, FIELD(a));
+
+            const u32 entries = flat_entries(w, stmt -> arm_count, FIELD(entries));
+
+            for (usize i = 0; i < stmt -> arm_count; i++) {
+                const AstMatchArm* arm = &stmt -> arms[i];
+
+                flat_push(w, arm -> pattern, ENTRY_FIELD(entries, i, node));
+                flat_nodes(w, arm -> statements, arm -> stmt_count, ENTRY_FIELD(entries, i, list));
+            }
+
+            flat_nodes(w, stmt -> statements, stmt -> stmt_count, FIELD(list));
+        } break;
+
+        case AST_LOOP_STMT: {
+            flat_nodes(w, node -> loop_stmt.statements, node -> loop_stmt.stmt_count, FIELD(list));
+        } break;
+
+        case AST_WHILE_STMT: {
+            flat_push(w, node -> while_stmt.cond, FIELD(a));
+            flat_nodes(w, node -> while_stmt.statements, node -> while_stmt.stmt_count, FIELD(list));
+        } break;
+
+        case AST_FOR_STMT: {
+            const AstForStmt* stmt = &node -> for_stmt;
+
+            flat_push(w, stmt -> init, FIELD(a));
+            flat_push(w, stmt -> cond, FIELD(b));
+            flat_push(w, stmt -> step, FIELD(c));
+            flat_nodes(w, stmt -> statements, stmt -> stmt_count, FIELD(list));
+        } break;
+
+        case AST_RETURN_STMT: {
+            flat_push(w, node -> return_stmt.expression, FIELD(a));
+        } break;
+
+        case AST_EXPR_STMT: {
+            flat_push(w, node -> expr_stmt.expression, FIELD(a));
+        } break;
+
+        case AST_UNARY: {
+            NODE -> op = node -> unary.op;
+
+            flat_push(w, node -> unary.operand, FIELD(a));
+        } break;
+
+        case AST_BINARY: {
+            NODE -> op = node -> binary.op;
+
+            flat_push(w, node -> binary.left, FIELD(a));
+            flat_push(w, node -> binary.right, FIELD(b));
+        } break;
+
+        case AST_FUNCTION_CALL: {
+            const AstFunctionCall* call = &node -> function_call;
+
+            const u32 name = flat_intern(w, call -> identifier);
+            NODE -> name = name;
+
+            flat_push(w, call -> callee, FIELD(a));
+            flat_nodes(w, call -> arguments, call -> arg_count, FIELD(list));
+        } break;
+
+        case AST_ARRAY_INDEX: {
+            flat_push(w, node -> array_index.array, FIELD(a));
+            flat_push(w, node -> array_index.index, FIELD(b));
+        } break;
+
+        case AST_MEMBER_ACCESS: {
+            const u32 name = flat_intern(w, node -> member_access.member);
+
+            NODE -> name = name;
+            NODE -> op = node -> member_access.op;
+
+            flat_push(w, node -> member_access.object, FIELD(a));
+        } break;
+
+        case AST_IDENTIFIER: {
+            const u32 name = flat_intern(w, node -> identifier.value);
+            NODE -> name = name;
+        } break;
+
+        case AST_LITERAL: {
+            const u32 name = flat_intern(w, node -> literal.value);
+
+            NODE -> name = name;
+            NODE -> op = node -> literal.kind;
+        } break;
+
+        case AST_PATTERN_IDENT: {
+            const u32 name = flat_intern(w, node -> pattern_ident.identifier);
+            NODE -> name = name;
+        } break;
+
+        case AST_PATTERN_LITERAL: {
+            const u32 name = flat_intern(w, node -> pattern_literal.literal.value);
+
+            NODE -> name = name;
+            NODE -> op = node -> pattern_literal.literal.kind;
+        } break;
+
+        case AST_PATTERN_VARIANT: {
+            const AstPatternVariant* pattern = &node -> pattern_variant;
+
+            const u32 name = flat_intern(w, pattern -> variant);
+            NODE -> name = name;
+
+            flat_nodes(w, pattern -> patterns, pattern -> count, FIELD(list));
+        } break;
+
+        default: {
+            // break, continue, wildcard and error nodes carry nothing
+        } break;
+    }
+
+    #undef ENTRY_FIELD
+    #undef ENTRY
+    #undef NODE
+    #undef FIELD
+}
+
+static void thaw_push(ThawState* t, const FlatNode* src, AstNode** dst) {
+    *dst = nullptr;
+
+    if (!src) {
+        return;
+    }
+
+    if (MEOW_UNLIKELY(t -> work_count >= t -> work_capacity)) {
+        usize size = t -> work_capacity * sizeof(ThawWork);
+
+        t -> work = flat_realloc(t -> arena, t -> work, size, size * 2);
+        t -> work_capacity *= 2;
+    }
+
+    t -> work[t -> work_count++] = (ThawWork) {
+        .src = src,
+        .dst = dst
+    };
+}
+
+static AstType* thaw_type(ThawState* t, const FlatType* src) {
+    AstType* head = nullptr;
+    AstType** dst = &head;
+
+    while (src) {
+        AstType* type = flat_alloc(t -> arena, sizeof(*type));
+
+        type -> kind = src -> kind;
+        type -> is_mutable = src -> is_mutable;
+        type -> is_ref = src -> is_ref;
+
+        *dst = type;
+
+        switch (type -> kind) {
+            case TYPE_BASIC: {
+                type -> identifier = flat_string(t -> view, src -> name);
+                src = nullptr;
+            } break;
+
+            case TYPE_POINTER: {
+                type -> pointee = nullptr;
+                dst = &type -> pointee;
+                src = flat_deref(&src -> inner);
+            } break;
+
+            case TYPE_ARRAY: {
+                thaw_push(t, flat_deref(&src -> size_expr), &type -> array.size_expr);
+
+                type -> array.element_type = nullptr;
+                dst = &type -> array.element_type;
+                src = flat_deref(&src -> inner);
+            } break;
+
+            default: {
+                src = nullptr;
+            } break;
+        }
+    }
+
+    return head;
+}
+
+static void thaw_block(ThawState* t, const i32* field, AstNode*** items, usize* capacity, usize* count) {
+    const FlatList* list = flat_deref(field);
+    const usize n = list ? list -> count : 0;
+
+    // never hand out a zero capacity, growth doubles it
+    *capacity = n > 0 ? n : 1;
+    *count = n;
+    *items = flat_alloc(t -> arena, *capacity * sizeof(AstNode*));
+
+    for (usize i = n; i > 0; i--) {
+        thaw_push(t, flat_deref(&list -> items[i - 1]), &(*items)[i - 1]);
+    }
+}
+
+static void thaw_node(ThawState* t, const FlatNode* src, AstNode** dst) {
+    const AstCacheView* view = t -> view;
+
+    AstNode* node = flat_alloc(t -> arena, sizeof(*node));
+    node -> kind = src -> kind;
+
+    *dst = node;
+
+    const FlatEntryList* entries = flat_deref(&src -> entries);
+    const usize entry_count = entries ? entries -> count : 0;
+    const usize entry_capacity = entry_count > 0 ? entry_count : 1;
+
+    switch (node -> kind) {
+        case AST_MODULE_DECL:
+        case AST_IMPORT_DECL: {
+            // both decls share the segments layout
+            AstSlice* segments = flat_alloc(t -> arena, entry_capacity * sizeof(AstSlice));
+
+            for (usize i = 0; i < entry_count; i++) {
+                segments[i] = flat_string(view, entries -> items[i].name);
+            }
+
+            node -> module_decl.segments = segments;
+            node -> module_decl.count = entry_count;
+        } break;
+
+        case AST_STRUCT_DECL: {
+            AstStructDecl* decl = &node -> struct_decl;
+
+            decl -> identifier = flat_string(view, src -> name);
+            decl -> fields = flat_alloc(t -> arena, entry_capacity * sizeof(AstStructField*));
+            decl -> capacity = entry_capacity;
+            decl -> count = entry_count;
+
+            for (usize i = 0; i < entry_count; i++) {
+                AstStructField* field = flat_alloc(t -> arena, sizeof(*field));
+
+                field -> identifier = flat_string(view, entries -> items[i].name);
+                field -> type = thaw_type(t, flat_deref(&entries -> items[i].type));
+
+                decl -> fields[i] = field;
+            }
+        } break;
+
+        case AST_UNION_DECL: {
+            AstUnionDecl* decl = &node -> union_decl;
+
+            decl -> identifier = flat_string(view, src -> name);
+            decl -> variants = flat_alloc(t -> arena, entry_capacity * sizeof(AstUnionVariant*));
+            decl -> capacity = entry_capacity;
+            decl -> count = entry_count;
+
+            for (usize i = 0; i < entry_count; i++) {
+                AstUnionVariant* variant = flat_alloc(t -> arena, sizeof(*variant));
+
+                variant -> identifier = flat_string(view, entries -> items[i].name);
+                variant -> type = thaw_type(t, flat_deref(&entries -> items[i].type));
+
+                decl -> variants[i] = variant;
+            }
+        } break;
+
+        case AST_ENUM_DECL: {
+            AstEnumDecl* decl = &node -> enum_decl;
+
+            decl -> identifier = flat_string(view, src -> name);
+            decl -> type = flat_string(view, src -> extra);
+            decl -> variants = flat_alloc(t -> arena, entry_capacity * sizeof(AstEnumVariant*));
+            decl -> capacity = entry_capacity;
+            decl -> count = entry_count;
+
+            for (usize i = 0; i < entry_count; i++) {
+                AstEnumVariant* variant = flat_alloc(t -> arena, sizeof(*variant));
+
+                variant -> identifier = flat_string(view, entries -> items[i].name);
+                thaw_push(t, flat_deref(&entries -> items[i].node), &variant -> value);
+
+                decl -> variants[i] = variant;
+            }
+        } break;
+
+        case AST_IMPL_DECL: {
+            AstImplDecl* decl = &node -> impl_decl;
+
+            decl -> target = flat_string(view, src -> name);
+            thaw_block(t, &src -> list, &decl -> functions, &decl -> fn_capacity, &decl -> fn_count);
+        } break;
+
+        case AST_FUNCTION_DECL: {
+            AstFunctionDecl* decl = &node -> function_decl;
+
+            decl -> identifier = flat_string(view, src -> name);
+            decl -> parameters = flat_alloc(t -> arena, entry_capacity * sizeof(AstParameter));
+            decl -> param_capacity = entry_capacity;
+            decl -> param_count = entry_count;
+
+            for (usize i = 0; i < entry_count; i++) {
+                decl -> parameters[i] = (AstParameter) {
+                    .identifier = flat_string(view, entries -> items[i].name),
+                    .type = thaw_type(t, flat_deref(&entries -> items[i].type))
+                };
+            }
+
+            decl -> return_type = thaw_type(t, flat_deref(&src -> type));
+            decl -> body_start = 0;
+            decl -> body_end = 0;
+            decl -> lazy_body = false;
+            thaw_block(t, &src -> list, &decl -> statements, &decl -> stmt_capacity, &decl -> stmt_count);
+        } break;
+
+        case AST_STATIC_DECL: {
+            node -> static_decl.identifier = flat_string(view, src -> name);
+            node -> static_decl.type = thaw_type(t, flat_deref(&src -> type));
+            thaw_push(t, flat_deref(&src -> a), &node -> static_decl.value);
+        } break;
+
+        case AST_CONST_DECL: {
+            node -> const_decl.identifier = flat_string(view, src -> name);
+            node -> const_decl.type = thaw_type(t, flat_deref(&src -> type));
+            thaw_push(t, flat_deref(&src -> a), &node -> const_decl.value);
+        } break;
+
+        case AST_VAR_DECL: {
+            node -> var_decl.identifier = flat_string(view, src -> name);
+            node -> var_decl.type = thaw_type(t, flat_deref(&src -> type));
+            node -> var_decl.is_mutable = src -> op;
+            thaw_push(t, flat_deref(&src -> a), &node -> var_decl.value);
+        } break;
+
+        case AST_ASSIGNMENT: {
+            node -> assignment.op = src -> op;
+            thaw_push(t, flat_deref(&src -> a), &node -> assignment.lvalue);
+            thaw_push(t, flat_deref(&src -> b), &node -> assignment.rvalue);
+        } break;
+
+        case AST_IF_STMT: {
+            AstIfStmt* stmt = &node -> if_stmt;
+
+            thaw_push(t, flat_deref(&src -> a), &stmt -> expression);
+            thaw_block(t, &src -> list, &stmt -> statements, &stmt -> stmt_capacity, &stmt -> stmt_count);
+            thaw_push(t, flat_deref(&src -> b), &stmt -> else_stmt);
+        } break;
+
+        case AST_MATCH_STMT: {
+            AstMatchStmt* stmt = &node -> match_stmt;
+
+            thaw_push(t, flat_deref(&src -> a), &stmt -> expression);
+
+            stmt -> arms = flat_alloc(t -> arena, entry_capacity * sizeof(AstMatchArm));
+            stmt -> arm_capacity = entry_capacity;
+            stmt -> arm_count = entry_count;
+
+            for (usize i = 0; i < entry_count; i++) {
+                AstMatchArm* arm = &stmt -> arms[i];
+
+                thaw_push(t, flat_deref(&entries -> items[i].node), &arm -> pattern);
+                thaw_block(t, &entries -> items[i].list, &arm -> statements, &arm -> stmt_capacity, &arm -> stmt_count);
+            }
+
+            thaw_block(t, &src -> list, &stmt -> statements, &stmt -> stmt_capacity, &stmt -> stmt_count);
+        } break;
+
+        case AST_LOOP_STMT: {
+            AstLoopStmt* stmt = &node -> loop_stmt;
+
+            thaw_block(t, &src -> list, &stmt -> statements, &stmt -> stmt_capacity, &stmt -> stmt_count);
+        } break;
+
+        case AST_WHILE_STMT: {
+            AstWhileStmt* stmt = &node -> while_stmt;
+
+            thaw_push(t, flat_deref(&src -> a), &stmt -> cond);
+            thaw_block(t, &src -> list, &stmt -> statements, &stmt -> stmt_capacity, &stmt -> stmt_count);
+        } break;
+
+        case AST_FOR_STMT: {
+            AstForStmt* stmt = &node -> for_stmt;
+
+            thaw_push(t, flat_deref(&src -> a), &stmt -> init);
+            thaw_push(t, flat_deref(&src -> b), &stmt -> cond);
+            thaw_push(t, flat_deref(&src -> c), &stmt -> step);
+            thaw_block(t, &src -> list, &stmt -> statements, &stmt -> stmt_capacity, &stmt -> stmt_count);
+        } break;
+
+        case AST_RETURN_STMT: {
+            thaw_push(t, flat_deref(&src -> a), &node -> return_stmt.expression);
+        } break;
+
+        case AST_EXPR_STMT: {
+            thaw_push(t, flat_deref(&src -> a), &node -> expr_stmt.expression);
+        } break;
+
+        case AST_UNARY: {
+            node -> unary.op = src -> op;
+            thaw_push(t, flat_deref(&src -> a), &node -> unary.operand);
+        } break;
+
+        case AST_BINARY: {
+            node -> binary.op = src -> op;
+            thaw_push(t, flat_deref(&src -> a), &node -> binary.left);
+            thaw_push(t, flat_deref(&src -> b), &node -> binary.right);
+        } break;
+
+        case AST_FUNCTION_CALL: {
+            AstFunctionCall* call = &node -> function_call;
+
+            call -> identifier = flat_string(view, src -> name);
+            thaw_push(t, flat_deref(&src -> a), &call -> callee);
+            thaw_block(t, &src -> list, &call -> arguments, &call -> arg_capacity, &call -> arg_count);
+        } break;
+
+        case AST_ARRAY_INDEX: {
+            thaw_push(t, flat_deref(&src -> a), &node -> array_index.array);
+            thaw_push(t, flat_deref(&src -> b), &node -> array_index.index);
+        } break;
+
+        case AST_MEMBER_ACCESS: {
+            node -> member_access.op = src -> op;
+            node -> member_access.member = flat_string(view, src -> name);
+            thaw_push(t, flat_deref(&src -> a), &node -> member_access.object);
+        } break;
+
+        case AST_IDENTIFIER: {
+            node -> identifier.value = flat_string(view, src -> name);
+        } break;
+
+        case AST_LITERAL: {
+            node -> literal.kind = src -> op;
+            node -> literal.value = flat_string(view, src -> name);
+        } break;
+
+        case AST_PATTERN_IDENT: {
+            node -> pattern_ident.identifier = flat_string(view, src -> name);
+        } break;
+
+        case AST_PATTERN_LITERAL: {
+            node -> pattern_literal.literal.kind = src -> op;
+            node -> pattern_literal.literal.value = flat_string(view, src -> name);
+        } break;
+
+        case AST_PATTERN_VARIANT: {
+            AstPatternVariant* pattern = &node -> pattern_variant;
+
+            pattern -> variant = flat_string(view, src -> name);
+            thaw_block(t, &src -> list, &pattern -> patterns, &pattern -> capacity, &pattern -> count);
+        } break;
+
+        default: {
+        } break;
+    }
+}
+
+/*
+*
+*   the layout in the header, the string table and then every record
+*   reachable from the declarations, each offset and count checked
+*   against the file before it is followed
+*
+*/
+static b8 verify_cache(const u8* data, const AstCacheHeader* header) {
+    const u64 size = header -> total_size;
+    const u64 strings_end = (u64) header -> strings + (u64) header -> string_count * sizeof(FlatString);
+
+    if (
+        header -> decls < sizeof(AstCacheHeader)                                                ||
+        header -> decls % FLAT_ALIGN != 0                                                       ||
+        header -> strings % FLAT_ALIGN != 0                                                     ||
+        header -> strings < header -> decls                                                     ||
+        strings_end > size                                                                      ||
+        (u64) header -> decls + sizeof(FlatList) + (u64) header -> decl_count * sizeof(i32) > header -> strings
+    ) {
+        return false;
+    }
+
+    const FlatList* decls = (const FlatList*) (data + header -> decls);
+
+    if (decls -> count != header -> decl_count) {
+        return false;
+    }
+
+    const FlatString* table = (const FlatString*) (data + header -> strings);
+
+    for (u32 i = 0; i < header -> string_count; i++) {
+        if (table[i].offset < strings_end || (u64) table[i].offset + table[i].len > size) {
+            return false;
+        }
+    }
+
+    FlatVerifier v = {
+        .data = data,
+        .header = header,
+        .begin = header -> decls,
+        .end = header -> strings,
+        .budget = (header -> strings - header -> decls) / FLAT_ALIGN,
+        .work = malloc(FLAT_WORK_INIT_CAPACITY * sizeof(VerifyWork)),
+        .work_count = 0,
+        .work_capacity = FLAT_WORK_INIT_CAPACITY
+    };
+
+    b8 ok = v.work != nullptr;
+
+    for (u32 i = 0; ok && i < header -> decl_count; i++) {
+        ok = verify_ref(&v, header -> decls + offsetof(FlatList, items) + i * sizeof(i32), FLAT_RECORD_NODE);
+    }
+
+    while (ok && v.work_count > 0) {
+        ok = verify_record(&v, v.work[--v.work_count]);
+    }
+
+    free(v.work);
+
+    return ok;
+}
+
+// the record the i32 at field points to, queued if it fits, true for none
+static b8 verify_ref(FlatVerifier* v, u32 field, FlatRecord record) {
+    i32 relative;
+    memcpy(&relative, v -> data + field, sizeof(relative));
+
+    if (relative == 0) {
+        return true;
+    }
+
+    static const usize sizes[] = {
+        [FLAT_RECORD_NODE]    = sizeof(FlatNode),
+        [FLAT_RECORD_TYPE]    = sizeof(FlatType),
+        [FLAT_RECORD_LIST]    = sizeof(FlatList),
+        [FLAT_RECORD_ENTRIES] = sizeof(FlatEntryList)
+    };
+
+    const i64 target = (i64) field + relative;
+
+    if (
+        relative < 0                                ||
+        target < v -> begin                         ||
+        target % FLAT_ALIGN != 0                    ||
+        (u64) target + sizes[record] > v -> end     ||
+        v -> budget == 0
+    ) {
+        return false;
+    }
+
+    v -> budget--;
+
+    if (MEOW_UNLIKELY(v -> work_count >= v -> work_capacity)) {
+        VerifyWork* work = realloc(v -> work, v -> work_capacity * 2 * sizeof(VerifyWork));
+
+        if (!work) {
+            return false;
+        }
+
+        v -> work = work;
+        v -> work_capacity *= 2;
+    }
+
+    v -> work[v -> work_count++] = (VerifyWork) {
+        .offset = (u32) target,
+        .record = record
+    };
+
+    return true;
+}
+
+static b8 verify_string(const FlatVerifier* v, u32 id) {
+    return id == FLAT_NO_STRING || id < v -> header -> string_count;
+}
+
+static b8 verify_record(FlatVerifier* v, VerifyWork work) {
+    const u32 offset = work.offset;
+
+    switch (work.record) {
+        case FLAT_RECORD_NODE: {
+            const FlatNode* node = (const FlatNode*) (v -> data + offset);
+
+            #define FIELD(member) (offset + offsetof(FlatNode, member))
+
+            const b8 ok =
+                node -> kind < AST_KIND_COUNT                           &&
+                verify_string(v, node -> name)                          &&
+                verify_string(v, node -> extra)                         &&
+                verify_ref(v, FIELD(type), FLAT_RECORD_TYPE)            &&
+                verify_ref(v, FIELD(a), FLAT_RECORD_NODE)               &&
+                verify_ref(v, FIELD(b), FLAT_RECORD_NODE)               &&
+                verify_ref(v, FIELD(c), FLAT_RECORD_NODE)               &&
+                verify_ref(v, FIELD(list), FLAT_RECORD_LIST)            &&
+                verify_ref(v, FIELD(entries), FLAT_RECORD_ENTRIES);
+
+            #undef FIELD
+
+            return ok;
+        }
+
+        case FLAT_RECORD_TYPE: {
+            const FlatType* type = (const FlatType*) (v -> data + offset);
+
+            return
+                type -> kind <= TYPE_ARRAY                                                      &&
+                verify_string(v, type -> name)                                                  &&
+                verify_ref(v, offset + offsetof(FlatType, inner), FLAT_RECORD_TYPE)             &&
+                verify_ref(v, offset + offsetof(FlatType, size_expr), FLAT_RECORD_NODE);
+        }
+
+        case FLAT_RECORD_LIST: {
+            const FlatList* list = (const FlatList*) (v -> data + offset);
+
+            if ((u64) offset + sizeof(FlatList) + (u64) list -> count * sizeof(i32) > v -> end) {
+                return false;
+            }
+
+            for (u32 i = 0; i < list -> count; i++) {
+                if (!verify_ref(v, offset + offsetof(FlatList, items) + i * sizeof(i32), FLAT_RECORD_NODE)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        case FLAT_RECORD_ENTRIES: {
+            const FlatEntryList* entries = (const FlatEntryList*) (v -> data + offset);
+
+            if ((u64) offset + sizeof(FlatEntryList) + (u64) entries -> count * sizeof(FlatEntry) > v -> end) {
+                return false;
+            }
+
+            for (u32 i = 0; i < entries -> count; i++) {
+                const u32 entry = offset + offsetof(FlatEntryList, items) + i * sizeof(FlatEntry);
+
+                if (
+                    !verify_ref(v, entry + offsetof(FlatEntry, type), FLAT_RECORD_TYPE)     ||
+                    !verify_ref(v, entry + offsetof(FlatEntry, node), FLAT_RECORD_NODE)     ||
+                    !verify_ref(v, entry + offsetof(FlatEntry, list), FLAT_RECORD_LIST)
+                ) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef MYTHRIL_SERIALIZE_H
+#define MYTHRIL_SERIALIZE_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+#include "../ast/types.h"
+
+/*
+*
+*   flattens the declarations into the relocatable on disk format,
+*   the tree is walked with an explicit work stack so deep expressions
+*   cannot overflow the C stack
+*
+*/
+void serialize_declarations(
+    AstCacheBlob* blob,
+    ArenaAllocator* arena,
+    AstNode** declarations,
+    usize count,
+    const u8 source_digest[SHA256_DIGEST_SIZE],
+    u64 source_len
+);
+
+/*
+*
+*   writes the blob to a temporary file next to path and renames it
+*   into place so readers never see a partial cache
+*
+*/
+i32 write_ast_cache(const AstCacheBlob* blob, const char* path);
+
+/*
+*
+*   maps a cache file read only with a single mmap(), returns -1 if the
+*   file is missing, malformed or was produced for a different source
+*
+*/
+i32 load_ast_cache(AstCacheView* view, const char* path, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len);
+
+/*
+*
+*   the same checks over serialized bytes already in memory, the view
+*   borrows them and they have to outlive every tree thawed from it
+*
+*/
+i32 open_ast_cache(AstCacheView* view, const u8* data, usize size, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len);
+
+void unload_ast_cache(AstCacheView* view);
+
+/*
+*
+*   direct access to the mapped records, no copies are made
+*
+*/
+usize ast_cache_decl_count(const AstCacheView* view);
+const FlatNode* ast_cache_decl(const AstCacheView* view, usize index);
+const void* flat_deref(const i32* field);
+AstSlice flat_string(const AstCacheView* view, u32 id);
+
+/*
+*
+*   rebuilds AstNodes for every declaration into out, which must hold
+*   ast_cache_decl_count() entries. Every node is copied out and its
+*   offsets turned into pointers, a load is linear in the tree size.
+*   Identifiers keep pointing into the mapping, so the view has to
+*   outlive the tree
+*
+*/
+void thaw_declarations(const AstCacheView* view, ArenaAllocator* arena, AstNode** out);
+
+#endif // !MYTHRIL_SERIALIZE_H
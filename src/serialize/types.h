@@ -0,0 +1,139 @@
+#pragma once
+#ifndef MYTHRIL_SERIALIZE_TYPES_H
+#define MYTHRIL_SERIALIZE_TYPES_H
+
+#include "../hash/types.h"
+#include "../utils/types.h"
+
+/*
+*
+*   On disk AST format
+*
+*   The file is used straight out of a read only mapping, nothing in it
+*   is an absolute pointer. Node, type and list references are i32
+*   offsets relative to the address of the field holding them (0 means
+*   none), strings are ids into an interned table at the end of the file.
+*   Every record is 8 byte aligned.
+*
+*       AstCacheHeader
+*       u32 decls[decl_count]      offsets of the top level FlatNodes
+*       FlatNode / FlatType / FlatList / FlatEntryList records
+*       FlatString strings[string_count]
+*       string bytes
+*
+*/
+
+#define AST_CACHE_MAGIC     0x5453414d /* "MAST" */
+#define AST_CACHE_VERSION   3
+#define AST_CACHE_EXTENSION ".myast"
+
+#define FLAT_NO_STRING      UINT32_MAX
+
+typedef struct {
+    u32 magic;
+    u32 version;
+
+    // the cache is only valid for this exact source, by its SHA-256
+    u8 source_digest[SHA256_DIGEST_SIZE];
+    u64 source_len;
+
+    u32 total_size;
+
+    u32 decl_count;
+    u32 decls;
+
+    u32 string_count;
+    u32 strings;
+    u32 _padding;
+} AstCacheHeader;
+
+typedef struct {
+    u32 offset; // from the start of the file
+    u32 len;
+    u64 hash;
+} FlatString;
+
+/*
+*
+*   one record for every AstKind, what a, b, c, list and entries
+*   hold depends on the kind, see serialize.c
+*
+*/
+typedef struct {
+    u16 kind;   // AstKind
+    u16 op;     // TokenKind of operators and literals, mutability of vars
+    u32 name;
+    u32 extra;
+
+    i32 type;
+    i32 a;
+    i32 b;
+    i32 c;
+    i32 list;
+    i32 entries;
+    u32 _padding;
+} FlatNode;
+
+typedef struct {
+    u8 kind;    // TypeKind
+    u8 is_mutable;
+    u8 is_ref;
+    u8 _padding;
+
+    u32 name;
+    i32 inner;  // pointee or element type
+    i32 size_expr;
+} FlatType;
+
+typedef struct {
+    u32 count;
+    i32 items[];
+} FlatList;
+
+/*
+*
+*   named members: path segments, struct fields, enum variants,
+*   parameters and match arms
+*
+*/
+typedef struct {
+    u32 name;
+    i32 type;
+    i32 node;
+    i32 list;
+} FlatEntry;
+
+typedef struct {
+    u32 count;
+    u32 _padding;
+    FlatEntry items[];
+} FlatEntryList;
+
+/*
+*
+*   a loaded cache file, base is the read only mapping or, for a view
+*   opened over memory, bytes that belong to someone else
+*
+*/
+typedef struct {
+    const u8* base;
+    usize size;
+
+    const AstCacheHeader* header;
+    const FlatString* strings;
+
+    b8 mapped;
+    u8 _padding[7];
+} AstCacheView;
+
+/*
+*
+*   serialized bytes ready to be written out
+*
+*/
+typedef struct {
+    u8* data;
+    usize len;
+} AstCacheBlob;
+
+#endif // !MYTHRIL_SERIALIZE_TYPES_H
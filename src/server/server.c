@@ -0,0 +1,472 @@
+// SO_PEERCRED, accept4() and MSG_CMSG_CLOEXEC
+#define _GNU_SOURCE
+
+#include "server.h"
+#include "types.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(i32 signal_number);
+static i32 bind_socket(const char* path);
+static b8 serve_client(i32 client, i32 home, ServerHandler handler, void* user);
+static i32 receive_request(i32 client, ServerRequest* request, i32* fds, char** args);
+static i32 send_request(i32 server, i32 argc, char** argv, i32 cwd);
+static i32 recv_all(i32 fd, void* data, usize len);
+static i32 send_all(i32 fd, const void* data, usize len);
+
+i32 server_socket_path(char* out, usize size, const char* requested) {
+    i32 len;
+
+    if (requested && requested[0] != 0) {
+        len = snprintf(out, size, "%s", requested);
+    } else if (getenv("XDG_RUNTIME_DIR")) {
+        len = snprintf(out, size, "%s/%s", getenv("XDG_RUNTIME_DIR"), SERVER_SOCKET_NAME);
+    } else {
+        len = snprintf(out, size, "/tmp/mythril-%u.sock", (u32) getuid());
+    }
+
+    // sun_path is the tighter limit, the socket has to fit there too
+    if (len < 0 || (usize) len >= size || (usize) len >= sizeof(((struct sockaddr_un*) 0) -> sun_path)) {
+        fprintf(stderr, "Error: Socket path is too long\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+i32 run_server(const char* path, ServerHandler handler, void* user) {
+    const i32 listener = bind_socket(path);
+
+    if (listener == -1) {
+        return -1;
+    }
+
+    // requests resolve their paths against the client, not the server
+    const i32 home = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (home == -1) {
+        fprintf(stderr, "Error: Failed to open the working directory\n");
+        close(listener);
+        unlink(path);
+        return -1;
+    }
+
+    // no SA_RESTART, accept() has to come back when asked to stop
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    // a client that goes away mid request must not take the server with it
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "mythril: serving on %s\n", path);
+
+    u32 served = 0;
+
+    // stdio, the working directory and the warm state belong to the whole
+    // process, so one request runs at a time and the rest wait in the backlog
+    while (!stop_requested) {
+        const i32 client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (client == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            fprintf(stderr, "Error: Failed to accept a client: %s\n", strerror(errno));
+            break;
+        }
+
+        served += serve_client(client, home, handler, user);
+        close(client);
+    }
+
+    fprintf(stderr, "mythril: served %u requests\n", served);
+
+    close(home);
+    close(listener);
+    unlink(path);
+
+    return 0;
+}
+
+static void request_stop(i32 signal_number) {
+    (void) signal_number;
+
+    stop_requested = 1;
+}
+
+static i32 bind_socket(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strcpy(address.sun_path, path);
+
+    const i32 listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (listener == -1) {
+        fprintf(stderr, "Error: Failed to create a socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // the socket is only ever the users own
+    const mode_t mask = umask(0077);
+    i32 bound = bind(listener, (struct sockaddr*) &address, sizeof(address));
+
+    if (bound == -1 && errno == EADDRINUSE) {
+        // left behind by a server that died if nobody answers on it
+        const i32 probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const b8 live = probe != -1 && connect(probe, (struct sockaddr*) &address, sizeof(address)) == 0;
+
+        if (probe != -1) {
+            close(probe);
+        }
+
+        if (!live) {
+            unlink(path);
+            bound = bind(listener, (struct sockaddr*) &address, sizeof(address));
+        } else {
+            errno = EADDRINUSE;
+        }
+    }
+
+    umask(mask);
+
+    if (bound == -1 || listen(listener, SERVER_BACKLOG) == -1) {
+        fprintf(stderr, "Error: Failed to listen on '%s': %s\n", path, strerror(errno));
+        close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+/*
+*
+*   the handler runs with the descriptors of the client as 0, 1 and 2
+*   and in its working directory, everything it writes goes straight
+*   to the client. The servers own are put back before the reply.
+*   Returns false if the request never reached the handler
+*
+*/
+static b8 serve_client(i32 client, i32 home, ServerHandler handler, void* user) {
+    struct ucred peer;
+    socklen_t peer_len = sizeof(peer);
+
+    if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) == -1 || peer.uid != getuid()) {
+        return false;
+    }
+
+    const struct timeval timeout = { .tv_sec = SERVER_REQUEST_TIMEOUT, .tv_usec = 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    ServerRequest request;
+    i32 fds[SERVER_FD_COUNT];
+    char* args = nullptr;
+
+    if (receive_request(client, &request, fds, &args) == -1) {
+        free(args);
+        return false;
+    }
+
+    // the request owns every argument, argv itself is NULL terminated like the one main() gets
+    char** argv = malloc((request.argc + 1) * sizeof(char*));
+    char* cursor = args;
+
+    for (u32 i = 0; i < request.argc; i++) {
+        argv[i] = cursor;
+        cursor += strlen(cursor) + 1;
+    }
+
+    argv[request.argc] = nullptr;
+
+    i32 saved[3];
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i32 i = 0; i < 3; i++) {
+        saved[i] = dup(i);
+        dup2(fds[i + 1], i);
+    }
+
+    i32 exit_code = 1;
+
+    if (fchdir(fds[0]) == 0) {
+        exit_code = handler((i32) request.argc, argv, user);
+    } else {
+        fprintf(stderr, "Error: Failed to enter the working directory of the client\n");
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    fchdir(home);
+
+    for (i32 i = 0; i < 3; i++) {
+        dup2(saved[i], i);
+        close(saved[i]);
+    }
+
+    for (u32 i = 0; i < SERVER_FD_COUNT; i++) {
+        close(fds[i]);
+    }
+
+    free(argv);
+    free(args);
+
+    const ServerReply reply = {
+        .magic = SERVER_MAGIC,
+        .exit_code = exit_code
+    };
+
+    send_all(client, &reply, sizeof(reply));
+
+    return true;
+}
+
+static i32 receive_request(i32 client, ServerRequest* request, i32* fds, char** args) {
+    union {
+        struct cmsghdr header;
+        u8 bytes[CMSG_SPACE(SERVER_FD_COUNT * sizeof(i32))];
+    } control;
+
+    struct iovec io = {
+        .iov_base = request,
+        .iov_len = sizeof(*request)
+    };
+
+    struct msghdr message = {
+        .msg_iov = &io,
+        .msg_iovlen = 1,
+        .msg_control = control.bytes,
+        .msg_controllen = sizeof(control.bytes)
+    };
+
+    ssize got;
+
+    do {
+        got = recvmsg(client, &message, MSG_CMSG_CLOEXEC);
+    } while (got == -1 && errno == EINTR);
+
+    struct cmsghdr* cmsg = got > 0 ? CMSG_FIRSTHDR(&message) : nullptr;
+
+    if (
+        !cmsg                                                       ||
+        cmsg -> cmsg_level != SOL_SOCKET                            ||
+        cmsg -> cmsg_type != SCM_RIGHTS                             ||
+        cmsg -> cmsg_len != CMSG_LEN(SERVER_FD_COUNT * sizeof(i32))
+    ) {
+        // whatever descriptors did arrive are closed with the connection
+        if (cmsg && cmsg -> cmsg_type == SCM_RIGHTS) {
+            const usize count = (cmsg -> cmsg_len - CMSG_LEN(0)) / sizeof(i32);
+
+            for (usize i = 0; i < count; i++) {
+                close(((i32*) CMSG_DATA(cmsg))[i]);
+            }
+        }
+
+        return -1;
+    }
+
+    memcpy(fds, CMSG_DATA(cmsg), SERVER_FD_COUNT * sizeof(i32));
+
+    // the header may have come in pieces, the descriptors always come with the first
+    const b8 valid = recv_all(client, (u8*) request + got, sizeof(*request) - (usize) got) == 0
+        && request -> magic == SERVER_MAGIC
+        && request -> argc > 0
+        && request -> size > 0
+        && request -> size <= SERVER_MAX_REQUEST;
+
+    if (valid) {
+        *args = malloc(request -> size);
+    }
+
+    if (!valid || !*args || recv_all(client, *args, request -> size) == -1 || (*args)[request -> size - 1] != 0) {
+        for (u32 i = 0; i < SERVER_FD_COUNT; i++) {
+            close(fds[i]);
+        }
+
+        return -1;
+    }
+
+    u32 count = 0;
+
+    for (u32 i = 0; i < request -> size; i++) {
+        count += (*args)[i] == 0;
+    }
+
+    if (count != request -> argc) {
+        for (u32 i = 0; i < SERVER_FD_COUNT; i++) {
+            close(fds[i]);
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+i32 forward_to_server(const char* path, i32 argc, char** argv, i32* exit_code) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strcpy(address.sun_path, path);
+
+    const i32 server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (server == -1) {
+        return -1;
+    }
+
+    if (connect(server, (struct sockaddr*) &address, sizeof(address)) == -1) {
+        close(server);
+        return -1;
+    }
+
+    const i32 cwd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (cwd == -1) {
+        close(server);
+        return -1;
+    }
+
+    // nothing of this run was sent yet, a refused request can still be compiled here
+    const i32 sent = send_request(server, argc, argv, cwd);
+    close(cwd);
+
+    if (sent == -1) {
+        close(server);
+        return -1;
+    }
+
+    ServerReply reply;
+
+    // output may be out already, compiling again would repeat it
+    if (recv_all(server, &reply, sizeof(reply)) == -1 || reply.magic != SERVER_MAGIC) {
+        fprintf(stderr, "Error: Lost the connection to the compile server\n");
+        reply.exit_code = 1;
+    }
+
+    close(server);
+
+    *exit_code = reply.exit_code;
+
+    return 0;
+}
+
+static i32 send_request(i32 server, i32 argc, char** argv, i32 cwd) {
+    usize size = 0;
+
+    for (i32 i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+
+    if (size > SERVER_MAX_REQUEST) {
+        return -1;
+    }
+
+    ServerRequest request = {
+        .magic = SERVER_MAGIC,
+        .argc = (u32) argc,
+        .size = (u32) size,
+        ._padding = 0
+    };
+
+    const i32 fds[SERVER_FD_COUNT] = { cwd, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+
+    union {
+        struct cmsghdr header;
+        u8 bytes[CMSG_SPACE(SERVER_FD_COUNT * sizeof(i32))];
+    } control;
+
+    memset(&control, 0, sizeof(control));
+
+    struct iovec io = {
+        .iov_base = &request,
+        .iov_len = sizeof(request)
+    };
+
+    struct msghdr message = {
+        .msg_iov = &io,
+        .msg_iovlen = 1,
+        .msg_control = control.bytes,
+        .msg_controllen = sizeof(control.bytes)
+    };
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg -> cmsg_level = SOL_SOCKET;
+    cmsg -> cmsg_type = SCM_RIGHTS;
+    cmsg -> cmsg_len = CMSG_LEN(SERVER_FD_COUNT * sizeof(i32));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize sent;
+
+    do {
+        sent = sendmsg(server, &message, MSG_NOSIGNAL);
+    } while (sent == -1 && errno == EINTR);
+
+    if (sent <= 0 || send_all(server, (u8*) &request + sent, sizeof(request) - (usize) sent) == -1) {
+        return -1;
+    }
+
+    for (i32 i = 0; i < argc; i++) {
+        if (send_all(server, argv[i], strlen(argv[i]) + 1) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static i32 recv_all(i32 fd, void* data, usize len) {
+    u8* cursor = data;
+
+    while (len > 0) {
+        const ssize got = recv(fd, cursor, len, 0);
+
+        if (got == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (got <= 0) {
+            return -1;
+        }
+
+        cursor += got;
+        len -= (usize) got;
+    }
+
+    return 0;
+}
+
+static i32 send_all(i32 fd, const void* data, usize len) {
+    const u8* cursor = data;
+
+    while (len > 0) {
+        const ssize sent = send(fd, cursor, len, MSG_NOSIGNAL);
+
+        if (sent == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (sent <= 0) {
+            return -1;
+        }
+
+        cursor += sent;
+        len -= (usize) sent;
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef MYTHRIL_SERVER_H
+#define MYTHRIL_SERVER_H
+
+#include "types.h"
+
+#include "../serialize/types.h"
+
+/*
+*
+*   requested as is when there is one, otherwise SERVER_SOCKET_NAME in
+*   $XDG_RUNTIME_DIR or a per user name in /tmp. Returns -1 if the path
+*   does not fit
+*
+*/
+i32 server_socket_path(char* out, usize size, const char* requested);
+
+/*
+*
+*   listens on path and serves one request at a time until SIGINT or
+*   SIGTERM. Only the user running the server may connect. A stale
+*   socket left by a server that died is replaced, a live one is not
+*
+*   Requests never overlap, the handler takes over stdio and the working
+*   directory of the process. A client waits for every request queued
+*   ahead of it, up to SERVER_BACKLOG, and one that connects and stalls
+*   holds the others up for SERVER_REQUEST_TIMEOUT at most
+*
+*/
+i32 run_server(const char* path, ServerHandler handler, void* user);
+
+/*
+*
+*   sends argv to the server on path and waits for its exit code.
+*   Returns -1 without side effects if no server listens there, the
+*   caller compiles on its own then
+*
+*/
+i32 forward_to_server(const char* path, i32 argc, char** argv, i32* exit_code);
+
+void init_warm_state(WarmState* warm, usize memo_limit);
+void free_warm_state(WarmState* warm);
+
+// an arena with blocks left from an earlier request, false if none is left
+b8 take_warm_arena(WarmState* warm, ArenaAllocator* out);
+
+// resets the arena and keeps its blocks for the next request, or frees them
+void keep_warm_arena(WarmState* warm, ArenaAllocator* arena);
+
+/*
+*
+*   the serialized AST of a source with this digest and length, nullptr if
+*   there is none. The bytes stay valid until the next memo_trim()
+*
+*/
+const MemoEntry* memo_find(AstMemo* memo, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len);
+
+// keeps a copy of blob, a source that is in already is left alone
+void memo_store(AstMemo* memo, const AstCacheBlob* blob, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len);
+
+// ends a request, evicts the least recently used entries over the limit
+void memo_trim(AstMemo* memo);
+
+#endif // !MYTHRIL_SERVER_H
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef MYTHRIL_SERVER_TYPES_H
+#define MYTHRIL_SERVER_TYPES_H
+
+#include "../arena/arena.h"
+#include "../hash/types.h"
+#include "../utils/types.h"
+
+// set to a socket path, or empty for the default one, and a run hands its arguments to the server there
+#define SERVER_ENV              "MYTHRIL_SERVER"
+#define SERVER_SOCKET_NAME      "mythril.sock"
+
+#define SERVER_MAGIC            0x5652534d /* "MSRV" */
+#define SERVER_BACKLOG          64
+
+// every argument of a request together, NULs included
+#define SERVER_MAX_REQUEST      (1024 * 1024)
+
+// a client that connects and then says nothing holds the server up no longer than this
+#define SERVER_REQUEST_TIMEOUT  5 /* seconds */
+
+// the working directory, stdin, stdout and stderr of the client
+#define SERVER_FD_COUNT         4
+
+// unit arenas kept between requests, reset but with their blocks
+#define SERVER_WARM_ARENAS      256
+
+// a warm arena larger than this is freed, the first unit of a parallel
+// parse takes the worker arenas and would grow with every request
+#define SERVER_WARM_ARENA_LIMIT (64 * 1024 * 1024)
+
+// serialized ASTs kept in memory, the least recently used go first
+#define SERVER_MEMO_LIMIT       (256 * 1024 * 1024)
+#define SERVER_MEMO_INIT_CAPACITY 1024
+
+/*
+*
+*   Protocol
+*
+*   The client connects and sends a ServerRequest followed by size bytes
+*   of arguments, each ending in a NUL. The descriptors of its working
+*   directory and stdio ride along with the header as SCM_RIGHTS, the
+*   server compiles with them in place of its own and answers with a
+*   ServerReply once every byte of output is written
+*
+*/
+typedef struct {
+    u32 magic;
+    u32 argc;
+    u32 size;
+    u32 _padding;
+} ServerRequest;
+
+typedef struct {
+    u32 magic;
+    i32 exit_code;
+} ServerReply;
+
+// compiles one request, argv is gone after it returns
+typedef i32 (*ServerHandler)(i32 argc, char** argv, void* user);
+
+/*
+*
+*   serialized ASTs by the SHA-256 and length of their source, open
+*   addressing with linear probing. data is nullptr in an empty slot
+*
+*/
+typedef struct {
+    u8 source_digest[SHA256_DIGEST_SIZE];
+    u64 source_len;
+
+    u8* data;
+    usize size;
+
+    // the request that used it last
+    u64 used;
+} MemoEntry;
+
+typedef struct {
+    MemoEntry* entries;
+    u32 capacity;   // a power of two
+    u32 count;
+
+    usize bytes;
+    usize limit;
+
+    // requests served so far
+    u64 clock;
+} AstMemo;
+
+/*
+*
+*   what a server keeps from one request to the next
+*
+*/
+typedef struct {
+    AstMemo memo;
+
+    ArenaAllocator arenas[SERVER_WARM_ARENAS];
+    u32 arena_count;
+    u8 _padding[4];
+} WarmState;
+
+#endif // !MYTHRIL_SERVER_TYPES_H
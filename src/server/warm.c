@@ -0,0 +1,209 @@
+#include "server.h"
+#include "types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static u32 memo_slot(const u8 source_digest[SHA256_DIGEST_SIZE]);
+static void memo_insert(AstMemo* memo, MemoEntry entry);
+static i32 memo_rebuild(AstMemo* memo, u32 capacity);
+
+void init_warm_state(WarmState* warm, usize memo_limit) {
+    memset(warm, 0, sizeof(*warm));
+
+    warm -> memo = (AstMemo) {
+        .entries = calloc(SERVER_MEMO_INIT_CAPACITY, sizeof(MemoEntry)),
+        .capacity = SERVER_MEMO_INIT_CAPACITY,
+        .count = 0,
+        .bytes = 0,
+        .limit = memo_limit,
+        .clock = 0
+    };
+}
+
+void free_warm_state(WarmState* warm) {
+    for (u32 i = 0; i < warm -> arena_count; i++) {
+        arena_free(&warm -> arenas[i]);
+    }
+
+    for (u32 i = 0; i < warm -> memo.capacity; i++) {
+        free(warm -> memo.entries[i].data);
+    }
+
+    free(warm -> memo.entries);
+
+    warm -> arena_count = 0;
+    warm -> memo.entries = nullptr;
+    warm -> memo.capacity = 0;
+}
+
+b8 take_warm_arena(WarmState* warm, ArenaAllocator* out) {
+    if (warm -> arena_count == 0) {
+        return false;
+    }
+
+    *out = warm -> arenas[--warm -> arena_count];
+
+    return true;
+}
+
+void keep_warm_arena(WarmState* warm, ArenaAllocator* arena) {
+    if (warm -> arena_count == SERVER_WARM_ARENAS || total_capacity(arena) > SERVER_WARM_ARENA_LIMIT) {
+        arena_free(arena);
+        return;
+    }
+
+    arena_reset(arena);
+    warm -> arenas[warm -> arena_count++] = *arena;
+
+    arena -> start = nullptr;
+    arena -> end = nullptr;
+}
+
+const MemoEntry* memo_find(AstMemo* memo, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len) {
+    const u32 mask = memo -> capacity - 1;
+
+    for (u32 i = memo_slot(source_digest) & mask; memo -> entries[i].data; i = (i + 1) & mask) {
+        MemoEntry* entry = &memo -> entries[i];
+
+        if (entry -> source_len == source_len && memcmp(entry -> source_digest, source_digest, SHA256_DIGEST_SIZE) == 0) {
+            entry -> used = memo -> clock;
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+void memo_store(AstMemo* memo, const AstCacheBlob* blob, const u8 source_digest[SHA256_DIGEST_SIZE], u64 source_len) {
+    if (memo_find(memo, source_digest, source_len)) {
+        return;
+    }
+
+    // at most half full, every probe ends at an empty slot soon
+    if ((memo -> count + 1) * 2 > memo -> capacity && memo_rebuild(memo, memo -> capacity * 2) == -1) {
+        return;
+    }
+
+    u8* data = malloc(blob -> len);
+
+    if (!data) {
+        return;
+    }
+
+    memcpy(data, blob -> data, blob -> len);
+
+    MemoEntry entry = {
+        .source_len = source_len,
+        .data = data,
+        .size = blob -> len,
+        .used = memo -> clock
+    };
+
+    memcpy(entry.source_digest, source_digest, SHA256_DIGEST_SIZE);
+    memo_insert(memo, entry);
+
+    memo -> count++;
+    memo -> bytes += blob -> len;
+}
+
+static i32 compare_used(const void* a, const void* b) {
+    const u64 x = ((const MemoEntry*) a) -> used;
+    const u64 y = ((const MemoEntry*) b) -> used;
+
+    // most recently used first
+    return (x < y) - (x > y);
+}
+
+/*
+*
+*   entries are only ever dropped here, between requests, so no probe
+*   sequence has to survive a removal. The survivors are put into a
+*   fresh table instead
+*
+*/
+void memo_trim(AstMemo* memo) {
+    memo -> clock++;
+
+    if (memo -> bytes <= memo -> limit) {
+        return;
+    }
+
+    MemoEntry* live = malloc(memo -> count * sizeof(MemoEntry));
+
+    if (!live) {
+        return;
+    }
+
+    u32 live_count = 0;
+
+    for (u32 i = 0; i < memo -> capacity; i++) {
+        if (memo -> entries[i].data) {
+            live[live_count++] = memo -> entries[i];
+        }
+    }
+
+    qsort(live, live_count, sizeof(MemoEntry), compare_used);
+
+    memset(memo -> entries, 0, memo -> capacity * sizeof(MemoEntry));
+    memo -> count = 0;
+    memo -> bytes = 0;
+
+    for (u32 i = 0; i < live_count; i++) {
+        if (memo -> bytes + live[i].size > memo -> limit) {
+            free(live[i].data);
+            continue;
+        }
+
+        memo_insert(memo, live[i]);
+
+        memo -> count++;
+        memo -> bytes += live[i].size;
+    }
+
+    free(live);
+}
+
+// the digest is uniform already, its first bytes make a good slot
+static u32 memo_slot(const u8 source_digest[SHA256_DIGEST_SIZE]) {
+    u32 slot;
+    memcpy(&slot, source_digest, sizeof(slot));
+
+    return slot;
+}
+
+static void memo_insert(AstMemo* memo, MemoEntry entry) {
+    const u32 mask = memo -> capacity - 1;
+
+    u32 i = memo_slot(entry.source_digest) & mask;
+
+    while (memo -> entries[i].data) {
+        i = (i + 1) & mask;
+    }
+
+    memo -> entries[i] = entry;
+}
+
+static i32 memo_rebuild(AstMemo* memo, u32 capacity) {
+    MemoEntry* entries = calloc(capacity, sizeof(MemoEntry));
+
+    if (!entries) {
+        return -1;
+    }
+
+    MemoEntry* old = memo -> entries;
+    const u32 old_capacity = memo -> capacity;
+
+    memo -> entries = entries;
+    memo -> capacity = capacity;
+
+    for (u32 i = 0; i < old_capacity; i++) {
+        if (old[i].data) {
+            memo_insert(memo, old[i]);
+        }
+    }
+
+    free(old);
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "timing.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static const char* PHASE_NAMES[] = {
+    "load",
+    "lex",
+    "parse",
+    "emit"
+};
+
+static const char* PHASE_ITEMS[] = {
+    nullptr,
+    "tokens",
+    "nodes",
+    nullptr
+};
+
+static f64 clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+
+    return (f64) ts.tv_sec + (f64) ts.tv_nsec * 1e-9;
+}
+
+void init_time_report(TimeReport* report, b8 enabled) {
+    *report = (TimeReport) {0};
+    report -> enabled = enabled;
+}
+
+void phase_begin(TimeReport* report, Phase phase) {
+    if (!report -> enabled) {
+        return;
+    }
+
+    PhaseTime* time = &report -> phases[phase];
+
+    time -> wall_start = clock_seconds(CLOCK_MONOTONIC);
+    time -> cpu_start = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void phase_end(TimeReport* report, Phase phase) {
+    if (!report -> enabled) {
+        return;
+    }
+
+    PhaseTime* time = &report -> phases[phase];
+
+    time -> cpu += clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - time -> cpu_start;
+    time -> wall += clock_seconds(CLOCK_MONOTONIC) - time -> wall_start;
+    time -> runs++;
+}
+
+void phase_account(TimeReport* report, Phase phase, usize bytes, usize items, usize arena_bytes) {
+    if (!report -> enabled) {
+        return;
+    }
+
+    PhaseTime* time = &report -> phases[phase];
+
+    time -> bytes += bytes;
+    time -> items += items;
+    time -> arena_bytes += arena_bytes;
+}
+
+// per second of wall time, a phase too quick for the clock has no rate
+static f64 per_second(usize amount, f64 wall) {
+    return wall > 0.0 ? (f64) amount / wall : 0.0;
+}
+
+void print_time_report(const TimeReport* report) {
+    if (!report -> enabled) {
+        return;
+    }
+
+    fprintf(stderr, "\ntime report\n");
+    fprintf(stderr, "  %-8s %10s %10s %12s %12s  %s\n", "phase", "wall ms", "cpu ms", "bytes", "arena", "throughput");
+
+    f64 wall = 0.0;
+    f64 cpu = 0.0;
+    usize arena_bytes = 0;
+
+    for (u32 i = 0; i < PHASE_COUNT; i++) {
+        const PhaseTime* time = &report -> phases[i];
+
+        if (time -> runs == 0) {
+            continue;
+        }
+
+        wall += time -> wall;
+        cpu += time -> cpu;
+        arena_bytes += time -> arena_bytes;
+
+        fprintf(
+            stderr,
+            "  %-8s %10.3f %10.3f %12zu %12zu ",
+            PHASE_NAMES[i],
+            time -> wall * 1e3,
+            time -> cpu * 1e3,
+            time -> bytes,
+            time -> arena_bytes
+        );
+
+        if (time -> bytes > 0) {
+            fprintf(stderr, " %.1f MB/s", per_second(time -> bytes, time -> wall) * 1e-6);
+        }
+
+        if (PHASE_ITEMS[i]) {
+            fprintf(
+                stderr,
+                " %.2f M %s/s (%zu)",
+                per_second(time -> items, time -> wall) * 1e-6,
+                PHASE_ITEMS[i],
+                time -> items
+            );
+        }
+
+        fprintf(stderr, "\n");
+    }
+
+    fprintf(stderr, "  %-8s %10.3f %10.3f %12s %12zu\n", "total", wall * 1e3, cpu * 1e3, "", arena_bytes);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef MYTHRIL_TIMING_H
+#define MYTHRIL_TIMING_H
+
+#include "types.h"
+
+void init_time_report(TimeReport* report, b8 enabled);
+
+void phase_begin(TimeReport* report, Phase phase);
+void phase_end(TimeReport* report, Phase phase);
+
+// bytes, items and arena bytes are added to what the phase already has
+void phase_account(TimeReport* report, Phase phase, usize bytes, usize items, usize arena_bytes);
+
+// one line per phase that ran and a total, to stderr
+void print_time_report(const TimeReport* report);
+
+#endif // !MYTHRIL_TIMING_H
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef MYTHRIL_TIMING_TYPES_H
+#define MYTHRIL_TIMING_TYPES_H
+
+#include "../utils/types.h"
+
+#define X_PHASES(X) \
+    X(PHASE_LOAD)   \
+    X(PHASE_LEX)    \
+    X(PHASE_PARSE)  \
+    X(PHASE_EMIT)
+
+typedef enum {
+    X_PHASES(GENERATE_ENUM)
+    PHASE_COUNT
+} Phase;
+
+/*
+*
+*   what one phase cost, summed over every time it ran. cpu is the whole
+*   process, so a phase running on several threads takes more cpu than
+*   wall time. items are tokens for the lexer and nodes for the parser
+*
+*/
+typedef struct {
+    f64 wall;
+    f64 cpu;
+
+    f64 wall_start;
+    f64 cpu_start;
+
+    usize bytes;
+    usize items;
+    usize arena_bytes;
+
+    u32 runs;
+    u8 _padding[4];
+} PhaseTime;
+
+// everything stays zero and no clock is read unless enabled
+typedef struct {
+    PhaseTime phases[PHASE_COUNT];
+
+    b8 enabled;
+    u8 _padding[7];
+} TimeReport;
+
+#endif // !MYTHRIL_TIMING_TYPES_H
@@ -1,18 +1,92 @@
 #include "tokens.h"
 #include "types.h"
 
-#include <stdio.h>
+#include "../writer/writer.h"
 
-void print_tokens(Tokens tokens) {
-    for (usize i = 0; i < tokens.count; i++) {
-        Token token = tokens.items[i];
+void print_tokens(Writer* w, Tokens* tokens) {
+    for (usize i = 0; i < tokens -> count; i++) {
+        Token* token = &tokens -> items[i];
 
-        const char* lexeme = token.kind == TOK_EOF ? "EOF" : token.lexeme;
-        const i32 length = token.kind == TOK_EOF ? 3 : token.length;
+        const char* lexeme = token -> kind == TOK_EOF ? "EOF" : token -> lexeme;
+        const u32 length = token -> kind == TOK_EOF ? 3 : token -> length;
 
-        printf("Token %zu:\n", i);
-        printf("  Kind: %s\n", TOKEN_KIND_STRINGS[token.kind]);
-        printf("  Lexeme: \"%.*s\"\n", (i32) length, lexeme);
-        printf("  Length: %u\n\n", token.length);
+        writer_str(w, "Token ");
+        writer_u64(w, i);
+        writer_str(w, ":\n  Kind: ");
+        writer_str(w, TOKEN_KIND_STRINGS[token -> kind]);
+        writer_str(w, "\n  Lexeme: \"");
+        writer_write(w, lexeme, lexeme ? length : 0);
+        writer_str(w, "\"\n  Length: ");
+        writer_u64(w, token -> length);
+        writer_str(w, "\n\n");
+    }
+}
+
+void reserve_token_tables(Tokens* tokens, ArenaAllocator* arena) {
+    if (tokens -> tables_capacity >= tokens -> capacity) {
+        return;
+    }
+
+    if (tokens -> tables_capacity == 0) {
+        tokens -> matches = arena_array(arena, u32, tokens -> capacity);
+        tokens -> kinds = arena_array(arena, u8, tokens -> capacity);
+    } else {
+        tokens -> matches = arena_realloc(
+            arena,
+            tokens -> matches,
+            tokens -> tables_capacity * sizeof(u32),
+            tokens -> capacity * sizeof(u32)
+        );
+
+        tokens -> kinds = arena_realloc(
+            arena,
+            tokens -> kinds,
+            tokens -> tables_capacity * sizeof(u8),
+            tokens -> capacity * sizeof(u8)
+        );
+    }
+
+    tokens -> tables_capacity = tokens -> capacity;
+}
+
+void push_end_of_program(Tokens* tokens, ArenaAllocator* arena) {
+    tokens -> count++;
+
+    pad_end_of_program(tokens, arena);
+}
+
+void pad_end_of_program(Tokens* tokens, ArenaAllocator* arena) {
+    const usize first = tokens -> count - 1;
+    const usize end = tokens -> count + TOKEN_SENTINEL_PADDING;
+
+    if (end > tokens -> capacity) {
+        usize capacity = tokens -> capacity;
+
+        while (capacity < end) {
+            capacity *= 2;
+        }
+
+        tokens -> items = arena_realloc(
+            arena,
+            tokens -> items,
+            tokens -> capacity * sizeof(Token),
+            capacity * sizeof(Token)
+        );
+
+        tokens -> capacity = capacity;
+    }
+
+    reserve_token_tables(tokens, arena);
+
+    for (usize i = first; i < end; i++) {
+        tokens -> items[i] = (Token) {
+            .kind = TOK_EOP,
+            .file = tokens -> file,
+            .lexeme = nullptr,
+            .length = 0
+        };
+
+        tokens -> matches[i] = TOKEN_UNMATCHED;
+        tokens -> kinds[i] = TOK_EOP;
     }
 }
@@ -4,8 +4,37 @@
 
 #include "types.h"
 
+#include "../arena/arena.h"
+#include "../writer/types.h"
+
 #define IS_PRIMITIVE_TYPE(x) ((x) >= TOK_UINT_8 && (x) <= TOK_BOOL)
 
-void print_tokens(Tokens tokens);
+void print_tokens(Writer* w, Tokens* tokens);
+
+/*
+*
+*   grows matches and kinds to the capacity of items, entries already
+*   written are kept
+*
+*/
+void reserve_token_tables(Tokens* tokens, ArenaAllocator* arena);
+
+/*
+*
+*   appends the TOK_EOP closing the token stream, matches and kinds
+*   included, and pads it with sentinels, see pad_end_of_program()
+*
+*/
+void push_end_of_program(Tokens* tokens, ArenaAllocator* arena);
+
+/*
+*
+*   the last counted token is TOK_EOP, fills the TOKEN_SENTINEL_PADDING
+*   slots after it with TOK_EOP as well so a cursor that ends up a few
+*   tokens past the end reads TOK_EOP without checking bounds. Needed
+*   again whenever count changes
+*
+*/
+void pad_end_of_program(Tokens* tokens, ArenaAllocator* arena);
 
 #endif // !MYTHRIL_TOKENS_H
@@ -129,13 +129,35 @@ static const char* TOKEN_KIND_STRINGS[] = {
 typedef struct {
     const char* lexeme;
     u32 length;
-    TokenKind kind;
+    TokenKind kind : 16;
+    u16 file; // id of the CompilationUnit that lexed it
 } Token;
 
+#define TOKEN_UNMATCHED UINT32_MAX
+
+// TOK_EOP sentinels that follow the end of every token stream, see
+// push_end_of_program()
+#define TOKEN_SENTINEL_PADDING 8
+
 typedef struct {
     Token* items;
     usize count;
     usize capacity;
+
+    // filled by the lexer, for ( ) [ ] { } the index of the matching
+    // bracket, TOKEN_UNMATCHED for every other or unbalanced token
+    u32* matches;
+
+    // filled by the lexer, items[i].kind packed into a byte so scans over
+    // the kinds alone touch a sixteenth of the memory
+    u8* kinds;
+
+    // capacity of both matches and kinds, see reserve_token_tables()
+    usize tables_capacity;
+
+    // stamped into Token.file of every token by the lexer
+    u16 file;
+    u8 _padding[6];
 } Tokens;
 
 #endif // !MYTHRIL_TOKENS_TYPES_H
@@ -0,0 +1,108 @@
+#include "trace.h"
+#include "types.h"
+
+#include "../writer/writer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void init_trace(Trace* trace, ArenaAllocator* arena, usize capacity) {
+    trace -> events = arena_array(arena, TraceEvent, capacity);
+    trace -> capacity = capacity;
+    trace -> count = 0;
+    trace -> origin = trace_clock();
+}
+
+void trace_span(Trace* trace, const char* name, const char* file, u32 thread, u64 start) {
+    if (!trace) {
+        return;
+    }
+
+    const u64 end = trace_clock();
+    const usize slot = __atomic_fetch_add(&trace -> count, 1, __ATOMIC_RELAXED);
+
+    if (slot >= trace -> capacity) {
+        return;
+    }
+
+    trace -> events[slot] = (TraceEvent) {
+        .name = name,
+        .file = file,
+        .start = start - trace -> origin,
+        .duration = end - start,
+        .thread = thread
+    };
+}
+
+// trace event timestamps are microseconds, nanoseconds go after the point
+static void write_micros(Writer* w, u64 nanos) {
+    const u64 fraction = nanos % 1000;
+
+    writer_u64(w, nanos / 1000);
+    writer_char(w, '.');
+    writer_char(w, (char) ('0' + fraction / 100));
+    writer_char(w, (char) ('0' + fraction / 10 % 10));
+    writer_char(w, (char) ('0' + fraction % 10));
+}
+
+i32 write_trace(const Trace* trace, ArenaAllocator* arena, const char* path) {
+    i32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd == -1) {
+        fprintf(stderr, "Error: Failed to open trace file '%s'\n", path);
+        return -1;
+    }
+
+    const usize count = trace -> count < trace -> capacity ? trace -> count : trace -> capacity;
+
+    Writer w;
+    init_writer(&w, arena, fd, 0);
+
+    writer_str(&w, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    u32 threads = 1;
+
+    for (usize i = 0; i < count; i++) {
+        const TraceEvent* event = &trace -> events[i];
+
+        if (event -> thread >= threads) {
+            threads = event -> thread + 1;
+        }
+
+        writer_str(&w, "{\"name\":");
+        writer_json_string(&w, event -> name, strlen(event -> name));
+        writer_str(&w, ",\"cat\":\"mythril\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+        writer_u64(&w, event -> thread);
+        writer_str(&w, ",\"ts\":");
+        write_micros(&w, event -> start);
+        writer_str(&w, ",\"dur\":");
+        write_micros(&w, event -> duration);
+
+        if (event -> file) {
+            writer_str(&w, ",\"args\":{\"file\":");
+            writer_json_string(&w, event -> file, strlen(event -> file));
+            writer_char(&w, '}');
+        }
+
+        writer_str(&w, "},\n");
+    }
+
+    // thread 0 is the main thread, the others only ever parse
+    for (u32 i = 0; i < threads; i++) {
+        writer_str(&w, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        writer_u64(&w, i);
+        writer_str(&w, i == 0 ? ",\"args\":{\"name\":\"main\"}}" : ",\"args\":{\"name\":\"parse worker\"}}");
+        writer_str(&w, i + 1 < threads ? ",\n" : "\n");
+    }
+
+    writer_str(&w, "],\"otherData\":{\"dropped_events\":");
+    writer_u64(&w, trace -> count - count);
+    writer_str(&w, "}}\n");
+
+    writer_flush(&w);
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef MYTHRIL_TRACE_H
+#define MYTHRIL_TRACE_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+
+#include <time.h>
+
+static inline u64 trace_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+// start of a span, the clock is not read when tracing is off
+static inline u64 trace_start(const Trace* trace) {
+    return trace ? trace_clock() : 0;
+}
+
+void init_trace(Trace* trace, ArenaAllocator* arena, usize capacity);
+
+/*
+*
+*   records the span from start until now, does nothing for a nullptr
+*   trace. name and file are kept as pointers, they have to outlive the
+*   trace. Safe to call from several threads
+*
+*/
+void trace_span(Trace* trace, const char* name, const char* file, u32 thread, u64 start);
+
+/*
+*
+*   writes the Chrome trace event JSON to path, loadable by
+*   chrome://tracing and Perfetto
+*
+*/
+i32 write_trace(const Trace* trace, ArenaAllocator* arena, const char* path);
+
+#endif // !MYTHRIL_TRACE_H
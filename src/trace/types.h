@@ -0,0 +1,46 @@
+#pragma once
+#ifndef MYTHRIL_TRACE_TYPES_H
+#define MYTHRIL_TRACE_TYPES_H
+
+#include "../utils/types.h"
+
+// mapping, tokenizing and parsing a file, plus room to spare
+#define TRACE_EVENTS_PER_FILE 4
+
+// whole run spans and one per parse worker
+#define TRACE_EVENTS_BASE 256
+
+/*
+*
+*   one complete span, a "ph": "X" event once written. Times are
+*   nanoseconds since the trace was started, file is nullptr for spans
+*   that are not about a single file
+*
+*/
+typedef struct {
+    const char* name;
+    const char* file;
+
+    u64 start;
+    u64 duration;
+
+    u32 thread;
+    u8 _padding[4];
+} TraceEvent;
+
+/*
+*
+*   every event slot is allocated up front, recording a span is a clock
+*   read and a store. count is claimed atomically so parse workers can
+*   record too, it keeps counting past capacity to report the dropped ones
+*
+*/
+typedef struct {
+    TraceEvent* events;
+    usize capacity;
+    usize count;
+
+    u64 origin;
+} Trace;
+
+#endif // !MYTHRIL_TRACE_TYPES_H
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MYTHRIL_UNIT_TYPES_H
+#define MYTHRIL_UNIT_TYPES_H
+
+#include "../arena/arena.h"
+#include "../ast/types.h"
+#include "../files/types.h"
+#include "../tokens/types.h"
+#include "../utils/types.h"
+
+#define UNIT_ARENA_CAPACITY 65536
+
+// Token.file is 16 bits wide
+#define UNIT_MAX_COUNT UINT16_MAX
+
+/*
+*
+*   byte offset of the first character of every line, starts[0] is 0.
+*   A location is a binary search away instead of a scan from the start
+*   of the buffer
+*
+*/
+typedef struct {
+    u32* starts;
+    usize count;
+} LineTable;
+
+/*
+*
+*   everything that belongs to one source file. The id is the index in
+*   the array of units and is stamped into every token the unit lexes, so
+*   a token alone leads back to its buffer, path and lines
+*
+*/
+typedef struct {
+    u32 id;
+    u8 _padding[4];
+
+    const char* path;
+    FileBuffer buffer;
+
+    ArenaAllocator arena;
+
+    Tokens tokens;
+    LineTable lines;
+    Program program;
+} CompilationUnit;
+
+#endif // !MYTHRIL_UNIT_TYPES_H
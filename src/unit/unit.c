@@ -0,0 +1,137 @@
+#include "unit.h"
+#include "types.h"
+
+#include "../ast/ast.h"
+#include "../diagnostics/diagnostics.h"
+#include "../lexer/lexer.h"
+#include "../tokens/tokens.h"
+#include "../utils/macros.h"
+
+#include <string.h>
+
+#define UNIT_TOKENS_INIT_CAPACITY 64
+
+static void build_line_table(CompilationUnit* unit);
+
+void init_unit(CompilationUnit* unit, u32 id, const char* path, FileBuffer buffer, const ArenaAllocator* warm) {
+    unit -> id = id;
+    unit -> path = path;
+    unit -> buffer = buffer;
+
+    if (warm) {
+        unit -> arena = *warm;
+    } else {
+        init_arena(&unit -> arena, UNIT_ARENA_CAPACITY);
+    }
+
+    unit -> tokens = (Tokens) {
+        .items = arena_array(&unit -> arena, Token, UNIT_TOKENS_INIT_CAPACITY),
+        .count = 0,
+        .capacity = UNIT_TOKENS_INIT_CAPACITY,
+        .file = (u16) id
+    };
+
+    unit -> program = (Program) {
+        .declarations = nullptr,
+        .capacity = 0,
+        .count = 0
+    };
+
+    build_line_table(unit);
+}
+
+void free_unit(CompilationUnit* unit) {
+    arena_free(&unit -> arena);
+}
+
+MythrilContext unit_context(CompilationUnit* unit, DiagContext* diag_ctx) {
+    return (MythrilContext) {
+        .arena = &unit -> arena,
+        .diag_ctx = diag_ctx,
+        .tokens = &unit -> tokens,
+        .program = &unit -> program,
+        .buffer_start = unit -> buffer.ptr,
+        .buffer_end = unit -> buffer.ptr + unit -> buffer.len
+    };
+}
+
+void lex_unit(CompilationUnit* unit, DiagContext* diag_ctx) {
+    MythrilContext ctx = unit_context(unit, diag_ctx);
+
+    diag_ctx -> path = unit -> path;
+    diag_ctx -> source_buffer = unit -> buffer.ptr;
+
+    tokenize(&ctx);
+
+    push_end_of_program(&unit -> tokens, &unit -> arena);
+}
+
+void parse_unit(CompilationUnit* unit, DiagContext* diag_ctx, u32 flags) {
+    MythrilContext ctx = unit_context(unit, diag_ctx);
+
+    diag_ctx -> path = unit -> path;
+    diag_ctx -> source_buffer = unit -> buffer.ptr;
+
+    parse(&ctx, unit -> path, flags);
+}
+
+SourceLocation unit_location(const CompilationUnit* unit, const Token* token) {
+    const char* source = unit -> buffer.ptr;
+
+    if (MEOW_UNLIKELY(token -> lexeme < source || token -> lexeme >= source + unit -> buffer.len)) {
+        return source_location_from_token(unit -> path, source, (Token*) token);
+    }
+
+    const u32 offset = (u32) (token -> lexeme - source);
+    const u32* starts = unit -> lines.starts;
+
+    // last line starting at or before offset
+    usize lo = 0;
+    usize hi = unit -> lines.count;
+
+    while (hi - lo > 1) {
+        const usize mid = lo + (hi - lo) / 2;
+
+        if (starts[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (SourceLocation) {
+        .path = unit -> path,
+        .source_buffer = source,
+        .line = lo + 1,
+        .column = offset - starts[lo] + 1,
+        .pointer = token -> lexeme,
+        .length = token -> length
+    };
+}
+
+// counts the lines first so the table is allocated exactly once
+static void build_line_table(CompilationUnit* unit) {
+    const char* source = unit -> buffer.ptr;
+    const char* end = source + unit -> buffer.len;
+
+    usize count = 1;
+
+    for (const char* p = source; (p = memchr(p, '\n', end - p)); p++) {
+        count++;
+    }
+
+    // rounded up to an even count, the arena does not align what comes next
+    u32* starts = arena_array(&unit -> arena, u32, (count + 1) & ~(usize) 1);
+    starts[0] = 0;
+
+    usize line = 1;
+
+    for (const char* p = source; (p = memchr(p, '\n', end - p)); p++) {
+        starts[line++] = (u32) (p + 1 - source);
+    }
+
+    unit -> lines = (LineTable) {
+        .starts = starts,
+        .count = count
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MYTHRIL_UNIT_H
+#define MYTHRIL_UNIT_H
+
+#include "types.h"
+
+#include "../diagnostics/types.h"
+#include "../mythril/types.h"
+
+/*
+*
+*   takes over buffer, which has to end in a NUL, and builds its line
+*   table. Tokens and Program start out empty on an arena of the unit,
+*   the emptied blocks of warm when there is one
+*
+*/
+void init_unit(CompilationUnit* unit, u32 id, const char* path, FileBuffer buffer, const ArenaAllocator* warm);
+
+// the buffer stays with the caller
+void free_unit(CompilationUnit* unit);
+
+MythrilContext unit_context(CompilationUnit* unit, DiagContext* diag_ctx);
+
+// tokenizes the whole buffer and closes the stream with TOK_EOP
+void lex_unit(CompilationUnit* unit, DiagContext* diag_ctx);
+
+// flags are ParseFlags
+void parse_unit(CompilationUnit* unit, DiagContext* diag_ctx, u32 flags);
+
+/*
+*
+*   location of a token of the unit through its line table. Tokens
+*   pointing outside the buffer (TOK_EOP) fall back to a scan
+*
+*/
+SourceLocation unit_location(const CompilationUnit* unit, const Token* token);
+
+#endif // !MYTHRIL_UNIT_H
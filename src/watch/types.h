@@ -0,0 +1,84 @@
+#pragma once
+#ifndef MYTHRIL_WATCH_TYPES_H
+#define MYTHRIL_WATCH_TYPES_H
+
+#include "../arena/arena.h"
+#include "../diagnostics/types.h"
+#include "../options/types.h"
+#include "../unit/types.h"
+#include "../utils/types.h"
+
+// events this close after one another are one save, an editor writes and renames in a burst
+#define WATCH_SETTLE_MS         2
+
+// room for a few hundred events with their names
+#define WATCH_EVENT_BUFFER      (64 * 1024)
+
+#define WATCH_INIT_CAPACITY     64
+
+/*
+*
+*   what a watched file keeps between rebuilds next to its unit. The
+*   diagnostics of its last compile live on the arena of the unit and
+*   go with it when the file is compiled again
+*
+*/
+typedef struct {
+    // events name a file by its directory, as that was first watched,
+    // and its name in it. The path it was given is only shown
+    const char* dir;
+    const char* name;
+    u64 name_hash;
+
+    // of the source the unit holds, a save that changes nothing is not compiled again
+    u64 source_hash;
+    usize source_len;
+
+    DiagContext diag_ctx;
+
+    // gone once deleted or moved away, a file that comes back keeps its unit
+    b8 live;
+    b8 dirty;
+    u8 _padding[6];
+} WatchFile;
+
+// a directory with an inotify watch on it
+typedef struct {
+    i32 wd;
+
+    // new sources in it join the build, those of a directory named on the command line
+    b8 adopt;
+    u8 _padding[3];
+
+    char* path;
+} WatchDir;
+
+/*
+*
+*   units and files are parallel arrays indexed by unit id, ids are
+*   never reused so a diagnostic always leads back to its unit. paths
+*   and both arrays live on arena, sources and everything compiled from
+*   them on the arenas of the units
+*
+*/
+typedef struct {
+    const MythrilOptions* options;
+    i32 fd;
+    u32 flags; // ParseFlags
+
+    ArenaAllocator arena;
+
+    // reset every rebuild, fresh reads and the merged diagnostics
+    ArenaAllocator scratch;
+
+    CompilationUnit* units;
+    WatchFile* files;
+    u32 count;
+    u32 capacity;
+
+    WatchDir* dirs;
+    u32 dir_count;
+    u32 dir_capacity;
+} Watch;
+
+#endif // !MYTHRIL_WATCH_TYPES_H
@@ -0,0 +1,579 @@
+#include "watch.h"
+#include "types.h"
+
+#include "../ast_parser/types.h"
+#include "../diagnostics/diagnostics.h"
+#include "../diagnostics/stream/stream.h"
+#include "../files/files.h"
+#include "../hash/hash.h"
+#include "../loader/loader.h"
+#include "../options/options.h"
+#include "../trace/trace.h"
+#include "../unit/unit.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WATCH_DIR_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_ONLYDIR)
+
+static const char* watch_directory(Watch* watch, const char* path, b8 adopt);
+static void watch_tree(Watch* watch, const char* path, b8 adopt, b8 take_sources);
+static i32 add_file(Watch* watch, const char* path);
+static i32 find_file(const Watch* watch, const char* dir, const char* name);
+static void read_events(Watch* watch);
+static void handle_event(Watch* watch, const struct inotify_event* event);
+static void rebuild(Watch* watch);
+static b8 compile_file(Watch* watch, u32 index);
+static void drop_file(Watch* watch, u32 index);
+static void report(Watch* watch, u32 compiled, u32 dropped, u64 elapsed);
+static b8 is_source(const char* name);
+
+i32 run_watch(const MythrilOptions* options) {
+    Watch watch = {
+        .options = options,
+        .fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC),
+        .flags = options -> outline ? PARSE_LAZY_BODIES : PARSE_NONE,
+        .units = nullptr,
+        .files = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .dirs = nullptr,
+        .dir_count = 0,
+        .dir_capacity = 0
+    };
+
+    if (watch.fd == -1) {
+        fprintf(stderr, "Error: Failed to start watching: %s\n", strerror(errno));
+        return -1;
+    }
+
+    init_arena(&watch.arena, 65536);
+    init_arena(&watch.scratch, 65536);
+
+    PathList inputs;
+
+    if (expand_inputs(&inputs, &watch.arena, options -> file_paths, options -> file_count) == -1) {
+        return -1;
+    }
+
+    // directories on the command line take in every source that appears below them
+    for (u32 i = 0; i < options -> file_count; i++) {
+        struct stat st;
+
+        if (stat(options -> file_paths[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            watch_tree(&watch, options -> file_paths[i], true, false);
+        }
+    }
+
+    for (u32 i = 0; i < inputs.count; i++) {
+        if (strcmp(inputs.items[i], FILE_STDIN_PATH) == 0) {
+            fprintf(stderr, "Error: stdin cannot be watched\n");
+            return -1;
+        }
+
+        if (add_file(&watch, inputs.items[i]) == -1) {
+            return -1;
+        }
+    }
+
+    if (watch.count == 0) {
+        fprintf(stderr, "Error: No source files to watch\n");
+        return -1;
+    }
+
+    fprintf(stderr, "mythril: watching %u files in %u directories\n", watch.count, watch.dir_count);
+
+    rebuild(&watch);
+
+    struct pollfd pfd = {
+        .fd = watch.fd,
+        .events = POLLIN,
+        .revents = 0
+    };
+
+    while (true) {
+        if (poll(&pfd, 1, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, "Error: Failed to wait for changes: %s\n", strerror(errno));
+            return -1;
+        }
+
+        read_events(&watch);
+
+        // the rest of the save, an editor writes, renames and deletes in a burst
+        while (poll(&pfd, 1, WATCH_SETTLE_MS) > 0) {
+            read_events(&watch);
+        }
+
+        rebuild(&watch);
+    }
+}
+
+/*
+*
+*   one watch per directory, inotify hands out the same wd for another
+*   path to it. A directory seen again only ever gains adopt. Returns
+*   the path it was first watched by, the one its events are joined to,
+*   or nullptr
+*
+*/
+static const char* watch_directory(Watch* watch, const char* path, b8 adopt) {
+    const i32 wd = inotify_add_watch(watch -> fd, path, WATCH_DIR_EVENTS);
+
+    if (wd == -1) {
+        fprintf(stderr, "Error: Failed to watch directory '%s': %s\n", path, strerror(errno));
+        return nullptr;
+    }
+
+    for (u32 i = 0; i < watch -> dir_count; i++) {
+        if (watch -> dirs[i].wd == wd) {
+            watch -> dirs[i].adopt |= adopt;
+            return watch -> dirs[i].path;
+        }
+    }
+
+    if (watch -> dir_count == watch -> dir_capacity) {
+        const u32 capacity = watch -> dir_capacity > 0 ? watch -> dir_capacity * 2 : WATCH_INIT_CAPACITY;
+
+        watch -> dirs = watch -> dirs
+            ? arena_realloc(&watch -> arena, watch -> dirs, watch -> dir_capacity * sizeof(WatchDir), capacity * sizeof(WatchDir))
+            : arena_array(&watch -> arena, WatchDir, capacity);
+
+        watch -> dir_capacity = capacity;
+    }
+
+    // without a trailing slash, names of events are joined with one
+    usize len = strlen(path);
+
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+
+    char* copy = arena_alloc(&watch -> arena, (len + 1 + 7) & ~(usize) 7);
+    memcpy(copy, path, len);
+    copy[len] = 0;
+
+    watch -> dirs[watch -> dir_count++] = (WatchDir) {
+        .wd = wd,
+        .adopt = adopt,
+        .path = copy
+    };
+
+    return copy;
+}
+
+// path and every directory below it, hidden ones skipped like the loader does
+static void watch_tree(Watch* watch, const char* path, b8 adopt, b8 take_sources) {
+    if (!watch_directory(watch, path, adopt)) {
+        return;
+    }
+
+    DIR* dir = opendir(path);
+
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* entry;
+
+    while ((entry = readdir(dir))) {
+        if (entry -> d_name[0] == '.') {
+            continue;
+        }
+
+        char full[PATH_MAX];
+
+        if (snprintf(full, sizeof(full), "%s/%s", path, entry -> d_name) >= (i32) sizeof(full)) {
+            continue;
+        }
+
+        struct stat st;
+
+        if (stat(full, &st) == -1) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            watch_tree(watch, full, adopt, take_sources);
+        } else if (take_sources && is_source(entry -> d_name)) {
+            // written before the watch was up, no event will tell of it
+            add_file(watch, full);
+        }
+    }
+
+    closedir(dir);
+}
+
+/*
+*
+*   a new unit for path, or the one it had before it went away. Either
+*   way it is compiled on the next rebuild, its directory is watched
+*
+*/
+static i32 add_file(Watch* watch, const char* path) {
+    const usize len = strlen(path);
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+
+    char parent[PATH_MAX];
+
+    if (!slash) {
+        snprintf(parent, sizeof(parent), ".");
+    } else if (slash == path) {
+        snprintf(parent, sizeof(parent), "/");
+    } else {
+        snprintf(parent, sizeof(parent), "%.*s", (i32) (slash - path), path);
+    }
+
+    // "a.myth", "./a.myth" and "src/../a.myth" are all one file to the events
+    const char* dir = watch_directory(watch, parent, false);
+
+    if (!dir) {
+        return -1;
+    }
+
+    const i32 found = find_file(watch, dir, name);
+
+    if (found != -1) {
+        watch -> files[found].live = true;
+        watch -> files[found].dirty = true;
+        return found;
+    }
+
+    if (watch -> count >= UNIT_MAX_COUNT) {
+        fprintf(stderr, "Error: Too many files, at most %u can be watched at once\n", UNIT_MAX_COUNT);
+        return -1;
+    }
+
+    if (watch -> count == watch -> capacity) {
+        const u32 capacity = watch -> capacity > 0 ? watch -> capacity * 2 : WATCH_INIT_CAPACITY;
+
+        // units move, nothing keeps a pointer to one between rebuilds
+        watch -> units = watch -> units
+            ? arena_realloc(&watch -> arena, watch -> units, watch -> capacity * sizeof(CompilationUnit), capacity * sizeof(CompilationUnit))
+            : arena_array(&watch -> arena, CompilationUnit, capacity);
+
+        watch -> files = watch -> files
+            ? arena_realloc(&watch -> arena, watch -> files, watch -> capacity * sizeof(WatchFile), capacity * sizeof(WatchFile))
+            : arena_array(&watch -> arena, WatchFile, capacity);
+
+        watch -> capacity = capacity;
+    }
+
+    const u32 id = watch -> count++;
+
+    char* copy = arena_alloc(&watch -> arena, (len + 1 + 7) & ~(usize) 7);
+    memcpy(copy, path, len + 1);
+
+    CompilationUnit* unit = &watch -> units[id];
+
+    memset(unit, 0, sizeof(*unit));
+    unit -> id = id;
+    unit -> path = copy;
+    init_arena(&unit -> arena, UNIT_ARENA_CAPACITY);
+
+    watch -> files[id] = (WatchFile) {
+        .dir = dir,
+        .name = copy + (name - path),
+        .name_hash = hash_fnv1a(name, strlen(name)),
+        .source_hash = 0,
+        .source_len = SIZE_MAX,
+        .diag_ctx = { 0 },
+        .live = true,
+        .dirty = true
+    };
+
+    return (i32) id;
+}
+
+// dir as watch_directory() returned it, a directory watched again after it was gone has a new copy
+static i32 find_file(const Watch* watch, const char* dir, const char* name) {
+    const u64 hash = hash_fnv1a(name, strlen(name));
+
+    for (u32 i = 0; i < watch -> count; i++) {
+        const WatchFile* file = &watch -> files[i];
+
+        if (file -> name_hash == hash && strcmp(file -> name, name) == 0 && strcmp(file -> dir, dir) == 0) {
+            return (i32) i;
+        }
+    }
+
+    return -1;
+}
+
+static void read_events(Watch* watch) {
+    _Alignas(struct inotify_event) char buffer[WATCH_EVENT_BUFFER];
+
+    while (true) {
+        const ssize len = read(watch -> fd, buffer, sizeof(buffer));
+
+        if (len <= 0) {
+            return;
+        }
+
+        for (ssize offset = 0; offset < len;) {
+            const struct inotify_event* event = (const struct inotify_event*) (buffer + offset);
+
+            handle_event(watch, event);
+
+            offset += (ssize) sizeof(struct inotify_event) + event -> len;
+        }
+    }
+}
+
+static void handle_event(Watch* watch, const struct inotify_event* event) {
+    // events were lost, every file is read again and the unchanged ones are left alone
+    if (event -> mask & IN_Q_OVERFLOW) {
+        for (u32 i = 0; i < watch -> count; i++) {
+            watch -> files[i].dirty = true;
+        }
+
+        return;
+    }
+
+    WatchDir* dir = nullptr;
+
+    for (u32 i = 0; i < watch -> dir_count && !dir; i++) {
+        if (watch -> dirs[i].wd == event -> wd) {
+            dir = &watch -> dirs[i];
+        }
+    }
+
+    if (!dir) {
+        return;
+    }
+
+    // the directory is gone, its files said so one by one before
+    if (event -> mask & IN_IGNORED) {
+        *dir = watch -> dirs[--watch -> dir_count];
+        return;
+    }
+
+    if (event -> len == 0 || event -> name[0] == '.') {
+        return;
+    }
+
+    char path[PATH_MAX];
+
+    if (snprintf(path, sizeof(path), "%s/%s", dir -> path, event -> name) >= (i32) sizeof(path)) {
+        return;
+    }
+
+    if (event -> mask & IN_ISDIR) {
+        if ((event -> mask & (IN_CREATE | IN_MOVED_TO)) && dir -> adopt) {
+            watch_tree(watch, path, true, true);
+        }
+
+        return;
+    }
+
+    if (!is_source(event -> name)) {
+        return;
+    }
+
+    const i32 index = find_file(watch, dir -> path, event -> name);
+
+    if (event -> mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        if (index != -1) {
+            watch -> files[index].live = true;
+            watch -> files[index].dirty = true;
+        } else if (dir -> adopt) {
+            add_file(watch, path);
+        }
+    } else if ((event -> mask & (IN_DELETE | IN_MOVED_FROM)) && index != -1) {
+        watch -> files[index].live = false;
+        watch -> files[index].dirty = true;
+    }
+}
+
+// the dirty files compiled again, or dropped if they are gone, then the whole set reported
+static void rebuild(Watch* watch) {
+    const u64 start = trace_clock();
+
+    arena_reset(&watch -> scratch);
+
+    u32 compiled = 0;
+    u32 dropped = 0;
+
+    for (u32 i = 0; i < watch -> count; i++) {
+        WatchFile* file = &watch -> files[i];
+
+        if (!file -> dirty) {
+            continue;
+        }
+
+        file -> dirty = false;
+
+        if (!file -> live) {
+            drop_file(watch, i);
+            dropped++;
+        } else if (compile_file(watch, i)) {
+            compiled++;
+        }
+    }
+
+    if (compiled + dropped > 0) {
+        report(watch, compiled, dropped, trace_clock() - start);
+    }
+}
+
+/*
+*
+*   reads the file once more and compiles it if it changed. The new
+*   source replaces the old one on the arena of the unit, which is reset
+*   with everything that was built from the old one
+*
+*/
+static b8 compile_file(Watch* watch, u32 index) {
+    CompilationUnit* unit = &watch -> units[index];
+    WatchFile* file = &watch -> files[index];
+
+    FileBuffer fresh;
+
+    // gone again before the rebuild got to it, its delete is on the way
+    if (load_file(&fresh, &watch -> scratch, unit -> path) == -1) {
+        return false;
+    }
+
+    const usize len = fresh.len - 1;
+    const u64 hash = hash_fnv1a(fresh.ptr, len);
+
+    if (hash == file -> source_hash && len == file -> source_len) {
+        unload_file(&fresh);
+        return false;
+    }
+
+    unload_file(&unit -> buffer);
+
+    ArenaAllocator arena = unit -> arena;
+    arena_reset(&arena);
+
+    FileBuffer buffer = fresh;
+
+    // a mapped source is the units as it is, one read into scratch moves over
+    if (fresh.mapped == 0) {
+        usize capacity;
+
+        buffer.ptr = alloc_source(&arena, len, &capacity);
+        memcpy(buffer.ptr, fresh.ptr, len);
+    }
+
+    init_unit(unit, index, unit -> path, buffer, &arena);
+
+    const MythrilOptions* options = watch -> options;
+
+    file -> diag_ctx = (DiagContext) {
+        .arena = &unit -> arena,
+        .units = watch -> units,
+        .stream = nullptr,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .warning_count = 0,
+        .error_count = 0,
+        .max_errors = options -> syntax_only ? 1 : options -> max_errors,
+        .display_limit = options -> diagnostics_limit,
+        .unit_count = watch -> count,
+        .streamed = 0,
+        .hold = 0,
+        .stderr_supports_colours = false,
+        .aborted = false
+    };
+
+    lex_unit(unit, &file -> diag_ctx);
+
+    if (options -> stop_after >= STOP_AFTER_PARSE) {
+        parse_unit(unit, &file -> diag_ctx, watch -> flags);
+    }
+
+    file -> source_hash = hash;
+    file -> source_len = len;
+
+    return true;
+}
+
+// a file that went away, its unit keeps the arena for when it comes back
+static void drop_file(Watch* watch, u32 index) {
+    CompilationUnit* unit = &watch -> units[index];
+    WatchFile* file = &watch -> files[index];
+
+    unload_file(&unit -> buffer);
+    arena_reset(&unit -> arena);
+
+    unit -> tokens.count = 0;
+    unit -> program.count = 0;
+
+    file -> diag_ctx.count = 0;
+    file -> source_hash = 0;
+    file -> source_len = SIZE_MAX;
+}
+
+static void report(Watch* watch, u32 compiled, u32 dropped, u64 elapsed) {
+    const MythrilOptions* options = watch -> options;
+
+    DiagContext ctx = {
+        .arena = &watch -> scratch,
+        .units = watch -> units,
+        .stream = nullptr,
+        .items = nullptr,
+        .count = 0,
+        .capacity = 0,
+        .warning_count = 0,
+        .error_count = 0,
+        .max_errors = 0,
+        .display_limit = options -> diagnostics_limit,
+        .unit_count = watch -> count,
+        .streamed = 0,
+        .hold = 0,
+        .stderr_supports_colours = isatty(STDERR_FILENO),
+        .aborted = false
+    };
+
+    u32 live = 0;
+
+    for (u32 i = 0; i < watch -> count; i++) {
+        if (watch -> files[i].live) {
+            diagnostics_append(&ctx, &watch -> files[i].diag_ctx);
+            live++;
+        }
+    }
+
+    if (dropped > 0) {
+        fprintf(stderr, "mythril: compiled %u of %u files in %.2f ms, %u gone\n", compiled, live, elapsed / 1e6, dropped);
+    } else {
+        fprintf(stderr, "mythril: compiled %u of %u files in %.2f ms\n", compiled, live, elapsed / 1e6);
+    }
+
+    if (options -> diagnostics_format != DIAG_FORMAT_TEXT) {
+        DiagStream stream;
+
+        // one complete log per rebuild
+        init_diag_stream(&stream, &watch -> scratch, STDERR_FILENO, options -> diagnostics_format);
+        ctx.stream = &stream;
+
+        diagnostics_flush_stream(&ctx);
+        finish_diag_stream(&stream);
+    } else if (ctx.error_count > 0) {
+        diagnostics_print_all(&ctx);
+    } else {
+        printf("%s\n", stop_after_message(options -> stop_after));
+        fflush(stdout);
+    }
+}
+
+static b8 is_source(const char* name) {
+    const usize len = strlen(name);
+    const usize ext_len = sizeof(LOADER_SOURCE_EXTENSION) - 1;
+
+    return len > ext_len && strcmp(name + len - ext_len, LOADER_SOURCE_EXTENSION) == 0;
+}
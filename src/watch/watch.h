@@ -0,0 +1,22 @@
+#pragma once
+#ifndef MYTHRIL_WATCH_H
+#define MYTHRIL_WATCH_H
+
+#include "types.h"
+
+#include "../options/types.h"
+
+/*
+*
+*   compiles the files of options once, then waits on inotify and
+*   compiles again only the files that were saved, created or moved in
+*   since. Tokens, ASTs and diagnostics of every other file are kept as
+*   they are. Each rebuild reports the diagnostics of the whole set.
+*   Directories among the arguments are watched with everything below
+*   them, new sources in them join the build. Returns -1 if nothing
+*   could be watched, otherwise runs until it is killed
+*
+*/
+i32 run_watch(const MythrilOptions* options);
+
+#endif // !MYTHRIL_WATCH_H
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef MYTHRIL_WRITER_TYPES_H
+#define MYTHRIL_WRITER_TYPES_H
+
+#include "../arena/arena.h"
+#include "../utils/types.h"
+
+#define WRITER_DEFAULT_CAPACITY (1024 * 1024)
+
+// fd of a writer that only collects, see init_memory_writer()
+#define WRITER_NO_FD -1
+
+/*
+*
+*   output buffer in front of a file descriptor, everything is
+*   collected in memory and handed to write(2) in one go on flush,
+*   it only flushes early when the buffer is full. A memory writer
+*   has no fd, its buffer grows on grow instead
+*
+*/
+typedef struct {
+    char* buffer;
+    usize len;
+    usize capacity;
+
+    i32 fd;
+    u8 _padding[4];
+
+    ArenaAllocator* grow;
+} Writer;
+
+#endif // !MYTHRIL_WRITER_TYPES_H
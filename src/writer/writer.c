@@ -0,0 +1,194 @@
+#include "writer.h"
+#include "types.h"
+
+#include "../utils/macros.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static void write_all(i32 fd, const char* ptr, usize len) {
+    while (len > 0) {
+        ssize written = write(fd, ptr, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return;
+        }
+
+        ptr += written;
+        len -= written;
+    }
+}
+
+void init_writer(Writer* w, ArenaAllocator* arena, i32 fd, usize capacity) {
+    if (capacity == 0) {
+        capacity = WRITER_DEFAULT_CAPACITY;
+    }
+
+    w -> buffer = arena_alloc(arena, capacity);
+    w -> len = 0;
+    w -> capacity = capacity;
+    w -> fd = fd;
+    w -> grow = nullptr;
+}
+
+void init_memory_writer(Writer* w, ArenaAllocator* arena, usize capacity) {
+    init_writer(w, arena, WRITER_NO_FD, capacity);
+    w -> grow = arena;
+}
+
+// room for at least extra more bytes, a memory writer grows and the others flush
+static void writer_make_room(Writer* w, usize extra) {
+    if (!w -> grow) {
+        writer_flush(w);
+        return;
+    }
+
+    usize capacity = w -> capacity;
+
+    while (capacity < w -> len + extra) {
+        capacity *= 2;
+    }
+
+    w -> buffer = arena_realloc(w -> grow, w -> buffer, w -> capacity, capacity);
+    w -> capacity = capacity;
+}
+
+void writer_flush(Writer* w) {
+    if (w -> len == 0 || w -> grow) {
+        return;
+    }
+
+    write_all(w -> fd, w -> buffer, w -> len);
+    w -> len = 0;
+}
+
+void writer_write(Writer* w, const char* ptr, usize len) {
+    if (MEOW_UNLIKELY(w -> len + len > w -> capacity)) {
+        writer_make_room(w, len);
+
+        // bigger than the whole buffer, no point in copying it
+        if (len > w -> capacity - w -> len) {
+            write_all(w -> fd, ptr, len);
+            return;
+        }
+    }
+
+    memcpy(w -> buffer + w -> len, ptr, len);
+    w -> len += len;
+}
+
+void writer_str(Writer* w, const char* str) {
+    writer_write(w, str, strlen(str));
+}
+
+void writer_char(Writer* w, char c) {
+    if (MEOW_UNLIKELY(w -> len >= w -> capacity)) {
+        writer_make_room(w, 1);
+    }
+
+    w -> buffer[w -> len++] = c;
+}
+
+void writer_repeat(Writer* w, char c, usize count) {
+    while (count > 0) {
+        if (MEOW_UNLIKELY(w -> len >= w -> capacity)) {
+            writer_make_room(w, count);
+        }
+
+        usize available = w -> capacity - w -> len;
+        usize n = count < available ? count : available;
+
+        memset(w -> buffer + w -> len, c, n);
+
+        w -> len += n;
+        count -= n;
+    }
+}
+
+void writer_u64(Writer* w, u64 value) {
+    // u64 max is 20 digits, fill from the back two digits at a time
+    char digits[20];
+    char* cursor = digits + sizeof(digits);
+
+    while (value >= 100) {
+        const u64 pair = (value % 100) * 2;
+        value /= 100;
+
+        *--cursor = DIGIT_PAIRS[pair + 1];
+        *--cursor = DIGIT_PAIRS[pair];
+    }
+
+    if (value >= 10) {
+        const u64 pair = value * 2;
+
+        *--cursor = DIGIT_PAIRS[pair + 1];
+        *--cursor = DIGIT_PAIRS[pair];
+    } else {
+        *--cursor = (char) ('0' + value);
+    }
+
+    writer_write(w, cursor, digits + sizeof(digits) - cursor);
+}
+
+void writer_i64(Writer* w, i64 value) {
+    if (value < 0) {
+        writer_char(w, '-');
+        writer_u64(w, (u64) 0 - (u64) value);
+        return;
+    }
+
+    writer_u64(w, (u64) value);
+}
+
+void writer_json_string(Writer* w, const char* str, usize len) {
+    static const char HEX[] = "0123456789abcdef";
+
+    writer_char(w, '"');
+
+    usize run = 0;
+
+    for (usize i = 0; i < len; i++) {
+        const u8 c = (u8) str[i];
+
+        if (MEOW_LIKELY(c >= 0x20 && c != '"' && c != '\\')) {
+            continue;
+        }
+
+        // everything up to the escaped character goes out in one piece
+        writer_write(w, str + run, i - run);
+        run = i + 1;
+
+        switch (c) {
+            case '"':  writer_write(w, "\\\"", 2); break;
+            case '\\': writer_write(w, "\\\\", 2); break;
+            case '\n': writer_write(w, "\\n", 2); break;
+            case '\t': writer_write(w, "\\t", 2); break;
+            case '\r': writer_write(w, "\\r", 2); break;
+
+            default: {
+                const char escape[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] };
+                writer_write(w, escape, sizeof(escape));
+            } break;
+        }
+    }
+
+    writer_write(w, str + run, len - run);
+    writer_char(w, '"');
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef MYTHRIL_WRITER_H
+#define MYTHRIL_WRITER_H
+
+#include "types.h"
+
+#include "../arena/arena.h"
+
+/*
+*
+*   allocates the output buffer on the arena, capacity 0 picks 
+*   WRITER_DEFAULT_CAPACITY
+*
+*/
+void init_writer(Writer* w, ArenaAllocator* arena, i32 fd, usize capacity);
+
+/*
+*
+*   a writer that keeps everything, the buffer grows on arena and flush
+*   does nothing. What was written is buffer[0, len)
+*
+*/
+void init_memory_writer(Writer* w, ArenaAllocator* arena, usize capacity);
+
+/*
+*
+*   hands the buffered bytes to the fd, retrying short writes
+*
+*/
+void writer_flush(Writer* w);
+
+void writer_write(Writer* w, const char* ptr, usize len);
+void writer_str(Writer* w, const char* str);
+void writer_char(Writer* w, char c);
+
+/*
+*
+*   appends count copies of c, used for indentation and carets
+*
+*/
+void writer_repeat(Writer* w, char c, usize count);
+
+/*
+*
+*   decimal formatting without going through printf
+*
+*/
+void writer_u64(Writer* w, u64 value);
+void writer_i64(Writer* w, i64 value);
+
+/*
+*
+*   len bytes of str as a quoted JSON string, quotes, backslashes and
+*   control characters escaped
+*
+*/
+void writer_json_string(Writer* w, const char* str, usize len);
+
+#endif // !MYTHRIL_WRITER_H
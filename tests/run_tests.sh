@@ -48,6 +48,461 @@ for file in ./invalid/*.myth; do
     fi
 done
 
+echo -e "\nTesting --stop-after and -ftime-report"
+
+STOP_DIR=$(mktemp -d)
+
+# lexes cleanly, fails to parse
+echo "fn main(): void { let x: i32 = ; }" > "$STOP_DIR/parse_error.myth"
+
+# phase, input, expected exit code, expected success line or nothing
+stop_after_case() {
+    echo -n "Testing --stop-after=$1 on $(basename "$2")..."
+
+    $COMPILER --stop-after=$1 "$2" > "$STOP_DIR/out.txt" 2> /dev/null
+    exit_code=$?
+
+    if [ -n "$4" ]; then
+        grep -qx "$4" "$STOP_DIR/out.txt"
+    else
+        ! grep -q "successfully" "$STOP_DIR/out.txt"
+    fi
+
+    if [ $? -eq 0 ] && [ $exit_code -eq $3 ]; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+}
+
+stop_after_case lex ./valid/statements.myth 0 "lexed successfully"
+stop_after_case parse ./valid/statements.myth 0 "parsed successfully"
+stop_after_case lex "$STOP_DIR/parse_error.myth" 0 "lexed successfully"
+stop_after_case parse "$STOP_DIR/parse_error.myth" 1 ""
+stop_after_case bogus ./valid/statements.myth 1 ""
+
+# a title, the column header, one row per phase that ran and the total
+TIME_ROW='[0-9]+\.[0-9]{3} +[0-9]+\.[0-9]{3} +[0-9]+ +[0-9]+ +[0-9.]+ MB/s'
+
+time_report_case() {
+    echo -n "Testing -ftime-report${1:+ $1}..."
+
+    $COMPILER -ftime-report $1 ./valid/statements.myth > "$STOP_DIR/out.txt" 2> "$STOP_DIR/report.txt"
+    exit_code=$?
+
+    if [ $exit_code -eq 0 ] &&
+        grep -qx "$2" "$STOP_DIR/out.txt" &&
+        grep -qx "time report" "$STOP_DIR/report.txt" &&
+        grep -Eqx "  phase +wall ms +cpu ms +bytes +arena +throughput" "$STOP_DIR/report.txt" &&
+        [ "$(grep -Ec "^  (load|lex|parse) +$TIME_ROW" "$STOP_DIR/report.txt")" -eq $3 ] &&
+        grep -Eqx "  total +[0-9]+\.[0-9]{3} +[0-9]+\.[0-9]{3} +[0-9]+" "$STOP_DIR/report.txt"; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+}
+
+time_report_case "" "compiled successfully" 3
+time_report_case "--stop-after=lex" "lexed successfully" 2
+
+rm -rf "$STOP_DIR"
+
+echo -e "\nTesting --trace"
+
+TRACE_FILE=$(mktemp)
+
+echo -n "Testing --trace writes a Chrome trace..."
+
+$COMPILER --trace="$TRACE_FILE" --jobs=2 ./valid/statements.myth ./valid/struct.myth > /dev/null 2>&1
+exit_code=$?
+
+# complete events carry a start and a duration, every file was tokenized
+python3 - "$TRACE_FILE" << 'EOF'
+import json, sys
+
+with open(sys.argv[1]) as f:
+    trace = json.load(f)
+
+events = trace["traceEvents"]
+spans = [e for e in events if e["ph"] == "X"]
+
+assert spans and all(e["ts"] >= 0 and e["dur"] >= 0 for e in spans)
+assert {e["args"]["file"] for e in spans if e["name"] == "tokenize"} == {"./valid/statements.myth", "./valid/struct.myth"}
+assert any(e["name"] == "parse" for e in spans)
+EOF
+
+if [ $? -eq 0 ] && [ $exit_code -eq 0 ]; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+rm -f "$TRACE_FILE"
+
+echo -e "\nTesting diagnostic formats"
+
+# what editors and CI read has to stay byte for byte the same
+FORMAT_OUT=$(mktemp)
+
+for format in json sarif; do
+    echo -n "Testing --diagnostics-format=$format..."
+
+    $COMPILER --diagnostics-format=$format ./invalid/cascade.myth 2> "$FORMAT_OUT" > /dev/null
+    exit_code=$?
+
+    if [ $exit_code -eq 1 ] && cmp -s "$FORMAT_OUT" "./golden/cascade.$format"; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+done
+
+rm -f "$FORMAT_OUT"
+
+echo -e "\nTesting parallel parsing"
+
+# enough declarations to be split across workers, every 97th one broken
+PARALLEL_DIR=$(mktemp -d)
+PARALLEL_INPUT="$PARALLEL_DIR/many.myth"
+
+for i in $(seq 2000); do
+    if [ $((i % 97)) -eq 13 ]; then
+        echo "fn f$i(): i32 { let x: i32 = ; return x; }"
+    else
+        echo "fn f$i(): i32 { let x: i32 = $i + 2 * 3; return x; }"
+    fi
+done > "$PARALLEL_INPUT"
+
+echo "fn main(): void { }" >> "$PARALLEL_INPUT"
+
+# the same declarations and diagnostics in the same order either way
+echo -n "Testing --jobs=8 against --jobs=1..."
+
+$COMPILER --jobs=1 --emit=ast "$PARALLEL_INPUT" > "$PARALLEL_DIR/one.txt" 2>&1
+$COMPILER --jobs=8 --emit=ast "$PARALLEL_INPUT" > "$PARALLEL_DIR/eight.txt" 2>&1
+
+if cmp -s "$PARALLEL_DIR/one.txt" "$PARALLEL_DIR/eight.txt" && grep -q "^error" "$PARALLEL_DIR/one.txt"; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+# one pass and eight workers have to stop at the same error
+for budget in 1 5 21; do
+    echo -n "Testing --jobs=8 --max-errors=$budget against --jobs=1..."
+
+    $COMPILER --jobs=1 --max-errors=$budget --emit=ast "$PARALLEL_INPUT" > "$PARALLEL_DIR/one.txt" 2>&1
+    $COMPILER --jobs=8 --max-errors=$budget --emit=ast "$PARALLEL_INPUT" > "$PARALLEL_DIR/eight.txt" 2>&1
+
+    if cmp -s "$PARALLEL_DIR/one.txt" "$PARALLEL_DIR/eight.txt"; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+done
+
+# the broken bodies are skipped unparsed, only the declarations are left
+echo -n "Testing --outline skips function bodies..."
+
+$COMPILER --jobs=8 --outline --emit=ast "$PARALLEL_INPUT" > "$PARALLEL_DIR/outline.txt" 2>&1
+exit_code=$?
+
+if [ $exit_code -eq 0 ] && ! grep -q "^error" "$PARALLEL_DIR/outline.txt" && [ "$(grep -c "^ *\.\.\.$" "$PARALLEL_DIR/outline.txt")" -eq 2001 ]; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+rm -rf "$PARALLEL_DIR"
+
+echo -e "\nTesting the compile server"
+
+# clients that arrive together are queued and served one after another,
+# each gets its own output and exit code back
+SERVER_DIR=$(mktemp -d)
+SOCKET="$SERVER_DIR/mythril.sock"
+CLIENTS=8
+CLIENT_PIDS=()
+
+$COMPILER --server="$SOCKET" 2> "$SERVER_DIR/server.log" &
+SERVER_PID=$!
+
+for _ in $(seq 50); do
+    [ -S "$SOCKET" ] && break
+    sleep 0.1
+done
+
+for i in $(seq $CLIENTS); do
+    if [ $((i % 2)) -eq 0 ]; then
+        file=./valid/statements.myth
+    else
+        file=./invalid/cascade.myth
+    fi
+
+    (
+        MYTHRIL_SERVER="$SOCKET" $COMPILER "$file" > "$SERVER_DIR/$i.out" 2>&1
+        echo $? > "$SERVER_DIR/$i.code"
+    ) &
+
+    CLIENT_PIDS+=($!)
+done
+
+wait "${CLIENT_PIDS[@]}"
+
+kill -TERM $SERVER_PID
+wait $SERVER_PID
+
+for i in $(seq $CLIENTS); do
+    echo -n "Testing client $i..."
+
+    exit_code=$(cat "$SERVER_DIR/$i.code")
+    successes=$(grep -c "compiled successfully" "$SERVER_DIR/$i.out")
+
+    if [ $((i % 2)) -eq 0 ]; then
+        expected_code=0
+        expected_successes=1
+    else
+        expected_code=1
+        expected_successes=0
+    fi
+
+    if [ "$exit_code" -eq $expected_code ] && [ "$successes" -eq $expected_successes ]; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+done
+
+echo -n "Testing every client reached the server..."
+
+if grep -q "served $CLIENTS requests" "$SERVER_DIR/server.log"; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+rm -rf "$SERVER_DIR"
+
+echo -e "\nTesting the watcher"
+
+# a file named without a directory, its events arrive joined to "."
+WATCH_DIR=$(mktemp -d)
+cp ./valid/statements.myth "$WATCH_DIR/main.myth"
+
+COMPILER_PATH=$(realpath "$COMPILER")
+
+(cd "$WATCH_DIR" && exec "$COMPILER_PATH" --watch main.myth > out.log 2> err.log) &
+WATCH_PID=$!
+
+wait_for_builds() {
+    for _ in $(seq 50); do
+        [ "$(grep -c "compiled 1 of 1 files" "$WATCH_DIR/err.log" 2> /dev/null)" -ge "$1" ] && return 0
+        sleep 0.1
+    done
+
+    return 1
+}
+
+echo -n "Testing a bare filename is compiled again when saved..."
+
+if wait_for_builds 1 && cp ./invalid/cascade.myth "$WATCH_DIR/main.myth" && wait_for_builds 2 && grep -q "^error" "$WATCH_DIR/err.log"; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+kill $WATCH_PID
+wait $WATCH_PID 2> /dev/null
+
+rm -rf "$WATCH_DIR"
+
+echo -e "\nTesting incremental reparsing"
+
+# edits reach document_edit() through the language server, the byte counts
+# in the headers need the length in bytes
+export LC_ALL=C
+
+LSP_DIR=$(mktemp -d)
+
+lsp_send() {
+    printf 'Content-Length: %d\r\n\r\n%s' "${#1}" "$1"
+}
+
+lsp_open() {
+    lsp_send '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"'"$1"'","languageId":"mythril","version":1,"text":"'"$2"'"}}}'
+}
+
+lsp_begin() {
+    lsp_send '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{"capabilities":{"general":{"positionEncodings":["utf-8"]}}}}'
+    lsp_send '{"jsonrpc":"2.0","method":"initialized","params":{}}'
+}
+
+lsp_end() {
+    lsp_send '{"jsonrpc":"2.0","id":99,"method":"shutdown"}'
+    lsp_send '{"jsonrpc":"2.0","method":"exit"}'
+}
+
+# one message per line, bodies never hold a raw newline
+lsp_split() {
+    tr -d '\r' | sed 's/Content-Length: [0-9]*/\n/g' | grep .
+}
+
+# the last diagnostics and the symbols of uri, with uri and id taken out
+lsp_state() {
+    grep "publishDiagnostics.*\"uri\":\"$2\"" "$1" | tail -1 | sed "s|$2||"
+    grep "\"id\":$3," "$1" | sed "s/\"id\":$3,//"
+}
+
+# a document that was opened and edited has to end up with the same
+# diagnostics and symbols as one opened with the text the edits leave
+lsp_compare() {
+    echo -n "Testing $1 against a full parse..."
+
+    {
+        lsp_begin
+        lsp_open "file:///edited.myth" "$2"
+        lsp_send '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///edited.myth","version":2},"contentChanges":['"$3"']}}'
+        lsp_open "file:///fresh.myth" "$4"
+        lsp_send '{"jsonrpc":"2.0","id":2,"method":"textDocument/documentSymbol","params":{"textDocument":{"uri":"file:///edited.myth"}}}'
+        lsp_send '{"jsonrpc":"2.0","id":3,"method":"textDocument/documentSymbol","params":{"textDocument":{"uri":"file:///fresh.myth"}}}'
+        lsp_end
+    } | $COMPILER --lsp 2> /dev/null | lsp_split > "$LSP_DIR/session.txt"
+
+    lsp_state "$LSP_DIR/session.txt" "file:///edited.myth" 2 > "$LSP_DIR/edited.txt"
+    lsp_state "$LSP_DIR/session.txt" "file:///fresh.myth" 3 > "$LSP_DIR/fresh.txt"
+
+    if [ "$(wc -l < "$LSP_DIR/fresh.txt")" -eq 2 ] && grep -q "\"diagnostics\":$5" "$LSP_DIR/fresh.txt" && cmp -s "$LSP_DIR/edited.txt" "$LSP_DIR/fresh.txt"; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+}
+
+LSP_TEXT='struct Point {\n    x: i32;\n    y: i32;\n}\n\nfn add(a: i32, b: i32): i32 {\n    let c: i32 = a + b;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = add(1, 2);\n}\n'
+
+lsp_compare "an insert and a delete inside one declaration" "$LSP_TEXT" \
+    '{"range":{"start":{"line":7,"character":4},"end":{"line":7,"character":4}},"text":"let d: i32 = c * 2;\n    "},{"range":{"start":{"line":6,"character":17},"end":{"line":6,"character":21}},"text":""}' \
+    'struct Point {\n    x: i32;\n    y: i32;\n}\n\nfn add(a: i32, b: i32): i32 {\n    let c: i32 = b;\n    let d: i32 = c * 2;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = add(1, 2);\n}\n' \
+    '\[\]'
+
+lsp_compare "an edit across two declarations" "$LSP_TEXT" \
+    '{"range":{"start":{"line":2,"character":4},"end":{"line":6,"character":17}},"text":"z: i32;\n}\n\nfn sub(a: i32, b: i32): i32 {\n    let c: i32 = "}' \
+    'struct Point {\n    x: i32;\n    z: i32;\n}\n\nfn sub(a: i32, b: i32): i32 {\n    let c: i32 = a + b;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = add(1, 2);\n}\n' \
+    '\[\]'
+
+# the declaration reported before has to be parsed whole again
+lsp_compare "an edit in a declaration with diagnostics" \
+    'fn add(a: i32, b: i32): i32 {\n    let c: i32 = ;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = add(1, 2);\n}\n' \
+    '{"range":{"start":{"line":2,"character":4},"end":{"line":2,"character":4}},"text":"let d: i32 = 1;\n    "}' \
+    'fn add(a: i32, b: i32): i32 {\n    let c: i32 = ;\n    let d: i32 = 1;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = add(1, 2);\n}\n' \
+    '\[{"range"'
+
+# only the edited declaration is parsed again, what main reported moves down a line
+lsp_compare "an edit before a declaration with diagnostics" \
+    'fn add(a: i32, b: i32): i32 {\n    let c: i32 = a + b;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = ;\n}\n' \
+    '{"range":{"start":{"line":2,"character":4},"end":{"line":2,"character":4}},"text":"let d: i32 = 1;\n    "}' \
+    'fn add(a: i32, b: i32): i32 {\n    let c: i32 = a + b;\n    let d: i32 = 1;\n    return c;\n}\n\nfn main(): void {\n    let p: i32 = ;\n}\n' \
+    '\[{"range":{"start":{"line":7,'
+
+echo -e "\nTesting the language server"
+
+# a whole session, every response is compared as the exact JSON sent
+LSP_URI="file:///main.myth"
+
+lsp_change() {
+    lsp_send '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"'"$LSP_URI"'","version":'"$1"'},"contentChanges":['"$2"']}}'
+}
+
+lsp_request() {
+    lsp_send '{"jsonrpc":"2.0","id":'"$1"',"method":"textDocument/'"$2"'","params":{"textDocument":{"uri":"'"$LSP_URI"'"}'"$3"'}}'
+}
+
+{
+    lsp_begin
+    lsp_open "$LSP_URI" "$LSP_TEXT"
+
+    # takes the call out of main, then puts it back and adds a line above add
+    lsp_change 2 '{"range":{"start":{"line":11,"character":17},"end":{"line":11,"character":26}},"text":""}'
+    lsp_change 3 '{"range":{"start":{"line":11,"character":17},"end":{"line":11,"character":17}},"text":"add(1, 2)"},{"range":{"start":{"line":4,"character":0},"end":{"line":4,"character":0}},"text":"\n"}'
+
+    lsp_request 2 documentSymbol
+    lsp_request 3 definition ',"position":{"line":8,"character":11}'
+    lsp_request 4 definition ',"position":{"line":12,"character":18}'
+    lsp_end
+} | $COMPILER --lsp 2> /dev/null | lsp_split > "$LSP_DIR/session.txt"
+
+LSP_EXIT=${PIPESTATUS[1]}
+
+LSP_NO_DIAGNOSTICS='{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///main.myth","diagnostics":[]}}'
+
+# the nth message of the session has to be exactly expected
+lsp_expect() {
+    echo -n "Testing $1..."
+
+    if [ "$(sed -n "$2p" "$LSP_DIR/session.txt")" = "$3" ]; then
+        echo -e "${GREEN}Passed${RESET}"
+        ((PASSED++))
+    else
+        echo -e "${RED}Failed${RESET}"
+        ((FAILED++))
+    fi
+}
+
+lsp_expect "initialize" 1 \
+    '{"jsonrpc":"2.0","id":1,"result":{"capabilities":{"positionEncoding":"utf-8","textDocumentSync":{"openClose":true,"change":2},"documentSymbolProvider":true,"hoverProvider":true,"definitionProvider":true},"serverInfo":{"name":"mythril"}}}'
+
+lsp_expect "didOpen publishes no diagnostics" 2 "$LSP_NO_DIAGNOSTICS"
+
+lsp_expect "an incremental didChange publishes the new error" 3 \
+    '{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///main.myth","diagnostics":[{"range":{"start":{"line":11,"character":16},"end":{"line":11,"character":17}},"severity":1,"source":"mythril","message":"expected an expression\nhelp: add an expression"}]}}'
+
+lsp_expect "two changes in one didChange clear it" 4 "$LSP_NO_DIAGNOSTICS"
+
+lsp_expect "documentSymbol after the edits" 5 \
+    '{"jsonrpc":"2.0","id":2,"result":[{"name":"Point","kind":23,"range":{"start":{"line":0,"character":0},"end":{"line":3,"character":1}},"selectionRange":{"start":{"line":0,"character":7},"end":{"line":0,"character":12}},"children":[{"name":"x","kind":8,"range":{"start":{"line":1,"character":4},"end":{"line":1,"character":5}},"selectionRange":{"start":{"line":1,"character":4},"end":{"line":1,"character":5}}},{"name":"y","kind":8,"range":{"start":{"line":2,"character":4},"end":{"line":2,"character":5}},"selectionRange":{"start":{"line":2,"character":4},"end":{"line":2,"character":5}}}]},{"name":"add","kind":12,"range":{"start":{"line":6,"character":0},"end":{"line":9,"character":1}},"selectionRange":{"start":{"line":6,"character":3},"end":{"line":6,"character":6}},"children":[]},{"name":"main","kind":12,"range":{"start":{"line":11,"character":0},"end":{"line":13,"character":1}},"selectionRange":{"start":{"line":11,"character":3},"end":{"line":11,"character":7}},"children":[]}]}'
+
+lsp_expect "definition of a local" 6 \
+    '{"jsonrpc":"2.0","id":3,"result":{"uri":"file:///main.myth","range":{"start":{"line":7,"character":8},"end":{"line":7,"character":9}}}}'
+
+lsp_expect "definition of a function" 7 \
+    '{"jsonrpc":"2.0","id":4,"result":{"uri":"file:///main.myth","range":{"start":{"line":6,"character":3},"end":{"line":6,"character":6}}}}'
+
+lsp_expect "shutdown" 8 '{"jsonrpc":"2.0","id":99,"result":null}'
+
+echo -n "Testing exit after shutdown..."
+
+if [ "$LSP_EXIT" -eq 0 ] && [ "$(wc -l < "$LSP_DIR/session.txt")" -eq 8 ]; then
+    echo -e "${GREEN}Passed${RESET}"
+    ((PASSED++))
+else
+    echo -e "${RED}Failed${RESET}"
+    ((FAILED++))
+fi
+
+rm -rf "$LSP_DIR"
+
 echo -e "\n=== Test Summary ===\n"
 echo "Passed: $PASSED"
 echo "Failed: $FAILED"